@@ -128,4 +128,7 @@ void loop() {
     player.playChunked(greenhill_chunks, greenhill_chunk_sizes,
                        GREENHILL_NUM_CHUNKS, GREENHILL_TOTAL_LEN);
   }
+
+  // Optional: rest the CPU until the next write is due (battery boards)
+  player.sleepUntilDue();
 }
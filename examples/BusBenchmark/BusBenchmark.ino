@@ -0,0 +1,517 @@
+/**
+ * BusBenchmark - Bus Throughput and Timing Calibration
+ *
+ * Measures how many chip writes per second this board gets through
+ * GenesisBoard, and helps find the shortest bus timing that still works.
+ *
+ * Benchmark ('b') - sustained writes per second for:
+ * - YM2612 single writes (writeYM2612)
+ * - YM2612 batch writes (writeYM2612Batch, 32 registers per burst)
+ * - PSG single writes (writePSG)
+ * - PSG batch writes (writePSGBatch, 32 bytes per burst)
+ * - DAC stream writes (writeDAC with the DAC address latched)
+ * All of them go to registers that make no sound (keyed-off channels,
+ * PSG at full attenuation, DAC output disabled).
+ *
+ * Calibration ('c') - the board has no read line from the chips, so bad
+ * writes can't be read back. Instead each bus timing value is stepped down
+ * one microsecond at a time, and at every step a test pattern plays twice:
+ * first at the default timing, then at the new one. Answer 'y' if both
+ * sounded the same, 'n' if the second had missing or wrong notes or a
+ * different tone, 'r' to hear them again. The chips are reset at the
+ * default timing after every pattern, so a bad value can't leave a note
+ * hanging.
+ *
+ * Serial Commands (115200 baud):
+ *   b         - Run the benchmark with the current timing
+ *   c         - Calibrate the timing by ear
+ *   t         - Show the current timing
+ *   y<us>     - Set the YM2612 busy wait
+ *   h<us>     - Set the YM2612 busy wait after 0xA0-0xB6
+ *   s<us>     - Set the YM2612 data setup time
+ *   p<us>     - Set the PSG write pulse width
+ *   g<us>     - Set the PSG busy wait
+ *   d         - Back to the default timing
+ *   ?         - Show help
+ *
+ * Wiring: Match your GenesisEngine board connections
+ */
+
+#include <GenesisBoard.h>
+#include <synth/FMPatch.h>
+#include <synth/FMFrequency.h>
+#include <synth/PSGFrequency.h>
+#include <synth/DefaultPatches.h>
+
+// Pin configuration - platform specific
+#ifdef ARDUINO_ARCH_ESP32
+  const uint8_t PIN_WR_P = 16;  // WR_P - SN76489 (PSG) write strobe
+  const uint8_t PIN_WR_Y = 17;  // WR_Y - YM2612 write strobe
+  const uint8_t PIN_IC_Y = 25;  // IC_Y - YM2612 reset
+  const uint8_t PIN_A0_Y = 26;  // A0_Y - YM2612 address bit 0
+  const uint8_t PIN_A1_Y = 27;  // A1_Y - YM2612 address bit 1 (port select)
+  const uint8_t PIN_SCK  = 18;  // SCK  - Hardware SPI (fixed on ESP32)
+  const uint8_t PIN_SDI  = 23;  // SDI  - Hardware SPI (fixed on ESP32)
+#else
+  // Teensy / Arduino defaults
+  const uint8_t PIN_WR_P = 2;   // WR_P - SN76489 (PSG) write strobe
+  const uint8_t PIN_WR_Y = 3;   // WR_Y - YM2612 write strobe
+  const uint8_t PIN_IC_Y = 4;   // IC_Y - YM2612 reset
+  const uint8_t PIN_A0_Y = 5;   // A0_Y - YM2612 address bit 0
+  const uint8_t PIN_A1_Y = 6;   // A1_Y - YM2612 address bit 1 (port select)
+  const uint8_t PIN_SCK  = 13;  // SCK  - Shift register clock (ignored w/ HW SPI)
+  const uint8_t PIN_SDI  = 11;  // SDI  - Shift register data (ignored w/ HW SPI)
+#endif
+
+GenesisBoard board(PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y, PIN_SCK, PIN_SDI);
+
+// Board revisions with YM2612 status read-back: RD_Y and the D7 input
+// REQUIRED: a 4.7k resistor in series between the shift register and the
+// YM2612's D7, with PIN_BUSY on the YM2612 side (the shift register drives
+// D7 during the read). Teensy 4.x/3.6 and ESP32: divide PIN_BUSY down to
+// 3.3V (10k from D7, 20k to ground). See README.md.
+// const uint8_t PIN_RD_Y = 7;
+// const uint8_t PIN_BUSY = 8;
+// GenesisBoard board(PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y, PIN_SCK, PIN_SDI,
+//                    PIN_RD_Y, PIN_BUSY);
+
+// Board revisions with D0-D7 wired to GPIOs (Mega PORTA shown)
+// const uint8_t PIN_DATA[8] = { 22, 23, 24, 25, 26, 27, 28, 29 };
+// GenesisBoard board(PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y, PIN_DATA);
+
+// Writes timed per test
+const uint16_t BENCH_WRITES = 4096;
+const uint8_t BATCH_SIZE = 32;
+
+// Bus timing fields, in GenesisBoard::BusTiming order
+const uint8_t TIMING_FIELDS = 5;
+enum { YM_BUSY, YM_CHANNEL_BUSY, YM_SETUP, PSG_PULSE, PSG_BUSY };
+
+// Notes of the calibration patterns
+const uint8_t PATTERN_NOTES[] = { 60, 64, 67, 72, 67, 64, 60 };
+const uint8_t PATTERN_LENGTH = sizeof(PATTERN_NOTES);
+
+// Serial input buffer
+char inputBuffer[16];
+uint8_t inputPos = 0;
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial && millis() < 3000) {
+        // Wait for serial connection (with timeout for non-USB boards)
+    }
+
+    board.begin();
+    board.reset();
+
+    Serial.println(F("BusBenchmark - GenesisEngine Bus Throughput"));
+    Serial.print(F("Platform: "));
+    Serial.println(F(PLATFORM_NAME));
+    Serial.print(F("Data bus: "));
+    if (board.hasParallelBus()) {
+        Serial.println(F("parallel D0-D7"));
+    } else {
+        Serial.println(board.usesHardwareSPI() ? F("shift register, hardware SPI")
+                                               : F("shift register, bit-banged"));
+    }
+    Serial.print(F("YM2612 busy: "));
+    Serial.println(board.hasBusyReadback() ? F("status read-back") : F("timed"));
+    printTiming();
+    Serial.println(F("Commands: b c t y<us> h<us> s<us> p<us> g<us> d ?"));
+    Serial.print(F("> "));
+}
+
+void loop() {
+    while (Serial.available()) {
+        char c = Serial.read();
+
+        // Handle line ending - process command
+        if (c == '\n' || c == '\r') {
+            Serial.println();  // Echo newline
+            if (inputPos > 0) {
+                inputBuffer[inputPos] = '\0';
+                processCommand(inputBuffer);
+                inputPos = 0;
+            }
+            Serial.print(F("> "));  // Prompt for next command
+        }
+        // Handle backspace
+        else if (c == '\b' || c == 127) {
+            if (inputPos > 0) {
+                inputPos--;
+                Serial.print(F("\b \b"));  // Erase character on screen
+            }
+        }
+        // Add to buffer if room
+        else if (inputPos < sizeof(inputBuffer) - 1) {
+            inputBuffer[inputPos++] = c;
+            Serial.print(c);  // Echo character
+        }
+    }
+}
+
+void processCommand(const char* cmd) {
+    char command = cmd[0];
+    const char* arg = &cmd[1];
+
+    switch (command) {
+        case 'b':
+            runBenchmark();
+            break;
+
+        case 'c':
+            calibrate();
+            break;
+
+        case 't':
+            printTiming();
+            break;
+
+        case 'y':
+            setTimingField(YM_BUSY, arg);
+            break;
+
+        case 'h':
+            setTimingField(YM_CHANNEL_BUSY, arg);
+            break;
+
+        case 's':
+            setTimingField(YM_SETUP, arg);
+            break;
+
+        case 'p':
+            setTimingField(PSG_PULSE, arg);
+            break;
+
+        case 'g':
+            setTimingField(PSG_BUSY, arg);
+            break;
+
+        case 'd':
+            board.setBusTiming(GenesisBoard::defaultBusTiming());
+            printTiming();
+            break;
+
+        case '?':
+            printHelp();
+            break;
+
+        default:
+            Serial.print(F("Unknown command: "));
+            Serial.println(cmd);
+            break;
+    }
+}
+
+// =============================================================================
+// Bus Timing
+// =============================================================================
+
+uint8_t* timingField(GenesisBoard::BusTiming& timing, uint8_t field) {
+    switch (field) {
+        case YM_BUSY:         return &timing.ymBusyUs;
+        case YM_CHANNEL_BUSY: return &timing.ymChannelBusyUs;
+        case YM_SETUP:        return &timing.ymSetupUs;
+        case PSG_PULSE:       return &timing.psgPulseUs;
+        default:              return &timing.psgBusyUs;
+    }
+}
+
+void printFieldName(uint8_t field) {
+    switch (field) {
+        case YM_BUSY:         Serial.print(F("YM2612 busy wait")); break;
+        case YM_CHANNEL_BUSY: Serial.print(F("YM2612 busy wait (0xA0-0xB6)")); break;
+        case YM_SETUP:        Serial.print(F("YM2612 data setup")); break;
+        case PSG_PULSE:       Serial.print(F("PSG write pulse")); break;
+        default:              Serial.print(F("PSG busy wait")); break;
+    }
+}
+
+// Build flag that makes a value the default
+void printFieldFlag(uint8_t field) {
+    switch (field) {
+        case YM_BUSY:         Serial.print(F("-DGENESIS_ENGINE_YM_BUSY_US=")); break;
+        case YM_CHANNEL_BUSY: Serial.print(F("-DGENESIS_ENGINE_YM_CHANNEL_BUSY_US=")); break;
+        case YM_SETUP:        Serial.print(F("-DGENESIS_ENGINE_YM_SETUP_US=")); break;
+        case PSG_PULSE:       Serial.print(F("-DGENESIS_ENGINE_PSG_PULSE_US=")); break;
+        default:              Serial.print(F("-DGENESIS_ENGINE_PSG_BUSY_US=")); break;
+    }
+}
+
+void printTiming() {
+    GenesisBoard::BusTiming timing = board.getBusTiming();
+    GenesisBoard::BusTiming defaults = GenesisBoard::defaultBusTiming();
+
+    Serial.println(F("Bus timing:"));
+    for (uint8_t field = 0; field < TIMING_FIELDS; field++) {
+        Serial.print(F("  "));
+        printFieldName(field);
+        Serial.print(F(": "));
+        Serial.print(*timingField(timing, field));
+        Serial.print(F(" us (default "));
+        Serial.print(*timingField(defaults, field));
+        Serial.println(F(")"));
+    }
+}
+
+void setTimingField(uint8_t field, const char* arg) {
+    if (arg[0] == '\0') {
+        printTiming();
+        return;
+    }
+    int value = atoi(arg);
+    if (value < 0 || value > 255) {
+        Serial.println(F("Value must be 0-255 us"));
+        return;
+    }
+
+    GenesisBoard::BusTiming timing = board.getBusTiming();
+    *timingField(timing, field) = (uint8_t)value;
+    board.setBusTiming(timing);
+    printTiming();
+}
+
+// =============================================================================
+// Benchmark
+// =============================================================================
+
+// Reset both chips and turn the DAC output off, so benchmark writes are silent
+void quietChips() {
+    board.reset();
+    board.setDACEnabled(false);
+}
+
+void printRate(const __FlashStringHelper* name, uint32_t writes, uint32_t elapsedUs) {
+    if (elapsedUs == 0) elapsedUs = 1;
+    uint32_t perSecond = (uint32_t)(((uint64_t)writes * 1000000ULL) / elapsedUs);
+
+    Serial.print(name);
+    Serial.print(perSecond);
+    Serial.print(F(" writes/sec ("));
+    Serial.print((float)elapsedUs / writes, 2);
+    Serial.println(F(" us each)"));
+}
+
+void runBenchmark() {
+    uint8_t pairs[BATCH_SIZE * 2];
+    uint8_t bytes[BATCH_SIZE];
+    const uint16_t batches = BENCH_WRITES / BATCH_SIZE;
+    uint32_t start;
+
+    printTiming();
+    Serial.println(F("Running..."));
+    quietChips();
+
+    // Values alternate on every write, so the register shadow never drops
+    // one as redundant
+    // YM2612 single: channel 0 operator 1 DT/MUL (keyed off)
+    start = micros();
+    for (uint16_t i = 0; i < BENCH_WRITES; i++) {
+        board.writeYM2612(0, 0x30, (i & 1) ? 0x01 : 0x02);
+    }
+    printRate(F("YM2612 single: "), BENCH_WRITES, micros() - start);
+
+    // YM2612 batch: DT/MUL and TL of channels 0-2 (keyed off)
+    start = micros();
+    for (uint16_t b = 0; b < batches; b++) {
+        for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+            pairs[i * 2] = 0x30 + i;
+            pairs[i * 2 + 1] = (b & 1) ? 0x01 : 0x02;
+        }
+        board.writeYM2612Batch(0, pairs, BATCH_SIZE);
+    }
+    printRate(F("YM2612 batch:  "), (uint32_t)batches * BATCH_SIZE, micros() - start);
+
+    // PSG single: tone 0 low bits (channel 0 fully attenuated)
+    start = micros();
+    for (uint16_t i = 0; i < BENCH_WRITES; i++) {
+        board.writePSG(0x80 | (i & 1));
+    }
+    printRate(F("PSG single:    "), BENCH_WRITES, micros() - start);
+
+    // PSG batch: the same tone register, 32 bytes per burst
+    for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+        bytes[i] = 0x80 | (i & 1);
+    }
+    start = micros();
+    for (uint16_t b = 0; b < batches; b++) {
+        board.writePSGBatch(bytes, BATCH_SIZE);
+    }
+    printRate(F("PSG batch:     "), (uint32_t)batches * BATCH_SIZE, micros() - start);
+
+    // DAC stream: 0x2A latched once, one data write per sample
+    board.beginDACStream();
+    start = micros();
+    for (uint16_t i = 0; i < BENCH_WRITES; i++) {
+        board.writeDAC((uint8_t)i);
+    }
+    uint32_t elapsed = micros() - start;
+    board.endDACStream();
+    printRate(F("DAC stream:    "), BENCH_WRITES, elapsed);
+    Serial.println(F("(44100 DAC writes/sec play PCM at the full VGM rate)"));
+
+    quietChips();
+}
+
+// =============================================================================
+// Calibration
+// =============================================================================
+
+// FM pattern: every note reloads a patch on channels 0 and 3 (one batch per
+// port), then sets the frequency and keys on. Alternating two patches keeps
+// the register shadow from dropping the reloads.
+void playFMPattern() {
+    FMPatch patches[2];
+    memcpy_P(&patches[0], &defaultFMPatches[0], sizeof(FMPatch));  // Bright EP
+    memcpy_P(&patches[1], &defaultFMPatches[7], sizeof(FMPatch));  // Bell
+
+    for (uint8_t i = 0; i < PATTERN_LENGTH; i++) {
+        const FMPatch& patch = patches[i & 1];
+        FMPatchUtils::loadToChannel(board, 0, patch);
+        FMPatchUtils::loadToChannel(board, 3, patch);
+        FMFrequency::writeToChannel(board, 0, PATTERN_NOTES[i]);
+        FMFrequency::writeToChannel(board, 3, PATTERN_NOTES[i] - 12);
+        FMFrequency::keyOn(board, 0);
+        FMFrequency::keyOn(board, 3);
+        delay(180);
+        FMFrequency::keyOff(board, 0);
+        FMFrequency::keyOff(board, 3);
+        delay(20);
+    }
+    delay(300);
+}
+
+// PSG pattern: the melody on tone 0 with a fifth on tone 1, then a burst of
+// noise
+void playPSGPattern() {
+    for (uint8_t i = 0; i < PATTERN_LENGTH; i++) {
+        PSGFrequency::playNote(board, 0, PATTERN_NOTES[i], 2);
+        PSGFrequency::playNote(board, 1, PATTERN_NOTES[i] + 7, 5);
+        delay(180);
+        board.silencePSG();
+        delay(20);
+    }
+    PSGFrequency::setNoise(board, true, 1);
+    PSGFrequency::setVolume(board, 3, 3);
+    delay(200);
+    board.silencePSG();
+    delay(300);
+}
+
+// Play the pattern for a timing field, then reset the chips at the default
+// timing so nothing is left sounding
+void playPattern(uint8_t field, const GenesisBoard::BusTiming& timing) {
+    board.setBusTiming(timing);
+    board.reset();  // Clears the register shadow too, so every write goes out
+
+    if (field == YM_BUSY || field == YM_CHANNEL_BUSY || field == YM_SETUP) {
+        playFMPattern();
+    } else {
+        playPSGPattern();
+    }
+
+    board.setBusTiming(GenesisBoard::defaultBusTiming());
+    board.reset();
+}
+
+// Wait for y, n, r or q
+char readAnswer() {
+    while (Serial.available()) Serial.read();
+    for (;;) {
+        if (Serial.available()) {
+            char c = Serial.read();
+            if (c == 'y' || c == 'n' || c == 'r' || c == 'q') {
+                Serial.println(c);
+                return c;
+            }
+        }
+    }
+}
+
+void calibrate() {
+    GenesisBoard::BusTiming defaults = GenesisBoard::defaultBusTiming();
+    GenesisBoard::BusTiming lowest = defaults;
+
+    Serial.println(F("\n=== Calibration ==="));
+    Serial.println(F("Each step plays a pattern at the default timing, then at a shorter one."));
+    Serial.println(F("y = same, n = second one was wrong, r = play again, q = quit"));
+
+    for (uint8_t field = 0; field < TIMING_FIELDS; field++) {
+        uint8_t* value = timingField(lowest, field);
+
+        printFieldName(field);
+        Serial.print(F(": default "));
+        Serial.print(*value);
+        Serial.println(F(" us"));
+        if (*value == 0) {
+            Serial.println(F("  Already 0, skipped"));
+            continue;
+        }
+
+        // Earlier fields stay at their lowest passing value, so the
+        // patterns also catch combinations that fail
+        while (*value > 0) {
+            GenesisBoard::BusTiming candidate = lowest;
+            *timingField(candidate, field) = *value - 1;
+
+            char answer;
+            do {
+                Serial.print(F("  Trying "));
+                Serial.print(*value - 1);
+                Serial.print(F(" us... "));
+                playPattern(field, defaults);
+                delay(400);
+                playPattern(field, candidate);
+                Serial.print(F("same? "));
+                answer = readAnswer();
+            } while (answer == 'r');
+
+            if (answer == 'q') {
+                board.setBusTiming(defaults);
+                Serial.println(F("Calibration stopped, default timing restored"));
+                return;
+            }
+            if (answer != 'y') {
+                break;
+            }
+            *value = *value - 1;
+        }
+
+        Serial.print(F("  Lowest that passed: "));
+        Serial.print(*value);
+        Serial.println(F(" us"));
+    }
+
+    // One microsecond of margin over what passed, never above the default
+    GenesisBoard::BusTiming suggested = lowest;
+    for (uint8_t field = 0; field < TIMING_FIELDS; field++) {
+        uint8_t* value = timingField(suggested, field);
+        if (*value < *timingField(defaults, field)) {
+            *value = *value + 1;
+        }
+    }
+    board.setBusTiming(suggested);
+
+    Serial.println(F("\nSuggested timing (1 us over the lowest that passed) is now active:"));
+    printTiming();
+    Serial.println(F("Run 'b' to measure it. To build it in, add:"));
+    for (uint8_t field = 0; field < TIMING_FIELDS; field++) {
+        Serial.print(F("  "));
+        printFieldFlag(field);
+        Serial.println(*timingField(suggested, field));
+    }
+}
+
+void printHelp() {
+    Serial.println(F("\n=== BusBenchmark Help ==="));
+    Serial.println(F("b        - Benchmark writes/sec with the current timing"));
+    Serial.println(F("c        - Calibrate the timing by ear"));
+    Serial.println(F("t        - Show the current timing"));
+    Serial.println(F("y<us>    - Set the YM2612 busy wait"));
+    Serial.println(F("h<us>    - Set the YM2612 busy wait after 0xA0-0xB6"));
+    Serial.println(F("s<us>    - Set the YM2612 data setup time"));
+    Serial.println(F("p<us>    - Set the PSG write pulse width"));
+    Serial.println(F("g<us>    - Set the PSG busy wait"));
+    Serial.println(F("d        - Back to the default timing"));
+    Serial.println(F("?        - Show this help"));
+}
@@ -46,6 +46,31 @@
                                    // Format: 0x66
                                    // Total: 1 byte
 
+// =============================================================================
+// Timed Mode (optional)
+//
+// By default writes play as they arrive, so emulator frame pacing and USB
+// scheduling show up as uneven tempo. In timed mode the emulator tags its
+// writes with its 44.1 kHz sample clock and the device plays them a fixed
+// latency after they arrive, trimming its playback rate (up to 1%) to follow
+// the emulator's clock. If a timestamp arrives after it should have played,
+// the device raises the latency by 2 ms and reports it. After 10 s without
+// that happening it steps back towards the requested latency.
+// =============================================================================
+
+#define CMD_TIMED_MODE       0xAB  // Turn timed mode on/off
+                                   // Format: 0xAB <latency_lo> <latency_hi>
+                                   // Latency in ms, 0 = off
+                                   // Device answers 0xAB <lo> <hi> with the
+                                   // latency it holds, and again on each change
+                                   // Total: 3 bytes
+
+#define CMD_TIMESTAMP        0xAC  // Host sample clock for the writes after it
+                                   // Format: 0xAC <clock, 4 bytes LE>
+                                   // Once per frame is enough - waits in between
+                                   // run against the same clock
+                                   // Total: 5 bytes
+
 // =============================================================================
 // Flow Control (Device -> Emulator)
 // =============================================================================
@@ -43,26 +43,31 @@
   #define BUFFER_SIZE 512
   #define BUFFER_MASK 0x1FF
   #define BUFFER_FILL_BEFORE_PLAY 0  // Play immediately (no DAC = lower data rate)
+  #define LATENCY_MAX_MS 40
 #elif defined(__AVR_ATmega2560__)
   #define BOARD_TYPE 2  // Mega
   #define BUFFER_SIZE 2048
   #define BUFFER_MASK 0x7FF
   #define BUFFER_FILL_BEFORE_PLAY 0  // Play immediately (no DAC = lower data rate)
+  #define LATENCY_MAX_MS 100
 #elif defined(__IMXRT1062__)
   #define BOARD_TYPE 4  // Teensy 4.x - 32KB buffer!
   #define BUFFER_SIZE 32768
   #define BUFFER_MASK 0x7FFF
   #define BUFFER_FILL_BEFORE_PLAY 0
+  #define LATENCY_MAX_MS 250
 #elif defined(ARDUINO_ARCH_ESP32)
   #define BOARD_TYPE 5  // ESP32
   #define BUFFER_SIZE 16384
   #define BUFFER_MASK 0x3FFF
   #define BUFFER_FILL_BEFORE_PLAY 0
+  #define LATENCY_MAX_MS 250
 #else
   #define BOARD_TYPE 3  // Other
   #define BUFFER_SIZE 4096
   #define BUFFER_MASK 0xFFF
   #define BUFFER_FILL_BEFORE_PLAY 1024
+  #define LATENCY_MAX_MS 150
 #endif
 
 // =============================================================================
@@ -79,6 +84,10 @@
 #define CMD_WAIT_50          0x63  // Wait 882 samples (1/50 sec)
 #define CMD_END_STREAM       0x66  // Reset/silence chips
 #define CMD_WAIT_SHORT_BASE  0x70  // 0x70-0x7F: wait 1-16 samples
+#define CMD_TIMED_MODE       0xAB  // 2 bytes: target latency in ms (LE), 0 = off
+                                   // Device answers with the same command
+                                   // carrying the latency it holds
+#define CMD_TIMESTAMP        0xAC  // 4 bytes: host sample clock (LE, 44100 Hz)
 #define FLOW_READY           0x06  // Ready signal for handshake
 
 // YM2612 DAC register - use fast path for these writes
@@ -194,6 +203,36 @@ uint32_t nextCommandTime = 0;
 // Timeout: silence chips if no data received (emulator paused/closed)
 #define ACTIVITY_TIMEOUT_MS 1000
 
+// =============================================================================
+// Timed Mode - jitter buffer against the emulator's sample clock
+// =============================================================================
+
+#define TIMED_MIN_MS         5       // Smallest target latency
+#define TIMED_STEP_MS        2       // Target raised by this after an underrun
+#define TIMED_SETTLE_MS      10000   // Underrun-free stretch before it comes back down 1 ms
+#define TIMED_MAX_PPM        10000   // Drift correction limit (1%)
+#define TIMED_JUMP_SAMPLES   441000  // Host clock moved more than 10 s: not a delay
+#define US_PER_SAMPLE_Q16    1486077UL  // 1000000 / 44100 in 16.16 fixed point
+
+bool timed = false;
+uint16_t latencyMs = 0;          // Asked for by the host
+uint16_t targetMs = 0;           // Held now - raised after underruns
+bool clockValid = false;         // cursorSample/nextCommandTime pair is set
+uint32_t cursorSample = 0;       // Host sample clock of the next command
+uint32_t usPerSampleQ16 = US_PER_SAMPLE_Q16;  // Drift-corrected
+uint16_t waitFrac = 0;           // Fraction of a microsecond carried between waits
+int32_t latencyErr = 0;          // Filtered (arrival to play) minus target, us
+int32_t driftPpm = 0;            // Host clock against ours, as learned so far
+uint32_t settleStart = 0;        // millis() of the last underrun or step down
+
+// Command boundaries followed as bytes go into the ring, so timed-mode
+// commands can be acted on (and timestamps matched with the moment they
+// arrived) ahead of playback
+uint8_t scanCmd = 0;
+uint8_t scanRemaining = 0;       // Bytes of scanCmd still to come
+uint8_t scanShift = 0;
+uint32_t scanValue = 0;
+
 // =============================================================================
 // Setup
 // =============================================================================
@@ -222,12 +261,139 @@ void setup() {
   lastActivityTime = millis();
 }
 
+// =============================================================================
+// Timed Mode
+// =============================================================================
+
+uint8_t getCommandSize(uint8_t cmd);
+
+// Host samples to microseconds at the corrected rate
+inline uint32_t timedMicros(uint32_t samples) {
+  return (uint32_t)(((uint64_t)samples * usPerSampleQ16) >> 16);
+}
+
+void sendLatency() {
+  Serial.write(CMD_TIMED_MODE);
+  Serial.write((uint8_t)(targetMs & 0xFF));
+  Serial.write((uint8_t)(targetMs >> 8));
+}
+
+void resetClock() {
+  clockValid = false;
+  usPerSampleQ16 = US_PER_SAMPLE_Q16;
+  waitFrac = 0;
+  latencyErr = 0;
+  driftPpm = 0;
+  settleStart = millis();
+}
+
+void setTimedMode(uint16_t ms) {
+  timed = ms > 0;
+  if (timed && ms < TIMED_MIN_MS) ms = TIMED_MIN_MS;
+  if (ms > LATENCY_MAX_MS) ms = LATENCY_MAX_MS;
+  latencyMs = targetMs = ms;
+  resetClock();
+  sendLatency();
+}
+
+// A timestamp has arrived: compare when it will play with when it should
+void timestampArrived(uint32_t hostSample) {
+  uint32_t now = micros();
+  int32_t targetUs = (int32_t)targetMs * 1000;
+
+  if (!clockValid) {
+    cursorSample = hostSample;
+    nextCommandTime = now + targetUs;
+    clockValid = true;
+    return;
+  }
+
+  // A reset or a long pause in the emulator - playback carries on from the
+  // new clock when it gets there
+  int32_t ahead = (int32_t)(hostSample - cursorSample);
+  if (ahead < 0 || ahead > TIMED_JUMP_SAMPLES) {
+    return;
+  }
+
+  int32_t err = (int32_t)(nextCommandTime + timedMicros(ahead) - now) - targetUs;
+
+  // Arrived after it should have played, or far more buffered than asked
+  // for: move the whole schedule so this one plays on target
+  if (err < -targetUs || err > targetUs) {
+    nextCommandTime -= err;
+    latencyErr = 0;
+    if (err < 0 && targetMs < LATENCY_MAX_MS) {
+      targetMs += TIMED_STEP_MS;
+      if (targetMs > LATENCY_MAX_MS) targetMs = LATENCY_MAX_MS;
+      settleStart = millis();
+      sendLatency();
+    }
+    return;
+  }
+
+  // Small errors are jitter plus drift - filter out the jitter, learn the
+  // drift from what's left and lean the playback rate against both
+  latencyErr += (err - latencyErr) / 16;
+  driftPpm += latencyErr / 256;
+  if (driftPpm > TIMED_MAX_PPM) driftPpm = TIMED_MAX_PPM;
+  if (driftPpm < -TIMED_MAX_PPM) driftPpm = -TIMED_MAX_PPM;
+  int32_t ppm = driftPpm + latencyErr / 4;
+  if (ppm > TIMED_MAX_PPM) ppm = TIMED_MAX_PPM;
+  if (ppm < -TIMED_MAX_PPM) ppm = -TIMED_MAX_PPM;
+  usPerSampleQ16 = US_PER_SAMPLE_Q16 - (int32_t)((int64_t)US_PER_SAMPLE_Q16 * ppm / 1000000);
+
+  if (targetMs > latencyMs && millis() - settleStart > TIMED_SETTLE_MS) {
+    targetMs--;
+    settleStart = millis();
+    sendLatency();
+  }
+}
+
+// Follow one byte going into the ring
+inline void scanByte(uint8_t b) {
+  if (scanRemaining == 0) {
+    scanCmd = b;
+    scanRemaining = getCommandSize(b) - 1;
+    scanShift = 0;
+    scanValue = 0;
+    return;
+  }
+
+  scanValue |= (uint32_t)b << scanShift;
+  scanShift += 8;
+  if (--scanRemaining == 0) {
+    if (scanCmd == CMD_TIMED_MODE) {
+      setTimedMode((uint16_t)scanValue);
+    } else if (scanCmd == CMD_TIMESTAMP && timed) {
+      timestampArrived(scanValue);
+    }
+  }
+}
+
+// Move the schedule on by a wait
+inline void scheduleWait(uint32_t now, uint32_t samples) {
+  if (timed) {
+    // Lateness is the jitter buffer's business - no snapping
+    uint64_t us = (uint64_t)samples * usPerSampleQ16 + waitFrac;
+    waitFrac = (uint16_t)us;
+    nextCommandTime += (uint32_t)(us >> 16);
+    cursorSample += samples;
+    return;
+  }
+
+  nextCommandTime += SAMPLES_TO_MICROS(samples);
+
+  // If behind, snap to now (don't try to catch up)
+  if ((int32_t)(now - nextCommandTime) > 0) {
+    nextCommandTime = now;
+  }
+}
+
 // =============================================================================
 // Data Reception - With backpressure handling
 // =============================================================================
 
 // Forward declarations
-uint8_t getCommandSize(uint8_t cmd);
 int32_t processCommand();
 
 #if defined(ARDUINO_ARCH_ESP32)
@@ -272,8 +438,7 @@ void receiveData() {
       if (result < 0) break;  // End or need data
       if (result > 0) {
         // Wait command - update timing
-        nextCommandTime += SAMPLES_TO_MICROS(result);
-        if ((int32_t)(now - nextCommandTime) > 0) nextCommandTime = now;
+        scheduleWait(now, result);
         break;
       }
     }
@@ -285,6 +450,24 @@ void receiveData() {
       return;  // Buffer full - stop reading until we process more
     }
 
+#if defined(__IMXRT1062__)
+    // Teensy 4: once connected the stream is plain commands, so take whole
+    // USB packets straight into the ring's free space (up to the wrap point;
+    // the rest goes in at the start of the ring next time round)
+    if (connected) {
+      uint32_t n = Serial.available();
+      if (n > ringFree()) n = ringFree();
+      if (n > BUFFER_SIZE - ringHead) n = BUFFER_SIZE - ringHead;
+      n = Serial.readBytes((char*)&ringBuffer[ringHead], n);
+      for (uint32_t i = 0; i < n; i++) {
+        scanByte(ringBuffer[ringHead + i]);
+      }
+      ringHead = (ringHead + n) & BUFFER_MASK;
+      lastActivityTime = millis();
+      continue;
+    }
+#endif
+
 #if defined(ARDUINO_ARCH_ESP32)
     int16_t result = esp32GetByte();
     if (result < 0) break;
@@ -304,6 +487,8 @@ void receiveData() {
 #endif
       connected = true;
       nextCommandTime = 0;      // Will be set when playback starts
+      scanRemaining = 0;
+      timed = false;
 #if BUFFER_FILL_BEFORE_PLAY > 0
       state = BUFFERING;        // AVR: wait for buffer to fill before playing
 #endif
@@ -314,6 +499,7 @@ void receiveData() {
     }
 
     // Buffer the byte for processing
+    scanByte(b);
     ringWrite(b);
   }
 }
@@ -338,7 +524,10 @@ uint8_t getCommandSize(uint8_t cmd) {
     case CMD_WAIT:
     case CMD_YM2612_PORT0:
     case CMD_YM2612_PORT1:
+    case CMD_TIMED_MODE:
       return 3;
+    case CMD_TIMESTAMP:
+      return 5;
     default:
       return 1;
   }
@@ -400,8 +589,34 @@ int32_t processCommand() {
     case CMD_END_STREAM:
       board.reset();
       nextCommandTime = micros();
+      resetClock();  // Emulator paused - resync on the next timestamp
       return -1;
 
+    case CMD_TIMED_MODE:
+      // Acted on as it arrived (see scanByte)
+      ringRead();
+      ringRead();
+      return 0;
+
+    case CMD_TIMESTAMP: {
+      uint32_t hostSample = ringRead();
+      hostSample |= (uint32_t)ringRead() << 8;
+      hostSample |= (uint32_t)ringRead() << 16;
+      hostSample |= (uint32_t)ringRead() << 24;
+      if (!timed || !clockValid) {
+        return 0;
+      }
+
+      // Writes after this play at hostSample - a wait unless the host
+      // clock jumped (or waits already took us past it)
+      int32_t ahead = (int32_t)(hostSample - cursorSample);
+      if (ahead <= 0 || ahead > TIMED_JUMP_SAMPLES) {
+        cursorSample = hostSample;
+        return 0;
+      }
+      return ahead;
+    }
+
     default:
       return 0;
   }
@@ -432,14 +647,7 @@ void updatePlayback() {
 
     if (result > 0) {
       // Wait command - schedule next command time
-      uint32_t waitUs = SAMPLES_TO_MICROS(result);
-      nextCommandTime += waitUs;
-
-      // If behind, snap to now (don't try to catch up)
-      if ((int32_t)(now - nextCommandTime) > 0) {
-        nextCommandTime = now;
-      }
-
+      scheduleWait(now, result);
       return;  // Exit to let main loop receive more data
     }
 
@@ -464,6 +672,7 @@ void loop() {
     board.reset();
     ringHead = ringTail = 0;
     connected = false;
+    timed = false;
   }
 #endif
 
@@ -478,8 +687,11 @@ void loop() {
       break;
 
     case BUFFERING:
-      // Wait for buffer to fill before starting playback
-      if (ringAvailable() >= BUFFER_FILL_BEFORE_PLAY) {
+      // Wait for buffer to fill before starting playback (timed mode
+      // holds its own latency instead)
+      if (timed) {
+        state = PLAYING;
+      } else if (ringAvailable() >= BUFFER_FILL_BEFORE_PLAY) {
         state = PLAYING;
         nextCommandTime = micros();  // Start timing fresh
         lastActivityTime = millis();
@@ -14,6 +14,10 @@
  *   - Any board: Serial MIDI at 115200 baud
  *
  * Both USB MIDI and Serial MIDI can be used simultaneously on Teensy.
+ *
+ * With an SD card (Mega, Teensy, ESP32), TFI files in /patches are a patch
+ * library: Bank Select 1 and up picks library patches, bank 0 the 16 slots.
+ * Copy Test_Patches from this folder to the card as /patches to try it.
  */
 
 // =============================================================================
@@ -32,7 +36,11 @@
 
 #include <GenesisBoard.h>
 #include <synth/FMPatch.h>
+#include <synth/FMPatchBank.h>
+#include <synth/FMPatchLibrary.h>
 #include <synth/FMFrequency.h>
+#include <synth/GenesisSynth.h>
+#include <synth/ModulationEngine.h>
 #include <synth/PSGFrequency.h>
 #include <synth/PSGEnvelope.h>
 #include <synth/DefaultPatches.h>
@@ -62,32 +70,31 @@
 
 GenesisBoard board(PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y, PIN_SCK, PIN_SDI);
 
+// FM voices and the YM2612 write queue (flushed once per loop() pass)
+GenesisSynth synth(board);
+
+// PSG envelopes and software vibrato/tremolo/sweeps, ticked by a timer
+ModulationEngine mod(board);
+
 // =============================================================================
 // Patch Storage
 // =============================================================================
 
 // RAM storage for user-loaded patches
-FMPatch fmPatches[16];           // 16 FM patch slots
+FMPatchBank patchBank;           // 16 FM patch slots, compiled for fast loading
 PSGEnvelope psgEnvelopes[8];     // 8 PSG envelope slots
 
+#if GENESIS_SYNTH_USE_PATCH_LIBRARY
+// TFI files on the SD card, loaded on demand (bank n = patches (n-1)*128 on)
+FMPatchLibrary library;
+uint8_t fmBank[6] = {0, 0, 0, 0, 0, 0};  // Bank Select per FM channel (0 = slots)
+#define LIBRARY_SLOT_BASE 10             // Library patches are copied to slots 10-15
+#endif
+
 // Current patch assignment per channel
 uint8_t fmChannelPatch[6] = {0, 1, 2, 3, 4, 5};
 uint8_t psgChannelEnv[4] = {0, 1, 2, 3};  // Each PSG channel gets different envelope
 
-// =============================================================================
-// PSG Envelope State (software envelopes at 60Hz)
-// =============================================================================
-
-struct PSGChannelState {
-    bool active;
-    bool noteOn;
-    uint8_t envPos;
-    uint16_t baseTone;
-    uint8_t baseNote;
-};
-
-PSGChannelState psgState[4] = {0};
-
 // =============================================================================
 // Synth Mode
 // =============================================================================
@@ -101,19 +108,9 @@ SynthMode synthMode = MODE_MULTI;
 uint8_t polyPatchSlot = 0;  // Patch slot used in poly mode
 
 // =============================================================================
-// FM Channel/Voice State
+// FM Channel State
 // =============================================================================
 
-struct FMChannelState {
-    bool noteOn;
-    bool sustainPending;  // Note should release when sustain pedal is lifted
-    uint8_t currentNote;
-    uint8_t velocity;
-    uint32_t timestamp;  // For voice stealing (when note started)
-};
-
-FMChannelState fmState[6] = {0};
-
 // Sustain pedal state per channel (for multi mode) or global (for poly mode)
 bool sustainPedal[16] = {false};
 
@@ -121,22 +118,20 @@ bool sustainPedal[16] = {false};
 // In poly mode, all voices share the pitch bend from channel 0
 int16_t fmPitchBend[6] = {0, 0, 0, 0, 0, 0};
 
-// =============================================================================
-// Timing
-// =============================================================================
-
-uint32_t lastEnvTick = 0;
-const uint32_t ENV_TICK_US = 16667;  // 60Hz = 16667 microseconds
+// Pitch bend and note per PSG tone channel
+int16_t psgPitchBend[3] = {0, 0, 0};
+uint8_t psgNote[3] = {0, 0, 0};
 
 // =============================================================================
 // Forward Declarations
 // =============================================================================
 
-void setFMFrequencyWithBend(uint8_t ch, uint8_t note, int16_t bend);
 void fmNoteOn(uint8_t ch, uint8_t note, uint8_t velocity);
 void fmNoteOff(uint8_t ch, uint8_t note);
-void fmKeyOff(uint8_t ch);
-void writeFMPatch(uint8_t ch, const FMPatch& patch);
+void writeFMPatch(uint8_t ch, const FMPatchImage& patch);
+#if GENESIS_SYNTH_USE_PATCH_LIBRARY
+void loadLibraryPatch(uint8_t ch, uint16_t number);
+#endif
 void processSerialMIDI();
 void handleSerialMIDIByte(uint8_t byte);
 
@@ -163,67 +158,9 @@ uint8_t serialMidiStatus = 0;    // Running status byte
 bool serialInSysEx = false;      // Currently receiving SysEx
 
 // =============================================================================
-// Voice Allocator (for Poly Mode)
+// Mode Switching
 // =============================================================================
 
-/**
- * Find a voice to use for a new note.
- * Strategy:
- *   1. Reuse voice if same note is retriggered
- *   2. Use first free voice
- *   3. Steal oldest voice (voice stealing)
- */
-int8_t allocateVoice(uint8_t note) {
-    // 1. Check if this note is already playing (retrigger - reuse same voice)
-    for (int i = 0; i < 6; i++) {
-        if (fmState[i].noteOn && fmState[i].currentNote == note) {
-            return i;
-        }
-    }
-
-    // 2. Find first free voice
-    for (int i = 0; i < 6; i++) {
-        if (!fmState[i].noteOn) {
-            return i;
-        }
-    }
-
-    // 3. All voices busy - steal oldest note
-    uint32_t oldest = UINT32_MAX;
-    int8_t oldestIdx = 0;
-    for (int i = 0; i < 6; i++) {
-        if (fmState[i].timestamp < oldest) {
-            oldest = fmState[i].timestamp;
-            oldestIdx = i;
-        }
-    }
-
-    // Release the stolen voice before reusing
-    fmKeyOff(oldestIdx);
-
-    return oldestIdx;
-}
-
-/**
- * Find the voice playing a specific note (for note-off).
- * If multiple voices play same note, returns the oldest one (FIFO release).
- * Returns -1 if note not found.
- */
-int8_t findVoiceByNote(uint8_t note) {
-    int8_t found = -1;
-    uint32_t oldest = UINT32_MAX;
-
-    for (int i = 0; i < 6; i++) {
-        if (fmState[i].noteOn && fmState[i].currentNote == note) {
-            if (fmState[i].timestamp < oldest) {
-                oldest = fmState[i].timestamp;
-                found = i;
-            }
-        }
-    }
-    return found;
-}
-
 /**
  * Switch to poly mode - load same patch on all 6 FM channels
  */
@@ -234,9 +171,9 @@ void enablePolyMode(uint8_t patchSlot) {
     // Load the same patch on all 6 channels
     for (uint8_t ch = 0; ch < 6; ch++) {
         fmChannelPatch[ch] = patchSlot;  // All channels use same patch
-        writeFMPatch(ch, fmPatches[patchSlot]);
-        fmState[ch].noteOn = false;
+        writeFMPatch(ch, patchBank[patchSlot]);
     }
+    synth.reset();
 
     Serial.print("Poly mode enabled, patch slot ");
     Serial.println(patchSlot);
@@ -250,9 +187,9 @@ void enableMultiMode() {
 
     // Restore individual patches per channel
     for (uint8_t ch = 0; ch < 6; ch++) {
-        writeFMPatch(ch, fmPatches[fmChannelPatch[ch]]);
-        fmState[ch].noteOn = false;
+        writeFMPatch(ch, patchBank[fmChannelPatch[ch]]);
     }
+    synth.reset();
 
     Serial.println("Multi mode enabled");
 }
@@ -270,16 +207,32 @@ void setup() {
     // Load default patches from PROGMEM
     loadDefaultPatches();
 
+    #if GENESIS_SYNTH_USE_PATCH_LIBRARY
+    // Builds /patches.idx the first time
+    if (SD.begin(GENESIS_ENGINE_SD_CS_PIN) && library.begin("/patches")) {
+        Serial.print("Patch library: ");
+        Serial.print(library.count());
+        Serial.println(" patches");
+    }
+    #endif
+
     // Initialize all FM channels with their assigned patches
     for (uint8_t ch = 0; ch < 6; ch++) {
-        writeFMPatch(ch, fmPatches[fmChannelPatch[ch]]);
+        writeFMPatch(ch, patchBank[fmChannelPatch[ch]]);
         // Set stereo output (both L+R enabled)
         setFMPanning(ch, 0xC0);  // Both speakers
     }
 
+    synth.flush();
+
     // Silence PSG
     board.silencePSG();
 
+    // FM notes feed the modulation engine, which ticks from a timer where
+    // the board has one (otherwise loop() polls it)
+    synth.setModulation(&mod);
+    mod.begin();
+
     Serial.println("MIDISynth ready");
 }
 
@@ -317,12 +270,16 @@ void loop() {
     // Process Serial MIDI (all platforms - from companion app)
     processSerialMIDI();
 
-    // Update PSG envelopes at 60Hz
-    uint32_t now = micros();
-    if (now - lastEnvTick >= ENV_TICK_US) {
-        lastEnvTick += ENV_TICK_US;
-        updatePSGEnvelopes();
-    }
+    // Everything the MIDI input changed goes out as one burst per port
+    synth.flush();
+
+    // Envelopes and modulation (only needed on boards without a timer)
+    mod.update();
+
+    #if GENESIS_SYNTH_USE_PATCH_LIBRARY
+    // Read the next library patches ahead while nothing else is happening
+    library.update();
+    #endif
 }
 
 // =============================================================================
@@ -386,10 +343,7 @@ void noteOn(uint8_t midiCh, uint8_t note, uint8_t velocity) {
     if (synthMode == MODE_POLY6) {
         // Poly mode: MIDI Ch 1 controls all 6 FM voices
         if (midiCh == 0) {
-            int8_t voice = allocateVoice(note);
-            if (voice >= 0) {
-                fmNoteOn(voice, note, velocity);
-            }
+            fmNoteOn(synth.allocateVoice(note), note, velocity);
         } else if (midiCh >= 6 && midiCh < 9) {
             // PSG still works on Ch 7-9
             psgNoteOn(midiCh - 6, note, velocity);
@@ -412,8 +366,8 @@ void noteOff(uint8_t midiCh, uint8_t note) {
     if (synthMode == MODE_POLY6) {
         // Poly mode: find which voice is playing this note
         if (midiCh == 0) {
-            int8_t voice = findVoiceByNote(note);
-            if (voice >= 0) {
+            uint8_t voice = synth.findVoice(note);
+            if (voice != GenesisSynth::NO_VOICE) {
                 fmNoteOff(voice, note);
             }
         } else if (midiCh >= 6 && midiCh < 9) {
@@ -438,54 +392,17 @@ void noteOff(uint8_t midiCh, uint8_t note) {
 // =============================================================================
 
 void fmNoteOn(uint8_t ch, uint8_t note, uint8_t velocity) {
-    // Store state
-    fmState[ch].noteOn = true;
-    fmState[ch].currentNote = note;
-    fmState[ch].velocity = velocity;
-    fmState[ch].timestamp = millis();  // For voice stealing
-
-    // Apply velocity to carrier TL (simple scaling)
-    applyVelocity(ch, velocity);
-
-    // Set frequency (apply any active pitch bend)
+    // Velocity scales the carrier TLs; any active pitch bend applies
     // In poly mode, use channel 0's pitch bend for all voices
     int16_t bend = (synthMode == MODE_POLY6) ? fmPitchBend[0] : fmPitchBend[ch];
-    if (bend != 0) {
-        setFMFrequencyWithBend(ch, note, bend);
-    } else {
-        setFMFrequency(ch, note);
-    }
-
-    // Key on (all 4 operators)
-    fmKeyOn(ch);
+    synth.noteOn(ch, note, velocity, patchBank[fmChannelPatch[ch]], bend);
 }
 
 void fmNoteOff(uint8_t ch, uint8_t note) {
-    // Only release if this is the note that's playing
-    if (fmState[ch].noteOn && fmState[ch].currentNote == note) {
-        // Check sustain pedal - in poly mode use ch 0, in multi mode use the actual channel
-        uint8_t sustainCh = (synthMode == MODE_POLY6) ? 0 : ch;
-        if (sustainPedal[sustainCh]) {
-            // Mark as pending release instead of actually releasing
-            fmState[ch].sustainPending = true;
-        } else {
-            fmState[ch].noteOn = false;
-            fmState[ch].sustainPending = false;
-            fmKeyOff(ch);
-        }
-    }
-}
-
-void fmKeyOn(uint8_t ch) {
-    FMFrequency::keyOn(board, ch);
-}
-
-void fmKeyOff(uint8_t ch) {
-    FMFrequency::keyOff(board, ch);
-}
-
-void setFMFrequency(uint8_t ch, uint8_t note) {
-    FMFrequency::writeToChannel(board, ch, note);
+    // Check sustain pedal - in poly mode use ch 0, in multi mode use the actual channel
+    // (a sustained note is released by handleSustainPedal)
+    uint8_t sustainCh = (synthMode == MODE_POLY6) ? 0 : ch;
+    synth.noteOff(ch, note, sustainPedal[sustainCh]);
 }
 
 void setFMPanning(uint8_t ch, uint8_t pan) {
@@ -494,57 +411,12 @@ void setFMPanning(uint8_t ch, uint8_t pan) {
 
     // Register B4-B6: L/R/AMS/PMS
     // We preserve AMS/PMS and just set L/R bits
-    board.writeYM2612(port, 0xB4 + chReg, pan);
-}
-
-// Helper: get carrier mask for algorithm - delegates to library
-void getCarrierMask(uint8_t algorithm, bool* isCarrier) {
-    FMPatchUtils::getCarrierMask(algorithm, isCarrier);
-}
-
-void applyVelocity(uint8_t ch, uint8_t velocity) {
-    // Scale carrier TL based on velocity
-    // TL 0 = loudest, 127 = silent
-    // Velocity 127 = loudest, 0 = silent
-
-    FMPatch& patch = fmPatches[fmChannelPatch[ch]];
-    bool isCarrier[4];
-    getCarrierMask(patch.algorithm, isCarrier);
-
-    // Calculate velocity attenuation (0 = none, ~40 = significant)
-    uint8_t attenuation = (127 - velocity) / 3;
-
-    uint8_t port = (ch >= 3) ? 1 : 0;
-    uint8_t chReg = ch % 3;
-
-    // Operator register offsets: S1=0, S3=8, S2=4, S4=12
-    const uint8_t opOffsets[4] = {0, 8, 4, 12};
-
-    for (int op = 0; op < 4; op++) {
-        if (isCarrier[op]) {
-            uint8_t tl = patch.op[op].tl;
-            tl = min(127, tl + attenuation);
-            board.writeYM2612(port, 0x40 + opOffsets[op] + chReg, tl);
-        }
-    }
+    synth.writeYM2612(port, 0xB4 + chReg, pan);
 }
 
-void applyVolumeAttenuation(uint8_t ch, const FMPatch& patch, uint8_t attenuation) {
+void applyVolumeAttenuation(uint8_t ch, const FMPatchImage& patch, uint8_t attenuation) {
     // Apply attenuation to carrier operators
-    bool isCarrier[4];
-    getCarrierMask(patch.algorithm, isCarrier);
-
-    uint8_t port = (ch >= 3) ? 1 : 0;
-    uint8_t chReg = ch % 3;
-    const uint8_t opOffsets[4] = {0, 8, 4, 12};
-
-    for (int op = 0; op < 4; op++) {
-        if (isCarrier[op]) {
-            uint8_t tl = patch.op[op].tl;
-            tl = min(127, tl + attenuation);
-            board.writeYM2612(port, 0x40 + opOffsets[op] + chReg, tl);
-        }
-    }
+    synth.setCarrierLevel(ch, patch, attenuation);
 }
 
 // =============================================================================
@@ -554,32 +426,15 @@ void applyVolumeAttenuation(uint8_t ch, const FMPatch& patch, uint8_t attenuatio
 void psgNoteOn(uint8_t ch, uint8_t note, uint8_t velocity) {
     if (ch >= 3) return;
 
-    // Set frequency
-    uint16_t tone = pgm_read_word(&psgToneTable[note]);
-    psgState[ch].baseTone = tone;
-    psgState[ch].baseNote = note;
-
-    // Write tone
-    board.writePSG(0x80 | (ch << 5) | (tone & 0x0F));
-    board.writePSG((tone >> 4) & 0x3F);
-
-    // Start envelope
-    psgState[ch].active = true;
-    psgState[ch].noteOn = true;
-    psgState[ch].envPos = 0;
-
-    // Set initial volume (envelope will take over)
-    uint8_t vol = 15 - (velocity >> 3);  // 0-15, 0=loud
-    board.writePSG(0x90 | (ch << 5) | vol);
+    // Tone now, then the channel's envelope takes over the volume
+    psgNote[ch] = note;
+    uint16_t tone = PSGFrequency::midiToToneWithBend(note, psgPitchBend[ch]);
+    mod.psgNoteOn(ch, tone, 0, &psgEnvelopes[psgChannelEnv[ch]]);
 }
 
 void psgNoteOff(uint8_t ch) {
     if (ch >= 3) return;
-
-    psgState[ch].noteOn = false;
-    // Let envelope finish or silence immediately
-    board.writePSG(0x90 | (ch << 5) | 0x0F);  // Silence
-    psgState[ch].active = false;
+    mod.psgNoteOff(ch);  // Silence
 }
 
 void psgNoiseOn(uint8_t note, uint8_t velocity) {
@@ -588,55 +443,13 @@ void psgNoiseOn(uint8_t note, uint8_t velocity) {
     uint8_t mode = (note < 64) ? 0x00 : 0x04;  // Bit 2 = white noise
     uint8_t freq = note % 4;  // 0-3 frequency select
 
-    board.writePSG(0xE0 | mode | freq);
-
-    // Set volume
+    // No envelope: held at the velocity's volume
     uint8_t vol = 15 - (velocity >> 3);
-    board.writePSG(0xF0 | vol);
-
-    psgState[3].active = true;
-    psgState[3].noteOn = true;
+    mod.psgNoteOn(3, mode | freq, vol, nullptr);
 }
 
 void psgNoiseOff() {
-    board.writePSG(0xFF);  // Silence noise channel
-    psgState[3].active = false;
-    psgState[3].noteOn = false;
-}
-
-// =============================================================================
-// PSG Envelope Processing (called at 60Hz)
-// =============================================================================
-
-void updatePSGEnvelopes() {
-    for (uint8_t ch = 0; ch < 3; ch++) {
-        if (!psgState[ch].active) continue;
-
-        PSGEnvelope& env = psgEnvelopes[psgChannelEnv[ch]];
-
-        if (psgState[ch].envPos >= env.length) {
-            // Envelope finished
-            if (!psgState[ch].noteOn) {
-                psgState[ch].active = false;
-                board.writePSG(0x90 | (ch << 5) | 0x0F);  // Silence
-            }
-            continue;
-        }
-
-        uint8_t data = env.data[psgState[ch].envPos];
-        uint8_t volume = data & 0x0F;
-
-        // Apply volume
-        board.writePSG(0x90 | (ch << 5) | volume);
-
-        // Advance position
-        psgState[ch].envPos++;
-
-        // Handle loop
-        if (psgState[ch].envPos >= env.length && env.loopStart != 0xFF) {
-            psgState[ch].envPos = env.loopStart;
-        }
-    }
+    mod.psgNoteOff(3);  // Silence noise channel
 }
 
 // =============================================================================
@@ -656,6 +469,54 @@ void echoCC(uint8_t ch, uint8_t cc, uint8_t value) {
     Serial.write(value & 0x7F);
 }
 
+// Software vibrato settings per modulation channel (0-5 FM, 6-9 PSG)
+uint8_t vibratoRate[ModulationEngine::NUM_CHANNELS] = {5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
+uint8_t vibratoDepth[ModulationEngine::NUM_CHANNELS] = {0};
+
+/**
+ * Software modulation CCs (modulation engine, FM and PSG channels):
+ *   CC 1  Mod wheel - vibrato depth on PSG channels (FM uses the chip LFO)
+ *   CC 20 Pitch sweep, 64 = off, above sweeps up, below sweeps down
+ *   CC 76 Vibrato rate, CC 77 Vibrato depth
+ *   CC 92 Tremolo depth
+ * Returns true if the CC was one of these.
+ */
+bool handleModulationCC(uint8_t ch, uint8_t cc, uint8_t value) {
+    if (ch >= 10) return false;
+    if (cc == 1 && ch < 6) return false;
+    if (cc != 1 && cc != 20 && cc != 76 && cc != 77 && cc != 92) return false;
+
+    // In poly mode, Ch 1 sets all 6 FM voices
+    uint8_t first = ch;
+    uint8_t last = ch;
+    if (synthMode == MODE_POLY6 && ch < 6) {
+        if (ch != 0) return true;
+        last = 5;
+    }
+
+    for (uint8_t c = first; c <= last; c++) {
+        switch (cc) {
+            case 1:   // PSG vibrato depth
+            case 77:
+                vibratoDepth[c] = value;
+                mod.setVibrato(c, vibratoRate[c], value);
+                break;
+            case 76:  // About 1-16Hz at the default 240Hz tick
+                vibratoRate[c] = 1 + (value >> 3);
+                mod.setVibrato(c, vibratoRate[c], vibratoDepth[c]);
+                break;
+            case 92:
+                mod.setTremolo(c, value);
+                break;
+            case 20:
+                mod.setSweep(c, (int16_t)value - 64);
+                break;
+        }
+    }
+    echoCC(ch, cc, value);
+    return true;
+}
+
 void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
     // Mode switching CCs work on any channel
     switch (cc) {
@@ -670,6 +531,10 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
             return;
     }
 
+    if (handleModulationCC(ch, cc, value)) {
+        return;
+    }
+
     // In poly mode, only respond to MIDI Ch 1 for FM controls
     if (synthMode == MODE_POLY6 && ch != 0 && ch < 6) {
         return;  // Ignore FM CCs on channels 2-6 in poly mode
@@ -678,16 +543,23 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
     if (ch >= 6) return;  // Only FM channels for CCs below
 
     switch (cc) {
+        #if GENESIS_SYNTH_USE_PATCH_LIBRARY
+        case 0:  // Bank Select - library bank for the next Program Change
+            fmBank[ch] = value;
+            echoCC(ch, cc, value);
+            break;
+        #endif
+
         case 1:  // Mod wheel - LFO depth (vibrato)
             {
                 // Enable LFO if mod wheel > 0
                 if (value > 0 && !lfoEnabled) {
                     // Enable LFO at medium speed (freq index 4 ≈ 5.9 Hz)
-                    board.writeYM2612(0, 0x22, 0x08 | 4);
+                    synth.writeYM2612(0, 0x22, 0x08 | 4);
                     lfoEnabled = true;
                 } else if (value == 0 && lfoEnabled) {
                     // Disable LFO
-                    board.writeYM2612(0, 0x22, 0x00);
+                    synth.writeYM2612(0, 0x22, 0x00);
                     lfoEnabled = false;
                 }
 
@@ -699,12 +571,12 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
                     for (uint8_t i = 0; i < 6; i++) {
                         uint8_t port = (i >= 3) ? 1 : 0;
                         uint8_t chReg = i % 3;
-                        board.writeYM2612(port, 0xB4 + chReg, 0xC0 | pms);
+                        synth.writeYM2612(port, 0xB4 + chReg, 0xC0 | pms);
                     }
                 } else {
                     uint8_t port = (ch >= 3) ? 1 : 0;
                     uint8_t chReg = ch % 3;
-                    board.writeYM2612(port, 0xB4 + chReg, 0xC0 | pms);
+                    synth.writeYM2612(port, 0xB4 + chReg, 0xC0 | pms);
                 }
                 echoCC(ch, cc, value);
             }
@@ -716,12 +588,12 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
 
                 if (synthMode == MODE_POLY6) {
                     // Apply to all 6 channels in poly mode
-                    FMPatch& patch = fmPatches[polyPatchSlot];
+                    const FMPatchImage& patch = patchBank[polyPatchSlot];
                     for (uint8_t i = 0; i < 6; i++) {
                         applyVolumeAttenuation(i, patch, attenuation);
                     }
                 } else {
-                    FMPatch& patch = fmPatches[fmChannelPatch[ch]];
+                    const FMPatchImage& patch = patchBank[fmChannelPatch[ch]];
                     applyVolumeAttenuation(ch, patch, attenuation);
                 }
                 echoCC(ch, cc, value);
@@ -741,16 +613,22 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
 
         case 14: // Algorithm (GenMDM-style)
             if (value < 8) {
-                fmPatches[fmChannelPatch[ch]].algorithm = value;
-                writeFMPatch(ch, fmPatches[fmChannelPatch[ch]]);
+                FMPatch patch;
+                patchBank.get(fmChannelPatch[ch], patch);
+                patch.algorithm = value;
+                patchBank.set(fmChannelPatch[ch], patch);
+                writeFMPatch(ch, patchBank[fmChannelPatch[ch]]);
                 echoCC(ch, cc, value);
             }
             break;
 
         case 15: // Feedback
             if (value < 8) {
-                fmPatches[fmChannelPatch[ch]].feedback = value;
-                writeFMPatch(ch, fmPatches[fmChannelPatch[ch]]);
+                FMPatch patch;
+                patchBank.get(fmChannelPatch[ch], patch);
+                patch.feedback = value;
+                patchBank.set(fmChannelPatch[ch], patch);
+                writeFMPatch(ch, patchBank[fmChannelPatch[ch]]);
                 echoCC(ch, cc, value);
             }
             break;
@@ -759,7 +637,10 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
         case 16: case 17: case 18: case 19:
             {
                 uint8_t op = cc - 16;
-                fmPatches[fmChannelPatch[ch]].op[op].tl = value;
+                FMPatch patch;
+                patchBank.get(fmChannelPatch[ch], patch);
+                patch.op[op].tl = value;
+                patchBank.set(fmChannelPatch[ch], patch);
                 writeOperatorTL(ch, op, value);
                 echoCC(ch, cc, value);
             }
@@ -783,8 +664,7 @@ void handleCC(uint8_t ch, uint8_t cc, uint8_t value) {
 void writeOperatorTL(uint8_t ch, uint8_t op, uint8_t tl) {
     uint8_t port = (ch >= 3) ? 1 : 0;
     uint8_t chReg = ch % 3;
-    const uint8_t opOffsets[4] = {0, 8, 4, 12};
-    board.writeYM2612(port, 0x40 + opOffsets[op] + chReg, tl);
+    synth.writeYM2612(port, 0x40 + FMPatchUtils::OPERATOR_OFFSETS[op] + chReg, tl);
 }
 
 // =============================================================================
@@ -799,19 +679,11 @@ void handleSustainPedal(uint8_t ch, bool on) {
         if (synthMode == MODE_POLY6 && ch == 0) {
             // In poly mode, sustain on ch 0 affects all 6 voices
             for (uint8_t i = 0; i < 6; i++) {
-                if (fmState[i].sustainPending) {
-                    fmState[i].noteOn = false;
-                    fmState[i].sustainPending = false;
-                    fmKeyOff(i);
-                }
+                synth.releaseSustained(i);
             }
         } else if (synthMode == MODE_MULTI && ch < 6) {
             // In multi mode, each FM channel has its own sustain
-            if (fmState[ch].sustainPending) {
-                fmState[ch].noteOn = false;
-                fmState[ch].sustainPending = false;
-                fmKeyOff(ch);
-            }
+            synth.releaseSustained(ch);
         }
         // PSG doesn't support sustain pedal
     }
@@ -824,10 +696,8 @@ void allNotesOff(uint8_t ch) {
         uint8_t start = (ch >= 16) ? 0 : ch;
         uint8_t end = (ch >= 16) ? 6 : ch + 1;
         for (uint8_t i = start; i < end; i++) {
-            if (fmState[i].noteOn) {
-                fmState[i].noteOn = false;
-                fmState[i].sustainPending = false;
-                fmKeyOff(i);
+            if (synth.isNoteOn(i)) {
+                synth.release(i);
             }
         }
     }
@@ -867,10 +737,10 @@ void allSoundOff(uint8_t ch) {
         uint8_t start = (ch >= 16) ? 0 : ch - 6;
         uint8_t end = (ch >= 16) ? 3 : start + 1;
         for (uint8_t i = start; i < end; i++) {
-            board.writePSG(0x90 | (i << 5) | 0x0F);
+            mod.psgNoteOff(i);
         }
         if (ch == 9 || ch >= 16) {
-            board.writePSG(0x90 | (3 << 5) | 0x0F);  // Noise channel
+            mod.psgNoteOff(3);  // Noise channel
         }
     }
 }
@@ -880,12 +750,19 @@ void allSoundOff(uint8_t ch) {
 // =============================================================================
 
 void handleProgramChange(uint8_t ch, uint8_t program) {
+    #if GENESIS_SYNTH_USE_PATCH_LIBRARY
+    if (ch < 6 && fmBank[ch] > 0) {
+        loadLibraryPatch(ch, (uint16_t)(fmBank[ch] - 1) * 128 + program);
+        return;
+    }
+    #endif
+
     if (synthMode == MODE_POLY6) {
         // In poly mode, Ch 1 Program Change sets patch for all 6 voices
         if (ch == 0 && program < 16) {
             polyPatchSlot = program;
             for (uint8_t i = 0; i < 6; i++) {
-                writeFMPatch(i, fmPatches[program]);
+                writeFMPatch(i, patchBank[program]);
             }
             Serial.print("Poly patch changed to slot ");
             Serial.println(program);
@@ -901,7 +778,7 @@ void handleProgramChange(uint8_t ch, uint8_t program) {
         if (ch < 6) {
             if (program < 16) {
                 fmChannelPatch[ch] = program;
-                writeFMPatch(ch, fmPatches[program]);
+                writeFMPatch(ch, patchBank[program]);
             }
         } else if (ch < 10) {
             uint8_t psgCh = ch - 6;
@@ -921,6 +798,16 @@ void handlePitchBend(uint8_t ch, uint16_t bend) {
     // Convert to signed: -8192 to +8191
     int16_t bendOffset = (int16_t)bend - 8192;
 
+    // PSG tone channels (Ch 7-9) bend in either mode
+    if (ch >= 6 && ch < 9) {
+        uint8_t psgCh = ch - 6;
+        psgPitchBend[psgCh] = bendOffset;
+        if (mod.isPSGActive(psgCh)) {
+            mod.setPSGPitch(psgCh, PSGFrequency::midiToToneWithBend(psgNote[psgCh], bendOffset));
+        }
+        return;
+    }
+
     if (synthMode == MODE_POLY6) {
         // In poly mode, Ch 1 pitch bend affects all 6 voices
         if (ch != 0) return;
@@ -929,9 +816,7 @@ void handlePitchBend(uint8_t ch, uint16_t bend) {
 
         // Update all active voices
         for (uint8_t i = 0; i < 6; i++) {
-            if (fmState[i].noteOn) {
-                setFMFrequencyWithBend(i, fmState[i].currentNote, bendOffset);
-            }
+            synth.setPitchBend(i, bendOffset);
         }
     } else {
         // Multi mode: each channel has its own pitch bend
@@ -939,16 +824,10 @@ void handlePitchBend(uint8_t ch, uint16_t bend) {
 
         fmPitchBend[ch] = bendOffset;
 
-        if (fmState[ch].noteOn) {
-            setFMFrequencyWithBend(ch, fmState[ch].currentNote, bendOffset);
-        }
+        synth.setPitchBend(ch, bendOffset);
     }
 }
 
-void setFMFrequencyWithBend(uint8_t ch, uint8_t note, int16_t bend) {
-    FMFrequency::writeToChannelWithBend(board, ch, note, bend);
-}
-
 // =============================================================================
 // SysEx Handler
 // =============================================================================
@@ -986,7 +865,8 @@ void sendPatchDump(uint8_t slot) {
     data[0] = slot;
 
     // Serialize patch to extended format (45 bytes)
-    const FMPatch& patch = fmPatches[slot];
+    FMPatch patch;
+    patchBank.get(slot, patch);
     data[1] = patch.algorithm;
     data[2] = patch.feedback;
     for (int op = 0; op < 4; op++) {
@@ -1026,14 +906,16 @@ void handleSysEx(const uint8_t* data, uint16_t len) {
                 uint8_t ch = data[4];
                 if (ch < 6) {
                     bool extended = (len >= 5 + 1 + FM_PATCH_SIZE_EXTENDED);
-                    parsePatchData(&data[5], fmPatches[fmChannelPatch[ch]], extended);
+                    FMPatch patch;
+                    parsePatchData(&data[5], patch, extended);
+                    patchBank.set(fmChannelPatch[ch], patch);
                     if (synthMode == MODE_POLY6) {
                         // In poly mode, update all 6 channels with the shared patch
                         for (uint8_t i = 0; i < 6; i++) {
-                            writeFMPatch(i, fmPatches[fmChannelPatch[ch]]);
+                            writeFMPatch(i, patchBank[fmChannelPatch[ch]]);
                         }
                     } else {
-                        writeFMPatch(ch, fmPatches[fmChannelPatch[ch]]);
+                        writeFMPatch(ch, patchBank[fmChannelPatch[ch]]);
                     }
                 }
             }
@@ -1045,10 +927,13 @@ void handleSysEx(const uint8_t* data, uint16_t len) {
                 uint8_t envLen = data[5];
                 uint8_t loopStart = data[6];
                 if (ch < 4 && envLen <= 64 && len >= 5 + 3 + envLen) {
+                    // The envelope may be running in the modulation tick
                     PSGEnvelope& env = psgEnvelopes[psgChannelEnv[ch]];
+                    mod.lock();
                     env.length = envLen;
                     env.loopStart = loopStart;
                     memcpy(env.data, &data[7], envLen);
+                    mod.unlock();
                 }
             }
             break;
@@ -1059,7 +944,9 @@ void handleSysEx(const uint8_t* data, uint16_t len) {
                 uint8_t slot = data[4];
                 if (slot < 16) {
                     bool extended = (len >= 5 + 1 + FM_PATCH_SIZE_EXTENDED);
-                    parsePatchData(&data[5], fmPatches[slot], extended);
+                    FMPatch patch;
+                    parsePatchData(&data[5], patch, extended);
+                    patchBank.set(slot, patch);
                 }
             }
             break;
@@ -1070,7 +957,7 @@ void handleSysEx(const uint8_t* data, uint16_t len) {
                 uint8_t slot = data[5];
                 if (ch < 6 && slot < 16) {
                     fmChannelPatch[ch] = slot;
-                    writeFMPatch(ch, fmPatches[slot]);
+                    writeFMPatch(ch, patchBank[slot]);
                 }
             }
             break;
@@ -1124,15 +1011,40 @@ void parseTFIPatch(const uint8_t* data, FMPatch& patch) {
     parsePatchData(data, patch, false);
 }
 
-void writeFMPatch(uint8_t ch, const struct FMPatch& patch) {
-    FMPatchUtils::loadToChannel(board, ch, patch);
+void writeFMPatch(uint8_t ch, const FMPatchImage& patch) {
+    synth.loadPatch(ch, patch);
 }
 
-void loadDefaultPatches() {
-    // Load default FM patches from PROGMEM
-    for (int i = 0; i < DEFAULT_FM_PATCH_COUNT && i < 16; i++) {
-        memcpy_P(&fmPatches[i], &defaultFMPatches[i], sizeof(FMPatch));
+#if GENESIS_SYNTH_USE_PATCH_LIBRARY
+/**
+ * Copy a library patch into the channel's library slot and load it
+ * (in poly mode Ch 1 loads it on all 6 voices)
+ */
+void loadLibraryPatch(uint8_t ch, uint16_t number) {
+    if (synthMode == MODE_POLY6 && ch != 0) return;
+
+    const FMPatchImage* patch = library.get(number);
+    if (!patch) return;
+
+    uint8_t slot = LIBRARY_SLOT_BASE + ch;
+    patchBank.set(slot, *patch);
+
+    if (synthMode == MODE_POLY6) {
+        polyPatchSlot = slot;
+        for (uint8_t i = 0; i < 6; i++) {
+            fmChannelPatch[i] = slot;
+            writeFMPatch(i, patchBank[slot]);
+        }
+    } else {
+        fmChannelPatch[ch] = slot;
+        writeFMPatch(ch, patchBank[slot]);
     }
+}
+#endif
+
+void loadDefaultPatches() {
+    // Compile the default FM patches from PROGMEM
+    patchBank.loadDefaults();
 
     // Load default PSG envelopes from PROGMEM
     for (int i = 0; i < DEFAULT_PSG_ENV_COUNT && i < 8; i++) {
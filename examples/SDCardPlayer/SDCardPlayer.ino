@@ -79,6 +79,7 @@
  *   next              Next track (playlist mode)
  *   prev              Previous track (playlist mode)
  *   loop              Toggle loop mode
+ *   seek <sec>        Jump to a position in the current track
  *   playlist <name>   Load and start playlist (<name>.txt)
  *   info              Show current track info
  *   help              Show command list
@@ -183,6 +184,7 @@ int8_t currentFileIndex = -1;
   uint8_t playlistPos = 0;
   uint8_t currentPlays = 0;           // How many times current track has played
   uint16_t lastLoopCount = 0;         // Track loop count to detect new loops
+  uint16_t lastTrackNumber = 0;       // Engine track number to detect gapless changes
   bool playlistShuffle = false;
   bool playlistLoop = false;
   bool playlistActive = false;
@@ -214,6 +216,8 @@ void printError(const char* msg, const char* detail = nullptr);
   bool loadPlaylist(const char* name);
   void startPlaylist();
   void playNextInPlaylist();
+  void queueNextInPlaylist();
+  void followQueuedTrack();
   void shufflePlaylist();
   int8_t findFileIndex(const char* name);
 #endif
@@ -260,6 +264,11 @@ void setup() {
   }
   Serial.println(F("OK!"));
 
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  // Remember parsed headers so files start faster and list with details
+  player.setInfoCache(true);
+#endif
+
   // Scan for VGM files
   scanFiles();
 #ifndef AVR_NO_PLAYLISTS
@@ -327,7 +336,10 @@ void loop() {
         player.stop();
         playNextInPlaylist();
       } else {
-        // Still more plays needed
+        // Still more plays needed - queue the next track for the last one
+        if (currentPlays + 1 >= targetPlays) {
+          queueNextInPlaylist();
+        }
         Serial.print(F("[Playlist: track "));
         Serial.print(playlistPos + 1);
         Serial.print(F("/"));
@@ -340,6 +352,11 @@ void loop() {
       }
     }
   }
+
+  // Playlist: the engine moved on to the queued track without a gap
+  if (playlistActive && player.getTrackNumber() != lastTrackNumber) {
+    followQueuedTrack();
+  }
 #endif
 
   // Show status when playback finishes
@@ -356,6 +373,10 @@ void loop() {
       Serial.print(F("> "));
     }
     wasPlaying = false;
+  } else if (wasPlaying && player.enqueueFailed()) {
+    Serial.println(F("Couldn't open the next file - playback stopped"));
+    Serial.print(F("> "));
+    wasPlaying = false;
   } else if (player.isPlaying()) {
     wasPlaying = true;
   }
@@ -383,13 +404,14 @@ void scanFiles() {
       const char* name = entry.name();
       size_t len = strlen(name);
 
-      // Check for .vgm or .vgz extension (case insensitive)
+      // Check for .vgm, .vgz or .gec extension (case insensitive)
       if (len >= 4) {
         const char* ext = name + len - 4;
         bool isVGM = (strcasecmp(ext, ".vgm") == 0);
         bool isVGZ = (strcasecmp(ext, ".vgz") == 0);
+        bool isGEC = (strcasecmp(ext, ".gec") == 0);
 
-        if (isVGM || isVGZ) {
+        if (isVGM || isVGZ || isGEC) {
           // On AVR, warn about VGZ but still list it
           strncpy(fileList[fileCount], name, MAX_FILENAME_LEN - 1);
           fileList[fileCount][MAX_FILENAME_LEN - 1] = '\0';
@@ -472,6 +494,27 @@ void printFileList() {
       Serial.print(F(". "));
       Serial.print(fileList[i]);
 
+#if GENESIS_ENGINE_USE_INFO_CACHE
+      // Duration and title of files played before
+      char path[MAX_FILENAME_LEN + 2];
+      path[0] = '/';
+      strncpy(path + 1, fileList[i], MAX_FILENAME_LEN);
+      path[MAX_FILENAME_LEN + 1] = '\0';
+      VGMFileInfo info;
+      if (player.getFileInfo(path, info)) {
+        uint32_t dur = info.totalSamples / VGM_SAMPLE_RATE;
+        Serial.print(F("  "));
+        Serial.print(dur / 60);
+        Serial.print(':');
+        if (dur % 60 < 10) Serial.print('0');
+        Serial.print(dur % 60);
+        if (info.title[0]) {
+          Serial.print(F("  "));
+          Serial.print(info.title);
+        }
+      }
+#endif
+
       // Mark currently playing file
       if (i == currentFileIndex && player.isPlaying()) {
         Serial.print(F(" [PLAYING]"));
@@ -563,6 +606,12 @@ void playFileByName(const char* name) {
   }
 
   // Show file info
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  if (player.getTitle()[0]) {
+    Serial.print(F("  Title: "));
+    Serial.println(player.getTitle());
+  }
+#endif
   Serial.print(F("  Duration: "));
   uint32_t dur = (uint32_t)player.getDurationSeconds();
   Serial.print(dur / 60);
@@ -736,6 +785,7 @@ void startPlaylist() {
   playlistPos = 0;
   currentPlays = 0;
   lastLoopCount = 0;
+  lastTrackNumber = 0;
 
   // Start first track
   uint8_t fileIdx = playlistIndices[0];
@@ -745,6 +795,9 @@ void startPlaylist() {
 
   // Enable looping if we need to play more than once (must be after file loads)
   player.setLooping(targetPlays > 1 && player.hasLoop());
+  if (!player.isLooping()) {
+    queueNextInPlaylist();
+  }
 
   Serial.print(F("[Playlist: track 1/"));
   Serial.print(playlistSize);
@@ -803,9 +856,13 @@ void playNextInPlaylist() {
   targetPlays = playlistPlays[playlistPos];
 
   playFileByIndex(fileIdx);
+  lastTrackNumber = 0;
 
   // Enable looping if we need to play more than once (must be after file loads)
   player.setLooping(targetPlays > 1 && player.hasLoop());
+  if (!player.isLooping()) {
+    queueNextInPlaylist();
+  }
 
   Serial.print(F("[Playlist: track "));
   Serial.print(playlistPos + 1);
@@ -817,6 +874,55 @@ void playNextInPlaylist() {
   }
   Serial.println(F("]"));
 }
+
+void queueNextInPlaylist() {
+  // Last play of this track: let it run to the end and hand over to the
+  // next one there, with no stop/reset in between
+  uint8_t nextPos = playlistPos + 1;
+  if (nextPos >= playlistSize) {
+    if (!playlistLoop) return;  // Finishes normally
+    nextPos = 0;
+  }
+
+  char path[MAX_FILENAME_LEN + 2];
+  path[0] = '/';
+  strncpy(path + 1, fileList[playlistIndices[nextPos]], MAX_FILENAME_LEN);
+  path[MAX_FILENAME_LEN + 1] = '\0';
+
+  player.setLooping(false);
+  player.enqueue(path);
+}
+
+void followQueuedTrack() {
+  lastTrackNumber = player.getTrackNumber();
+
+  playlistPos++;
+  if (playlistPos >= playlistSize) {
+    playlistPos = 0;
+    Serial.println(F("[Playlist: restarting]"));
+  }
+  currentPlays = 0;
+  lastLoopCount = 0;
+  currentFileIndex = playlistIndices[playlistPos];
+
+  uint8_t targetPlays = playlistPlays[playlistPos];
+  player.setLooping(targetPlays > 1 && player.hasLoop());
+  if (!player.isLooping()) {
+    queueNextInPlaylist();
+  }
+
+  Serial.print(F("Playing: "));
+  Serial.println(fileList[currentFileIndex]);
+  Serial.print(F("[Playlist: track "));
+  Serial.print(playlistPos + 1);
+  Serial.print(F("/"));
+  Serial.print(playlistSize);
+  if (targetPlays > 1) {
+    Serial.print(F(", play 1/"));
+    Serial.print(targetPlays);
+  }
+  Serial.println(F("]"));
+}
 #endif // AVR_NO_PLAYLISTS
 
 // =============================================================================
@@ -863,6 +969,18 @@ void processCommand(const char* cmd) {
   else if (strcasecmp(cmd, "info") == 0) {
     printInfo();
   }
+  else if (strncasecmp(cmd, "seek ", 5) == 0) {
+    uint32_t seconds = strtoul(cmd + 5, nullptr, 10);
+    if (player.isStopped() || player.isFinished()) {
+      Serial.println(F("Nothing playing"));
+    } else if (player.seekToSample(seconds * VGM_SAMPLE_RATE)) {
+      Serial.print(F("Position: "));
+      Serial.print(seconds);
+      Serial.println(F("s"));
+    } else {
+      Serial.println(F("Seek failed"));
+    }
+  }
   else if (strcasecmp(cmd, "next") == 0) {
 #ifndef AVR_NO_PLAYLISTS
     if (playlistActive) {
@@ -938,6 +1056,15 @@ void processCommand(const char* cmd) {
 #endif
     printFileList();
   }
+#if GENESIS_ENGINE_USE_PROFILING
+  else if (strcasecmp(cmd, "profile") == 0) {
+    player.printProfile(Serial);
+  }
+  else if (strcasecmp(cmd, "profile reset") == 0) {
+    player.resetProfile();
+    Serial.println(F("Profile reset"));
+  }
+#endif
   else if (strncasecmp(cmd, "play ", 5) == 0) {
     const char* arg = cmd + 5;
     while (*arg == ' ') arg++;  // Skip spaces
@@ -1041,8 +1168,16 @@ void printHelp() {
   Serial.println(F("  next            Next file"));
   Serial.println(F("  prev            Previous file"));
   Serial.println(F("  loop            Toggle loop mode"));
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  Serial.println(F("  seek <sec>      Jump to a position"));
+#else
+  Serial.println(F("  seek <sec>      Jump to a position (.gec)"));
+#endif
   Serial.println(F("  info            Show current track info"));
   Serial.println(F("  rescan          Rescan SD card for files"));
+#if GENESIS_ENGINE_USE_PROFILING
+  Serial.println(F("  profile [reset] Show/reset playback timings"));
+#endif
   Serial.println(F("  help            Show this help"));
   Serial.println(F(""));
   Serial.println(F("Tip: Just type a number to play that file"));
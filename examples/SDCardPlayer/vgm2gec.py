@@ -0,0 +1,436 @@
+#!/usr/bin/env python3
+"""
+vgm2gec.py - Compile VGM/VGZ files into GEC files for GenesisEngine
+
+GEC is a playback format made for the device: the VGM commands are grouped
+into frames (one per wait) with a fixed-width header that counts the
+YM2612 and SN76489 writes of each frame, so the player copies writes out
+without decoding a command byte for each one. DAC samples take a 4-bit
+gap each and read on through the data bank, with pre-resolved positions
+where the VGM jumps, and a seek table lists a frame for every second of
+music. See src/GECFormat.h for the layout.
+
+Features:
+  - Decompress VGZ
+  - All YM2612 PCM data blocks merged into one bank
+  - DAC samples take 4 bits each, with bank positions resolved ahead
+  - Seek table (one entry per second) for seekToSample() without a
+    register shadow
+  - Preserves loop points and the GD3 track title
+
+GEC files play from SD card (name them .gec) or PROGMEM like VGM files.
+
+Usage:
+    python vgm2gec.py input.vgz -o output.gec
+    python vgm2gec.py input.vgm --no-dac -o output_no_dac.gec
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+from vgm_prep import decompress_vgz, read_u32, parse_header, VGM_MAGIC
+
+
+# =============================================================================
+# GEC Constants (match src/GECFormat.h)
+# =============================================================================
+
+GEC_MAGIC = b'GEC1'
+GEC_VERSION = 1
+GEC_HEADER_SIZE = 0x60
+GEC_TITLE_SIZE = 0x20
+
+GEC_FLAG_YM2612 = 0x01
+GEC_FLAG_SN76489 = 0x02
+GEC_FLAG_LOOP = 0x04
+
+GEC_FRAME_HEADER_SIZE = 5
+GEC_FRAME_BANK_SEEK = 0x8000
+
+# Write groups, in frame order
+GROUP_YM0 = 0
+GROUP_YM1 = 1
+GROUP_YM0_AFTER = 2
+GROUP_PSG = 3
+
+SEEK_INTERVAL = 44100
+
+MAX_WAIT = 0x7FFF   # Frame wait (bit 15 flags a bank seek)
+MAX_COUNT = 0x0F    # Writes per group and frame
+MAX_SAMPLES = 0xFF  # DAC samples per frame
+MAX_GAP = 0x0F      # Samples before a DAC sample (4 bits)
+
+# VGM header offsets not in vgm_prep
+OFF_SN76489_CLOCK = 0x0C
+OFF_GD3 = 0x14
+OFF_YM2612_CLOCK = 0x2C
+
+# Argument bytes of VGM commands that are skipped
+SKIP_LENGTHS = {0x4F: 1, 0x90: 4, 0x91: 4, 0x92: 5, 0x93: 10, 0x94: 1, 0x95: 4}
+
+
+# =============================================================================
+# VGM Input
+# =============================================================================
+
+def read_title(data):
+    """GD3 English track title as ASCII ('' if there is none)."""
+    gd3_rel = read_u32(data, OFF_GD3)
+    if not gd3_rel:
+        return ''
+    pos = OFF_GD3 + gd3_rel
+    if data[pos:pos+4] != b'Gd3 ':
+        return ''
+    text = data[pos+12:]
+    end = 0
+    while end + 1 < len(text) and (text[end] or text[end+1]):
+        end += 2
+    title = text[:end].decode('utf-16-le', errors='replace')
+    return ''.join(c if 0x20 <= ord(c) < 0x7F else '?' for c in title)
+
+
+def command_length(cmd):
+    """Argument bytes of a fixed-length VGM command (None = unknown)."""
+    if cmd in SKIP_LENGTHS:
+        return SKIP_LENGTHS[cmd]
+    if 0x30 <= cmd <= 0x3F:
+        return 1
+    if 0x40 <= cmd <= 0x5F or 0xA0 <= cmd <= 0xBF:
+        return 2
+    if 0xC0 <= cmd <= 0xDF:
+        return 3
+    if 0xE0 <= cmd <= 0xFF:
+        return 4
+    return None
+
+
+# =============================================================================
+# GEC Output
+# =============================================================================
+
+class Frame:
+    """Chip writes due at one point in time, and the DAC samples after it."""
+
+    def __init__(self, time):
+        self.time = time
+        self.writes = ([], [], [], [])  # YM2612 port 0, 1, 0 again, SN76489
+        self.bank_seek = None           # Data bank position of the first sample
+        self.samples = []               # Sample times
+
+    def add(self, group, values):
+        """Add a write, False if it needs a new frame."""
+        if self.samples:
+            return False  # Writes come before the samples
+        if group == GROUP_YM1 and self.writes[GROUP_YM0_AFTER]:
+            return False  # YM2612 writes keep their order
+        if group == GROUP_YM0 and self.writes[GROUP_YM1]:
+            group = GROUP_YM0_AFTER
+        if len(self.writes[group]) >= MAX_COUNT:
+            return False
+        self.writes[group].append(values)
+        return True
+
+    def add_sample(self, time):
+        """Add a DAC sample, False if its gap doesn't fit."""
+        last = self.samples[-1] if self.samples else self.time
+        if time - last > MAX_GAP or len(self.samples) >= MAX_SAMPLES:
+            return False
+        self.samples.append(time)
+        return True
+
+    def empty(self):
+        return not any(self.writes) and not self.samples
+
+
+def read_events(data, header, strip_dac):
+    """Chip writes and DAC samples of a VGM file, in order.
+
+    Returns (events, bank, end_time, loop_event, streams) where events are
+    (time, group, values) for writes and (time, None, bank_position) for DAC
+    samples, and loop_event is the index of the first event at or after
+    the loop point (None without a loop).
+    """
+    loop_offset = header['loop_offset']
+    loop_event = None
+    events = []
+    bank = bytearray()
+    bank_pos = 0
+    streams = 0
+    time = 0
+
+    pos = header['data_offset']
+    while pos < len(data):
+        if loop_offset and pos == loop_offset:
+            loop_event = len(events)
+
+        cmd = data[pos]
+
+        if cmd == 0x66:
+            break
+
+        if cmd == 0x67:
+            block_type = data[pos + 2]
+            block_size = read_u32(data, pos + 3)
+            if block_type == 0x00 and not strip_dac:
+                bank += data[pos + 7:pos + 7 + block_size]
+            pos += 7 + block_size
+            continue
+
+        if cmd == 0x50:
+            events.append((time, GROUP_PSG, (data[pos + 1],)))
+            pos += 2
+        elif cmd in (0x52, 0x53):
+            if not (strip_dac and data[pos + 1] == 0x2A):
+                group = GROUP_YM1 if cmd & 1 else GROUP_YM0
+                events.append((time, group, (data[pos + 1], data[pos + 2])))
+            pos += 3
+        elif cmd == 0x61:
+            time += data[pos + 1] | (data[pos + 2] << 8)
+            pos += 3
+        elif cmd == 0x62:
+            time += 735
+            pos += 1
+        elif cmd == 0x63:
+            time += 882
+            pos += 1
+        elif 0x70 <= cmd <= 0x7F:
+            time += (cmd & 0x0F) + 1
+            pos += 1
+        elif 0x80 <= cmd <= 0x8F:
+            if bank and not strip_dac:
+                events.append((time, None, bank_pos))
+            bank_pos += 1
+            time += cmd & 0x0F
+            pos += 1
+        elif cmd == 0xE0:
+            bank_pos = read_u32(data, pos + 1)
+            pos += 5
+        else:
+            length = command_length(cmd)
+            if length is None:
+                raise ValueError(f"Unknown VGM command 0x{cmd:02X} at 0x{pos:X}")
+            if 0x90 <= cmd <= 0x95:
+                streams += 1
+            pos += 1 + length
+
+    return events, bank, time, loop_event, streams
+
+
+def build_frames(events, end_time, loop_event):
+    """Frames for the events. Returns (frames, loop frame index).
+
+    The loop point and every second start a frame that seeks the data bank
+    before its first sample, so playback can start there.
+    """
+    frames = []
+    loop_frame = None
+    next_second = 0
+    bank_next = None  # Bank position the next sample reads without a seek
+
+    def start(time):
+        frames.append(Frame(time))
+        return frames[-1]
+
+    frame = None
+    for i, (time, group, value) in enumerate(events + [(end_time, None, None)]):
+        while next_second * SEEK_INTERVAL <= time and next_second * SEEK_INTERVAL < end_time:
+            frame = start(next_second * SEEK_INTERVAL)
+            bank_next = None
+            next_second += 1
+        if i == len(events):
+            break
+        if i == loop_event:
+            frame = start(time)
+            loop_frame = len(frames) - 1
+            bank_next = None
+
+        if group is not None:
+            if frame is None or frame.time != time or not frame.add(group, value):
+                frame = start(time)
+                frame.add(group, value)
+            continue
+
+        # DAC sample - a bank seek only comes before the first one
+        seek = value != bank_next
+        if frame is None or (seek and frame.samples) or not frame.add_sample(time):
+            frame = start(time)
+            frame.add_sample(time)
+        if seek:
+            frame.bank_seek = value
+        bank_next = value + 1
+
+    # A loop point after the last event has nothing to loop
+    return frames, loop_frame
+
+
+def write_frames(frames, end_time, loop_frame):
+    """Frame data, the loop frame offset and the seek table entries."""
+    out = bytearray()
+    offsets = []
+    seek_table = []
+
+    for i, frame in enumerate(frames):
+        offsets.append(len(out))
+        if frame.time == len(seek_table) * SEEK_INTERVAL:
+            seek_table.append((frame.time, len(out)))
+
+        wait = (frames[i + 1].time if i + 1 < len(frames) else end_time) - frame.time
+        if wait == 0 and frame.empty():
+            continue  # Would read as the end - the next frame starts here too
+
+        ym0, ym1, ym0_after, psg = frame.writes
+        first = min(wait, MAX_WAIT)
+        word = first | (GEC_FRAME_BANK_SEEK if frame.bank_seek is not None else 0)
+        out += struct.pack('<HBBB', word, len(ym0) | (len(ym1) << 4),
+                           len(ym0_after) | (len(psg) << 4), len(frame.samples))
+        if frame.bank_seek is not None:
+            out += struct.pack('<I', frame.bank_seek)
+        for reg, val in ym0 + ym1 + ym0_after:
+            out += bytes((reg, val))
+        for (val,) in psg:
+            out.append(val)
+
+        # Sample gaps, two per byte
+        gaps = [t - p for t, p in zip(frame.samples, [frame.time] + frame.samples)]
+        gaps += [0] * (len(gaps) & 1)
+        out += bytes(gaps[j] | (gaps[j + 1] << 4) for j in range(0, len(gaps), 2))
+
+        # Long silences go on in frames without writes
+        wait -= first
+        while wait > 0:
+            out += struct.pack('<HBBB', min(wait, MAX_WAIT), 0, 0, 0)
+            wait -= min(wait, MAX_WAIT)
+
+    # An empty frame ends the data
+    out += bytes(GEC_FRAME_HEADER_SIZE)
+    loop_offset = offsets[loop_frame] if loop_frame is not None else None
+    return out, loop_offset, seek_table
+
+
+def compile_vgm(data, strip_dac=False, verbose=False):
+    """Compile VGM data into GEC data. Returns the GEC bytes."""
+    header = parse_header(data)
+    if not header:
+        raise ValueError("Invalid VGM file")
+
+    version = header['version']
+    has_sn = read_u32(data, OFF_SN76489_CLOCK) != 0
+    has_ym = version >= 0x110 and read_u32(data, OFF_YM2612_CLOCK) != 0
+    if not has_ym and not has_sn:
+        raise ValueError("VGM has no YM2612 or SN76489")
+
+    events, bank, end_time, loop_event, streams = read_events(data, header, strip_dac)
+    frames, loop_frame = build_frames(events, end_time, loop_event)
+    frame_data, loop_offset, seek_table = write_frames(frames, end_time, loop_frame)
+
+    if streams:
+        print(f"  Warning: {streams} DAC stream commands skipped "
+              "(play the .vgm for DAC streams)")
+
+    # Data area: PCM bank, frames, seek table
+    pcm_size = len(bank)
+    has_loop = loop_offset is not None
+
+    flags = ((GEC_FLAG_YM2612 if has_ym else 0) |
+             (GEC_FLAG_SN76489 if has_sn else 0) |
+             (GEC_FLAG_LOOP if has_loop else 0))
+    title = read_title(data).encode('ascii')[:GEC_TITLE_SIZE - 1]
+
+    gec = bytearray(GEC_HEADER_SIZE)
+    gec[0x00:0x04] = GEC_MAGIC
+    gec[0x04] = GEC_VERSION
+    gec[0x05] = flags
+    struct.pack_into('<IIIIII', gec, 0x08,
+                     header['total_samples'],
+                     header['loop_samples'] if has_loop else 0,
+                     GEC_HEADER_SIZE,
+                     pcm_size,
+                     pcm_size + loop_offset if has_loop else 0,
+                     pcm_size + len(frame_data))
+    struct.pack_into('<H', gec, 0x20, len(seek_table))
+    struct.pack_into('<I', gec, 0x24, version)
+    gec[0x40:0x40 + len(title)] = title
+
+    gec += bank
+    gec += frame_data
+    for sample, offset in seek_table:
+        gec += struct.pack('<II', sample, pcm_size + offset)
+
+    if verbose:
+        dac_samples = sum(1 for event in events if event[1] is None)
+        print(f"  Frames: {len(frames):,}")
+        print(f"  PCM bank: {pcm_size:,} bytes, {dac_samples:,} DAC samples")
+        print(f"  Seek table: {len(seek_table)} entries")
+        if has_loop:
+            print(f"  Loop frame at data offset 0x{pcm_size + loop_offset:X}")
+
+    return bytes(gec)
+
+
+# =============================================================================
+# Main
+# =============================================================================
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compile VGM/VGZ files into GEC files for GenesisEngine",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+    # Compile a VGZ file
+    python vgm2gec.py song.vgz -o song.gec
+
+    # Strip all DAC data (FM/PSG only)
+    python vgm2gec.py song.vgm --no-dac -o song_no_dac.gec
+
+    # Compile all VGZ files in a directory
+    for f in *.vgz; do python vgm2gec.py "$f"; done
+
+GEC files play from SD card (with a .gec extension) or PROGMEM.
+        """
+    )
+
+    parser.add_argument('input', help='Input VGM or VGZ file')
+    parser.add_argument('-o', '--output', help='Output GEC file (default: input.gec)')
+    parser.add_argument('--no-dac', action='store_true',
+                        help='Strip all DAC/PCM data (FM/PSG only)')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='Verbose output')
+
+    args = parser.parse_args()
+
+    if not os.path.exists(args.input):
+        print(f"Error: File not found: {args.input}")
+        return 1
+
+    output_path = args.output or os.path.splitext(args.input)[0] + '.gec'
+
+    print(f"Reading: {args.input}")
+    with open(args.input, 'rb') as f:
+        data = decompress_vgz(f.read())
+
+    if data[:4] != VGM_MAGIC:
+        print("Error: Not a valid VGM file")
+        return 1
+
+    print("Compiling...")
+    try:
+        gec = compile_vgm(data, strip_dac=args.no_dac, verbose=args.verbose)
+    except Exception as e:
+        print(f"Error compiling VGM: {e}")
+        return 1
+
+    print(f"Writing: {output_path}")
+    with open(output_path, 'wb') as f:
+        f.write(gec)
+
+    ratio = len(gec) / len(data) * 100
+    print(f"  Output size: {len(gec):,} bytes ({ratio:.1f}% of VGM)")
+    print("Done!")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -22,11 +22,14 @@ Usage:
 """
 
 import argparse
-import gzip
 import os
 import struct
 import sys
 
+# Shared VGM file handling (tools/vgm_preprocess.py)
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'tools'))
+from vgm_preprocess import decompress_vgz, parse_vgm_header
+
 
 # =============================================================================
 # VGM Constants
@@ -67,13 +70,6 @@ FRAME_PAL = 882
 # VGM Processing
 # =============================================================================
 
-def decompress_vgz(data):
-    """Decompress VGZ data if needed."""
-    if data[:2] == b'\x1f\x8b':
-        return gzip.decompress(data)
-    return data
-
-
 def read_u32(data, offset):
     """Read little-endian uint32."""
     return struct.unpack('<I', data[offset:offset+4])[0]
@@ -91,29 +87,7 @@ def write_u16(value):
 
 def parse_header(data):
     """Parse VGM header, return dict of fields."""
-    if data[:4] != VGM_MAGIC:
-        return None
-
-    version = read_u32(data, OFF_VERSION)
-    total_samples = read_u32(data, OFF_TOTAL_SAMPLES)
-
-    loop_offset_rel = read_u32(data, OFF_LOOP_OFFSET)
-    loop_offset = (OFF_LOOP_OFFSET + loop_offset_rel) if loop_offset_rel else 0
-    loop_samples = read_u32(data, OFF_LOOP_SAMPLES)
-
-    if version >= 0x150:
-        data_offset_rel = read_u32(data, OFF_DATA_OFFSET)
-        data_offset = (OFF_DATA_OFFSET + data_offset_rel) if data_offset_rel else 0x40
-    else:
-        data_offset = 0x40
-
-    return {
-        'version': version,
-        'total_samples': total_samples,
-        'loop_offset': loop_offset,
-        'loop_samples': loop_samples,
-        'data_offset': data_offset,
-    }
+    return parse_vgm_header(data)
 
 
 def extract_pcm_data(data, data_offset):
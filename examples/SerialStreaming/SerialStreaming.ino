@@ -43,6 +43,7 @@
   #define BUFFER_FILL_BEFORE_PLAY 384
   #define CHUNKS_IN_FLIGHT 1
   #define BOARD_TYPE 1  // Uno
+  #define DICT_SIZE 64
 #elif defined(__AVR_ATmega2560__)
   #define BUFFER_SIZE 2048
   #define BUFFER_MASK 0x7FF
@@ -50,6 +51,7 @@
   #define BUFFER_FILL_BEFORE_PLAY 1536
   #define CHUNKS_IN_FLIGHT 1
   #define BOARD_TYPE 2  // Mega
+  #define DICT_SIZE BATCH_DICT_MAX
 #elif defined(__IMXRT1062__)
   #define BUFFER_SIZE 4096
   #define BUFFER_MASK 0xFFF
@@ -57,6 +59,7 @@
   #define BUFFER_FILL_BEFORE_PLAY 3072
   #define CHUNKS_IN_FLIGHT 1
   #define BOARD_TYPE 4  // Teensy 4.x
+  #define DICT_SIZE BATCH_DICT_MAX
 #elif defined(ARDUINO_ARCH_ESP32)
   #define BUFFER_SIZE 4096
   #define BUFFER_MASK 0xFFF
@@ -64,6 +67,7 @@
   #define BUFFER_FILL_BEFORE_PLAY 3072
   #define CHUNKS_IN_FLIGHT 1
   #define BOARD_TYPE 5  // ESP32
+  #define DICT_SIZE BATCH_DICT_MAX
 #else
   #define BUFFER_SIZE 4096
   #define BUFFER_MASK 0xFFF
@@ -71,11 +75,19 @@
   #define BUFFER_FILL_BEFORE_PLAY 3072
   #define CHUNKS_IN_FLIGHT 1
   #define BOARD_TYPE 3  // Other
+  #define DICT_SIZE BATCH_DICT_MAX
 #endif
 
+// CHUNKS_IN_FLIGHT paces stop-and-wait hosts (CHUNK_HEADER); hosts sending
+// sequenced chunks (CHUNK_HEADER_SEQ) are paced by FLOW_CREDIT instead
 #define CHUNK_HEADER 0x01
 #define CHUNK_END    0x02
 
+// Must match DICT_SIZES in stream_vgm.py
+#if DICT_SIZE > BATCH_DICT_MAX || (DICT_SIZE % 8) != 0
+  #error "DICT_SIZE must be a multiple of 8, at most BATCH_DICT_MAX"
+#endif
+
 // =============================================================================
 // Pin Configuration
 // =============================================================================
@@ -158,6 +170,38 @@ bool streamEnded = false;
 // Timeout detection
 uint32_t lastDataTime = 0;
 #define DISCONNECT_TIMEOUT_MS 500
+#define PING_QUIET_MS 50  // Mid-stream PINGs are line noise (sliding window)
+
+// =============================================================================
+// Protocol v2 State
+// =============================================================================
+
+// Register dictionary: index -> (port, reg)
+uint8_t dictReg[DICT_SIZE];
+uint8_t dictPort[DICT_SIZE / 8];  // Port bit per index
+
+// Last frequency pair written to each channel, for BATCH_FREQ_DELTA
+uint8_t freqHi[6];
+uint8_t freqLo[6];
+
+// Entries left in the batch being decoded
+uint8_t batchRemaining = 0;
+
+// Samples left in a DAC run or values left in a PSG run
+uint8_t runSelector = 0;
+uint8_t runRemaining = 0;
+uint8_t runWait = 0;
+uint8_t runPhase = 0;  // BATCH_DAC_RUN_VAR: second sample of a pair
+
+// Back to the state a new stream starts in
+void resetSession() {
+  memset(dictReg, 0, sizeof(dictReg));
+  memset(dictPort, 0, sizeof(dictPort));
+  memset(freqHi, 0, sizeof(freqHi));
+  memset(freqLo, 0, sizeof(freqLo));
+  batchRemaining = 0;
+  runRemaining = 0;
+}
 
 // =============================================================================
 // Setup
@@ -192,6 +236,7 @@ void setup() {
       if (b == CMD_PING) {
         Serial.write(CMD_ACK);
         Serial.write(BOARD_TYPE);
+        Serial.write(PROTOCOL_VERSION);
         Serial.write(FLOW_READY);
         break;
       }
@@ -207,7 +252,7 @@ void setup() {
 // =============================================================================
 
 // Receive state machine
-enum RxState { RX_IDLE, RX_HAVE_HEADER, RX_HAVE_LENGTH, RX_AWAITING_CHECKSUM };
+enum RxState { RX_IDLE, RX_HAVE_SEQ_HEADER, RX_HAVE_HEADER, RX_HAVE_LENGTH, RX_AWAITING_CHECKSUM };
 RxState rxState = RX_IDLE;
 uint8_t rxLength = 0;
 uint8_t rxCount = 0;
@@ -215,6 +260,105 @@ uint8_t rxChecksum = 0;
 uint8_t rxTempBuf[CHUNK_SIZE];
 uint8_t chunksReceived = 0;  // Count chunks for pipelined ACK
 
+#if defined(__IMXRT1062__)
+// Teensy 4: chunk data is read a USB packet at a time straight into the
+// ring's free space past bufferHead, and only committed (bufferHead moved)
+// once the checksum passes - no per-byte Serial.read(), no copy
+#define RX_BULK 1
+bool rxInRing = false;       // Chunk is landing in the ring, not rxTempBuf
+#else
+#define RX_BULK 0
+#endif
+
+// Sliding window (sequenced chunks)
+bool rxSequenced = false;    // Chunk being received has a sequence number
+uint8_t rxSeq = 0;
+uint8_t rxExpectedSeq = 0;   // Next chunk to go in the ring
+bool windowed = false;       // Host is sending sequenced chunks
+bool resendRequested = false;  // FLOW_RESEND for rxExpectedSeq already sent
+uint16_t creditFree = 0;     // Free space in the last FLOW_CREDIT
+
+void resetWindow() {
+  rxExpectedSeq = 0;
+  windowed = false;
+  resendRequested = false;
+}
+
+// Tell the host how far it has got and how much room is left
+void sendCredit() {
+  creditFree = bufferFree();
+  Serial.write(FLOW_CREDIT);
+  Serial.write(rxExpectedSeq);
+  Serial.write((uint8_t)(creditFree & 0xFF));
+  Serial.write((uint8_t)(creditFree >> 8));
+}
+
+// Ask for everything from the first missing chunk on, once per gap
+void sendResend(bool again) {
+  if (resendRequested && !again) return;
+  Serial.write(FLOW_RESEND);
+  Serial.write(rxExpectedSeq);
+  resendRequested = true;
+}
+
+#if RX_BULK
+// XOR of a block, a word at a time
+inline uint8_t xorBlock(const uint8_t* p, uint8_t n) {
+  uint32_t x = 0;
+  for (; n >= 4; n -= 4, p += 4) {
+    uint32_t w;
+    memcpy(&w, p, 4);
+    x ^= w;
+  }
+  x ^= x >> 16;
+  x ^= x >> 8;
+  uint8_t c = (uint8_t)x;
+  while (n--) {
+    c ^= *p++;
+  }
+  return c;
+}
+
+// Read as much of the chunk's data as USB has, up to the ring's wrap point
+// (the rest lands at the start of the ring on the next pass)
+void receiveChunkData() {
+  uint16_t want = rxLength - rxCount;
+  uint16_t avail = Serial.available();
+  if (want > avail) want = avail;
+
+  uint8_t* dst;
+  if (rxInRing) {
+    uint16_t at = (bufferHead + rxCount) & BUFFER_MASK;
+    if (want > BUFFER_SIZE - at) want = BUFFER_SIZE - at;
+    dst = (uint8_t*)&buffer[at];
+  } else {
+    dst = &rxTempBuf[rxCount];
+  }
+
+  uint8_t got = Serial.readBytes((char*)dst, want);
+  rxChecksum ^= xorBlock(dst, got);
+  rxCount += got;
+  lastDataTime = millis();
+
+  if (rxCount >= rxLength) {
+    rxState = RX_AWAITING_CHECKSUM;
+  }
+}
+#endif
+
+// Move a chunk that passed its checksum into the ring
+inline void commitChunk() {
+#if RX_BULK
+  if (rxInRing) {
+    bufferHead = (bufferHead + rxLength) & BUFFER_MASK;
+    return;
+  }
+#endif
+  for (uint8_t i = 0; i < rxLength; i++) {
+    bufferWrite(rxTempBuf[i]);
+  }
+}
+
 #if defined(ARDUINO_ARCH_ESP32)
 // ESP32: Bulk read buffer to reduce per-byte Serial.read() overhead
 // Each Serial.read() call on ESP32 involves FreeRTOS queue operations
@@ -267,12 +411,34 @@ void receiveData() {
     uint8_t b = (uint8_t)result;
 #else
   while (Serial.available() > 0) {
+#if RX_BULK
+    if (rxState == RX_HAVE_LENGTH) {
+      receiveChunkData();
+      continue;
+    }
+#endif
     uint8_t b = Serial.read();
 #endif
+    uint32_t quietMs = millis() - lastDataTime;
     lastDataTime = millis();  // Track when we last received data
 
     switch (rxState) {
       case RX_IDLE:
+        // Between sequenced chunks, control bytes are only a damaged header
+        // away from payload - only believe a PING after a quiet line
+        if (windowed && (b == CHUNK_HEADER || b == CHUNK_END ||
+                         (b == CMD_PING && quietMs < PING_QUIET_MS))) {
+          break;
+        }
+
+        // Host is waiting for room (keeps the disconnect timeout away)
+        if (b == CHUNK_KEEPALIVE) {
+          if (windowed) {
+            sendCredit();
+          }
+          break;
+        }
+
         // Handle PING - reset everything and go back to WAITING
         // This allows reconnection after Ctrl+C or disconnect
         if (b == CMD_PING) {
@@ -281,12 +447,15 @@ void receiveData() {
           streamEnded = false;
           chunksReceived = 0;
           nextCommandTime = 0;
+          resetSession();
+          resetWindow();
           state = WAITING;
 #if defined(ARDUINO_ARCH_ESP32)
           esp32SerialBufPos = esp32SerialBufLen = 0;  // Clear bulk buffer
 #endif
           Serial.write(CMD_ACK);
           Serial.write(BOARD_TYPE);
+          Serial.write(PROTOCOL_VERSION);
           Serial.write(FLOW_READY);
           break;
         }
@@ -304,20 +473,49 @@ void receiveData() {
 
         // Chunk header
         if (b == CHUNK_HEADER) {
+          rxSequenced = false;
           rxState = RX_HAVE_HEADER;
+        } else if (b == CHUNK_HEADER_SEQ) {
+          rxSequenced = true;
+          windowed = true;
+          rxState = RX_HAVE_SEQ_HEADER;
         }
         break;
 
+      case RX_HAVE_SEQ_HEADER:
+        // This byte is the sequence number
+        rxSeq = b;
+        rxState = RX_HAVE_HEADER;
+        break;
+
       case RX_HAVE_HEADER:
         // This byte is the length
+        if (b == 0 && rxSequenced) {
+          rxLength = 0;  // End of stream
+          rxChecksum = rxSeq;
+          rxState = RX_AWAITING_CHECKSUM;
+          break;
+        }
         if (b == 0 || b > CHUNK_SIZE) {
-          Serial.write(FLOW_NAK);  // Invalid length - tell Python to retry
+          // Invalid length - tell Python to retry
+          if (rxSequenced) {
+            sendResend(true);
+          } else {
+            Serial.write(FLOW_NAK);
+          }
           rxState = RX_IDLE;
           break;
         }
         rxLength = b;
         rxCount = 0;
         rxChecksum = b;  // Start checksum with length
+        if (rxSequenced) {
+          rxChecksum ^= rxSeq;
+        }
+#if RX_BULK
+        // Room now means room at the checksum - nothing else moves the head
+        rxInRing = bufferFree() >= rxLength;
+#endif
         rxState = RX_HAVE_LENGTH;
         break;
 
@@ -351,11 +549,33 @@ void receiveData() {
 
       case RX_AWAITING_CHECKSUM:
         // This byte is the checksum
+        if (rxSequenced) {
+          if (rxSeq != rxExpectedSeq) {
+            if ((uint8_t)(rxExpectedSeq - rxSeq) <= 128) {
+              sendCredit();         // Already have it - a retransmit overlapped
+            } else {
+              sendResend(false);    // One went missing before this
+            }
+          } else if (b == rxChecksum && rxLength == 0) {
+            streamEnded = true;     // Empty chunk ends the stream
+            rxExpectedSeq++;
+            resendRequested = false;
+            Serial.write(FLOW_READY);
+          } else if (b == rxChecksum && bufferFree() >= rxLength) {
+            commitChunk();
+            rxExpectedSeq++;
+            resendRequested = false;
+            sendCredit();
+          } else {
+            sendResend(true);       // Bad checksum or overran the credit
+          }
+          rxState = RX_IDLE;
+          break;
+        }
+
         if (b == rxChecksum && bufferFree() >= rxLength) {
           // Valid chunk - copy to ring buffer
-          for (uint8_t i = 0; i < rxLength; i++) {
-            bufferWrite(rxTempBuf[i]);
-          }
+          commitChunk();
           chunksReceived++;
 
           // Always send READY immediately during WAITING (need to fill buffer fast)
@@ -379,6 +599,11 @@ void receiveData() {
     Serial.write(FLOW_READY);
     chunksReceived = 0;
   }
+
+  // Playback has made another chunk of room since the last credit
+  if (windowed && !streamEnded && bufferFree() >= creditFree + CHUNK_SIZE) {
+    sendCredit();
+  }
 }
 
 // =============================================================================
@@ -407,6 +632,7 @@ uint8_t commandSize(uint8_t cmd) {
       return 1;
 
     case CMD_RLE_WAIT_FRAME_1: // 0xC0: 1 byte count
+    case CMD_BATCH:            // 0xC1: 1 byte entry count
       return 2;
 
     case CMD_PCM_SEEK:        // 0xE0: 4 bytes offset
@@ -421,14 +647,191 @@ uint8_t commandSize(uint8_t cmd) {
   }
 }
 
+// Size of a batch entry from its selector byte
+uint8_t batchEntrySize(uint8_t sel) {
+  if (sel < BATCH_DICT_MAX) return 2;
+  if (sel <= BATCH_DAC_RUN_VAR) return 2;  // Medium waits, DAC runs
+  if (sel < BATCH_DAC) return 1;           // Short waits, reserved
+  if (sel < BATCH_WAIT_NTSC) return 2;     // DAC, frequency deltas
+  switch (sel) {
+    case BATCH_WAIT:
+    case BATCH_RAW_A0:
+    case BATCH_RAW_A1:
+    case BATCH_DAC_RUN:
+      return 3;
+    case BATCH_PSG:
+    case BATCH_PSG_RUN:
+      return 2;
+    case BATCH_DEFINE_A0:
+    case BATCH_DEFINE_A1:
+      return 4;
+    default:
+      return 1;  // NTSC/PAL frame waits
+  }
+}
+
 // =============================================================================
 // Command Processing
 // =============================================================================
 
+// Every YM2612 write goes through here so frequency deltas have a base
+inline void writeYM(uint8_t port, uint8_t reg, uint8_t val) {
+  uint8_t slot = reg & 0x03;
+  if (slot < 3) {
+    if ((reg & 0xFC) == 0xA4) {
+      freqHi[port * 3 + slot] = val;
+    } else if ((reg & 0xFC) == 0xA0) {
+      freqLo[port * 3 + slot] = val;
+    }
+  }
+  board.writeYM2612(port, reg, val);
+}
+
+// Decodes one entry of the current batch
+// Returns: >0 = wait samples, 0 = continue immediately, -2 = need more data
+int32_t processBatchEntry() {
+  uint8_t sel = bufferPeek();
+  if (bufferAvailable() < batchEntrySize(sel)) return -2;
+  bufferRead();
+  batchRemaining--;
+
+  if (sel < BATCH_DICT_MAX) {
+    uint8_t val = bufferRead();
+    if (sel < DICT_SIZE) {
+      writeYM((dictPort[sel >> 3] >> (sel & 7)) & 1, dictReg[sel], val);
+    }
+    return 0;
+  }
+
+  if (sel < BATCH_WAIT_MEDIUM + 8) {
+    return ((sel & 0x07) << 8) | bufferRead();
+  }
+
+  if (sel == BATCH_DAC_RUN_VAR) {
+    runSelector = sel;
+    runRemaining = bufferRead();
+    runPhase = 0;
+    return 0;
+  }
+
+  if (sel < BATCH_WAIT_SHORT) {
+    return 0;  // Reserved
+  }
+
+  if (sel < BATCH_DAC) {
+    return (sel & 0x0F) + 1;
+  }
+
+  if (sel < BATCH_FREQ_DELTA) {
+    board.writeDAC(bufferRead());
+    return sel & 0x0F;
+  }
+
+  if (sel < BATCH_WAIT_NTSC) {
+    uint8_t ch = sel - BATCH_FREQ_DELTA;
+    uint16_t freq = ((freqHi[ch] << 8) | freqLo[ch]) + (int8_t)bufferRead();
+    uint8_t port = ch >= 3 ? 1 : 0;
+    uint8_t slot = ch - port * 3;
+    writeYM(port, 0xA4 + slot, freq >> 8);  // Latched until the low byte
+    writeYM(port, 0xA0 + slot, freq & 0xFF);
+    return 0;
+  }
+
+  switch (sel) {
+    case BATCH_WAIT_NTSC:
+      return FRAME_SAMPLES_NTSC;
+
+    case BATCH_WAIT_PAL:
+      return FRAME_SAMPLES_PAL;
+
+    case BATCH_WAIT: {
+      uint8_t lo = bufferRead();
+      uint8_t hi = bufferRead();
+      return (uint16_t)(lo | (hi << 8));
+    }
+
+    case BATCH_PSG:
+      board.writePSG(bufferRead());
+      return 0;
+
+    case BATCH_RAW_A0:
+    case BATCH_RAW_A1: {
+      uint8_t reg = bufferRead();
+      uint8_t val = bufferRead();
+      writeYM(sel - BATCH_RAW_A0, reg, val);
+      return 0;
+    }
+
+    case BATCH_DEFINE_A0:
+    case BATCH_DEFINE_A1: {
+      uint8_t index = bufferRead();
+      uint8_t reg = bufferRead();
+      uint8_t val = bufferRead();
+      uint8_t port = sel - BATCH_DEFINE_A0;
+      if (index < DICT_SIZE) {
+        dictReg[index] = reg;
+        if (port) {
+          dictPort[index >> 3] |= (1 << (index & 7));
+        } else {
+          dictPort[index >> 3] &= ~(1 << (index & 7));
+        }
+      }
+      writeYM(port, reg, val);
+      return 0;
+    }
+
+    case BATCH_DAC_RUN:
+      runSelector = sel;
+      runWait = bufferRead();
+      runRemaining = bufferRead();
+      return 0;
+
+    case BATCH_PSG_RUN:
+      runSelector = sel;
+      runRemaining = bufferRead();
+      return 0;
+
+    default:
+      // Unknown entry - skip it
+      return 0;
+  }
+}
+
+// Next sample of a DAC run or value of a PSG run
+// Returns: >0 = wait samples, 0 = continue immediately, -2 = need more data
+int32_t processRunByte() {
+  if (runSelector == BATCH_DAC_RUN_VAR) {
+    if (runPhase == 0) {
+      if (bufferAvailable() < 2) return -2;
+      runWait = bufferRead();  // Waits for this sample and the next
+    }
+    board.writeDAC(bufferRead());
+    runRemaining--;
+    runPhase ^= 1;
+    uint8_t wait = runWait & 0x0F;
+    runWait >>= 4;
+    return wait;
+  }
+
+  uint8_t b = bufferRead();
+  runRemaining--;
+
+  if (runSelector == BATCH_PSG_RUN) {
+    board.writePSG(b);
+    return 0;
+  }
+  board.writeDAC(b);
+  return runWait;
+}
+
 // Returns: >0 = wait samples, 0 = continue immediately, -1 = end, -2 = need more data
 int32_t processCommand() {
   if (bufferEmpty()) return -2;
 
+  // Inside a batch, one entry at a time so updatePlayback() keeps reading serial
+  if (runRemaining > 0) return processRunByte();
+  if (batchRemaining > 0) return processBatchEntry();
+
   uint8_t cmd = bufferPeek();
 
   // Fixed-length commands
@@ -450,14 +853,14 @@ int32_t processCommand() {
     case CMD_YM2612_WRITE_A0: {
       uint8_t reg = bufferRead();
       uint8_t val = bufferRead();
-      board.writeYM2612(0, reg, val);
+      writeYM(0, reg, val);
       return 0;
     }
 
     case CMD_YM2612_WRITE_A1: {
       uint8_t reg = bufferRead();
       uint8_t val = bufferRead();
-      board.writeYM2612(1, reg, val);
+      writeYM(1, reg, val);
       return 0;
     }
 
@@ -482,6 +885,12 @@ int32_t processCommand() {
       return (uint32_t)count * FRAME_SAMPLES_NTSC;
     }
 
+    // === Write Batches (v2) ===
+
+    case CMD_BATCH:
+      batchRemaining = bufferRead();
+      return 0;
+
     // === Stream Control ===
 
     case CMD_END_OF_STREAM:
@@ -623,6 +1032,8 @@ void loop() {
       rxState = RX_IDLE;
       chunksReceived = 0;
       nextCommandTime = 0;
+      resetSession();
+      resetWindow();
 #if defined(ARDUINO_ARCH_ESP32)
       esp32SerialBufPos = esp32SerialBufLen = 0;  // Clear bulk buffer
 #endif
@@ -8,6 +8,12 @@
  *   - Little-endian for multi-byte values (matches AVR native format)
  *   - Single-byte commands followed by binary arguments
  *   - PING/ACK handshaking for device readiness
+ *
+ * Version 2 adds dictionary-coded write batches (see CMD_BATCH). A v2 device
+ * answers PING with ACK, board type, PROTOCOL_VERSION, READY; v1 hosts skip
+ * the version byte, and a v2 host that gets no version byte falls back to v1.
+ * Version 3 adds sequenced chunks with credit-based flow control (see
+ * Flow Control).
  */
 
 #ifndef STREAMING_PROTOCOL_H
@@ -20,6 +26,8 @@
 #define CMD_PING             0x00  // PC->Device: Is device ready?
 #define CMD_ACK              0x0F  // Device->PC: Acknowledgment/ready
 
+#define PROTOCOL_VERSION     3     // Sent after the board type in the handshake
+
 // =============================================================================
 // Chip Write Commands (matches VGM command bytes)
 // =============================================================================
@@ -63,6 +71,48 @@
 #define CMD_RLE_WAIT_FRAME_1 0xC0  // RLE: Wait for N single frames
                                    // Args: uint8_t count (2-255)
 
+// =============================================================================
+// Write Batches (protocol v2)
+// =============================================================================
+
+// A batch packs the writes and waits of one or more frames into short
+// entries. Each entry starts with a selector byte:
+//   0x00-0xBF  dictionary index, then uint8_t value (YM2612 write, 2 bytes)
+//   0xC0-0xFF  everything else, see BATCH_* below
+// The dictionary maps an index to a YM2612 (port, reg). It lasts for the
+// session (until PING or end of stream) and is filled by BATCH_DEFINE_*
+// entries, so the host decides which registers earn an index.
+
+#define CMD_BATCH            0xC1  // Args: uint8_t entries (1-255), entries...
+
+#define BATCH_DICT_MAX       0xC0  // Dictionary indexes are below this
+
+#define BATCH_WAIT_MEDIUM    0xC0  // 0xC0-0xC7: wait (sel & 7) << 8 | lo samples
+                                   // Args: uint8_t lo
+#define BATCH_DAC_RUN_VAR    0xC8  // Args: uint8_t count, then per two samples:
+                                   // uint8_t waits (low nibble first), samples
+                                   // (0xC9-0xCF reserved)
+
+#define BATCH_WAIT_SHORT     0xD0  // 0xD0-0xDF: wait (sel & 0x0F) + 1 samples
+#define BATCH_DAC            0xE0  // 0xE0-0xEF: DAC write, wait (sel & 0x0F)
+                                   // Args: uint8_t sample
+#define BATCH_FREQ_DELTA     0xF0  // 0xF0-0xF5: frequency of channel sel - 0xF0
+                                   // Args: int8_t delta
+                                   // Adds delta to the channel's last
+                                   // (0xA4 << 8 | 0xA0) pair and writes both
+#define BATCH_WAIT_NTSC      0xF6  // Wait 735 samples
+#define BATCH_WAIT_PAL       0xF7  // Wait 882 samples
+#define BATCH_WAIT           0xF8  // Args: uint16_t samples
+#define BATCH_PSG            0xF9  // Args: uint8_t value
+#define BATCH_RAW_A0         0xFA  // Args: uint8_t reg, uint8_t val
+#define BATCH_RAW_A1         0xFB  // Args: uint8_t reg, uint8_t val
+#define BATCH_DEFINE_A0      0xFC  // Args: uint8_t index, uint8_t reg, uint8_t val
+#define BATCH_DEFINE_A1      0xFD  // Args: uint8_t index, uint8_t reg, uint8_t val
+                                   // Maps index to (port, reg), then writes it
+#define BATCH_DAC_RUN        0xFE  // Args: uint8_t wait, uint8_t count, samples...
+                                   // count DAC writes, wait samples after each
+#define BATCH_PSG_RUN        0xFF  // Args: uint8_t count, values...
+
 // =============================================================================
 // Stream Control
 // =============================================================================
@@ -83,6 +133,23 @@
 #define FLOW_READY           0x06  // Device->PC: Ready for more data (ASCII ACK)
 #define FLOW_NAK             0x15  // Device->PC: Bad checksum/retry (ASCII NAK)
 
+// Sliding window (protocol v3). The host sends sequenced chunks
+//   [CHUNK_HEADER_SEQ][seq][length][data...][seq ^ length ^ data checksum]
+// without waiting, as long as the bytes not yet covered by a credit fit in
+// the free space of the last one. Chunks arrive in order or not at all: on a
+// bad checksum or a gap the device asks for the first missing chunk and
+// drops the rest until it comes (go-back-N). A chunk of length 0 ends the
+// stream (in place of CHUNK_END) and is answered with FLOW_READY.
+#define CHUNK_HEADER_SEQ     0x03  // PC->Device: sequenced chunk
+#define CHUNK_KEEPALIVE      0x04  // PC->Device: no room to send, still here
+                                   // Answered with FLOW_CREDIT
+
+#define FLOW_CREDIT          0x11  // Device->PC: uint8_t next seq, uint16_t free
+                                   // Every chunk before next seq is in the ring,
+                                   // which has free bytes of room
+#define FLOW_RESEND          0x12  // Device->PC: uint8_t seq
+                                   // Resend from seq on
+
 // =============================================================================
 // Timing Constants
 // =============================================================================
@@ -5,9 +5,12 @@ stream_vgm.py - High-performance VGM streaming to Genesis Engine
 Uses a compact binary protocol for efficient, real-time playback:
   - Direct binary commands (no text parsing overhead)
   - PING/ACK handshaking for device readiness
+  - Sliding-window flow control with per-chunk retransmit (protocol v3)
   - Output buffering for maximum throughput
   - RLE compression for wait commands
+  - Dictionary-coded write batches (protocol v2)
   - DPCM compression for DAC audio (optional)
+  - Starts sending while the VGM is still being prepared
 
 Protocol: See StreamingProtocol.h for command definitions.
 
@@ -18,7 +21,6 @@ Usage:
 
 import argparse
 import glob
-import gzip
 import os
 import sys
 import struct
@@ -31,6 +33,11 @@ except ImportError:
     print("ERROR: pyserial not installed. Run: pip install pyserial")
     sys.exit(1)
 
+# Shared VGM preprocessing (tools/vgm_preprocess.py)
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'tools'))
+from vgm_preprocess import (decompress_vgz, parse_vgm_header, scan_vgm, stream_commands,
+                            StreamPreparer, BackgroundStream, has_native)
+
 # =============================================================================
 # Protocol Constants (must match StreamingProtocol.h)
 # =============================================================================
@@ -39,6 +46,8 @@ except ImportError:
 CMD_PING = 0x00
 CMD_ACK = 0x0F
 
+PROTOCOL_VERSION = 3
+
 # Chip write commands
 CMD_PSG_WRITE = 0x50
 CMD_YM2612_WRITE_A0 = 0x52
@@ -52,6 +61,25 @@ CMD_WAIT_PAL = 0x63
 # Compression commands
 CMD_RLE_WAIT_FRAME_1 = 0xC0
 
+# Write batches (protocol v2)
+CMD_BATCH = 0xC1
+BATCH_DICT_MAX = 0xC0
+BATCH_WAIT_MEDIUM = 0xC0  # 0xC0-0xC7: 0-2047 samples
+BATCH_DAC_RUN_VAR = 0xC8
+BATCH_WAIT_SHORT = 0xD0  # 0xD0-0xDF: 1-16 samples
+BATCH_DAC = 0xE0         # 0xE0-0xEF: DAC + wait 0-15
+BATCH_FREQ_DELTA = 0xF0  # 0xF0-0xF5: channel 0-5
+BATCH_WAIT_NTSC = 0xF6
+BATCH_WAIT_PAL = 0xF7
+BATCH_WAIT = 0xF8
+BATCH_PSG = 0xF9
+BATCH_RAW_A0 = 0xFA      # 0xFB for port 1
+BATCH_DEFINE_A0 = 0xFC   # 0xFD for port 1
+BATCH_DAC_RUN = 0xFE
+BATCH_PSG_RUN = 0xFF
+BATCH_MAX_ENTRIES = 255
+BATCH_MAX_RUN = 255
+
 # Stream control
 CMD_END_OF_STREAM = 0x66
 CMD_PCM_SEEK = 0xE0
@@ -62,6 +90,12 @@ CMD_PCM_SEEK = 0xE0
 FLOW_READY = 0x06  # ASCII ACK - ready for more data
 FLOW_NAK = 0x15    # ASCII NAK - bad checksum, retry
 
+# Sliding window (protocol v3)
+CHUNK_HEADER_SEQ = 0x03  # [0x03][seq][length][data...][checksum]
+CHUNK_KEEPALIVE = 0x04
+FLOW_CREDIT = 0x11       # [0x11][next seq][free lo][free hi]
+FLOW_RESEND = 0x12       # [0x12][seq]
+
 # Timing
 FRAME_SAMPLES_NTSC = 735
 FRAME_SAMPLES_PAL = 882
@@ -88,6 +122,26 @@ BOARD_SETTINGS = {
     BOARD_TYPE_ESP32: (128, 1, 1),   # ESP32: larger chunks now that serial overhead is fixed
 }
 
+# Most sequenced chunks in flight per board; the free space the device
+# advertises is the other limit. Uno's 64-byte serial buffer overflows if
+# too much arrives while it's busy writing chips.
+WINDOW_CHUNKS = {
+    BOARD_TYPE_UNO: 4,
+    BOARD_TYPE_MEGA: 8,
+    BOARD_TYPE_OTHER: 8,
+    BOARD_TYPE_TEENSY4: 32,
+    BOARD_TYPE_ESP32: 32,
+}
+
+# Register dictionary entries per board (must match DICT_SIZE in SerialStreaming.ino)
+DICT_SIZES = {
+    BOARD_TYPE_UNO: 64,
+    BOARD_TYPE_MEGA: BATCH_DICT_MAX,
+    BOARD_TYPE_OTHER: BATCH_DICT_MAX,
+    BOARD_TYPE_TEENSY4: BATCH_DICT_MAX,
+    BOARD_TYPE_ESP32: BATCH_DICT_MAX,
+}
+
 CHUNK_HEADER = 0x01
 CHUNK_END = 0x02
 
@@ -118,412 +172,361 @@ def list_ports():
         print(f"  {port.device} - {port.description}")
 
 
-def decompress_vgz(data):
-    """Decompress VGZ if needed."""
-    if data[:2] == b'\x1f\x8b':
-        return gzip.decompress(data)
-    return data
+def batch_encoder(register_counts, dict_size=BATCH_DICT_MAX):
+    """Protocol v2 encoder for a stream handed over in pieces.
 
+    Chip writes, waits and DAC samples are packed into CMD_BATCH packets of
+    up to 255 entries. The most used YM2612 registers get dictionary indexes,
+    defined the first time each is written, so those writes cost two bytes;
+    frequency pairs close to the channel's previous pair cost two bytes for
+    both, as do waits under 2048 samples. Short waits fold into the DAC
+    write before them; back-to-back DAC samples cost one byte each when
+    their waits match and one and a half otherwise, and back-to-back PSG
+    writes one byte each. Other commands pass through unchanged.
 
-def parse_vgm_header(data):
-    """Parse VGM header."""
-    if data[:4] != b'Vgm ':
-        return None
+    The dictionary never changes once an index is defined, so the loop
+    section decodes the same on every pass. Frequency deltas only start
+    again after the loop point once the channel has been written in full.
+    Batches never span two pieces.
 
-    version = struct.unpack('<I', data[0x08:0x0C])[0]
-    total_samples = struct.unpack('<I', data[0x18:0x1C])[0]
+    register_counts is VgmScan.register_counts, so the indexes can be
+    handed out before the song has been prepared.
 
-    # Loop offset is relative to 0x1C
-    loop_offset_rel = struct.unpack('<I', data[0x1C:0x20])[0]
-    loop_offset = (0x1C + loop_offset_rel) if loop_offset_rel else 0
-
-    # Loop samples (how long the loop section is)
-    loop_samples = struct.unpack('<I', data[0x20:0x24])[0]
-
-    if version >= 0x150:
-        data_offset_rel = struct.unpack('<I', data[0x34:0x38])[0]
-        data_offset = 0x34 + data_offset_rel if data_offset_rel else 0x40
-    else:
-        data_offset = 0x40
-
-    return {
-        'version': version,
-        'data_offset': data_offset,
-        'total_samples': total_samples,
-        'duration': total_samples / 44100.0,
-        'loop_offset': loop_offset,
-        'loop_samples': loop_samples,
-    }
-
-
-# =============================================================================
-# VGM Processing
-# =============================================================================
-
-def preprocess_vgm(data, data_offset, loop_offset=0):
-    """
-    Preprocess VGM data:
-    1. Extract PCM data block
-    2. Inline DAC bytes for 0x80-0x8F commands
-    3. Convert to stream of (command_byte, args) tuples
-    4. Track loop point index if loop_offset is provided
-
-    Returns: (commands, loop_command_index)
-        loop_command_index is the index into commands where the loop starts,
-        or None if no loop point.
+    Returns: encode(stream, loop_offset) -> (bytes, loop_byte_offset),
+        taking v1 stream bytes that end on a command boundary
+        (see BackgroundStream)
     """
-    # First pass: extract PCM data block
-    pcm_data = None
-    pos = data_offset
-
-    while pos < len(data):
-        cmd = data[pos]
-        if cmd == 0x67:  # Data block
-            if pos + 7 <= len(data):
-                block_type = data[pos + 2]
-                block_size = struct.unpack('<I', data[pos + 3:pos + 7])[0]
-                if block_type == 0x00:
-                    pcm_data = data[pos + 7:pos + 7 + block_size]
-                pos += 7 + block_size
-            else:
-                break
-        elif cmd == 0x66:
-            break
-        elif cmd == 0x50:
-            pos += 2
-        elif cmd in (0x52, 0x53):
-            pos += 3
-        elif cmd == 0x61:
-            pos += 3
-        elif cmd in (0x62, 0x63):
-            pos += 1
-        elif 0x70 <= cmd <= 0x7F:
-            pos += 1
-        elif 0x80 <= cmd <= 0x8F:
-            pos += 1
-        elif cmd == 0xE0:
-            pos += 5
-        else:
-            pos += 1
-
-    # Second pass: generate commands with inlined PCM
-    commands = []
-    pos = data_offset
-    pcm_pos = 0
-    loop_command_index = None
-
-    while pos < len(data):
-        # Check if this position is the loop point
-        if loop_offset and pos == loop_offset and loop_command_index is None:
-            loop_command_index = len(commands)
-
-        cmd = data[pos]
-
-        if cmd == 0x67:  # Skip data block
-            block_size = struct.unpack('<I', data[pos + 3:pos + 7])[0]
-            pos += 7 + block_size
-
-        elif cmd == 0x66:  # End
-            commands.append((CMD_END_OF_STREAM, b''))
-            break
-
-        elif cmd == 0x50:  # PSG write
-            commands.append((CMD_PSG_WRITE, bytes([data[pos + 1]])))
-            pos += 2
-
-        elif cmd == 0x52:  # YM2612 Port 0
-            commands.append((CMD_YM2612_WRITE_A0, bytes([data[pos + 1], data[pos + 2]])))
-            pos += 3
-
-        elif cmd == 0x53:  # YM2612 Port 1
-            commands.append((CMD_YM2612_WRITE_A1, bytes([data[pos + 1], data[pos + 2]])))
-            pos += 3
-
-        elif cmd == 0x61:  # Wait N samples
-            samples = struct.unpack('<H', data[pos + 1:pos + 3])[0]
-            commands.append((CMD_WAIT_FRAMES, struct.pack('<H', samples)))
-            pos += 3
-
-        elif cmd == 0x62:  # Wait NTSC frame
-            commands.append((CMD_WAIT_NTSC, b''))
-            pos += 1
-
-        elif cmd == 0x63:  # Wait PAL frame
-            commands.append((CMD_WAIT_PAL, b''))
-            pos += 1
-
-        elif 0x70 <= cmd <= 0x7F:  # Short wait
-            commands.append((cmd, b''))
-            pos += 1
-
-        elif 0x80 <= cmd <= 0x8F:  # DAC + wait (inline PCM byte)
-            if pcm_data and pcm_pos < len(pcm_data):
-                dac_byte = pcm_data[pcm_pos]
-                pcm_pos += 1
-            else:
-                dac_byte = 0x80
-            commands.append((cmd, bytes([dac_byte])))
-            pos += 1
-
-        elif cmd == 0xE0:  # PCM seek
-            if pos + 5 <= len(data):
-                pcm_pos = struct.unpack('<I', data[pos + 1:pos + 5])[0]
-            pos += 5
+    def batchable(cmd):
+        return (cmd in (CMD_PSG_WRITE, CMD_YM2612_WRITE_A0, CMD_YM2612_WRITE_A1,
+                        CMD_WAIT_FRAMES, CMD_WAIT_NTSC, CMD_WAIT_PAL)
+                or 0x70 <= cmd <= 0x8F)
+
+    # Most written registers get the indexes; a single write isn't worth one
+    counts = register_counts
+    ranked = sorted((k for k, n in counts.items() if n > 1), key=lambda k: -counts[k])
+    dictionary = {key: index for index, key in enumerate(ranked[:dict_size])}
+    defined = set()
+
+    # Last 0xA4/0xA0 value per channel, as the device will have it
+    freq_hi = [0] * 6
+    freq_lo = [0] * 6
+    known_hi = [True] * 6
+    known_lo = [True] * 6
+
+    def freq_channel(port, reg):
+        slot = reg & 0x03
+        if slot < 3 and (reg & 0xF8) == 0xA0:
+            return port * 3 + slot
+        return None
 
+    def track(port, reg, val):
+        ch = freq_channel(port, reg)
+        if ch is None:
+            return
+        if reg & 0x04:
+            freq_hi[ch] = val
+            known_hi[ch] = True
         else:
-            pos += 1
-
-    return commands, loop_command_index
-
-
-def apply_wait_optimization(commands, loop_index=None):
-    """
-    Optimize wait commands:
-    1. Merge consecutive waits into single CMD_WAIT_FRAMES
-    2. Convert small waits to short wait commands (0x70-0x7F)
-    3. Use RLE for runs of frame waits
-
-    Returns: (optimized_commands, new_loop_index)
-    """
-    optimized = []
-    i = 0
-    new_loop_index = None
-
-    def get_wait_samples(cmd, args):
-        """Extract wait samples from a command."""
-        if cmd == CMD_WAIT_NTSC:
-            return FRAME_SAMPLES_NTSC
-        elif cmd == CMD_WAIT_PAL:
-            return FRAME_SAMPLES_PAL
-        elif cmd == CMD_WAIT_FRAMES:
-            return struct.unpack('<H', args)[0]
-        elif 0x70 <= cmd <= 0x7F:
-            return (cmd & 0x0F) + 1
-        return 0
-
-    def is_wait_cmd(cmd):
-        return cmd in (CMD_WAIT_NTSC, CMD_WAIT_PAL, CMD_WAIT_FRAMES) or (0x70 <= cmd <= 0x7F)
-
-    while i < len(commands):
-        # Track loop index mapping
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(optimized)
+            freq_lo[ch] = val
+            known_lo[ch] = True
+
+    def fold_dac_waits(run):
+        """DAC + wait N, short wait M -> DAC + wait N+M where it fits."""
+        folded = []
+        for cmd, args in run:
+            if 0x70 <= cmd <= 0x7F and folded and 0x80 <= folded[-1][0] <= 0x8F:
+                wait = (folded[-1][0] & 0x0F) + (cmd & 0x0F) + 1
+                if wait <= 15:
+                    folded[-1] = (0x80 + wait, folded[-1][1])
+                    continue
+            folded.append((cmd, args))
+        return folded
+
+    def run_length(run, i, same):
+        """How many commands from run[i] on satisfy same(), up to BATCH_MAX_RUN."""
+        n = 0
+        while i + n < len(run) and n < BATCH_MAX_RUN and same(run[i + n]):
+            n += 1
+        return n
+
+    def encode_run(run):
+        """Entries for a run of batchable commands."""
+        run = fold_dac_waits(run)
+        entries = []
+        i = 0
+        while i < len(run):
+            cmd, args = run[i]
+
+            # Runs of DAC samples or PSG writes, where the run header pays off
+            if 0x80 <= cmd <= 0x8F:
+                n = run_length(run, i, lambda c: c[0] == cmd)
+                if n >= 3:
+                    entries.append(bytes([BATCH_DAC_RUN, cmd & 0x0F, n]) +
+                                   b''.join(a for _, a in run[i:i + n]))
+                    i += n
+                    continue
+                n = run_length(run, i, lambda c: 0x80 <= c[0] <= 0x8F)
+                if n >= 6:
+                    entry = bytearray([BATCH_DAC_RUN_VAR, n])
+                    for k in range(i, i + n, 2):
+                        pair = run[k:min(k + 2, i + n)]
+                        waits = pair[0][0] & 0x0F
+                        if len(pair) > 1:
+                            waits |= (pair[1][0] & 0x0F) << 4
+                        entry.append(waits)
+                        for _, a in pair:
+                            entry.extend(a)
+                    entries.append(bytes(entry))
+                    i += n
+                    continue
+            elif cmd == CMD_PSG_WRITE:
+                n = run_length(run, i, lambda c: c[0] == CMD_PSG_WRITE)
+                if n >= 3:
+                    entries.append(bytes([BATCH_PSG_RUN, n]) +
+                                   b''.join(a for _, a in run[i:i + n]))
+                    i += n
+                    continue
 
-        cmd, args = commands[i]
+            i += 1
+
+            if cmd == CMD_PSG_WRITE:
+                entries.append(bytes([BATCH_PSG, args[0]]))
+            elif cmd == CMD_WAIT_NTSC:
+                entries.append(bytes([BATCH_WAIT_NTSC]))
+            elif cmd == CMD_WAIT_PAL:
+                entries.append(bytes([BATCH_WAIT_PAL]))
+            elif cmd == CMD_WAIT_FRAMES:
+                samples = struct.unpack('<H', args)[0]
+                if samples < 0x800:
+                    entries.append(bytes([BATCH_WAIT_MEDIUM + (samples >> 8), samples & 0xFF]))
+                else:
+                    entries.append(bytes([BATCH_WAIT]) + args)
+            elif 0x70 <= cmd <= 0x7F:
+                entries.append(bytes([BATCH_WAIT_SHORT + (cmd & 0x0F)]))
+            elif 0x80 <= cmd <= 0x8F:
+                entries.append(bytes([BATCH_DAC + (cmd & 0x0F)]) + args)
+            else:
+                port = cmd - CMD_YM2612_WRITE_A0
+                reg, val = args[0], args[1]
+
+                # 0xA4+n then 0xA0+n on the same port: try a delta
+                ch = freq_channel(port, reg)
+                if ch is not None and reg & 0x04 and i < len(run) and known_hi[ch] and known_lo[ch]:
+                    next_cmd, next_args = run[i]
+                    if next_cmd == cmd and next_args[0] == reg - 4:
+                        delta = ((val << 8) | next_args[1]) - ((freq_hi[ch] << 8) | freq_lo[ch])
+                        if -128 <= delta <= 127:
+                            entries.append(bytes([BATCH_FREQ_DELTA + ch, delta & 0xFF]))
+                            track(port, reg, val)
+                            track(port, next_args[0], next_args[1])
+                            i += 1
+                            continue
+
+                index = dictionary.get((port, reg))
+                if index is None:
+                    entries.append(bytes([BATCH_RAW_A0 + port, reg, val]))
+                elif index in defined:
+                    entries.append(bytes([index, val]))
+                else:
+                    entries.append(bytes([BATCH_DEFINE_A0 + port, index, reg, val]))
+                    defined.add(index)
+                track(port, reg, val)
+        return entries
+
+    def encode(stream, loop_offset=None):
+        commands, loop_index = stream_commands(stream, loop_offset)
+        output = bytearray()
+        loop_byte_offset = None
+        i = 0
+
+        while i < len(commands):
+            if loop_index is not None and i == loop_index:
+                loop_byte_offset = len(output)
+                known_hi[:] = [False] * 6
+                known_lo[:] = [False] * 6
+
+            cmd, args = commands[i]
+            if not batchable(cmd):
+                output.append(cmd)
+                output.extend(args)
+                i += 1
+                continue
 
-        # Accumulate consecutive waits
-        if is_wait_cmd(cmd):
-            total_samples = get_wait_samples(cmd, args)
+            # Run of batchable commands, split at the loop point so it starts a packet
             j = i + 1
-
-            # Merge consecutive waits, but stop if we hit the loop point
-            while j < len(commands) and is_wait_cmd(commands[j][0]):
-                # Don't merge past the loop point
-                if loop_index is not None and j == loop_index:
-                    break
-                total_samples += get_wait_samples(commands[j][0], commands[j][1])
+            while j < len(commands) and batchable(commands[j][0]) and j != loop_index:
                 j += 1
 
-            # Output optimized wait(s)
-            while total_samples > 0:
-                if total_samples >= FRAME_SAMPLES_NTSC * 2 and total_samples % FRAME_SAMPLES_NTSC == 0:
-                    # Multiple NTSC frames - use RLE
-                    frames = total_samples // FRAME_SAMPLES_NTSC
-                    if frames <= 255:
-                        optimized.append((CMD_RLE_WAIT_FRAME_1, bytes([frames])))
-                        total_samples = 0
-                    else:
-                        optimized.append((CMD_RLE_WAIT_FRAME_1, bytes([255])))
-                        total_samples -= 255 * FRAME_SAMPLES_NTSC
-                elif total_samples == FRAME_SAMPLES_NTSC:
-                    optimized.append((CMD_WAIT_NTSC, b''))
-                    total_samples = 0
-                elif total_samples == FRAME_SAMPLES_PAL:
-                    optimized.append((CMD_WAIT_PAL, b''))
-                    total_samples = 0
-                elif total_samples <= 16:
-                    # Short wait 0x70-0x7F (1-16 samples)
-                    optimized.append((0x70 + (total_samples - 1), b''))
-                    total_samples = 0
-                elif total_samples <= 65535:
-                    # General wait
-                    optimized.append((CMD_WAIT_FRAMES, struct.pack('<H', total_samples)))
-                    total_samples = 0
-                else:
-                    # Too large - split
-                    optimized.append((CMD_WAIT_FRAMES, struct.pack('<H', 65535)))
-                    total_samples -= 65535
+            if j - i == 1:
+                # Batch header would cost more than it saves
+                output.append(cmd)
+                output.extend(args)
+                if cmd in (CMD_YM2612_WRITE_A0, CMD_YM2612_WRITE_A1):
+                    track(cmd - CMD_YM2612_WRITE_A0, args[0], args[1])
+                i = j
+                continue
 
+            entries = encode_run(commands[i:j])
+            for start in range(0, len(entries), BATCH_MAX_ENTRIES):
+                packet = entries[start:start + BATCH_MAX_ENTRIES]
+                output.append(CMD_BATCH)
+                output.append(len(packet))
+                for entry in packet:
+                    output.extend(entry)
             i = j
-            continue
-
-        optimized.append((cmd, args))
-        i += 1
 
-    return optimized, new_loop_index
+        return bytes(output), loop_byte_offset
 
+    return encode
 
-def strip_dac(commands, loop_index=None):
-    """
-    Remove all DAC commands, converting them to waits.
-    Preserves timing by keeping the wait portion of 0x80-0x8F commands.
-
-    Returns: (stripped_commands, new_loop_index)
-    """
-    stripped = []
-    new_loop_index = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(stripped)
-
-        # DAC + wait commands (0x80-0x8F)
-        if 0x80 <= cmd <= 0x8F:
-            # Extract wait portion and convert to short wait
-            wait = cmd & 0x0F
-            if wait > 0:
-                stripped.append((0x70 + wait - 1, b''))  # Short wait (0x70-0x7F)
-            # If wait is 0, just skip the command entirely
-        else:
-            stripped.append((cmd, args))
-
-    return stripped, new_loop_index
-
-
-def apply_dac_rate_reduction(commands, dac_rate=1, loop_index=None):
-    """
-    Reduce DAC sample rate by skipping samples.
-    - dac_rate: 1 = full rate, 2 = half rate, 4 = quarter rate
-
-    This directly reduces command count, which is the main throughput bottleneck.
-
-    Returns: (compressed_commands, new_loop_index)
-    """
-    if dac_rate == 1:
-        return commands, loop_index  # No reduction
-
-    compressed = []
-    dac_count = 0
-    new_loop_index = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(compressed)
-
-        # DAC + wait commands (0x80-0x8F)
-        if 0x80 <= cmd <= 0x8F and args:
-            dac_count += 1
-
-            # Rate reduction: skip samples
-            if (dac_count % dac_rate) != 1:
-                # Skip this sample, but keep the wait
-                wait = cmd & 0x0F
-                if wait > 0:
-                    compressed.append((0x70 + wait - 1, b''))  # Short wait
-                continue
-
-            compressed.append((cmd, args))
-        else:
-            compressed.append((cmd, args))
-
-    return compressed, new_loop_index
 
+# =============================================================================
+# Streaming
+# =============================================================================
 
-def detect_chips(commands):
-    """Detect which chips are used in the command stream.
+class WindowedSender:
+    """Sends sequenced chunks without waiting for each one (protocol v3).
 
-    Returns: (has_psg, has_ym2612)
+    Keeps sending while the unacknowledged bytes fit in the free space of
+    the device's last FLOW_CREDIT. On FLOW_RESEND, or when nothing is
+    acknowledged for RESEND_TIMEOUT, goes back and sends everything
+    unacknowledged again.
+    While the device has no room, a keepalive every KEEPALIVE_INTERVAL keeps
+    its disconnect timeout (500 ms) from firing and asks for a fresh credit.
     """
-    has_psg = False
-    has_ym2612 = False
 
-    for cmd, args in commands:
-        if cmd == CMD_PSG_WRITE:
-            has_psg = True
-        elif cmd in (CMD_YM2612_WRITE_A0, CMD_YM2612_WRITE_A1):
-            has_ym2612 = True
-        # Also check DAC commands (0x80-0x8F) as YM2612
-        elif 0x80 <= cmd <= 0x8F:
-            has_ym2612 = True
-
-        if has_psg and has_ym2612:
-            break  # Found both, no need to continue
-
-    return has_psg, has_ym2612
-
-
-def attenuate_psg(commands, attenuation_increase=1, loop_index=None):
-    """Increase PSG attenuation (reduce volume) by specified amount.
-
-    PSG attenuation commands have format: 1cc1aaaa
-      - cc = channel (0-3)
-      - aaaa = attenuation (0=loudest, 15=silent)
-
-    Args:
-        commands: List of (cmd, args) tuples
-        attenuation_increase: How much to increase attenuation (1-15)
-        loop_index: Index of loop point in commands
-
-    Returns: (modified_commands, new_loop_index)
-    """
-    modified = []
-    new_loop_index = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(modified)
-
-        if cmd == CMD_PSG_WRITE and args:
-            psg_byte = args[0]
-            # Check if this is an attenuation command (bit 4 set, bit 7 set)
-            if (psg_byte & 0x90) == 0x90:
-                # Extract current attenuation (bits 0-3)
-                current_atten = psg_byte & 0x0F
-                # If already silent (15), leave it silent
-                # Otherwise increase attenuation but cap at 14 to preserve audibility
-                if current_atten == 15:
-                    new_atten = 15
+    RESEND_TIMEOUT = 0.25
+    KEEPALIVE_INTERVAL = 0.1
+
+    def __init__(self, ser, max_chunks):
+        self.ser = ser
+        self.max_chunks = max_chunks
+        self.next_seq = 0
+        self.unacked = []     # (seq, data), oldest first
+        self.credit = None    # Free bytes in the last FLOW_CREDIT
+        self.rx = bytearray()
+        self.last_progress = time.time()
+        self.last_write = time.time()
+        self.sent = 0
+        self.resent = 0
+        self.ready = 0        # FLOW_READY bytes not yet taken by wait_ready()
+
+    def in_flight(self):
+        return sum(len(data) for _, data in self.unacked)
+
+    def can_send(self, length):
+        if len(self.unacked) >= self.max_chunks:
+            return False
+        if self.credit is None:
+            # Nothing heard yet: an empty ring has room for one chunk
+            return not self.unacked
+        return self.in_flight() + length <= self.credit
+
+    def _write(self, seq, data):
+        checksum = seq ^ len(data)
+        for b in data:
+            checksum ^= b
+        self.ser.write(bytes([CHUNK_HEADER_SEQ, seq, len(data)]) + data + bytes([checksum]))
+        self.last_write = time.time()
+
+    def send(self, data):
+        seq = self.next_seq
+        self.next_seq = (seq + 1) & 0xFF
+        if not self.unacked:
+            self.last_progress = time.time()  # Resend timer starts with the first in flight
+        self.unacked.append((seq, data))
+        self._write(seq, data)
+        self.sent += 1
+
+    def _ack_to(self, next_seq):
+        """Drop chunks before next_seq. Returns how many."""
+        acked = 0
+        while self.unacked and 0 < ((next_seq - self.unacked[0][0]) & 0xFF) <= len(self.unacked):
+            self.unacked.pop(0)
+            acked += 1
+        return acked
+
+    def _resend(self):
+        for seq, data in self.unacked:
+            self._write(seq, data)
+        self.resent += len(self.unacked)
+        self.last_progress = time.time()
+
+    def poll(self, timeout=0.0):
+        """Handle device responses, waiting up to timeout for the first.
+
+        Returns the number of chunks newly acknowledged.
+        """
+        acked = 0
+        deadline = time.time() + timeout
+        while True:
+            if self.ser.in_waiting:
+                self.rx.extend(self.ser.read(self.ser.in_waiting))
+
+            heard = False
+            while self.rx:
+                b = self.rx[0]
+                if b == FLOW_CREDIT:
+                    if len(self.rx) < 4:
+                        break
+                    acked += self._ack_to(self.rx[1])
+                    self.credit = self.rx[2] | (self.rx[3] << 8)
+                    del self.rx[:4]
+                elif b == FLOW_RESEND:
+                    if len(self.rx) < 2:
+                        break
+                    acked += self._ack_to(self.rx[1])
+                    self._resend()
+                    del self.rx[:2]
                 else:
-                    new_atten = min(14, current_atten + attenuation_increase)
-                # Rebuild the byte
-                new_byte = (psg_byte & 0xF0) | new_atten
-                modified.append((cmd, bytes([new_byte])))
-            else:
-                modified.append((cmd, args))
-        else:
-            modified.append((cmd, args))
-
-    return modified, new_loop_index
-
-
-def commands_to_bytes(commands, loop_index=None):
-    """Convert command list to raw bytes.
-
-    Returns: (bytes, loop_byte_offset)
-        loop_byte_offset is the byte offset where the loop starts, or None.
-    """
-    output = bytearray()
-    loop_byte_offset = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            loop_byte_offset = len(output)
-        output.append(cmd)
-        output.extend(args)
+                    if b == FLOW_READY:
+                        self.ready += 1
+                    del self.rx[:1]
+                heard = True
+
+            now = time.time()
+            if acked:
+                self.last_progress = now
+            if heard:
+                return acked
+            if self.unacked and now - self.last_progress > self.RESEND_TIMEOUT:
+                self._resend()  # Lost chunk or lost reply
+            elif now - self.last_write > self.KEEPALIVE_INTERVAL:
+                self.ser.write(bytes([CHUNK_KEEPALIVE]))
+                self.last_write = now
+            if now >= deadline:
+                return acked
+            time.sleep(0.001)
 
-    return bytes(output), loop_byte_offset
+    def end(self, tries=5):
+        """Send the empty chunk that ends the stream. Returns True once acknowledged."""
+        seq = self.next_seq
+        self.next_seq = (seq + 1) & 0xFF
+        for _ in range(tries):
+            self._write(seq, b'')
+            if self.wait_ready(self.RESEND_TIMEOUT * 2):
+                return True
+        return False
 
+    def wait_ready(self, timeout):
+        """Wait for a FLOW_READY, skipping credits. Returns True if one came."""
+        deadline = time.time() + timeout
+        while self.ready == 0 and time.time() < deadline:
+            self.poll(0.05)
+        if self.ready:
+            self.ready -= 1
+            return True
+        return False
 
-# =============================================================================
-# Streaming
-# =============================================================================
 
-def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=None, verbose=False):
+def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=None, verbose=False,
+               protocol=None):
     """Stream VGM file using binary protocol.
 
     Args:
         dac_rate: None = use board default, 1-4 = override with specific rate
         loop_count: None = no looping, 0 = infinite, N = play N times total
+        protocol: None = newest the device supports, 1 or 2 = force a version
     """
 
     # Load file
@@ -551,11 +554,10 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
     elif loop_count is not None:
         print(f"  No VGM loop point (will restart from beginning)")
 
-    # Preprocess VGM (DAC processing deferred until we know board type)
-    print("  Preprocessing VGM...")
-    commands, loop_index = preprocess_vgm(data, header['data_offset'], header['loop_offset'])
-    original_cmd_count = len(commands)
-    original_bytes = sum(1 + len(args) for cmd, args in commands)
+    # Scan VGM (the stream is prepared once we know the board type)
+    scan = scan_vgm(data, header)
+    original_cmd_count = scan.commands
+    original_bytes = scan.stream_bytes
 
     # Connect
     print(f"\nConnecting to {port} at {baud} baud...")
@@ -574,6 +576,7 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
     print("Waiting for device...")
     got_ready = False
     board_type = None
+    device_protocol = None
 
     for attempt in range(5):
         if attempt > 0:
@@ -581,8 +584,9 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
 
         ser.reset_input_buffer()
         ser.write(bytes([CMD_PING]))
+        device_protocol = None
 
-        # Wait for ACK, BOARD_TYPE, then READY
+        # Wait for ACK, BOARD_TYPE, PROTOCOL_VERSION (v2 firmware), then READY
         got_ack = False
         timeout = time.time()
         while time.time() - timeout < 1.0:
@@ -595,8 +599,10 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                 elif b == FLOW_READY and got_ack and board_type is not None:
                     got_ready = True
                     board_name = {1: "Uno", 2: "Mega", 3: "Other", 4: "Teensy 4.x", 5: "ESP32"}.get(board_type, "Unknown")
-                    print(f"  Connected! (Board: {board_name})")
+                    print(f"  Connected! (Board: {board_name}, protocol v{device_protocol or 1})")
                     break
+                elif got_ack and board_type is not None and device_protocol is None:
+                    device_protocol = b
             time.sleep(0.01)
 
         if got_ready:
@@ -611,46 +617,61 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
 
     # Get board-specific settings
     chunk_size, chunks_in_flight, default_dac_rate = BOARD_SETTINGS.get(board_type, (64, 2, 1))
+    use_protocol = protocol if protocol is not None else min(device_protocol or 1, PROTOCOL_VERSION)
+    if use_protocol > (device_protocol or 1):
+        print(f"  Device only supports protocol v{device_protocol or 1}, using that")
+        use_protocol = device_protocol or 1
 
-    # Detect chips and apply PSG attenuation if both FM and PSG are present
-    has_psg, has_ym2612 = detect_chips(commands)
-    if has_psg and has_ym2612:
-        commands, loop_index = attenuate_psg(commands, attenuation_increase=2, loop_index=loop_index)
+    # PSG attenuation if both FM and PSG are present
+    if scan.has_psg and scan.has_ym2612:
         print(f"  PSG attenuated for FM+PSG mix")
 
-    # Apply DAC processing (now that we know board type)
+    # DAC processing (now that we know board type)
     effective_dac_rate = dac_rate if dac_rate is not None else default_dac_rate
     if no_dac:
-        commands, loop_index = strip_dac(commands, loop_index)
         print(f"  DAC stripped (FM/PSG only)")
     elif effective_dac_rate > 1:
-        commands, loop_index = apply_dac_rate_reduction(commands, effective_dac_rate, loop_index)
         print(f"  DAC rate reduction: 1/{effective_dac_rate} (keeping every {effective_dac_rate}th sample)")
 
-    # Apply wait optimization (merges and RLE)
-    commands, loop_index = apply_wait_optimization(commands, loop_index)
-    print(f"  Wait optimization: {original_cmd_count} -> {len(commands)} commands")
-
-    # Convert to bytes
-    stream_data, loop_byte_offset = commands_to_bytes(commands, loop_index)
-    compression_ratio = len(stream_data) / original_bytes * 100 if original_bytes > 0 else 100
-    print(f"  Stream size: {len(stream_data):,} bytes ({compression_ratio:.1f}% of original)")
-
-    if loop_byte_offset is not None:
-        print(f"  Loop byte offset: {loop_byte_offset:,}")
+    # Prepare while streaming; a looping stream gets its end marker at the very end
+    is_looping = loop_count is not None
+    preparer = StreamPreparer(data, header, scan, dac_rate=effective_dac_rate, no_dac=no_dac,
+                              end_marker=not is_looping)
+    dict_size = DICT_SIZES.get(board_type, 64)
+    stream = BackgroundStream(
+        preparer, batch_encoder(scan.register_counts, dict_size) if use_protocol >= 2 else None)
+    print(f"  Preparing stream ({'native' if has_native() else 'Python'}) while sending")
+
+    def print_stream_stats():
+        """Preprocessing results, once the whole stream is ready."""
+        stream.wait(len(stream.data))
+        print(f"  Wait optimization: {original_cmd_count} -> {preparer.commands} commands")
+        if use_protocol >= 2:
+            v1_size = len(preparer.out)
+            print(f"  Write batches: {v1_size:,} -> {len(stream.data):,} bytes "
+                  f"({len(stream.data) / v1_size * 100 if v1_size else 100:.1f}%, {dict_size} dictionary entries)")
+        compression_ratio = len(stream.data) / original_bytes * 100 if original_bytes > 0 else 100
+        print(f"  Stream size: {len(stream.data):,} bytes ({compression_ratio:.1f}% of original)")
+        if stream.loop_offset is not None:
+            print(f"  Loop byte offset: {stream.loop_offset:,}")
 
     ser.reset_input_buffer()
 
     # Stream data
     print("\nStreaming...")
     pos = 0
-    total = len(stream_data)
     start_time = time.time()
     last_progress = -1
     retransmits = 0
     pending_chunks = []
     chunks_sent = 0  # Debug counter
 
+    # Protocol v3: keep the pipe full instead of one chunk per round trip
+    sender = None
+    if use_protocol >= 3:
+        sender = WindowedSender(ser, WINDOW_CHUNKS.get(board_type, 4))
+        print(f"  Sliding window: up to {sender.max_chunks} chunks in flight")
+
     def send_chunk(data):
         """Send a chunk with header, length, data, and checksum."""
         nonlocal chunks_sent
@@ -693,7 +714,6 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
     try:
         # Determine loop behavior
         # loop_count: None = no looping, 0 = infinite, N = play N times total
-        is_looping = loop_count is not None
         plays_remaining = None
         if loop_count is not None:
             if loop_count == 0:
@@ -701,32 +721,27 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
             else:
                 plays_remaining = loop_count
 
-        # For looping: we need to strip the END_OF_STREAM command from the data
-        # and only send it when we're truly done
-        if is_looping:
-            # Remove trailing END_OF_STREAM (0x66) if present
-            if stream_data and stream_data[-1] == CMD_END_OF_STREAM:
-                stream_data_main = stream_data[:-1]
-            else:
-                stream_data_main = stream_data
-
-            # Loop section is from loop point to end (without END_OF_STREAM)
-            loop_start = loop_byte_offset if loop_byte_offset else 0
-            stream_data_loop = stream_data_main[loop_start:]
-        else:
-            stream_data_main = stream_data
-
         # Streaming state
         pos = 0
         total_bytes_streamed = 0
         loop_number = 1
         pending_chunks = []
         last_progress = -1
+        stream_data_loop = None
 
-        # Which data are we currently streaming?
-        current_data = stream_data_main
+        # Which data are we currently streaming? (the first pass grows as it's prepared)
+        current_data = stream.data
         current_label = ""
 
+        def preparing():
+            return current_data is stream.data and not stream.done.is_set()
+
+        def chunk_ready():
+            """A whole chunk to send, or the last of the section."""
+            if preparing():
+                return len(current_data) - pos >= chunk_size
+            return pos < len(current_data)
+
         while True:
             # Update label for display
             if is_looping:
@@ -735,8 +750,31 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                 else:
                     current_label = f"[{loop_number}/{loop_count}] "
 
+            # Caught up with the preparation (wait() also raises anything it hit)
+            if current_data is stream.data and not chunk_ready():
+                stream.wait(pos + chunk_size - 1, 0.01 if preparing() else 0)
+
+            if sender:
+                # Send while the device has room, then handle its replies
+                while chunk_ready():
+                    chunk_end = min(pos + chunk_size, len(current_data))
+                    if not sender.can_send(chunk_end - pos):
+                        break
+                    sender.send(current_data[pos:chunk_end])
+                    pending_chunks.append((pos, chunk_end))
+                    pos = chunk_end
+                acks = sender.poll(0.1 if pending_chunks or chunk_ready() else 0)
+                pending_chunks = pending_chunks[acks:]
+                retransmits = sender.resent
+                chunks_sent = sender.sent
+                if sender.ready:
+                    # Only sent mid-stream when the device gave up (timeout or end of song)
+                    print("\n\nERROR: Device stopped playback")
+                    ser.close()
+                    return False
+
             # Send chunks up to pipeline limit
-            while len(pending_chunks) < chunks_in_flight and pos < len(current_data):
+            while not sender and len(pending_chunks) < chunks_in_flight and chunk_ready():
                 chunk_end = min(pos + chunk_size, len(current_data))
                 chunk_data = current_data[pos:chunk_end]
                 send_chunk(chunk_data)
@@ -744,7 +782,7 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                 pos = chunk_end
 
             # Check for responses
-            acks, naks = check_responses()
+            acks, naks = check_responses() if not sender else (0, 0)
 
             # Handle NAKs - retransmit
             if naks > 0:
@@ -760,7 +798,7 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                 pending_chunks = pending_chunks[acks:]
 
             # If pipeline full or done sending or can't send, wait for responses
-            if pending_chunks and len(pending_chunks) >= chunks_in_flight:
+            if not sender and pending_chunks and len(pending_chunks) >= chunks_in_flight:
                 acks, naks = wait_for_response(0.1)
                 if naks > 0:
                     retransmits += naks
@@ -773,8 +811,9 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                     pending_chunks = pending_chunks[acks:]
 
             # Progress display
-            confirmed_pos = pos - sum(end - start for start, end in pending_chunks)
-            progress = confirmed_pos * 100 // len(current_data) if len(current_data) > 0 else 100
+            confirmed_pos = max(0, pos - sum(end - start for start, end in pending_chunks))
+            section_size = stream.estimated_size() if current_data is stream.data else len(current_data)
+            progress = min(confirmed_pos * 100 // section_size, 100) if section_size > 0 else 100
             if progress != last_progress:
                 last_progress = progress
                 elapsed = time.time() - start_time
@@ -783,9 +822,14 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                 print(f"\r  {current_label}{progress}% {rate:.1f}KB/s q:{len(pending_chunks)} rtx:{retransmits}   ", end="", flush=True)
 
             # Check if we've finished current data section
-            if pos >= len(current_data):
+            if not preparing() and pos >= len(current_data):
                 # Are we looping?
                 if is_looping:
+                    # Wait for pending chunks to drain before switching
+                    # (sequenced chunks keep their own copy for resending)
+                    if pending_chunks and not sender:
+                        continue  # Keep waiting for ACKs
+
                     # Check if we should continue looping
                     if plays_remaining == -1:
                         # Infinite loop - continue
@@ -800,31 +844,39 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
                             break
                         continue  # Keep waiting for ACKs
 
-                    # Wait for pending chunks to drain before switching
-                    if pending_chunks:
-                        continue  # Keep waiting for ACKs
-
                     # Start next loop iteration
                     total_bytes_streamed += len(current_data)
                     loop_number += 1
                     pos = 0
                     last_progress = -1
+                    if stream_data_loop is None:
+                        stream_data_loop = bytes(stream.data[stream.loop_offset or 0:])
                     current_data = stream_data_loop
                     print(f"\n  Starting loop {loop_number}...")
                 else:
+                    # Sequenced chunks may still need resending
+                    if sender and pending_chunks:
+                        continue
                     # Not looping - send end marker, device will ACK pending chunks
                     total_bytes_streamed += len(current_data)
                     break
 
         # Send end marker and wait for final ACK
-        ser.write(bytes([CHUNK_END]))
-        wait_for_response(1.0)
+        if sender:
+            sender.end()
+        else:
+            ser.write(bytes([CHUNK_END]))
+            wait_for_response(1.0)
 
         print(f"\n\nStream complete! Waiting for playback...")
 
         # Wait for playback to finish
         end_wait_start = time.time()
-        while time.time() - end_wait_start < 600:
+        while sender and time.time() - end_wait_start < 600:
+            if sender.wait_ready(1.0):
+                print("  Playback finished!")
+                break
+        while not sender and time.time() - end_wait_start < 600:
             if ser.in_waiting:
                 b = ser.read(1)[0]
                 if b == FLOW_READY:
@@ -834,6 +886,7 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
 
         elapsed = time.time() - start_time
         print(f"\nStats:")
+        print_stream_stats()
         print(f"  Total bytes streamed: {total_bytes_streamed:,}")
         print(f"  Chunks sent: {chunks_sent}, NAKs: {retransmits} ({retransmits*100//max(chunks_sent,1)}%)")
         print(f"  All bytes received: {dict(sorted([(hex(k), v) for k, v in all_bytes_received.items()]))}")
@@ -1055,6 +1108,7 @@ Examples:
     python stream_vgm.py song.vgm --no-dac       # FM/PSG only, no DAC
     python stream_vgm.py song.vgm --loop         # Loop forever
     python stream_vgm.py song.vgm --loop 3       # Loop 3 times
+    python stream_vgm.py song.vgm --protocol 1   # Uncompressed writes (older firmware)
 
 DAC Options (for songs with PCM/DAC audio):
     --dac-rate N   DAC sample rate divisor (1=full, 2=half, 3=third, 4=quarter)
@@ -1079,6 +1133,9 @@ Looping:
                         help='Strip all DAC/PCM data (FM/PSG only, smallest size)')
     parser.add_argument('--loop', nargs='?', const=0, type=int, default=None, metavar='N',
                         help='Loop playback: --loop for infinite, --loop N to play N times')
+    parser.add_argument('--protocol', type=int, default=None, choices=[1, 2, 3],
+                        help='Stream protocol version: 1 = raw writes, 2 = write batches, '
+                             '3 = batches + sliding window (default: newest the device supports)')
     parser.add_argument('--verbose', '-v', action='store_true',
                         help='Verbose output')
 
@@ -1109,7 +1166,8 @@ Looping:
         dac_rate=args.dac_rate,
         no_dac=args.no_dac,
         loop_count=args.loop,
-        verbose=args.verbose
+        verbose=args.verbose,
+        protocol=args.protocol
     )
     return 0 if success else 1
 
@@ -0,0 +1,142 @@
+// Oscilloscope analysis for the visualizer (see visualizer/scope.py)
+// Plain C++, no Python calls - the binding runs these without the GIL.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace scope {
+
+// Peak |x| and RMS of each of rows rows (row r at data + r * stride).
+// Eight independent accumulators so the loop vectorizes without
+// reassociating float math.
+inline void peakRms(const float* data, std::ptrdiff_t rows, std::ptrdiff_t stride, std::ptrdiff_t n,
+                    float* peak, float* rms) {
+    const int LANES = 8;
+    for (std::ptrdiff_t r = 0; r < rows; r++) {
+        const float* x = data + r * stride;
+        float lanePeak[LANES] = {0};
+        float laneSum[LANES] = {0};
+
+        std::ptrdiff_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            for (int l = 0; l < LANES; l++) {
+                float v = x[i + l];
+                lanePeak[l] = std::max(lanePeak[l], std::fabs(v));
+                laneSum[l] += v * v;
+            }
+        }
+        for (; i < n; i++) {
+            lanePeak[0] = std::max(lanePeak[0], std::fabs(x[i]));
+            laneSum[0] += x[i] * x[i];
+        }
+
+        float p = 0.0f, s = 0.0f;
+        for (int l = 0; l < LANES; l++) {
+            p = std::max(p, lanePeak[l]);
+            s += laneSum[l];
+        }
+        peak[r] = p;
+        rms[r] = n > 0 ? std::sqrt(s / static_cast<float>(n)) : 0.0f;
+    }
+}
+
+inline bool risingCrossing(const float* x, std::ptrdiff_t i) {
+    return x[i - 1] <= 0.0f && 0.0f < x[i];
+}
+
+inline float norm(const float* x, std::ptrdiff_t n) {
+    float s = 0.0f;
+    for (std::ptrdiff_t i = 0; i < n; i++) {
+        s += x[i] * x[i];
+    }
+    return std::sqrt(s);
+}
+
+// Frame-continuous trigger, same steps as the Python version in
+// visualizer/scope.py. offset is the trigger's distance from the end of
+// the buffer, updated in place. Returns the index the display starts at.
+inline std::ptrdiff_t findTrigger(const float* data, std::ptrdiff_t n, std::ptrdiff_t displaySamples,
+                                  std::ptrdiff_t& offset, std::ptrdiff_t samplesAdvanced) {
+    const std::ptrdiff_t compareLen = 64;
+
+    // The buffer moved by samplesAdvanced, so the trigger moved back
+    std::ptrdiff_t expected = offset + samplesAdvanced;
+    const std::ptrdiff_t maxOffset = displaySamples * 4;
+    const std::ptrdiff_t minOffset = displaySamples;
+    std::ptrdiff_t newOffset;
+
+    if (expected > maxOffset) {
+        // Jump: pick the crossing whose shape best matches the current one
+        std::ptrdiff_t current = n - std::min(expected, n - compareLen - 10);
+        current = std::max<std::ptrdiff_t>(0, std::min(current, n - compareLen));
+        const float* templ = data + current;
+        float templNorm = norm(templ, compareLen);
+
+        std::ptrdiff_t bestIdx = n - displaySamples - 50;
+        float bestScore = -1.0f;
+        std::ptrdiff_t searchStart = n - maxOffset;
+        std::ptrdiff_t searchEnd = n - minOffset;
+        std::ptrdiff_t last = std::min(n - displaySamples - compareLen, searchEnd);
+
+        for (std::ptrdiff_t i = std::max<std::ptrdiff_t>(1, searchStart); i < last; i++) {
+            if (!risingCrossing(data, i)) {
+                continue;
+            }
+            const float* candidate = data + i;
+            float candidateNorm = norm(candidate, compareLen);
+            float score = 0.0f;
+            if (templNorm > 0.01f && candidateNorm > 0.01f) {
+                float dot = 0.0f;
+                for (std::ptrdiff_t k = 0; k < compareLen; k++) {
+                    dot += templ[k] * candidate[k];
+                }
+                score = dot / (templNorm * candidateNorm);
+            }
+            if (score > bestScore) {
+                bestScore = score;
+                bestIdx = i;
+            }
+        }
+
+        if (bestScore > 0.5f) {
+            newOffset = n - bestIdx;
+        } else {
+            // No good match - latest rising crossing in range
+            newOffset = displaySamples + 50;
+            for (std::ptrdiff_t i = searchEnd; i > searchStart; i--) {
+                if (i > 0 && risingCrossing(data, i)) {
+                    newOffset = n - i;
+                    break;
+                }
+            }
+        }
+    } else {
+        // Normal case: nearest crossing to where the trigger should be
+        expected = std::max(minOffset, std::min(expected, maxOffset));
+        std::ptrdiff_t expectedIdx = n - expected;
+        const std::ptrdiff_t searchRadius = 50;
+        std::ptrdiff_t bestIdx = expectedIdx;
+        std::ptrdiff_t bestDist = -1;
+
+        std::ptrdiff_t last = std::min(n - displaySamples, expectedIdx + searchRadius);
+        for (std::ptrdiff_t i = std::max<std::ptrdiff_t>(1, expectedIdx - searchRadius); i < last; i++) {
+            if (risingCrossing(data, i)) {
+                std::ptrdiff_t dist = i > expectedIdx ? i - expectedIdx : expectedIdx - i;
+                if (bestDist < 0 || dist < bestDist) {
+                    bestDist = dist;
+                    bestIdx = i;
+                }
+            }
+        }
+        newOffset = n - bestIdx;
+    }
+
+    offset = std::max(minOffset, std::min(newOffset, maxOffset));
+    std::ptrdiff_t triggerIdx = n - offset;
+    return std::max<std::ptrdiff_t>(0, std::min(triggerIdx, n - displaySamples));
+}
+
+}  // namespace scope
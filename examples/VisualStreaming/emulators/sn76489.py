@@ -6,7 +6,9 @@ The SN76489 is a simple 4-channel sound chip:
 - Channel 3: Noise generator (periodic or white noise)
 
 This emulator tracks register state and generates approximate waveforms
-for visualization purposes.
+for visualization purposes. The ymfm binding carries a native renderer
+with the same interface (emulators/sn76489_render.h, SN76489Native in
+emulators.ymfm), which the command interceptor uses.
 """
 
 import numpy as np
@@ -0,0 +1,156 @@
+// Native SN76489 renderer, same interface and register handling as
+// emulators/sn76489.py. Noise shifts the LFSR once per period crossed
+// (the Python version approximates this per batch).
+// Plain C++, no Python calls - the binding renders without the GIL.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+class SN76489Renderer {
+public:
+    static constexpr int NUM_CHANNELS = 4;  // 3 tone + 1 noise
+    static constexpr double CLOCK = 3579545.0;
+    static constexpr double SAMPLE_RATE = 44100.0;
+
+    SN76489Renderer() { reset(); }
+
+    void reset() {
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            m_tone[ch] = 0;
+            m_atten[ch] = 15;
+        }
+        for (int ch = 0; ch < 3; ch++) {
+            m_phase[ch] = 0.0;
+        }
+        m_noiseReg = 0;
+        m_lfsr = 0x8000;
+        m_noiseCounter = 0.0;
+        m_noiseOutput = 1;
+        m_latchType = 0;
+        m_latchChannel = 0;
+    }
+
+    // Latch byte: 1 cc t dddd, data byte: 0 x dddddd
+    void write(uint8_t data) {
+        if (data & 0x80) {
+            m_latchChannel = (data >> 5) & 0x03;
+            m_latchType = (data >> 4) & 0x01;
+
+            if (m_latchType == 1) {
+                m_atten[m_latchChannel] = data & 0x0F;
+            } else if (m_latchChannel == 3) {
+                // Noise register - writing resets the LFSR
+                m_noiseReg = data & 0x07;
+                m_lfsr = 0x8000;
+            } else {
+                m_tone[m_latchChannel] = (m_tone[m_latchChannel] & 0x3F0) | (data & 0x0F);
+            }
+        } else if (m_latchType == 0 && m_latchChannel < 3) {
+            m_tone[m_latchChannel] = (m_tone[m_latchChannel] & 0x00F) | ((data & 0x3F) << 4);
+        }
+    }
+
+    double frequency(int channel) const {
+        if (channel < 0 || channel >= 3 || m_tone[channel] == 0) {
+            return 0.0;
+        }
+        return CLOCK / (32.0 * m_tone[channel]);
+    }
+
+    // 2dB per attenuation step, 15 = off
+    double volume(int channel) const {
+        if (channel < 0 || channel >= NUM_CHANNELS || m_atten[channel] == 15) {
+            return 0.0;
+        }
+        return std::pow(10.0, -m_atten[channel] / 10.0);
+    }
+
+    bool isActive(int channel) const {
+        if (channel < 0 || channel >= NUM_CHANNELS || m_atten[channel] >= 15) {
+            return false;
+        }
+        if (channel < 3) {
+            return m_tone[channel] > 0;
+        }
+        return true;
+    }
+
+    // Render n samples, channel ch at out[ch * stride + i]
+    void render(int n, float* out, std::ptrdiff_t stride) {
+        for (int ch = 0; ch < 3; ch++) {
+            float* x = out + ch * stride;
+            float vol = static_cast<float>(volume(ch));
+            if (vol <= 0.0f || m_tone[ch] == 0) {
+                for (int i = 0; i < n; i++) {
+                    x[i] = 0.0f;
+                }
+                continue;
+            }
+
+            // Square wave: +volume for the first half of each period
+            double inc = frequency(ch) / SAMPLE_RATE;
+            double phase = m_phase[ch];
+            for (int i = 0; i < n; i++) {
+                x[i] = phase < 0.5 ? vol : -vol;
+                phase += inc;
+                phase -= std::floor(phase);
+            }
+            m_phase[ch] = phase;
+        }
+
+        float* noise = out + 3 * stride;
+        float vol = static_cast<float>(volume(3));
+        double rate = noiseShiftRate();
+        if (vol <= 0.0f) {
+            for (int i = 0; i < n; i++) {
+                noise[i] = 0.0f;
+            }
+            return;
+        }
+        double inc = rate / SAMPLE_RATE;
+        for (int i = 0; i < n; i++) {
+            noise[i] = m_noiseOutput * vol;
+            m_noiseCounter += inc;
+            while (m_noiseCounter >= 1.0) {
+                m_noiseCounter -= 1.0;
+                shiftLfsr();
+            }
+        }
+    }
+
+private:
+    double noiseShiftRate() const {
+        switch (m_noiseReg & 0x03) {
+            case 0: return CLOCK / 512.0;
+            case 1: return CLOCK / 1024.0;
+            case 2: return CLOCK / 2048.0;
+            default:
+                // Follows tone channel 2
+                return m_tone[2] > 0 ? CLOCK / (32.0 * m_tone[2]) : 0.0;
+        }
+    }
+
+    // 16-bit LFSR: white noise taps bits 0 and 3, periodic just bit 0
+    void shiftLfsr() {
+        unsigned feedback;
+        if (m_noiseReg & 0x04) {
+            feedback = (m_lfsr ^ (m_lfsr >> 3)) & 1;
+        } else {
+            feedback = m_lfsr & 1;
+        }
+        m_lfsr = ((m_lfsr >> 1) | (feedback << 15)) & 0xFFFF;
+        m_noiseOutput = (m_lfsr & 1) ? 1 : -1;
+    }
+
+    int m_tone[NUM_CHANNELS];
+    int m_atten[NUM_CHANNELS];
+    double m_phase[3];
+    int m_noiseReg;
+    unsigned m_lfsr;
+    double m_noiseCounter;
+    int m_noiseOutput;
+    int m_latchType;
+    int m_latchChannel;
+};
@@ -14,6 +14,10 @@ if _this_dir not in sys.path:
 
 from _ymfm import YM2612 as _YM2612
 
+# Native SN76489 (same interface as emulators/sn76489.py) and scope analysis
+# (used through visualizer/scope.py)
+from _ymfm import SN76489 as SN76489Native, find_trigger, peak_rms
+
 
 class YM2612ymfm:
     """
@@ -23,6 +27,7 @@ class YM2612ymfm:
 
     NUM_CHANNELS = 6
     SAMPLE_RATE = 44100
+    RENDER_WAIT = 0x80000000   # Marks a wait in render() events
 
     def __init__(self):
         self._chip = _YM2612()
@@ -56,10 +61,25 @@ class YM2612ymfm:
         if num_samples <= 0:
             return tuple(np.zeros(0, dtype=np.float32) for _ in range(self.NUM_CHANNELS))
 
-        result = self._chip.generate_samples(num_samples)
+        # Rows of one float32 array straight from the binding - no copies
+        return self._chip.generate_samples(num_samples)
+
+    def render(self, events: np.ndarray, fm_out: np.ndarray, stereo_out: np.ndarray = None) -> int:
+        """
+        Apply a batch of register writes and render the waits between them
+        in one native call, with the GIL released so other Python threads
+        keep running. Call render() and write() from one thread only.
 
-        # Convert to numpy arrays with correct type
-        return tuple(np.array(result[ch], dtype=np.float32) for ch in range(self.NUM_CHANNELS))
+        Args:
+            events: uint32 array - write = (port << 16) | (addr << 8) | data,
+                    wait = RENDER_WAIT | samples
+            fm_out: float32 (6, capacity) array for per-channel output
+            stereo_out: Optional float32 (capacity, 2) array for the stereo mix
+
+        Returns:
+            Number of samples rendered into the start of the outputs
+        """
+        return self._chip.render(events, fm_out, stereo_out)
 
     def get_stereo_buffer(self) -> np.ndarray:
         """
@@ -4,10 +4,15 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
 #include <cstdint>
+#include <stdexcept>
 #include <vector>
 #include <cstring>
 #include <cmath>
 
+// Visualizer analysis and PSG renderer (no ymfm dependency)
+#include "scope_analysis.h"
+#include "sn76489_render.h"
+
 // ymfm includes
 #include "ymfm_opn.h"
 #include "ymfm_opn.cpp"
@@ -117,21 +122,112 @@ public:
         m_chip.write(offset + 1, static_cast<uint8_t>(data));
     }
 
+    // Generate num_samples for all channels. Returns a tuple of 6 float32 arrays,
+    // rows of one (6, num_samples) array - no copies on the way to numpy
     py::tuple generate_samples(int num_samples) {
-        std::vector<py::array_t<float>> outputs;
-        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-            outputs.push_back(py::array_t<float>(num_samples));
+        py::array_t<float> outputs({static_cast<py::ssize_t>(NUM_CHANNELS),
+                                    static_cast<py::ssize_t>(num_samples)});
+        float* out = outputs.mutable_data();
+
+        // Also capture stereo output in the same pass (for audio playback)
+        m_stereo_buffer.resize(num_samples * 2);
+        {
+            py::gil_scoped_release release;
+            render_span(num_samples, out, num_samples, m_stereo_buffer.data());
         }
 
-        std::vector<float*> out_ptrs;
+        py::tuple result(NUM_CHANNELS);
         for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-            out_ptrs.push_back(outputs[ch].mutable_data());
+            result[ch] = outputs[py::int_(ch)];
         }
+        return result;
+    }
 
-        // Also capture stereo output in the same pass (for audio playback)
-        m_stereo_buffer.resize(num_samples * 2);
+    // Apply register writes and render the waits between them in one call,
+    // without the GIL. events is uint32: bit 31 clear = write
+    // (port << 16 | addr << 8 | data), bit 31 set = wait (low 31 bits =
+    // samples). fm_out is a C-contiguous float32 (6, capacity) array and
+    // stereo_out, if not None, a C-contiguous float32 (capacity, 2) array.
+    // Returns the samples rendered.
+    int render(py::array_t<uint32_t, py::array::c_style | py::array::forcecast> events,
+               py::array_t<float, py::array::c_style> fm_out, py::object stereo_out) {
+        if (fm_out.ndim() != 2 || fm_out.shape(0) != NUM_CHANNELS) {
+            throw std::invalid_argument("fm_out must be shaped (6, capacity)");
+        }
+        py::ssize_t capacity = fm_out.shape(1);
+
+        float* stereo = nullptr;
+        py::array_t<float, py::array::c_style> stereo_array;
+        if (!stereo_out.is_none()) {
+            // Checked rather than cast - a converted copy would never be seen
+            if (!py::isinstance<py::array_t<float, py::array::c_style>>(stereo_out)) {
+                throw std::invalid_argument("stereo_out must be a C-contiguous float32 array");
+            }
+            stereo_array = py::reinterpret_borrow<py::array_t<float, py::array::c_style>>(stereo_out);
+            if (stereo_array.ndim() != 2 || stereo_array.shape(0) < capacity || stereo_array.shape(1) != 2) {
+                throw std::invalid_argument("stereo_out must be shaped (capacity, 2)");
+            }
+            stereo = stereo_array.mutable_data();
+        }
+
+        // Check the waits fit before letting go of the GIL
+        const uint32_t* ev = events.data();
+        py::ssize_t count = events.size();
+        py::ssize_t total = 0;
+        for (py::ssize_t i = 0; i < count; i++) {
+            if (ev[i] & 0x80000000u) {
+                total += ev[i] & 0x7FFFFFFFu;
+            }
+        }
+        if (total > capacity) {
+            throw std::invalid_argument("events wait longer than fm_out holds");
+        }
+
+        float* fm = fm_out.mutable_data();
+        py::ssize_t pos = 0;
+        {
+            py::gil_scoped_release release;
+            for (py::ssize_t i = 0; i < count; i++) {
+                uint32_t e = ev[i];
+                if (e & 0x80000000u) {
+                    int n = static_cast<int>(e & 0x7FFFFFFFu);
+                    render_span(n, fm + pos, capacity, stereo ? stereo + pos * 2 : nullptr);
+                    pos += n;
+                } else {
+                    write((e >> 16) & 1, (e >> 8) & 0xFF, e & 0xFF);
+                }
+            }
+        }
+        return static_cast<int>(pos);
+    }
 
-        for (int i = 0; i < num_samples; i++) {
+    // Get stereo buffer captured during last generate_samples() call
+    py::array_t<float> get_stereo_buffer() {
+        size_t num_samples = m_stereo_buffer.size() / 2;
+        py::array_t<float> output({static_cast<py::ssize_t>(num_samples), static_cast<py::ssize_t>(2)});
+        auto out_ptr = output.mutable_unchecked<2>();
+        for (size_t i = 0; i < num_samples; i++) {
+            out_ptr(i, 0) = m_stereo_buffer[i * 2];
+            out_ptr(i, 1) = m_stereo_buffer[i * 2 + 1];
+        }
+        return output;
+    }
+
+    bool is_active(int channel) {
+        if (channel == 5 && m_chip.get_dac_enable()) return true;
+        return std::abs(m_curr_output[channel]) > 0.001f;
+    }
+
+    bool is_dac_enabled() {
+        return m_chip.get_dac_enable();
+    }
+
+private:
+    // Render n samples into out (channel ch at out[ch * stride + i]) and,
+    // if not null, interleaved L/R into stereo. No Python calls - safe
+    // without the GIL.
+    void render_span(int n, float* out, py::ssize_t stride, float* stereo) {
+        for (int i = 0; i < n; i++) {
             m_resample_accum += m_resample_ratio;
 
             while (m_resample_accum >= 1.0) {
@@ -168,45 +264,19 @@ public:
             float frac = static_cast<float>(m_resample_accum);
             for (int ch = 0; ch < NUM_CHANNELS; ch++) {
                 float val = m_prev_output[ch] * (1.0f - frac) + m_curr_output[ch] * frac;
-                out_ptrs[ch][i] = std::max(-1.0f, std::min(1.0f, val));
+                out[ch * stride + i] = std::max(-1.0f, std::min(1.0f, val));
             }
 
-            // Store interpolated stereo in buffer
-            m_stereo_buffer[i * 2] = std::max(-1.0f, std::min(1.0f,
-                m_prev_stereo[0] * (1.0f - frac) + m_curr_stereo[0] * frac));
-            m_stereo_buffer[i * 2 + 1] = std::max(-1.0f, std::min(1.0f,
-                m_prev_stereo[1] * (1.0f - frac) + m_curr_stereo[1] * frac));
-        }
-
-        py::tuple result(NUM_CHANNELS);
-        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-            result[ch] = outputs[ch];
-        }
-        return result;
-    }
-
-    // Get stereo buffer captured during last generate_samples() call
-    py::array_t<float> get_stereo_buffer() {
-        size_t num_samples = m_stereo_buffer.size() / 2;
-        py::array_t<float> output({static_cast<py::ssize_t>(num_samples), static_cast<py::ssize_t>(2)});
-        auto out_ptr = output.mutable_unchecked<2>();
-        for (size_t i = 0; i < num_samples; i++) {
-            out_ptr(i, 0) = m_stereo_buffer[i * 2];
-            out_ptr(i, 1) = m_stereo_buffer[i * 2 + 1];
+            // Store interpolated stereo
+            if (stereo) {
+                stereo[i * 2] = std::max(-1.0f, std::min(1.0f,
+                    m_prev_stereo[0] * (1.0f - frac) + m_curr_stereo[0] * frac));
+                stereo[i * 2 + 1] = std::max(-1.0f, std::min(1.0f,
+                    m_prev_stereo[1] * (1.0f - frac) + m_curr_stereo[1] * frac));
+            }
         }
-        return output;
-    }
-
-    bool is_active(int channel) {
-        if (channel == 5 && m_chip.get_dac_enable()) return true;
-        return std::abs(m_curr_output[channel]) > 0.001f;
     }
 
-    bool is_dac_enabled() {
-        return m_chip.get_dac_enable();
-    }
-
-private:
     YmfmInterface m_interface;
     ym2612_perchannel m_chip;
     double m_resample_accum;
@@ -219,15 +289,92 @@ private:
     std::vector<float> m_stereo_buffer;  // Interleaved L/R
 };
 
+// SN76489 with the same interface as emulators/sn76489.py
+class SN76489Wrapper {
+public:
+    static constexpr int NUM_CHANNELS = SN76489Renderer::NUM_CHANNELS;
+
+    void reset() { m_psg.reset(); }
+    void write(int data) { m_psg.write(static_cast<uint8_t>(data)); }
+
+    // Tuple of 4 float32 arrays, rows of one (4, num_samples) array
+    py::tuple generate_samples(int num_samples) {
+        py::array_t<float> outputs({static_cast<py::ssize_t>(NUM_CHANNELS),
+                                    static_cast<py::ssize_t>(std::max(num_samples, 0))});
+        float* out = outputs.mutable_data();
+        {
+            py::gil_scoped_release release;
+            m_psg.render(num_samples, out, num_samples);
+        }
+
+        py::tuple result(NUM_CHANNELS);
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            result[ch] = outputs[py::int_(ch)];
+        }
+        return result;
+    }
+
+    double get_frequency(int channel) const { return m_psg.frequency(channel); }
+    double get_volume(int channel) const { return m_psg.volume(channel); }
+    bool is_active(int channel) const { return m_psg.isActive(channel); }
+
+private:
+    SN76489Renderer m_psg;
+};
+
+// Peak and RMS of each row of a (channels, n) block
+py::tuple peak_rms(py::array_t<float, py::array::c_style | py::array::forcecast> block) {
+    if (block.ndim() != 2) {
+        throw std::invalid_argument("block must be shaped (channels, n)");
+    }
+    py::ssize_t rows = block.shape(0), n = block.shape(1);
+    py::array_t<float> peak(rows), rms(rows);
+    const float* data = block.data();
+    float* peakOut = peak.mutable_data();
+    float* rmsOut = rms.mutable_data();
+    {
+        py::gil_scoped_release release;
+        scope::peakRms(data, rows, n, n, peakOut, rmsOut);
+    }
+    return py::make_tuple(peak, rms);
+}
+
+// Frame-continuous scope trigger. Returns (trigger_idx, new_offset).
+py::tuple find_trigger(py::array_t<float, py::array::c_style | py::array::forcecast> data,
+                       py::ssize_t display_samples, py::ssize_t offset, py::ssize_t samples_advanced) {
+    if (data.ndim() != 1) {
+        throw std::invalid_argument("data must be one channel");
+    }
+    std::ptrdiff_t off = offset;
+    std::ptrdiff_t trigger = scope::findTrigger(data.data(), data.shape(0), display_samples, off,
+                                                samples_advanced);
+    return py::make_tuple(static_cast<py::ssize_t>(trigger), static_cast<py::ssize_t>(off));
+}
+
 PYBIND11_MODULE(_ymfm, m) {
-    m.doc() = "ymfm YM2612 Python bindings with per-channel output";
+    m.doc() = "ymfm YM2612 Python bindings with per-channel output, plus native SN76489 and scope analysis";
 
     py::class_<YM2612Wrapper>(m, "YM2612")
         .def(py::init<>())
         .def("reset", &YM2612Wrapper::reset)
         .def("write", &YM2612Wrapper::write)
         .def("generate_samples", &YM2612Wrapper::generate_samples)
+        .def("render", &YM2612Wrapper::render,
+             py::arg("events"), py::arg("fm_out").noconvert(), py::arg("stereo_out") = py::none())
         .def("get_stereo_buffer", &YM2612Wrapper::get_stereo_buffer)
         .def("is_active", &YM2612Wrapper::is_active)
         .def("is_dac_enabled", &YM2612Wrapper::is_dac_enabled);
+
+    py::class_<SN76489Wrapper>(m, "SN76489")
+        .def(py::init<>())
+        .def("reset", &SN76489Wrapper::reset)
+        .def("write", &SN76489Wrapper::write)
+        .def("generate_samples", &SN76489Wrapper::generate_samples)
+        .def("get_frequency", &SN76489Wrapper::get_frequency)
+        .def("get_volume", &SN76489Wrapper::get_volume)
+        .def("is_active", &SN76489Wrapper::is_active);
+
+    m.def("peak_rms", &peak_rms, py::arg("block"));
+    m.def("find_trigger", &find_trigger, py::arg("data"), py::arg("display_samples"),
+          py::arg("offset"), py::arg("samples_advanced"));
 }
@@ -23,10 +23,8 @@ warnings.filterwarnings("ignore", category=DeprecationWarning)
 
 import argparse
 import glob
-import gzip
 import os
 import sys
-import struct
 import time
 import threading
 import queue
@@ -42,6 +40,11 @@ except ImportError:
 _script_dir = os.path.dirname(os.path.abspath(__file__))
 sys.path.insert(0, _script_dir)
 
+# Shared VGM preprocessing (tools/vgm_preprocess.py)
+sys.path.insert(0, os.path.join(_script_dir, '..', '..', 'tools'))
+from vgm_preprocess import (decompress_vgz, parse_vgm_header, preprocess_vgm, scan_vgm,
+                            stream_commands, prepare_stream, StreamPreparer)
+
 # Visualization imports (optional - falls back to CLI mode if unavailable)
 _HAS_VISUALIZATION = False
 _USE_PYGAME = True  # Set to False to use imgui version
@@ -144,470 +147,6 @@ def list_ports():
         print(f"  {port.device} - {port.description}")
 
 
-def decompress_vgz(data):
-    """Decompress VGZ if needed."""
-    if data[:2] == b'\x1f\x8b':
-        return gzip.decompress(data)
-    return data
-
-
-def parse_gd3_tag(data, gd3_offset):
-    """Parse GD3 tag for metadata (title, composer, etc.)."""
-    if gd3_offset == 0 or gd3_offset >= len(data):
-        return {}
-
-    # Check GD3 signature
-    if data[gd3_offset:gd3_offset + 4] != b'Gd3 ':
-        return {}
-
-    # GD3 data starts after signature (4), version (4), and length (4)
-    gd3_data_start = gd3_offset + 12
-    gd3_length = struct.unpack('<I', data[gd3_offset + 8:gd3_offset + 12])[0]
-    gd3_data = data[gd3_data_start:gd3_data_start + gd3_length]
-
-    # Parse UTF-16LE strings separated by null terminators
-    # Order: track_en, track_jp, game_en, game_jp, system_en, system_jp,
-    #        author_en, author_jp, date, creator, notes
-    try:
-        strings = gd3_data.decode('utf-16-le').split('\x00')
-    except:
-        return {}
-
-    result = {}
-    if len(strings) > 0 and strings[0]:
-        result['title'] = strings[0]
-    if len(strings) > 2 and strings[2]:
-        result['game'] = strings[2]
-    if len(strings) > 6 and strings[6]:
-        result['composer'] = strings[6]
-
-    return result
-
-
-def parse_vgm_header(data):
-    """Parse VGM header."""
-    if data[:4] != b'Vgm ':
-        return None
-
-    version = struct.unpack('<I', data[0x08:0x0C])[0]
-    total_samples = struct.unpack('<I', data[0x18:0x1C])[0]
-
-    # GD3 offset is relative to 0x14
-    gd3_offset_rel = struct.unpack('<I', data[0x14:0x18])[0]
-    gd3_offset = (0x14 + gd3_offset_rel) if gd3_offset_rel else 0
-
-    # Loop offset is relative to 0x1C
-    loop_offset_rel = struct.unpack('<I', data[0x1C:0x20])[0]
-    loop_offset = (0x1C + loop_offset_rel) if loop_offset_rel else 0
-
-    # Loop samples (how long the loop section is)
-    loop_samples = struct.unpack('<I', data[0x20:0x24])[0]
-
-    if version >= 0x150:
-        data_offset_rel = struct.unpack('<I', data[0x34:0x38])[0]
-        data_offset = 0x34 + data_offset_rel if data_offset_rel else 0x40
-    else:
-        data_offset = 0x40
-
-    # Parse GD3 metadata
-    gd3 = parse_gd3_tag(data, gd3_offset)
-
-    return {
-        'version': version,
-        'data_offset': data_offset,
-        'total_samples': total_samples,
-        'duration': total_samples / 44100.0,
-        'loop_offset': loop_offset,
-        'loop_samples': loop_samples,
-        'title': gd3.get('title', ''),
-        'game': gd3.get('game', ''),
-        'composer': gd3.get('composer', ''),
-    }
-
-
-# =============================================================================
-# VGM Processing
-# =============================================================================
-
-def preprocess_vgm(data, data_offset, loop_offset=0):
-    """
-    Preprocess VGM data:
-    1. Extract PCM data block
-    2. Inline DAC bytes for 0x80-0x8F commands
-    3. Convert to stream of (command_byte, args) tuples
-    4. Track loop point index if loop_offset is provided
-
-    Returns: (commands, loop_command_index)
-        loop_command_index is the index into commands where the loop starts,
-        or None if no loop point.
-    """
-    # First pass: extract PCM data block
-    pcm_data = None
-    pos = data_offset
-
-    while pos < len(data):
-        cmd = data[pos]
-        if cmd == 0x67:  # Data block
-            if pos + 7 <= len(data):
-                block_type = data[pos + 2]
-                block_size = struct.unpack('<I', data[pos + 3:pos + 7])[0]
-                if block_type == 0x00:
-                    pcm_data = data[pos + 7:pos + 7 + block_size]
-                pos += 7 + block_size
-            else:
-                break
-        elif cmd == 0x66:
-            break
-        elif cmd == 0x50:
-            pos += 2
-        elif cmd in (0x52, 0x53):
-            pos += 3
-        elif cmd == 0x61:
-            pos += 3
-        elif cmd in (0x62, 0x63):
-            pos += 1
-        elif 0x70 <= cmd <= 0x7F:
-            pos += 1
-        elif 0x80 <= cmd <= 0x8F:
-            pos += 1
-        elif cmd == 0xE0:
-            pos += 5
-        else:
-            pos += 1
-
-    # Second pass: generate commands with inlined PCM
-    commands = []
-    pos = data_offset
-    pcm_pos = 0
-    loop_command_index = None
-
-    while pos < len(data):
-        # Check if this position is the loop point
-        if loop_offset and pos == loop_offset and loop_command_index is None:
-            loop_command_index = len(commands)
-
-        cmd = data[pos]
-
-        if cmd == 0x67:  # Skip data block
-            block_size = struct.unpack('<I', data[pos + 3:pos + 7])[0]
-            pos += 7 + block_size
-
-        elif cmd == 0x66:  # End
-            commands.append((CMD_END_OF_STREAM, b''))
-            break
-
-        elif cmd == 0x50:  # PSG write
-            commands.append((CMD_PSG_WRITE, bytes([data[pos + 1]])))
-            pos += 2
-
-        elif cmd == 0x52:  # YM2612 Port 0
-            commands.append((CMD_YM2612_WRITE_A0, bytes([data[pos + 1], data[pos + 2]])))
-            pos += 3
-
-        elif cmd == 0x53:  # YM2612 Port 1
-            commands.append((CMD_YM2612_WRITE_A1, bytes([data[pos + 1], data[pos + 2]])))
-            pos += 3
-
-        elif cmd == 0x61:  # Wait N samples
-            samples = struct.unpack('<H', data[pos + 1:pos + 3])[0]
-            commands.append((CMD_WAIT_FRAMES, struct.pack('<H', samples)))
-            pos += 3
-
-        elif cmd == 0x62:  # Wait NTSC frame
-            commands.append((CMD_WAIT_NTSC, b''))
-            pos += 1
-
-        elif cmd == 0x63:  # Wait PAL frame
-            commands.append((CMD_WAIT_PAL, b''))
-            pos += 1
-
-        elif 0x70 <= cmd <= 0x7F:  # Short wait
-            commands.append((cmd, b''))
-            pos += 1
-
-        elif 0x80 <= cmd <= 0x8F:  # DAC + wait (inline PCM byte)
-            if pcm_data and pcm_pos < len(pcm_data):
-                dac_byte = pcm_data[pcm_pos]
-                pcm_pos += 1
-            else:
-                dac_byte = 0x80
-            commands.append((cmd, bytes([dac_byte])))
-            pos += 1
-
-        elif cmd == 0xE0:  # PCM seek
-            if pos + 5 <= len(data):
-                pcm_pos = struct.unpack('<I', data[pos + 1:pos + 5])[0]
-            pos += 5
-
-        else:
-            pos += 1
-
-    return commands, loop_command_index
-
-
-def apply_wait_optimization(commands, loop_index=None):
-    """
-    Optimize wait commands:
-    1. Merge consecutive waits into single CMD_WAIT_FRAMES
-    2. Convert small waits to short wait commands (0x70-0x7F)
-    3. Use RLE for runs of frame waits
-
-    Returns: (optimized_commands, new_loop_index)
-    """
-    optimized = []
-    i = 0
-    new_loop_index = None
-
-    def get_wait_samples(cmd, args):
-        """Extract wait samples from a command."""
-        if cmd == CMD_WAIT_NTSC:
-            return FRAME_SAMPLES_NTSC
-        elif cmd == CMD_WAIT_PAL:
-            return FRAME_SAMPLES_PAL
-        elif cmd == CMD_WAIT_FRAMES:
-            return struct.unpack('<H', args)[0]
-        elif 0x70 <= cmd <= 0x7F:
-            return (cmd & 0x0F) + 1
-        return 0
-
-    def is_wait_cmd(cmd):
-        return cmd in (CMD_WAIT_NTSC, CMD_WAIT_PAL, CMD_WAIT_FRAMES) or (0x70 <= cmd <= 0x7F)
-
-    while i < len(commands):
-        # Track loop index mapping
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(optimized)
-
-        cmd, args = commands[i]
-
-        # Accumulate consecutive waits
-        if is_wait_cmd(cmd):
-            total_samples = get_wait_samples(cmd, args)
-            j = i + 1
-
-            # Merge consecutive waits, but stop if we hit the loop point
-            while j < len(commands) and is_wait_cmd(commands[j][0]):
-                # Don't merge past the loop point
-                if loop_index is not None and j == loop_index:
-                    break
-                total_samples += get_wait_samples(commands[j][0], commands[j][1])
-                j += 1
-
-            # Output optimized wait(s)
-            while total_samples > 0:
-                if total_samples >= FRAME_SAMPLES_NTSC * 2 and total_samples % FRAME_SAMPLES_NTSC == 0:
-                    # Multiple NTSC frames - use RLE
-                    frames = total_samples // FRAME_SAMPLES_NTSC
-                    if frames <= 255:
-                        optimized.append((CMD_RLE_WAIT_FRAME_1, bytes([frames])))
-                        total_samples = 0
-                    else:
-                        optimized.append((CMD_RLE_WAIT_FRAME_1, bytes([255])))
-                        total_samples -= 255 * FRAME_SAMPLES_NTSC
-                elif total_samples == FRAME_SAMPLES_NTSC:
-                    optimized.append((CMD_WAIT_NTSC, b''))
-                    total_samples = 0
-                elif total_samples == FRAME_SAMPLES_PAL:
-                    optimized.append((CMD_WAIT_PAL, b''))
-                    total_samples = 0
-                elif total_samples <= 16:
-                    # Short wait 0x70-0x7F (1-16 samples)
-                    optimized.append((0x70 + (total_samples - 1), b''))
-                    total_samples = 0
-                elif total_samples <= 65535:
-                    # General wait
-                    optimized.append((CMD_WAIT_FRAMES, struct.pack('<H', total_samples)))
-                    total_samples = 0
-                else:
-                    # Too large - split
-                    optimized.append((CMD_WAIT_FRAMES, struct.pack('<H', 65535)))
-                    total_samples -= 65535
-
-            i = j
-            continue
-
-        optimized.append((cmd, args))
-        i += 1
-
-    return optimized, new_loop_index
-
-
-def strip_dac(commands, loop_index=None):
-    """
-    Remove all DAC commands, converting them to waits.
-    Preserves timing by keeping the wait portion of 0x80-0x8F commands.
-
-    Returns: (stripped_commands, new_loop_index)
-    """
-    stripped = []
-    new_loop_index = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(stripped)
-
-        # DAC + wait commands (0x80-0x8F)
-        if 0x80 <= cmd <= 0x8F:
-            # Extract wait portion and convert to short wait
-            wait = cmd & 0x0F
-            if wait > 0:
-                stripped.append((0x70 + wait - 1, b''))  # Short wait (0x70-0x7F)
-            # If wait is 0, just skip the command entirely
-        else:
-            stripped.append((cmd, args))
-
-    return stripped, new_loop_index
-
-
-def apply_dac_rate_reduction(commands, dac_rate=1, loop_index=None):
-    """
-    Reduce DAC sample rate by skipping samples.
-    - dac_rate: 1 = full rate, 2 = half rate, 4 = quarter rate
-
-    This directly reduces command count, which is the main throughput bottleneck.
-
-    Returns: (compressed_commands, new_loop_index)
-    """
-    if dac_rate == 1:
-        return commands, loop_index  # No reduction
-
-    compressed = []
-    dac_count = 0
-    new_loop_index = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(compressed)
-
-        # DAC + wait commands (0x80-0x8F)
-        if 0x80 <= cmd <= 0x8F and args:
-            dac_count += 1
-
-            # Rate reduction: skip samples
-            if (dac_count % dac_rate) != 1:
-                # Skip this sample, but keep the wait
-                wait = cmd & 0x0F
-                if wait > 0:
-                    compressed.append((0x70 + wait - 1, b''))  # Short wait
-                continue
-
-            compressed.append((cmd, args))
-        else:
-            compressed.append((cmd, args))
-
-    return compressed, new_loop_index
-
-
-def detect_chips(commands):
-    """Detect which chips are used in the command stream.
-
-    Returns: (has_psg, has_ym2612)
-    """
-    has_psg = False
-    has_ym2612 = False
-
-    for cmd, args in commands:
-        if cmd == CMD_PSG_WRITE:
-            has_psg = True
-        elif cmd in (CMD_YM2612_WRITE_A0, CMD_YM2612_WRITE_A1):
-            has_ym2612 = True
-        # Also check DAC commands (0x80-0x8F) as YM2612
-        elif 0x80 <= cmd <= 0x8F:
-            has_ym2612 = True
-
-        if has_psg and has_ym2612:
-            break  # Found both, no need to continue
-
-    return has_psg, has_ym2612
-
-
-def attenuate_psg(commands, attenuation_increase=1, loop_index=None):
-    """Increase PSG attenuation (reduce volume) by specified amount.
-
-    PSG attenuation commands have format: 1cc1aaaa
-      - cc = channel (0-3)
-      - aaaa = attenuation (0=loudest, 15=silent)
-
-    Args:
-        commands: List of (cmd, args) tuples
-        attenuation_increase: How much to increase attenuation (1-15)
-        loop_index: Index of loop point in commands
-
-    Returns: (modified_commands, new_loop_index)
-    """
-    modified = []
-    new_loop_index = None
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            new_loop_index = len(modified)
-
-        if cmd == CMD_PSG_WRITE and args:
-            psg_byte = args[0]
-            # Check if this is an attenuation command (bit 4 set, bit 7 set)
-            if (psg_byte & 0x90) == 0x90:
-                # Extract current attenuation (bits 0-3)
-                current_atten = psg_byte & 0x0F
-                # If already silent (15), leave it silent
-                # Otherwise increase attenuation but cap at 14 to preserve audibility
-                if current_atten == 15:
-                    new_atten = 15
-                else:
-                    new_atten = min(14, current_atten + attenuation_increase)
-                # Rebuild the byte
-                new_byte = (psg_byte & 0xF0) | new_atten
-                modified.append((cmd, bytes([new_byte])))
-            else:
-                modified.append((cmd, args))
-        else:
-            modified.append((cmd, args))
-
-    return modified, new_loop_index
-
-
-def commands_to_bytes(commands, loop_index=None):
-    """Convert command list to raw bytes.
-
-    Returns: (bytes, loop_byte_offset, byte_to_samples)
-        loop_byte_offset is the byte offset where the loop starts, or None.
-        byte_to_samples is a list mapping byte offset to cumulative sample count.
-    """
-    output = bytearray()
-    loop_byte_offset = None
-    byte_to_samples = []  # byte_to_samples[i] = samples elapsed at byte i
-    cumulative_samples = 0
-
-    for i, (cmd, args) in enumerate(commands):
-        if loop_index is not None and i == loop_index:
-            loop_byte_offset = len(output)
-
-        # Record sample count at start of this command
-        start_pos = len(output)
-        output.append(cmd)
-        output.extend(args)
-
-        # Fill byte_to_samples for all bytes of this command
-        cmd_len = len(output) - start_pos
-        for _ in range(cmd_len):
-            byte_to_samples.append(cumulative_samples)
-
-        # Calculate samples for wait commands (after the command)
-        if cmd == CMD_WAIT_NTSC:
-            cumulative_samples += FRAME_SAMPLES_NTSC
-        elif cmd == CMD_WAIT_PAL:
-            cumulative_samples += FRAME_SAMPLES_PAL
-        elif cmd == CMD_WAIT_FRAMES and len(args) >= 2:
-            cumulative_samples += args[0] | (args[1] << 8)
-        elif 0x70 <= cmd <= 0x7F:
-            cumulative_samples += (cmd & 0x0F) + 1
-        elif 0x80 <= cmd <= 0x8F:
-            cumulative_samples += cmd & 0x0F
-        elif cmd == CMD_RLE_WAIT_FRAME_1 and args:
-            cumulative_samples += args[0] * FRAME_SAMPLES_NTSC
-
-    return bytes(output), loop_byte_offset, byte_to_samples
-
-
 # =============================================================================
 # Streaming
 # =============================================================================
@@ -645,11 +184,10 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
     elif loop_count is not None:
         print(f"  No VGM loop point (will restart from beginning)")
 
-    # Preprocess VGM (DAC processing deferred until we know board type)
-    print("  Preprocessing VGM...")
-    commands, loop_index = preprocess_vgm(data, header['data_offset'], header['loop_offset'])
-    original_cmd_count = len(commands)
-    original_bytes = sum(1 + len(args) for cmd, args in commands)
+    # Scan VGM (the stream is prepared once we know the board type)
+    scan = scan_vgm(data, header)
+    original_cmd_count = scan.commands
+    original_bytes = scan.stream_bytes
 
     # Connect
     print(f"\nConnecting to {port} at {baud} baud...")
@@ -706,27 +244,21 @@ def stream_vgm(port, baud, vgm_path, dac_rate=None, no_dac=False, loop_count=Non
     # Get board-specific settings
     chunk_size, chunks_in_flight, default_dac_rate = BOARD_SETTINGS.get(board_type, (64, 2, 1))
 
-    # Detect chips and apply PSG attenuation if both FM and PSG are present
-    has_psg, has_ym2612 = detect_chips(commands)
-    if has_psg and has_ym2612:
-        commands, loop_index = attenuate_psg(commands, attenuation_increase=2, loop_index=loop_index)
+    # PSG attenuation if both FM and PSG are present
+    if scan.has_psg and scan.has_ym2612:
         print(f"  PSG attenuated for FM+PSG mix")
 
-    # Apply DAC processing (now that we know board type)
+    # DAC processing (now that we know board type)
     effective_dac_rate = dac_rate if dac_rate is not None else default_dac_rate
     if no_dac:
-        commands, loop_index = strip_dac(commands, loop_index)
         print(f"  DAC stripped (FM/PSG only)")
     elif effective_dac_rate > 1:
-        commands, loop_index = apply_dac_rate_reduction(commands, effective_dac_rate, loop_index)
         print(f"  DAC rate reduction: 1/{effective_dac_rate} (keeping every {effective_dac_rate}th sample)")
 
-    # Apply wait optimization (merges and RLE)
-    commands, loop_index = apply_wait_optimization(commands, loop_index)
-    print(f"  Wait optimization: {original_cmd_count} -> {len(commands)} commands")
-
-    # Convert to bytes
-    stream_data, loop_byte_offset, _ = commands_to_bytes(commands, loop_index)
+    # Prepare the stream (wait optimization merges and RLE)
+    preparer = StreamPreparer(data, header, scan, dac_rate=effective_dac_rate, no_dac=no_dac)
+    stream_data, loop_byte_offset = preparer.finish()
+    print(f"  Wait optimization: {original_cmd_count} -> {preparer.commands} commands")
     compression_ratio = len(stream_data) / original_bytes * 100 if original_bytes > 0 else 100
     print(f"  Stream size: {len(stream_data):,} bytes ({compression_ratio:.1f}% of original)")
 
@@ -1171,11 +703,12 @@ class VisualStreamer:
         # Create visualizer app
         self.app = VisualizerApp(crt_enabled=crt_enabled)
 
-        # Create command interceptor
-        self.interceptor = CommandInterceptor()
+        # Create command interceptor - chips render on its worker thread so
+        # they don't compete with this one for the GIL
+        self.interceptor = CommandInterceptor(threaded=True)
 
-        # Connect interceptor callbacks to visualizer
-        self.interceptor.on_waveform_update = self.app.update_waveform
+        # Connect interceptor callbacks to visualizer (waveforms via the ring)
+        self.app.attach_sample_ring(self.interceptor.sample_ring)
         self.interceptor.on_key_change = self.app.set_key_on
         self.interceptor.on_dac_mode_change = self.app.set_dac_mode
         self.interceptor.on_pitch_change = self.app.set_channel_pitch
@@ -1225,26 +758,12 @@ class VisualStreamer:
 
         self.total_duration = header['duration']
 
-        # Preprocess same as streaming
-        commands, loop_index = preprocess_vgm(data, header['data_offset'], header['loop_offset'])
-
-        # Detect chips and apply PSG attenuation (same as streaming)
-        has_psg, has_ym2612 = detect_chips(commands)
-        if has_psg and has_ym2612:
-            commands, loop_index = attenuate_psg(commands, attenuation_increase=2, loop_index=loop_index)
-
-        # Apply same DAC processing as streaming would
+        # Same processing as streaming (PSG attenuation, DAC, wait optimization)
         # Note: We don't know board type here, so use provided dac_rate or assume 1
-        if no_dac:
-            commands, loop_index = strip_dac(commands, loop_index)
-        elif dac_rate and dac_rate > 1:
-            commands, loop_index = apply_dac_rate_reduction(commands, dac_rate, loop_index)
+        stream_data, loop_byte_offset = prepare_stream(
+            data, header, scan_vgm(data, header), dac_rate=dac_rate or 1, no_dac=no_dac)
 
-        # Apply same wait optimization
-        commands, loop_index = apply_wait_optimization(commands, loop_index)
-
-        self.commands = commands
-        self.loop_index = loop_index
+        self.commands, self.loop_index = stream_commands(stream_data, loop_byte_offset)
 
     def _stream_thread(self, port, baud, vgm_path, dac_rate, no_dac, loop_count):
         """Background streaming thread."""
@@ -1447,11 +966,8 @@ def stream_vgm_visual_internal(port, baud, vgm_path, dac_rate=None, no_dac=False
     # Show loop info
     has_vgm_loop = header['loop_offset'] > 0
 
-    # Preprocess VGM
-    update_status("Preprocessing VGM...")
-    commands, loop_index = preprocess_vgm(data, header['data_offset'], header['loop_offset'])
-    original_cmd_count = len(commands)
-    original_bytes = sum(1 + len(args) for cmd, args in commands)
+    # Scan VGM (the stream is prepared once we know the board type)
+    scan = scan_vgm(data, header)
 
     # Connect
     update_status(f"Connecting to {port} at {baud} baud...")
@@ -1507,23 +1023,10 @@ def stream_vgm_visual_internal(port, baud, vgm_path, dac_rate=None, no_dac=False
     # Get board-specific settings
     chunk_size, chunks_in_flight, default_dac_rate = BOARD_SETTINGS.get(board_type, (64, 2, 1))
 
-    # Detect chips and apply PSG attenuation if both FM and PSG are present
-    has_psg, has_ym2612 = detect_chips(commands)
-    if has_psg and has_ym2612:
-        commands, loop_index = attenuate_psg(commands, attenuation_increase=2, loop_index=loop_index)
-
-    # Apply DAC processing
+    # PSG attenuation, DAC processing and wait optimization
     effective_dac_rate = dac_rate if dac_rate is not None else default_dac_rate
-    if no_dac:
-        commands, loop_index = strip_dac(commands, loop_index)
-    elif effective_dac_rate > 1:
-        commands, loop_index = apply_dac_rate_reduction(commands, effective_dac_rate, loop_index)
-
-    # Apply wait optimization
-    commands, loop_index = apply_wait_optimization(commands, loop_index)
-
-    # Convert to bytes
-    stream_data, loop_byte_offset, byte_to_samples = commands_to_bytes(commands, loop_index)
+    stream_data, loop_byte_offset = prepare_stream(data, header, scan, dac_rate=effective_dac_rate,
+                                                   no_dac=no_dac)
 
     ser.reset_input_buffer()
 
@@ -11,9 +11,16 @@ Key design principle: Two separate threads:
 This keeps visualization in sync with actual playback by generating samples
 at a constant rate regardless of when commands arrive.
 
-Uses ymfm for YM2612 emulation.
+Uses ymfm for YM2612 emulation. Chip writes are batched between renders
+and a whole batch goes to ymfm in one call that releases the GIL. With
+threaded=True that call runs on a worker thread and samples reach the
+visualizer through a lock-free SampleRing instead of callbacks.
 """
 
+import threading
+from array import array
+from collections import deque
+
 import numpy as np
 from typing import Optional, Callable
 
@@ -22,8 +29,8 @@ import sys
 import os
 sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
-from emulators.sn76489 import SN76489
-from emulators.ymfm import YM2612ymfm
+from emulators.ymfm import YM2612ymfm, SN76489Native as SN76489
+from streaming.sample_ring import SampleRing
 print("Using ymfm YM2612 emulator")
 
 
@@ -54,6 +61,12 @@ class CommandInterceptor:
 
     This keeps visualization in perfect sync with hardware streaming
     because both happen in the same call, at the same time.
+
+    With threaded=True, step 3 moves to a worker thread: each batch of
+    writes and waits is handed over and rendered there, so the caller only
+    pays for parsing. Rendered samples land in sample_ring (channels 0-5 FM,
+    6-9 PSG) for the visualizer to read, and on_audio_output /
+    on_waveform_update are called from the worker.
     """
 
     # Minimum samples to buffer before sending to visualizer
@@ -65,7 +78,10 @@ class CommandInterceptor:
     # Pre-allocated buffer size (must be >= MAX_SAMPLES_FOR_UPDATE)
     BUFFER_SIZE = 4096
 
-    def __init__(self):
+    # Samples the sample ring keeps for readers
+    RING_HISTORY = 8192
+
+    def __init__(self, threaded: bool = False):
         # Emulators
         self.ym2612 = YM2612ymfm()
         self.sn76489 = SN76489()
@@ -88,11 +104,26 @@ class CommandInterceptor:
         # DAC mode state (FM channel 6 becomes DAC output)
         self._dac_enabled = False
 
-        # Pre-allocated sample buffers (avoid list allocations)
-        self._fm_buffers = [np.zeros(self.BUFFER_SIZE, dtype=np.float32) for _ in range(6)]
-        self._psg_buffers = [np.zeros(self.BUFFER_SIZE, dtype=np.float32) for _ in range(4)]
+        # Pre-allocated sample buffers (avoid list allocations): one row per
+        # channel, FM rows rendered into directly by ymfm
+        self._wave_buffer = np.zeros((10, self.BUFFER_SIZE), dtype=np.float32)
+        self._fm_buffers = list(self._wave_buffer[:6])
+        self._psg_buffers = list(self._wave_buffer[6:])
         self._stereo_buffer = np.zeros((self.BUFFER_SIZE, 2), dtype=np.float32)
-        self._buffer_pos = 0  # Current write position in buffers
+        self._buffer_pos = 0  # Samples rendered into buffers, not yet sent
+
+        # Batch being collected: ymfm render() events, (sample offset, value)
+        # PSG writes, and samples of waits so far
+        self._events = array('I')
+        self._psg_writes = []
+        self._pending = 0
+
+        # Lock-free hand-off to the visualizer (threaded mode)
+        self.threaded = threaded
+        self.sample_ring = SampleRing(10, self.RING_HISTORY, self.BUFFER_SIZE) if threaded else None
+        self._batches = deque()
+        self._batch_ready = threading.Event()
+        self._worker: Optional[threading.Thread] = None
 
         # FM frequency tracking (fnum, block per channel)
         self._fm_fnum = [0] * 6
@@ -112,13 +143,30 @@ class CommandInterceptor:
         self.ym2612.reset()
         self.sn76489.reset()
         self._buffer_pos = 0
+        self._events = array('I')
+        self._psg_writes = []
+        self._pending = 0
         self._dac_enabled = False
 
+        if self.threaded:
+            self.sample_ring.reset()
+            self._batches.clear()
+            self._worker = threading.Thread(target=self._worker_run, daemon=True)
+            self._worker.start()
+
     def stop(self):
         """Stop the interceptor."""
-        self._running = False
         # Flush any remaining samples
-        self._flush_buffers()
+        self._submit_batch()
+        self._running = False
+
+        if self._worker:
+            # Worker drains what is queued, then exits
+            self._batch_ready.set()
+            self._worker.join(timeout=2.0)
+            self._worker = None
+        else:
+            self._flush_buffers()
 
     def process_chunk(self, data: bytes):
         """
@@ -172,7 +220,7 @@ class CommandInterceptor:
             elif 0x80 <= cmd <= 0x8F:
                 # DAC + wait
                 if i + 1 < len(data):
-                    self.ym2612.write(0, 0x2A, data[i + 1])
+                    self._events.append(0x2A00 | data[i + 1])
                 wait_samples = cmd & 0x0F
                 if wait_samples > 0:
                     self._generate_samples(wait_samples)
@@ -228,7 +276,7 @@ class CommandInterceptor:
 
         elif 0x80 <= cmd <= 0x8F:
             if args:
-                self.ym2612.write(0, 0x2A, args[0])
+                self._events.append(0x2A00 | args[0])
             wait_samples = cmd & 0x0F
             if wait_samples > 0:
                 self._generate_samples(wait_samples)
@@ -240,7 +288,8 @@ class CommandInterceptor:
 
     def _apply_psg_write(self, value: int):
         """Apply a PSG write and check for key/frequency changes."""
-        self.sn76489.write(value)
+        # Played at its place in the batch when the batch renders
+        self._psg_writes.append((self._pending, value))
 
         # Track frequency changes
         self._check_psg_frequency(value)
@@ -255,50 +304,96 @@ class CommandInterceptor:
 
     def _apply_ym_write(self, port: int, addr: int, data: int):
         """Apply a YM2612 write and check for key/DAC/frequency changes."""
-        self.ym2612.write(port, addr, data)
+        self._events.append((port << 16) | (addr << 8) | data)
         self._check_ym_key_change(addr, data)
         self._check_dac_change(port, addr, data)
         self._check_fm_frequency(port, addr, data)
 
     def _generate_samples(self, num_samples: int):
-        """Generate samples and buffer them for visualization and audio."""
-        if num_samples <= 0:
+        """Add a wait to the batch, rendering once enough samples are pending."""
+        while num_samples > 0:
+            # Split long waits so a batch always fits the buffers
+            n = min(num_samples, self.BUFFER_SIZE - self._pending)
+            self._events.append(YM2612ymfm.RENDER_WAIT | n)
+            self._pending += n
+            num_samples -= n
+
+            # Check if we have enough samples to send
+            if self._pending >= self.MIN_SAMPLES_FOR_UPDATE:
+                self._submit_batch()
+
+    def _submit_batch(self):
+        """Render the batch collected so far - here, or on the worker thread."""
+        # Writes with no samples after them yet wait for the next batch
+        if not self._pending:
             return
 
-        # Check if we need to flush before adding (buffer would overflow)
-        if self._buffer_pos + num_samples > self.BUFFER_SIZE:
-            self._flush_buffers()
-
-        # Generate from both chips
-        fm_waves = self.ym2612.generate_samples(num_samples)
-        psg_waves = self.sn76489.generate_samples(num_samples)
+        batch = (self._events, self._psg_writes, self._pending)
+        self._events = array('I')
+        self._psg_writes = []
+        self._pending = 0
 
-        # Copy to pre-allocated buffers (fast numpy slice assignment)
-        pos = self._buffer_pos
-        end = pos + num_samples
-        for ch in range(6):
-            self._fm_buffers[ch][pos:end] = fm_waves[ch]
-        for ch in range(4):
-            self._psg_buffers[ch][pos:end] = psg_waves[ch]
+        if self._worker:
+            self._batches.append(batch)
+            self._batch_ready.set()
+        else:
+            self._render_batch(*batch)
+            self._flush_buffers()
 
-        # Capture stereo output if audio callback is set
+    def _render_batch(self, events: array, psg_writes: list, num_samples: int):
+        """Render a batch of writes and waits into the (flushed) sample buffers."""
+        end = num_samples
+
+        # All FM writes and samples of the batch in one call, without the GIL.
+        # Whole buffers go in (render() fills from the start) - slices of
+        # them wouldn't be contiguous.
+        self.ym2612.render(np.frombuffer(events, dtype=np.uint32), self._wave_buffer[:6],
+                           self._stereo_buffer if self.on_audio_output else None)
+
+        # PSG in spans between its writes
+        at = 0
+        for offset, value in psg_writes:
+            if offset > at:
+                self._render_psg(at, offset)
+                at = offset
+            self.sn76489.write(value)
+        if end > at:
+            self._render_psg(at, end)
+
+        # Mix stereo output if audio callback is set
         if self.on_audio_output:
-            stereo = self.ym2612.get_stereo_buffer()  # Shape: (num_samples, 2)
+            stereo = self._stereo_buffer[:end]
             # FM stereo sums 6 channels but normalizes by 1 channel max - scale down
             stereo *= 0.45
             # Add PSG to stereo mix (PSG is mono, sum and add to both channels)
-            psg_mix = psg_waves[0] + psg_waves[1] + psg_waves[2] + psg_waves[3]
+            psg_mix = self._wave_buffer[6:, :end].sum(axis=0)
             psg_mix *= 0.10  # Scale PSG relative to FM
             stereo[:, 0] += psg_mix
             stereo[:, 1] += psg_mix
-            # Clip and copy to buffer
-            np.clip(stereo, -1.0, 1.0, out=self._stereo_buffer[pos:end])
+            np.clip(stereo, -1.0, 1.0, out=stereo)
 
         self._buffer_pos = end
 
-        # Check if we have enough samples to send
-        if self._buffer_pos >= self.MIN_SAMPLES_FOR_UPDATE:
-            self._flush_buffers()
+    def _render_psg(self, start: int, end: int):
+        """Generate PSG samples into buffer positions start..end."""
+        psg_waves = self.sn76489.generate_samples(end - start)
+        for ch in range(4):
+            self._psg_buffers[ch][start:end] = psg_waves[ch]
+
+    def _worker_run(self):
+        """Worker thread - renders batches as they arrive (threaded mode)."""
+        while True:
+            self._batch_ready.wait()
+            self._batch_ready.clear()
+
+            while self._batches:
+                self._render_batch(*self._batches.popleft())
+                self.sample_ring.write(self._wave_buffer[:, :self._buffer_pos])
+                self._flush_buffers()
+
+            # stop() queues its last batch before clearing _running
+            if not self._running and not self._batches:
+                return
 
     def _flush_buffers(self):
         """Send buffered samples to visualizer and audio output."""
@@ -0,0 +1,85 @@
+"""
+Lock-free sample ring between the chip emulation and the visualizer.
+
+One thread writes blocks of samples for every channel, another reads the
+most recent ones. Neither ever waits for the other: the writer publishes
+each block by bumping a sample counter after the data is in place, and a
+reader checks afterwards that the writer didn't lap the part it copied.
+"""
+
+import numpy as np
+
+
+class SampleRing:
+    """
+    Single-producer, single-consumer ring of float32 samples per channel.
+
+    written counts every sample ever written (per channel, all channels
+    move together). Readers compare it against the last value they saw to
+    know how far playback has advanced.
+    """
+
+    def __init__(self, channels: int, history: int, max_block: int):
+        """
+        Args:
+            channels: Number of channels
+            history: Most samples a reader asks for at once
+            max_block: Most samples written at once
+        """
+        self.channels = channels
+        self.max_block = max_block
+        # Room for a block in progress on top of what readers can ask for
+        self.capacity = history + 2 * max_block
+        self._buffer = np.zeros((channels, self.capacity), dtype=np.float32)
+        self.written = 0
+
+    def reset(self):
+        """Forget everything written (writer side, while no reader is running)."""
+        self._buffer.fill(0.0)
+        self.written = 0
+
+    def write(self, block: np.ndarray):
+        """Append a (channels, n) block. Writer thread only."""
+        n = block.shape[1]
+        if n > self.max_block:
+            raise ValueError(f"block of {n} samples, ring takes at most {self.max_block}")
+
+        start = self.written % self.capacity
+        first = min(n, self.capacity - start)
+        self._buffer[:, start:start + first] = block[:, :first]
+        if first < n:
+            self._buffer[:, :n - first] = block[:, first:]
+
+        # Publish only once the data is in place
+        self.written += n
+
+    def latest(self, channel: int, n: int):
+        """
+        Copy of the last n samples of a channel (zeros before the first write).
+
+        Returns:
+            (samples, written) - written as it was when the copy was taken
+        """
+        return self._copy_latest(channel, np.zeros(n, dtype=np.float32))
+
+    def latest_block(self, n: int):
+        """Like latest(), for every channel at once: (channels, n) samples."""
+        return self._copy_latest(slice(None), np.zeros((self.channels, n), dtype=np.float32))
+
+    def _copy_latest(self, rows, out: np.ndarray):
+        n = out.shape[-1]
+        while True:
+            written = self.written
+            count = min(n, written)
+            if count:
+                end = written % self.capacity or self.capacity
+                if count <= end:
+                    out[..., n - count:] = self._buffer[rows, end - count:end]
+                else:
+                    wrap = count - end
+                    out[..., n - count:n - end] = self._buffer[rows, self.capacity - wrap:]
+                    out[..., n - end:] = self._buffer[rows, :end]
+
+            # Retry if the writer got far enough to overwrite what was copied
+            if (written - count) - (self.written + self.max_block - self.capacity) >= 0:
+                return out, written
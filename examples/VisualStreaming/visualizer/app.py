@@ -6,6 +6,11 @@ import numpy as np
 from typing import Optional, Callable
 import threading
 import queue
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+from visualizer.scope import find_trigger
 
 try:
     from imgui_bundle import imgui, implot, hello_imgui, ImVec4
@@ -91,6 +96,10 @@ class VisualizerApp:
         # Lock for waveform data
         self._lock = threading.Lock()
 
+        # Lock-free waveform source (see attach_sample_ring)
+        self._sample_ring = None
+        self._ring_seen = [0] * self.TOTAL_CHANNELS
+
         # Display mode: True = triggered (stationary), False = scrolling
         self.triggered_display = True
 
@@ -190,6 +199,39 @@ class VisualizerApp:
                 # Accumulate samples for frame-to-frame continuity
                 self.samples_since_last_frame[channel] += samples
 
+    def attach_sample_ring(self, ring):
+        """Read waveforms from a SampleRing (threaded CommandInterceptor) instead of update_waveform()."""
+        self._sample_ring = ring
+        self._ring_seen = [0] * self.TOTAL_CHANNELS
+
+    def _waveform_snapshot(self, channel: int):
+        """Copy of a channel's waveform, its valid samples, and samples added since the last call."""
+        ring = self._sample_ring
+        if ring is not None:
+            data, written = ring.latest(channel, self.WAVEFORM_SAMPLES)
+            seen = self._ring_seen[channel]
+            self._ring_seen[channel] = written
+            advanced = written - seen if written >= seen else written
+            return data, min(written, self.WAVEFORM_SAMPLES), advanced
+
+        with self._lock:
+            data = self.waveforms[channel].copy()
+            valid_count = self.valid_samples[channel]
+            advanced = self.samples_since_last_frame[channel]
+            self.samples_since_last_frame[channel] = 0  # Reset for next frame
+        return data, valid_count, advanced
+
+    def _waveform_tails(self, n: int):
+        """Last n samples of every channel as one (channels, n) block, and valid sample counts."""
+        ring = self._sample_ring
+        if ring is not None:
+            block, written = ring.latest_block(n)
+            return block, [min(written, self.WAVEFORM_SAMPLES)] * self.TOTAL_CHANNELS
+
+        with self._lock:
+            block = np.stack([waveform[-n:] for waveform in self.waveforms])
+            return block, list(self.valid_samples)
+
     def _estimate_period(self, channel_idx: int, data: np.ndarray) -> float:
         """
         Estimate waveform period using zero-crossing analysis.
@@ -249,92 +291,10 @@ class VisualizerApp:
         return smoothed
 
     def _find_trigger(self, channel_idx: int, data: np.ndarray, display_samples: int, samples_advanced: int) -> int:
-        """
-        Frame-continuous trigger: track position and find nearest zero crossing.
-
-        The display smoothly advances with the audio, but snaps to zero crossings
-        for stability. When jumping, picks a crossing with similar waveform shape.
-        """
-        n = len(data)
-        compare_len = 64  # Samples to compare for shape matching
-
-        # Get last trigger offset (from end of buffer)
-        last_offset = self.trigger_offset[channel_idx]
-
-        # The buffer rolled by samples_advanced, so our trigger moved back
-        expected_offset = last_offset + samples_advanced
-
-        max_offset = display_samples * 4
-        min_offset = display_samples
-
-        # Check if we need to jump
-        needs_jump = expected_offset > max_offset
-
-        if needs_jump:
-            # Capture template of current waveform shape
-            current_idx = n - int(min(expected_offset, n - compare_len - 10))
-            current_idx = max(0, min(current_idx, n - compare_len))
-            template = data[current_idx:current_idx + compare_len]
-            template_norm = np.linalg.norm(template)
-
-            # Search for best matching zero crossing
-            best_idx = n - display_samples - 50  # fallback
-            best_score = -1
-
-            search_start = n - max_offset
-            search_end = n - min_offset
-
-            for i in range(max(1, search_start), min(n - display_samples - compare_len, search_end)):
-                if data[i-1] <= 0 < data[i]:
-                    # Compare waveform shape after this crossing
-                    candidate = data[i:i + compare_len]
-                    candidate_norm = np.linalg.norm(candidate)
-
-                    if template_norm > 0.01 and candidate_norm > 0.01:
-                        # Normalized correlation
-                        score = np.dot(template, candidate) / (template_norm * candidate_norm)
-                    else:
-                        score = 0
-
-                    if score > best_score:
-                        best_score = score
-                        best_idx = i
-
-            # Only use the match if it's reasonably good
-            if best_score > 0.5:
-                new_offset = n - best_idx
-            else:
-                # No good match - just find any rising crossing
-                for i in range(search_end, search_start, -1):
-                    if i > 0 and data[i-1] <= 0 < data[i]:
-                        new_offset = n - i
-                        break
-                else:
-                    new_offset = display_samples + 50
-        else:
-            # Normal case: find nearest zero crossing to expected position
-            expected_offset = max(min_offset, min(expected_offset, max_offset))
-            expected_idx = n - int(expected_offset)
-
-            search_radius = 50
-            best_idx = expected_idx
-            best_dist = float('inf')
-
-            for i in range(max(1, expected_idx - search_radius), min(n - display_samples, expected_idx + search_radius)):
-                if data[i-1] <= 0 < data[i]:
-                    dist = abs(i - expected_idx)
-                    if dist < best_dist:
-                        best_dist = dist
-                        best_idx = i
-
-            new_offset = n - best_idx
-
-        # Clamp and store
-        new_offset = max(min_offset, min(new_offset, max_offset))
-        self.trigger_offset[channel_idx] = new_offset
-
-        trigger_idx = n - int(new_offset)
-        return max(0, min(trigger_idx, n - display_samples))
+        """Frame-continuous trigger for a channel (see visualizer/scope.py)."""
+        trigger_idx, self.trigger_offset[channel_idx] = find_trigger(
+            data, display_samples, self.trigger_offset[channel_idx], samples_advanced)
+        return trigger_idx
 
     def set_key_on(self, channel: int, on: bool):
         """Set key-on state for a channel."""
@@ -366,12 +326,8 @@ class VisualizerApp:
         color = self.channel_colors[channel_idx]
         is_active = self.key_on[channel_idx]
 
-        # Get waveform data with lock
-        with self._lock:
-            full_data = self.waveforms[channel_idx].copy()
-            valid_count = self.valid_samples[channel_idx]
-            samples_advanced = self.samples_since_last_frame[channel_idx]
-            self.samples_since_last_frame[channel_idx] = 0  # Reset for next frame
+        # Get waveform data (locked copy or sample ring)
+        full_data, valid_count, samples_advanced = self._waveform_snapshot(channel_idx)
 
         # Noise channel (9) always scrolls
         # DAC mode (channel 5) scrolls only when DAC is enabled
@@ -721,11 +677,11 @@ class VisualizerApp:
 
         # Calculate global amplitude from all channels
         total_amp = 0.0
-        with self._lock:
-            for ch in range(self.TOTAL_CHANNELS):
-                if self.valid_samples[ch] > 100:
-                    chunk = self.waveforms[ch][-256:]
-                    total_amp += np.abs(chunk).mean()
+        tails, valid_counts = self._waveform_tails(256)
+        levels = np.abs(tails).mean(axis=1)
+        for ch in range(self.TOTAL_CHANNELS):
+            if valid_counts[ch] > 100:
+                total_amp += levels[ch]
         avg_amp = total_amp / self.TOTAL_CHANNELS
 
         # Smooth the amplitude for pulse effect
@@ -10,6 +10,10 @@ import numpy as np
 from typing import Optional, Callable
 import threading
 import queue
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+from visualizer.scope import find_trigger, peak_rms
 
 # Suppress pygame welcome message
 os.environ['PYGAME_HIDE_SUPPORT_PROMPT'] = "1"
@@ -204,6 +208,9 @@ class VisualizerApp:
 
         self._lock = threading.Lock()
         self.valid_samples = [0] * self.TOTAL_CHANNELS
+        # Lock-free waveform source (see attach_sample_ring)
+        self._sample_ring = None
+        self._ring_seen = [0] * self.TOTAL_CHANNELS
         # Portrait mode uses fewer samples since boxes are narrower
         self.default_display_samples = 128 if portrait_mode else 256
         self.max_display_samples = 512 if portrait_mode else 1024
@@ -276,6 +283,39 @@ class VisualizerApp:
                 )
                 self.samples_since_last_frame[channel] += samples
 
+    def attach_sample_ring(self, ring):
+        """Read waveforms from a SampleRing (threaded CommandInterceptor) instead of update_waveform()."""
+        self._sample_ring = ring
+        self._ring_seen = [0] * self.TOTAL_CHANNELS
+
+    def _waveform_snapshot(self, channel: int):
+        """Copy of a channel's waveform, its valid samples, and samples added since the last call."""
+        ring = self._sample_ring
+        if ring is not None:
+            data, written = ring.latest(channel, self.WAVEFORM_SAMPLES)
+            seen = self._ring_seen[channel]
+            self._ring_seen[channel] = written
+            advanced = written - seen if written >= seen else written
+            return data, min(written, self.WAVEFORM_SAMPLES), advanced
+
+        with self._lock:
+            data = self.waveforms[channel].copy()
+            valid_count = self.valid_samples[channel]
+            advanced = self.samples_since_last_frame[channel]
+            self.samples_since_last_frame[channel] = 0  # Reset for next frame
+        return data, valid_count, advanced
+
+    def _waveform_tails(self, n: int):
+        """Last n samples of every channel as one (channels, n) block, and valid sample counts."""
+        ring = self._sample_ring
+        if ring is not None:
+            block, written = ring.latest_block(n)
+            return block, [min(written, self.WAVEFORM_SAMPLES)] * self.TOTAL_CHANNELS
+
+        with self._lock:
+            block = np.stack([waveform[-n:] for waveform in self.waveforms])
+            return block, list(self.valid_samples)
+
     def set_key_on(self, channel: int, on: bool):
         if 0 <= channel < self.TOTAL_CHANNELS:
             self.key_on[channel] = on
@@ -316,78 +356,10 @@ class VisualizerApp:
         return min(expanded, self.max_display_samples)
 
     def _find_trigger(self, channel_idx: int, data: np.ndarray, display_samples: int, samples_advanced: int) -> int:
-        """
-        Frame-continuous trigger: track position and find nearest zero crossing.
-        Copied from app.py for identical behavior.
-        """
-        n = len(data)
-        compare_len = 64
-
-        last_offset = self.trigger_offset[channel_idx]
-        expected_offset = last_offset + samples_advanced
-
-        max_offset = display_samples * 4
-        min_offset = display_samples
-
-        needs_jump = expected_offset > max_offset
-
-        if needs_jump:
-            current_idx = n - int(min(expected_offset, n - compare_len - 10))
-            current_idx = max(0, min(current_idx, n - compare_len))
-            template = data[current_idx:current_idx + compare_len]
-            template_norm = np.linalg.norm(template)
-
-            best_idx = n - display_samples - 50
-            best_score = -1
-
-            search_start = n - max_offset
-            search_end = n - min_offset
-
-            for i in range(max(1, search_start), min(n - display_samples - compare_len, search_end)):
-                if data[i-1] <= 0 < data[i]:
-                    candidate = data[i:i + compare_len]
-                    candidate_norm = np.linalg.norm(candidate)
-
-                    if template_norm > 0.01 and candidate_norm > 0.01:
-                        score = np.dot(template, candidate) / (template_norm * candidate_norm)
-                    else:
-                        score = 0
-
-                    if score > best_score:
-                        best_score = score
-                        best_idx = i
-
-            if best_score > 0.5:
-                new_offset = n - best_idx
-            else:
-                for i in range(search_end, search_start, -1):
-                    if i > 0 and data[i-1] <= 0 < data[i]:
-                        new_offset = n - i
-                        break
-                else:
-                    new_offset = display_samples + 50
-        else:
-            expected_offset = max(min_offset, min(expected_offset, max_offset))
-            expected_idx = n - int(expected_offset)
-
-            search_radius = 50
-            best_idx = expected_idx
-            best_dist = float('inf')
-
-            for i in range(max(1, expected_idx - search_radius), min(n - display_samples, expected_idx + search_radius)):
-                if data[i-1] <= 0 < data[i]:
-                    dist = abs(i - expected_idx)
-                    if dist < best_dist:
-                        best_dist = dist
-                        best_idx = i
-
-            new_offset = n - best_idx
-
-        new_offset = max(min_offset, min(new_offset, max_offset))
-        self.trigger_offset[channel_idx] = new_offset
-
-        trigger_idx = n - int(new_offset)
-        return max(0, min(trigger_idx, n - display_samples))
+        """Frame-continuous trigger for a channel (see visualizer/scope.py)."""
+        trigger_idx, self.trigger_offset[channel_idx] = find_trigger(
+            data, display_samples, self.trigger_offset[channel_idx], samples_advanced)
+        return trigger_idx
 
     def _init_gl(self):
         """Initialize OpenGL resources."""
@@ -746,11 +718,7 @@ class VisualizerApp:
         if channel_idx == 5 and self.dac_enabled:
             is_active = True
 
-        with self._lock:
-            full_data = self.waveforms[channel_idx].copy()
-            valid_count = self.valid_samples[channel_idx]
-            samples_advanced = self.samples_since_last_frame[channel_idx]
-            self.samples_since_last_frame[channel_idx] = 0
+        full_data, valid_count, samples_advanced = self._waveform_snapshot(channel_idx)
 
         is_noise = (channel_idx == 9)
         is_dac_active = (channel_idx == 5 and self.dac_enabled)
@@ -871,12 +839,14 @@ class VisualizerApp:
                 step = len(y_data) // 256
                 draw_data = y_data[::step]
 
-            glBegin(GL_LINE_STRIP)
-            for i, val in enumerate(draw_data):
-                px = x + (i / len(draw_data)) * w
-                py = center_y - val * (h / 2) * 0.9
-                glVertex2f(px, py)
-            glEnd()
+            # One vertex array per strip instead of a GL call per point
+            vertices = np.empty((len(draw_data), 2), dtype=np.float32)
+            vertices[:, 0] = x + np.arange(len(draw_data), dtype=np.float32) * (w / len(draw_data))
+            vertices[:, 1] = center_y - draw_data * ((h / 2) * 0.9)
+            glEnableClientState(GL_VERTEX_ARRAY)
+            glVertexPointer(2, GL_FLOAT, 0, vertices)
+            glDrawArrays(GL_LINE_STRIP, 0, len(vertices))
+            glDisableClientState(GL_VERTEX_ARRAY)
 
         # Disable scissor test
         glDisable(GL_SCISSOR_TEST)
@@ -998,13 +968,11 @@ class VisualizerApp:
         # Calculate global amplitude for pulse using envelope follower
         # Use RMS of loudest active channels for better musical response
         max_rms = 0.0
-        with self._lock:
-            for ch in range(self.TOTAL_CHANNELS):
-                if self.valid_samples[ch] > 100 and self.key_on[ch]:
-                    chunk = self.waveforms[ch][-512:]
-                    # RMS is smoother than peak
-                    rms = np.sqrt(np.mean(chunk ** 2))
-                    max_rms = max(max_rms, rms)
+        tails, valid_counts = self._waveform_tails(512)
+        _, rms = peak_rms(tails)  # RMS is smoother than peak
+        for ch in range(self.TOTAL_CHANNELS):
+            if valid_counts[ch] > 100 and self.key_on[ch]:
+                max_rms = max(max_rms, float(rms[ch]))
 
         # Target pulse based on loudest channel
         target_pulse = min(1.0, max_rms * 4.0)
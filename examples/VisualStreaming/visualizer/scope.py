@@ -0,0 +1,129 @@
+"""
+Per-channel oscilloscope analysis shared by both visualizers.
+
+Uses the native versions in the ymfm binding (emulators/scope_analysis.h)
+when it is built; the Python versions here do the same steps, just slower.
+"""
+
+import os
+import sys
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+try:
+    from emulators.ymfm import find_trigger as _native_find_trigger, peak_rms as _native_peak_rms
+except ImportError:
+    _native_find_trigger = None
+    _native_peak_rms = None
+
+
+def peak_rms(block: np.ndarray):
+    """
+    Peak |x| and RMS of each row of a (channels, n) float32 block.
+
+    Returns:
+        (peak, rms) - float32 arrays with one value per channel
+    """
+    if _native_peak_rms:
+        return _native_peak_rms(block)
+    return np.abs(block).max(axis=1), np.sqrt(np.mean(block ** 2, axis=1))
+
+
+def find_trigger(data: np.ndarray, display_samples: int, offset: int, samples_advanced: int):
+    """
+    Frame-continuous trigger: track position and find nearest zero crossing.
+
+    The display smoothly advances with the audio, but snaps to zero crossings
+    for stability. When jumping, picks a crossing with similar waveform shape.
+
+    Args:
+        data: One channel's waveform buffer (newest sample last)
+        display_samples: Samples shown
+        offset: Trigger distance from the end of the buffer, last frame
+        samples_advanced: Samples added to the buffer since last frame
+
+    Returns:
+        (trigger_idx, new_offset) - display start index and the offset to
+        pass next frame
+    """
+    if _native_find_trigger:
+        return _native_find_trigger(data, display_samples, offset, samples_advanced)
+
+    n = len(data)
+    compare_len = 64  # Samples to compare for shape matching
+
+    # The buffer rolled by samples_advanced, so our trigger moved back
+    expected_offset = offset + samples_advanced
+
+    max_offset = display_samples * 4
+    min_offset = display_samples
+
+    # Check if we need to jump
+    needs_jump = expected_offset > max_offset
+
+    if needs_jump:
+        # Capture template of current waveform shape
+        current_idx = n - int(min(expected_offset, n - compare_len - 10))
+        current_idx = max(0, min(current_idx, n - compare_len))
+        template = data[current_idx:current_idx + compare_len]
+        template_norm = np.linalg.norm(template)
+
+        # Search for best matching zero crossing
+        best_idx = n - display_samples - 50  # fallback
+        best_score = -1
+
+        search_start = n - max_offset
+        search_end = n - min_offset
+
+        for i in range(max(1, search_start), min(n - display_samples - compare_len, search_end)):
+            if data[i-1] <= 0 < data[i]:
+                # Compare waveform shape after this crossing
+                candidate = data[i:i + compare_len]
+                candidate_norm = np.linalg.norm(candidate)
+
+                if template_norm > 0.01 and candidate_norm > 0.01:
+                    # Normalized correlation
+                    score = np.dot(template, candidate) / (template_norm * candidate_norm)
+                else:
+                    score = 0
+
+                if score > best_score:
+                    best_score = score
+                    best_idx = i
+
+        # Only use the match if it's reasonably good
+        if best_score > 0.5:
+            new_offset = n - best_idx
+        else:
+            # No good match - just find any rising crossing
+            for i in range(search_end, search_start, -1):
+                if i > 0 and data[i-1] <= 0 < data[i]:
+                    new_offset = n - i
+                    break
+            else:
+                new_offset = display_samples + 50
+    else:
+        # Normal case: find nearest zero crossing to expected position
+        expected_offset = max(min_offset, min(expected_offset, max_offset))
+        expected_idx = n - int(expected_offset)
+
+        search_radius = 50
+        best_idx = expected_idx
+        best_dist = float('inf')
+
+        for i in range(max(1, expected_idx - search_radius), min(n - display_samples, expected_idx + search_radius)):
+            if data[i-1] <= 0 < data[i]:
+                dist = abs(i - expected_idx)
+                if dist < best_dist:
+                    best_dist = dist
+                    best_idx = i
+
+        new_offset = n - best_idx
+
+    # Clamp
+    new_offset = max(min_offset, min(new_offset, max_offset))
+
+    trigger_idx = n - int(new_offset)
+    return max(0, min(trigger_idx, n - display_samples)), new_offset
@@ -0,0 +1,260 @@
+#include "DACStreamControl.h"
+#include "VGMCommands.h"
+
+// =============================================================================
+// Constructor
+// =============================================================================
+
+DACStreamControl::DACStreamControl(PCMDataBank& bank)
+  : bank_(bank)
+  , activeCount_(0)
+{
+  reset();
+}
+
+void DACStreamControl::reset() {
+  for (uint8_t i = 0; i < GENESIS_ENGINE_DAC_STREAMS; i++) {
+    streams_[i].id = 0xFF;
+    streams_[i].active = false;
+  }
+  activeCount_ = 0;
+}
+
+// =============================================================================
+// Commands
+// =============================================================================
+
+static inline uint32_t readLE32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void DACStreamControl::command(uint8_t cmd, const uint8_t* args) {
+  // 0x94 0xFF stops every stream
+  if (cmd == VGM_CMD_DAC_STOP && args[0] == VGM_STREAM_ALL) {
+    for (uint8_t i = 0; i < GENESIS_ENGINE_DAC_STREAMS; i++) {
+      stop(streams_[i]);
+    }
+    return;
+  }
+
+  Stream* stream = find(args[0], cmd == VGM_CMD_DAC_SETUP);
+  if (!stream) {
+    return;  // Not set up, or no free slot
+  }
+
+  switch (cmd) {
+    case VGM_CMD_DAC_SETUP:
+      // 0x90 ss tt pp cc - chip type, port, register
+      stream->chipType = args[1];
+      stream->port = args[2];
+      stream->reg = args[3];
+      break;
+
+    case VGM_CMD_DAC_DATA:
+      // 0x91 ss dd ll bb - data bank type, step size, step base
+      stream->dataType = args[1];
+      stream->stepSize = args[2] ? args[2] : 1;
+      stream->stepBase = args[3];
+      break;
+
+    case VGM_CMD_DAC_FREQ:
+      // 0x92 ss ff ff ff ff - writes per second
+      setFrequency(*stream, readLE32(args + 1));
+      break;
+
+    case VGM_CMD_DAC_START: {
+      // 0x93 ss aa aa aa aa mm ll ll ll ll - offset, length mode, length
+      uint32_t offset = readLE32(args + 1);
+      uint8_t mode = args[5];
+      uint32_t length = readLE32(args + 6);
+
+      if (offset != VGM_STREAM_KEEP_OFFSET) {
+        stream->start = offset;
+      }
+
+      switch (mode & 0x03) {
+        case VGM_STREAM_LEN_IGNORE:
+          // Only move the read position of a playing stream
+          if (offset != VGM_STREAM_KEEP_OFFSET) {
+            stream->position = offset + stream->stepBase;
+          }
+          return;
+        case VGM_STREAM_LEN_COMMANDS:
+          stream->length = length;
+          break;
+        case VGM_STREAM_LEN_MSEC:
+          stream->length = (uint32_t)(((uint64_t)length * stream->frequency) / 1000);
+          break;
+        case VGM_STREAM_LEN_TO_END:
+          stream->length = 0;
+          break;
+      }
+      stream->loop = (mode & VGM_STREAM_LOOP) != 0;
+      stream->reverse = (mode & VGM_STREAM_REVERSE) != 0;
+      play(*stream);
+      break;
+    }
+
+    case VGM_CMD_DAC_STOP:
+      // 0x94 ss
+      stop(*stream);
+      break;
+
+    case VGM_CMD_DAC_START_FAST: {
+      // 0x95 ss bb bb ff - play a whole data block
+      uint16_t block = (uint16_t)args[1] | ((uint16_t)args[2] << 8);
+      uint32_t start;
+      uint32_t length;
+      if (!bank_.getBlock(block, start, length)) {
+        stop(*stream);
+        break;
+      }
+      stream->start = start;
+      stream->length = length / stream->stepSize;
+      stream->loop = (args[3] & VGM_STREAM_FAST_LOOP) != 0;
+      stream->reverse = (args[3] & VGM_STREAM_FAST_REVERSE) != 0;
+      play(*stream);
+      break;
+    }
+  }
+}
+
+// =============================================================================
+// Playback
+// =============================================================================
+
+uint32_t DACStreamControl::update(uint32_t maxSamples, DACStreamWriteFunc write,
+                                  void* context) {
+  uint32_t step = maxSamples;
+
+  for (uint8_t i = 0; i < GENESIS_ENGINE_DAC_STREAMS; i++) {
+    Stream& stream = streams_[i];
+    if (!stream.active || stream.frequency == 0) {
+      continue;
+    }
+
+    // Writes due now (several per sample above 44.1kHz)
+    while (stream.countdown == 0) {
+      if (!write(context, stream.port, stream.reg, bank_.readByteAt(stream.position))) {
+        return 0;
+      }
+      if (stream.reverse) {
+        stream.position -= stream.stepSize;
+      } else {
+        stream.position += stream.stepSize;
+      }
+
+      if (--stream.remaining == 0) {
+        if (!stream.loop) {
+          stop(stream);
+          break;
+        }
+        play(stream);
+      }
+      stream.countdown = nextInterval(stream);
+    }
+
+    if (stream.active && stream.countdown < step) {
+      step = stream.countdown;
+    }
+  }
+
+  for (uint8_t i = 0; i < GENESIS_ENGINE_DAC_STREAMS; i++) {
+    if (streams_[i].active && streams_[i].frequency != 0) {
+      streams_[i].countdown -= step;
+    }
+  }
+  return step;
+}
+
+void DACStreamControl::play(Stream& stream) {
+  // Only the YM2612 with our PCM bank can be played
+  if (stream.chipType != VGM_STREAM_CHIP_YM2612 ||
+      stream.dataType != VGM_DATA_YM2612_PCM) {
+    stop(stream);
+    return;
+  }
+
+  uint32_t first = stream.start + stream.stepBase;
+  uint32_t count = stream.length;
+  if (count == 0) {
+    // Until the end of the bank
+    uint32_t bankSize = bank_.getOriginalSize();
+    count = first < bankSize ? (bankSize - first + stream.stepSize - 1) / stream.stepSize : 0;
+  }
+  if (count == 0) {
+    stop(stream);
+    return;
+  }
+
+  stream.position = stream.reverse ? first + (count - 1) * stream.stepSize : first;
+  stream.remaining = count;
+  if (!stream.active) {
+    stream.active = true;
+    stream.countdown = 0;
+    stream.error = 0;
+    activeCount_++;
+  }
+}
+
+void DACStreamControl::stop(Stream& stream) {
+  if (stream.active) {
+    stream.active = false;
+    activeCount_--;
+  }
+}
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+DACStreamControl::Stream* DACStreamControl::find(uint8_t id, bool create) {
+  Stream* unused = nullptr;
+  for (uint8_t i = 0; i < GENESIS_ENGINE_DAC_STREAMS; i++) {
+    if (streams_[i].id == id) {
+      return &streams_[i];
+    }
+    if (!unused && streams_[i].id == 0xFF) {
+      unused = &streams_[i];
+    }
+  }
+  if (!create || !unused) {
+    return nullptr;
+  }
+
+  unused->id = id;
+  unused->chipType = 0xFF;
+  unused->port = 0;
+  unused->reg = 0;
+  unused->dataType = 0xFF;
+  unused->active = false;
+  unused->loop = false;
+  unused->reverse = false;
+  unused->stepSize = 1;
+  unused->stepBase = 0;
+  unused->start = 0;
+  unused->position = 0;
+  unused->length = 0;
+  unused->remaining = 0;
+  unused->countdown = 0;
+  setFrequency(*unused, 0);
+  return unused;
+}
+
+void DACStreamControl::setFrequency(Stream& stream, uint32_t frequency) {
+  stream.frequency = frequency;
+  stream.interval = frequency ? VGM_SAMPLE_RATE / frequency : 0;
+  stream.remainder = frequency ? VGM_SAMPLE_RATE % frequency : 0;
+  stream.error = 0;
+}
+
+uint16_t DACStreamControl::nextInterval(Stream& stream) {
+  uint16_t samples = stream.interval;
+  stream.error += stream.remainder;
+  if (stream.error >= stream.frequency) {
+    stream.error -= stream.frequency;
+    samples++;
+  }
+  return samples;
+}
@@ -0,0 +1,85 @@
+#ifndef DAC_STREAM_CONTROL_H
+#define DAC_STREAM_CONTROL_H
+
+#include <Arduino.h>
+#include "config/feature_config.h"
+#include "PCMDataBank.h"
+
+// =============================================================================
+// DACStreamControl - VGM DAC stream commands (0x90-0x95)
+//
+// Instead of one 0x8n command per sample, newer VGM files set up a stream
+// once (target register, data bank, frequency) and start it at a bank
+// offset. This class keeps the stream state and works out when each
+// sample is due; VGMParser splits its waits at those points and writes
+// the samples, so they reach the chip through the same direct or queued
+// path as every other write.
+//
+// Only YM2612 streams reading the YM2612 PCM bank (data type 0x00) play.
+// =============================================================================
+
+// Called for every stream write (port, register, value)
+// Returns false if the write could not be taken (output queue full)
+typedef bool (*DACStreamWriteFunc)(void* context, uint8_t port, uint8_t reg, uint8_t val);
+
+class DACStreamControl {
+public:
+  DACStreamControl(PCMDataBank& bank);
+
+  // Forget all streams
+  void reset();
+
+  // Handle a stream command
+  // args: the command's argument bytes (length from the command table)
+  void command(uint8_t cmd, const uint8_t* args);
+
+  // Check if any stream is playing
+  bool isActive() const { return activeCount_ > 0; }
+
+  // Perform the writes due now, then advance up to maxSamples
+  // Returns the samples advanced (stops early at the next due write), or 0
+  // if a write was refused - call again once there is room
+  uint32_t update(uint32_t maxSamples, DACStreamWriteFunc write, void* context);
+
+private:
+  struct Stream {
+    uint8_t id;             // VGM stream ID (0xFF = slot unused)
+    uint8_t chipType;       // Target chip (VGM_STREAM_CHIP_YM2612)
+    uint8_t port;           // Port and register written
+    uint8_t reg;
+    uint8_t dataType;       // Data bank type read (VGM_DATA_YM2612_PCM)
+    bool active;
+    bool loop;
+    bool reverse;
+    uint8_t stepSize;       // Bank bytes advanced per write
+    uint8_t stepBase;       // Offset added to the start position
+    uint32_t frequency;     // Writes per second
+    uint16_t interval;      // Whole samples between writes
+    uint32_t remainder;     // Fractional part (in 1/frequency samples)
+    uint32_t error;         // Accumulated fraction
+    uint16_t countdown;     // Samples until the next write
+    uint32_t start;         // Bank position of the first write
+    uint32_t position;      // Bank position of the next write
+    uint32_t length;        // Writes per playthrough (0 = until end of bank)
+    uint32_t remaining;     // Writes left in this playthrough
+  };
+
+  PCMDataBank& bank_;
+  Stream streams_[GENESIS_ENGINE_DAC_STREAMS];
+  uint8_t activeCount_;
+
+  // Find the slot for a stream ID (create = take a free slot if missing)
+  Stream* find(uint8_t id, bool create);
+
+  // Begin playback at the stream's start position
+  void play(Stream& stream);
+  void stop(Stream& stream);
+
+  // Recompute the write interval after a frequency change
+  static void setFrequency(Stream& stream, uint32_t frequency);
+
+  // Samples until the write after this one (spreads the fraction evenly)
+  static uint16_t nextInterval(Stream& stream);
+};
+
+#endif // DAC_STREAM_CONTROL_H
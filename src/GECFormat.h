@@ -0,0 +1,90 @@
+#ifndef GEC_FORMAT_H
+#define GEC_FORMAT_H
+
+#include <Arduino.h>
+
+// =============================================================================
+// GEC File Format Constants
+// Pre-compiled playback format written by vgm2gec.py
+//
+// A VGM file recompiled into frames: one frame per point in time that has
+// chip writes, holding all of them. A fixed-width frame header counts the
+// writes of each kind, so the player copies them out in a loop per kind
+// instead of decoding a command byte per write. DAC samples take a 4-bit
+// gap each and read on through the data bank, with a pre-resolved position
+// wherever the VGM jumps. The loop point and every second of music start a
+// frame that doesn't depend on the ones before it.
+//
+// Layout (all values little-endian):
+//   Header      GEC_HEADER_SIZE bytes
+//   PCM data    pcmSize bytes - the YM2612 data bank, as one block
+//   Frames      up to an empty frame
+//   Seek table  seekCount entries, one per second of music
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+// File Header
+// -----------------------------------------------------------------------------
+static constexpr uint32_t GEC_MAGIC = 0x31434547;  // "GEC1" in little-endian
+static constexpr uint8_t GEC_VERSION = 1;
+static constexpr uint8_t GEC_HEADER_SIZE = 0x60;
+
+// Header offsets - every offset except dataOffset is relative to the data
+// start (PCM data first, then frames)
+static constexpr uint8_t GEC_OFF_VERSION     = 0x04;  // Format version (8-bit)
+static constexpr uint8_t GEC_OFF_FLAGS       = 0x05;  // GEC_FLAG_* (8-bit)
+static constexpr uint8_t GEC_OFF_SAMPLES     = 0x08;  // Total samples
+static constexpr uint8_t GEC_OFF_LOOP_SAMP   = 0x0C;  // Loop samples
+static constexpr uint8_t GEC_OFF_DATA        = 0x10;  // Data start (absolute)
+static constexpr uint8_t GEC_OFF_PCM_SIZE    = 0x14;  // PCM bytes at the data start
+static constexpr uint8_t GEC_OFF_LOOP        = 0x18;  // Frame the loop starts at
+static constexpr uint8_t GEC_OFF_SEEK        = 0x1C;  // Seek table
+static constexpr uint8_t GEC_OFF_SEEK_COUNT  = 0x20;  // Seek table entries (16-bit)
+static constexpr uint8_t GEC_OFF_VGM_VERSION = 0x24;  // Version of the source VGM
+static constexpr uint8_t GEC_OFF_TITLE       = 0x40;  // Track title (ASCII, 0-padded)
+static constexpr uint8_t GEC_TITLE_SIZE      = 0x20;
+
+// Header flags
+static constexpr uint8_t GEC_FLAG_YM2612  = 0x01;
+static constexpr uint8_t GEC_FLAG_SN76489 = 0x02;
+static constexpr uint8_t GEC_FLAG_LOOP    = 0x04;
+
+// -----------------------------------------------------------------------------
+// Frames
+// -----------------------------------------------------------------------------
+
+// Frame header (5 bytes):
+//   u16 wait      Samples until the next frame, bit 15 = GEC_FRAME_BANK_SEEK
+//   u8  ym        YM2612 port 0 writes (low nibble), port 1 writes (high)
+//   u8  more      YM2612 port 0 writes after the port 1 ones (low nibble),
+//                 SN76489 writes (high)
+//   u8  dac       DAC samples played during the frame
+// followed by a u32 data bank position if GEC_FRAME_BANK_SEEK is set (else
+// the samples follow on from the last one), then the writes group by group
+// (reg, val pairs for the YM2612, one byte each for the SN76489), then one
+// 4-bit gap per DAC sample, low nibble first: samples from the frame start
+// to the first one, then between samples (0-15, at most wait in total).
+// YM2612 writes keep their order (key-ons on port 0 come after the port 1
+// channel setup); SN76489 writes go last, DAC samples at the frame start
+// after the writes. An empty frame (all zero) ends the data.
+static constexpr uint8_t GEC_FRAME_HEADER_SIZE = 5;
+static constexpr uint16_t GEC_FRAME_BANK_SEEK = 0x8000;
+static constexpr uint16_t GEC_FRAME_WAIT_MASK = 0x7FFF;
+
+// Write groups, in the order they appear in a frame (one nibble each)
+static constexpr uint8_t GEC_GROUP_YM0       = 0;
+static constexpr uint8_t GEC_GROUP_YM1       = 1;
+static constexpr uint8_t GEC_GROUP_YM0_AFTER = 2;
+static constexpr uint8_t GEC_GROUP_PSG       = 3;
+static constexpr uint8_t GEC_GROUP_COUNT     = 4;
+
+// -----------------------------------------------------------------------------
+// Seek Table
+// -----------------------------------------------------------------------------
+
+// Entry i: u32 sample, u32 frame position - the frame starting at i seconds
+// (every second boundary starts a frame)
+static constexpr uint8_t GEC_SEEK_ENTRY_SIZE = 8;
+static constexpr uint32_t GEC_SEEK_INTERVAL = 44100;
+
+#endif // GEC_FORMAT_H
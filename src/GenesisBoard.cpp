@@ -1,5 +1,6 @@
 #include "GenesisBoard.h"
 #include "config/feature_config.h"
+#include "PlaybackProfiler.h"
 #include <SPI.h>
 
 #if defined(PLATFORM_ESP32)
@@ -20,12 +21,39 @@ static inline void delayNanoseconds(uint32_t ns) {
 // Automatically disabled on AVR/ESP32 when SD card support is enabled to avoid
 // SPI bus conflict (shift register has no CS pin, would receive garbage
 // during SD communication)
+#if PLATFORM_HAS_CYCLE_COUNTER
+// Spin until cycles have passed since start (wrap-safe)
+static inline void waitCyclesSince(uint32_t start, uint32_t cycles) __attribute__((always_inline));
+static inline void waitCyclesSince(uint32_t start, uint32_t cycles) {
+  while ((uint32_t)(PLATFORM_CYCLE_COUNT() - start) < cycles) { }
+}
+#endif
+
+// Drop writes the register shadow shows would change nothing
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW && GENESIS_ENGINE_SKIP_REDUNDANT_WRITES
+  #define FILTER_WRITES 1
+#else
+  #define FILTER_WRITES 0
+#endif
+
+// Pairs (or PSG bytes) collected before a filtered batch goes to the bus
+static constexpr uint16_t FILTER_CHUNK = 32;
+
 #if (defined(PLATFORM_AVR) || defined(PLATFORM_ESP32)) && GENESIS_ENGINE_USE_SD
   #define USE_HARDWARE_SPI 0
 #else
   #define USE_HARDWARE_SPI 1
 #endif
 
+// Teensy 4: feed the LPSPI transmit FIFO directly instead of the blocking
+// SPI.transfer(), so a byte can shift out while the CPU waits out the chip's
+// busy window. The SPI library's transaction from begin() stays active.
+#if defined(PLATFORM_TEENSY4) && USE_HARDWARE_SPI
+  #define USE_LPSPI_FIFO 1
+#else
+  #define USE_LPSPI_FIFO 0
+#endif
+
 // =============================================================================
 // YM2612 Register Definitions
 // =============================================================================
@@ -51,9 +79,87 @@ GenesisBoard::GenesisBoard(
   pinA1_Y_(pinA1_Y),
   pinSCK_(pinSCK),
   pinSDI_(pinSDI),
+  pinRD_Y_(NO_PIN),
+  pinBusy_(NO_PIN),
+  parallelBus_(false),
+  mirrorCount_(0),
   lastWriteTime_(0),
-  dacStreamMode_(false)
+  dacStreamMode_(false),
+  timing_(defaultBusTiming()),
+  ymBusyUs_(0)
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  , holdingWrites_(false)
+  , holdFromReset_(false)
+#endif
+#if FILTER_WRITES
+  , skippedWrites_(0)
+#endif
+{
+}
+
+GenesisBoard::GenesisBoard(
+  uint8_t pinWR_P,
+  uint8_t pinWR_Y,
+  uint8_t pinIC_Y,
+  uint8_t pinA0_Y,
+  uint8_t pinA1_Y,
+  uint8_t pinSCK,
+  uint8_t pinSDI,
+  uint8_t pinRD_Y,
+  uint8_t pinBusy
+) :
+  GenesisBoard(pinWR_P, pinWR_Y, pinIC_Y, pinA0_Y, pinA1_Y, pinSCK, pinSDI)
+{
+  pinRD_Y_ = pinRD_Y;
+  pinBusy_ = pinBusy;
+}
+
+GenesisBoard::GenesisBoard(
+  uint8_t pinWR_P,
+  uint8_t pinWR_Y,
+  uint8_t pinIC_Y,
+  uint8_t pinA0_Y,
+  uint8_t pinA1_Y,
+  const uint8_t dataPins[8]
+) :
+  GenesisBoard(pinWR_P, pinWR_Y, pinIC_Y, pinA0_Y, pinA1_Y, NO_PIN, NO_PIN)
 {
+  parallelBus_ = true;
+  memcpy(dataPins_, dataPins, sizeof(dataPins_));
+}
+
+// =============================================================================
+// Mirrored Boards
+// =============================================================================
+bool GenesisBoard::addMirror(uint8_t pinWR_P, uint8_t pinWR_Y) {
+  if (mirrorCount_ == GENESIS_ENGINE_MAX_MIRRORS) {
+    return false;
+  }
+
+  // The strobes only fold into one port write if they share the port
+#if defined(PLATFORM_AVR)
+  if (digitalPinToPort(pinWR_P) != digitalPinToPort(pinWR_P_) ||
+      digitalPinToPort(pinWR_Y) != digitalPinToPort(pinWR_Y_)) {
+    return false;
+  }
+#elif defined(PLATFORM_TEENSY4)
+  if (portSetRegister(pinWR_P) != portSetRegister(pinWR_P_) ||
+      portSetRegister(pinWR_Y) != portSetRegister(pinWR_Y_)) {
+    return false;
+  }
+#elif defined(PLATFORM_ESP32)
+  if (pinWR_P >= 32 || pinWR_Y >= 32) {
+    return false;
+  }
+#else
+  // Teensy 3 sets pins through bit-band aliases, the fallback one by one
+  return false;
+#endif
+
+  mirrorWR_P_[mirrorCount_] = pinWR_P;
+  mirrorWR_Y_[mirrorCount_] = pinWR_Y;
+  mirrorCount_++;
+  return true;
 }
 
 // =============================================================================
@@ -73,24 +179,51 @@ void GenesisBoard::begin() {
   digitalWrite(pinIC_Y_, HIGH);  // Not in reset
   digitalWrite(pinA0_Y_, LOW);
   digitalWrite(pinA1_Y_, LOW);
+  for (uint8_t i = 0; i < mirrorCount_; i++) {
+    pinMode(mirrorWR_P_[i], OUTPUT);
+    pinMode(mirrorWR_Y_[i], OUTPUT);
+    digitalWrite(mirrorWR_P_[i], HIGH);
+    digitalWrite(mirrorWR_Y_[i], HIGH);
+  }
 
+  // Status read-back (RD_Y idles high like WR_Y)
+  if (hasBusyReadback()) {
+    pinMode(pinRD_Y_, OUTPUT);
+    digitalWrite(pinRD_Y_, HIGH);
+    pinMode(pinBusy_, INPUT);
+  }
+
+  if (parallelBus_) {
+    // Parallel data bus - no shift register, SPI stays free
+    for (uint8_t i = 0; i < 8; i++) {
+      pinMode(dataPins_[i], OUTPUT);
+      digitalWrite(dataPins_[i], LOW);
+    }
+  } else {
 #if USE_HARDWARE_SPI
-  // Use hardware SPI for shift register - MUCH faster
-  // Mega: MOSI=51, SCK=52. Uno: MOSI=11, SCK=13
-  SPI.begin();
-  // 8MHz SPI clock - fast but within CD74HCT164E specs
-  SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+    // Use hardware SPI for shift register - MUCH faster
+    // Mega: MOSI=51, SCK=52. Uno: MOSI=11, SCK=13
+    SPI.begin();
+    // 8MHz SPI clock - fast but within CD74HCT164E specs
+    SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
 #else
-  // Software bit-bang on custom pins
-  pinMode(pinSCK_, OUTPUT);
-  pinMode(pinSDI_, OUTPUT);
-  digitalWrite(pinSCK_, LOW);
-  digitalWrite(pinSDI_, LOW);
+    // Software bit-bang on custom pins
+    pinMode(pinSCK_, OUTPUT);
+    pinMode(pinSDI_, OUTPUT);
+    digitalWrite(pinSCK_, LOW);
+    digitalWrite(pinSDI_, LOW);
 #endif
+  }
 
   // Initialize fast GPIO for control pins
   initFastGPIO();
 
+#if defined(PLATFORM_TEENSY3)
+  // Batch writes time themselves with the DWT cycle counter
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+
   // Give chips time to stabilize after power-on before reset
   // Teensy boots very fast, need longer delay for YM2612/PSG to be ready
   delay(200);
@@ -105,6 +238,14 @@ void GenesisBoard::begin() {
 // Reset
 // =============================================================================
 void GenesisBoard::reset() {
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  shadow_.clear();
+  if (holdingWrites_) {
+    holdFromReset_ = true;
+    return;  // Chips are reset when writes are released
+  }
+#endif
+
   // Reset YM2612 (hold IC low for at least 24 clock cycles)
   digitalWrite(pinIC_Y_, LOW);
   delayMicroseconds(500);  // Extended reset pulse for reliability
@@ -123,6 +264,75 @@ void GenesisBoard::reset() {
 // =============================================================================
 
 void GenesisBoard::writeYM2612(uint8_t port, uint8_t reg, uint8_t val) {
+  GENESIS_PROFILE_SCOPE(YM_WRITE);
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  if (holdingWrites_) {
+    shadow_.writeYM2612(port, reg, val);
+    GENESIS_PROFILE_HELD(1);
+    return;
+  }
+#endif
+
+#if FILTER_WRITES
+  uint8_t pairs[4];
+  uint8_t count = shadow_.filterYM2612(port, reg, val, pairs);
+  skippedWrites_ = skippedWrites_ + 1 - count;
+  for (uint8_t i = 0; i < count; i++) {
+    writeYM2612Bus(port, pairs[i * 2], pairs[i * 2 + 1]);
+  }
+#else
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  shadow_.writeYM2612(port, reg, val);
+#endif
+  writeYM2612Bus(port, reg, val);
+#endif
+}
+
+void GenesisBoard::writeYM2612Batch(uint8_t port, const uint8_t* pairs, uint16_t count) {
+  if (count == 0) return;
+  GENESIS_PROFILE_SCOPE(YM_WRITE);
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  if (holdingWrites_) {
+    for (uint16_t i = 0; i < count; i++) {
+      shadow_.writeYM2612(port, pairs[i * 2], pairs[i * 2 + 1]);
+    }
+    GENESIS_PROFILE_HELD(count);
+    return;
+  }
+#endif
+
+#if FILTER_WRITES
+  // Keep the pairs that change something, with room for a held-back
+  // frequency latch in front of the last one
+  uint8_t kept[(FILTER_CHUNK + 1) * 2];
+  uint16_t keptCount = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t n = shadow_.filterYM2612(port, pairs[i * 2], pairs[i * 2 + 1], kept + keptCount * 2);
+    skippedWrites_ = skippedWrites_ + 1 - n;
+    keptCount += n;
+    if (keptCount >= FILTER_CHUNK) {
+      writeYM2612BusBatch(port, kept, keptCount);
+      keptCount = 0;
+    }
+  }
+  if (keptCount > 0) {
+    writeYM2612BusBatch(port, kept, keptCount);
+  }
+#else
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  for (uint16_t i = 0; i < count; i++) {
+    shadow_.writeYM2612(port, pairs[i * 2], pairs[i * 2 + 1]);
+  }
+#endif
+  writeYM2612BusBatch(port, pairs, count);
+#endif
+}
+
+void GenesisBoard::writeYM2612Bus(uint8_t port, uint8_t reg, uint8_t val) {
+  GENESIS_PROFILE_WRITES(1);
+
   // Exit DAC stream mode if active
   if (dacStreamMode_) {
     endDACStream();
@@ -148,45 +358,51 @@ void GenesisBoard::writeYM2612(uint8_t port, uint8_t reg, uint8_t val) {
   *portWR_Y_ |= maskWR_Y_;
 
 #elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
-  waitIfNeeded(YM_BUSY_US);
   if (port) *portSetA1_Y_ = maskA1_Y_; else *portClearA1_Y_ = maskA1_Y_;
 
+  // Address shifts out while the previous write's busy window runs
+  // (WR is high, so the chip ignores the bus until the strobe)
   *portClearA0_Y_ = maskA0_Y_;
-  shiftOut8(reg);
-  delayMicroseconds(4);  // Data setup time before WR
+  shiftStart(reg);
+  waitYMReady();
+  shiftFinish();
+  delayMicroseconds(timing_.ymSetupUs);  // Data setup time before WR
   *portClearWR_Y_ = maskWR_Y_;
   delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
   *portSetWR_Y_ = maskWR_Y_;
 
   *portSetA0_Y_ = maskA0_Y_;
-  shiftOut8(val);
-  delayMicroseconds(4);  // Data setup time before WR
+  shiftStart(val);
+  shiftFinish();
+  delayMicroseconds(timing_.ymSetupUs);  // Data setup time before WR
   *portClearWR_Y_ = maskWR_Y_;
   delayNanoseconds(200);
   *portSetWR_Y_ = maskWR_Y_;
   lastWriteTime_ = micros();
+  ymBusyUs_ = ymBusyAfter(reg);
 
 #elif defined(PLATFORM_ESP32)
-  waitIfNeeded(YM_BUSY_US);
+  waitYMReady();
   if (port) GPIO.out_w1ts = (1 << pinA1_Y_cached_); else GPIO.out_w1tc = (1 << pinA1_Y_cached_);
 
   GPIO.out_w1tc = (1 << pinA0_Y_cached_);
   shiftOut8(reg);
-  delayMicroseconds(4);  // Data setup time before WR
-  GPIO.out_w1tc = (1 << pinWR_Y_cached_);
+  delayMicroseconds(timing_.ymSetupUs);  // Data setup time before WR
+  GPIO.out_w1tc = maskWR_Y_;
   delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
-  GPIO.out_w1ts = (1 << pinWR_Y_cached_);
+  GPIO.out_w1ts = maskWR_Y_;
 
   GPIO.out_w1ts = (1 << pinA0_Y_cached_);
   shiftOut8(val);
-  delayMicroseconds(4);  // Data setup time before WR
-  GPIO.out_w1tc = (1 << pinWR_Y_cached_);
+  delayMicroseconds(timing_.ymSetupUs);  // Data setup time before WR
+  GPIO.out_w1tc = maskWR_Y_;
   delayNanoseconds(200);
-  GPIO.out_w1ts = (1 << pinWR_Y_cached_);
+  GPIO.out_w1ts = maskWR_Y_;
   lastWriteTime_ = micros();
+  ymBusyUs_ = ymBusyAfter(reg);
 
 #else
-  waitIfNeeded(YM_BUSY_US);
+  waitYMReady();
   digitalWrite(pinA1_Y_, port ? HIGH : LOW);
   digitalWrite(pinA0_Y_, LOW);
   shiftOut8(reg);
@@ -195,6 +411,114 @@ void GenesisBoard::writeYM2612(uint8_t port, uint8_t reg, uint8_t val) {
   shiftOut8(val);
   pulseLow(pinWR_Y_);
   lastWriteTime_ = micros();
+  ymBusyUs_ = ymBusyAfter(reg);
+#endif
+}
+
+void GenesisBoard::writeYM2612BusBatch(uint8_t port, const uint8_t* pairs, uint16_t count) {
+#if defined(PLATFORM_AVR) || defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3) || \
+    defined(PLATFORM_ESP32)
+  GENESIS_PROFILE_WRITES(count);  // The fallback counts in writeYM2612Bus()
+#endif
+
+  // Exit DAC stream mode if active
+  if (dacStreamMode_) {
+    endDACStream();
+  }
+
+#if defined(PLATFORM_AVR)
+  // AVR: same as writeYM2612(), with the port select latched once
+  if (port) *portA1_Y_ |= maskA1_Y_; else *portA1_Y_ &= ~maskA1_Y_;
+
+  for (uint16_t i = 0; i < count; i++, pairs += 2) {
+    *portA0_Y_ &= ~maskA0_Y_;
+    shiftOut8(pairs[0]);
+    *portWR_Y_ &= ~maskWR_Y_;
+    *portWR_Y_ |= maskWR_Y_;
+
+    *portA0_Y_ |= maskA0_Y_;
+    shiftOut8(pairs[1]);
+    *portWR_Y_ &= ~maskWR_Y_;
+    *portWR_Y_ |= maskWR_Y_;
+  }
+
+#elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+  const uint32_t cyclesPerUs = PLATFORM_CYCLES_PER_US();
+  const uint32_t setupCycles = timing_.ymSetupUs * cyclesPerUs;  // Data setup time before WR
+  const bool readBack = hasBusyReadback();
+
+  waitYMReady();
+  if (port) *portSetA1_Y_ = maskA1_Y_; else *portClearA1_Y_ = maskA1_Y_;
+
+  uint32_t dataStrobe = PLATFORM_CYCLE_COUNT();
+  uint32_t busyCycles = 0;  // Busy after the previous data write
+  uint8_t busyUs = ymBusyUs_;
+  for (uint16_t i = 0; i < count; i++, pairs += 2) {
+    // Address is loaded while the previous data write is still busy
+    // (WR is high, so the chip ignores the bus until the strobe)
+    *portClearA0_Y_ = maskA0_Y_;
+    shiftStart(pairs[0]);
+    if (readBack) waitYMStatus(); else waitCyclesSince(dataStrobe, busyCycles);
+    shiftFinish();
+    waitCyclesSince(PLATFORM_CYCLE_COUNT(), setupCycles);
+    *portClearWR_Y_ = maskWR_Y_;
+    delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
+    *portSetWR_Y_ = maskWR_Y_;
+
+    *portSetA0_Y_ = maskA0_Y_;
+    shiftStart(pairs[1]);
+    shiftFinish();
+    waitCyclesSince(PLATFORM_CYCLE_COUNT(), setupCycles);
+    *portClearWR_Y_ = maskWR_Y_;
+    delayNanoseconds(200);
+    *portSetWR_Y_ = maskWR_Y_;
+    dataStrobe = PLATFORM_CYCLE_COUNT();
+    busyUs = ymBusyAfter(pairs[0]);
+    busyCycles = busyUs * cyclesPerUs;
+  }
+  lastWriteTime_ = micros();
+  ymBusyUs_ = busyUs;
+
+#elif defined(PLATFORM_ESP32)
+  const uint32_t cyclesPerUs = PLATFORM_CYCLES_PER_US();
+  const uint32_t setupCycles = timing_.ymSetupUs * cyclesPerUs;  // Data setup time before WR
+  const bool readBack = hasBusyReadback();
+
+  waitYMReady();
+  if (port) GPIO.out_w1ts = (1 << pinA1_Y_cached_); else GPIO.out_w1tc = (1 << pinA1_Y_cached_);
+
+  uint32_t dataStrobe = PLATFORM_CYCLE_COUNT();
+  uint32_t busyCycles = 0;  // Busy after the previous data write
+  uint8_t busyUs = ymBusyUs_;
+  for (uint16_t i = 0; i < count; i++, pairs += 2) {
+    // Address is loaded while the previous data write is still busy
+    GPIO.out_w1tc = (1 << pinA0_Y_cached_);
+    shiftOut8(pairs[0]);
+    uint32_t loaded = PLATFORM_CYCLE_COUNT();
+    if (readBack) waitYMStatus(); else waitCyclesSince(dataStrobe, busyCycles);
+    waitCyclesSince(loaded, setupCycles);
+    GPIO.out_w1tc = maskWR_Y_;
+    delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
+    GPIO.out_w1ts = maskWR_Y_;
+
+    GPIO.out_w1ts = (1 << pinA0_Y_cached_);
+    shiftOut8(pairs[1]);
+    waitCyclesSince(PLATFORM_CYCLE_COUNT(), setupCycles);
+    GPIO.out_w1tc = maskWR_Y_;
+    delayNanoseconds(200);
+    GPIO.out_w1ts = maskWR_Y_;
+    dataStrobe = PLATFORM_CYCLE_COUNT();
+    busyUs = ymBusyAfter(pairs[0]);
+    busyCycles = busyUs * cyclesPerUs;
+  }
+  lastWriteTime_ = micros();
+  ymBusyUs_ = busyUs;
+
+#else
+  // No cycle counter - fall back to individual writes
+  for (uint16_t i = 0; i < count; i++, pairs += 2) {
+    writeYM2612Bus(port, pairs[0], pairs[1]);
+  }
 #endif
 }
 
@@ -205,7 +529,7 @@ void GenesisBoard::setDACEnabled(bool enabled) {
 void GenesisBoard::beginDACStream() {
   if (dacStreamMode_) return;
 
-  waitIfNeeded(YM_BUSY_US);
+  waitYMReady();
 
 #if defined(PLATFORM_AVR)
   *portA1_Y_ &= ~maskA1_Y_;  // Port 0
@@ -230,9 +554,9 @@ void GenesisBoard::beginDACStream() {
   GPIO.out_w1tc = (1 << pinA0_Y_cached_);
   shiftOut8(YM2612_DAC_DATA);
   delayNanoseconds(100);  // Data setup time before WR
-  GPIO.out_w1tc = (1 << pinWR_Y_cached_);
+  GPIO.out_w1tc = maskWR_Y_;
   delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
-  GPIO.out_w1ts = (1 << pinWR_Y_cached_);
+  GPIO.out_w1ts = maskWR_Y_;
   GPIO.out_w1ts = (1 << pinA0_Y_cached_);
 
 #else
@@ -263,6 +587,15 @@ void GenesisBoard::endDACStream() {
 }
 
 void GenesisBoard::writeDAC(uint8_t sample) {
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  shadow_.writeYM2612(0, YM2612_DAC_DATA, sample);
+  if (holdingWrites_) {
+    GENESIS_PROFILE_HELD(1);
+    return;
+  }
+#endif
+  GENESIS_PROFILE_WRITES(1);
+
   // Auto-enter streaming mode if needed
   if (!dacStreamMode_) {
     beginDACStream();
@@ -276,42 +609,145 @@ void GenesisBoard::writeDAC(uint8_t sample) {
   *portWR_Y_ |= maskWR_Y_;
 
 #elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
-  waitIfNeeded(YM_BUSY_US);
-  shiftOut8(sample);
+  shiftStart(sample);
+  waitYMReady();
+  shiftFinish();
   delayNanoseconds(100);  // Data setup time before WR
   *portClearWR_Y_ = maskWR_Y_;
   delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
   *portSetWR_Y_ = maskWR_Y_;
   lastWriteTime_ = micros();
+  ymBusyUs_ = timing_.ymBusyUs;
 
 #elif defined(PLATFORM_ESP32)
-  waitIfNeeded(YM_BUSY_US);
+  waitYMReady();
   shiftOut8(sample);
   delayNanoseconds(100);  // Data setup time before WR
-  GPIO.out_w1tc = (1 << pinWR_Y_cached_);
+  GPIO.out_w1tc = maskWR_Y_;
   delayNanoseconds(200);  // YM2612 needs minimum WR pulse width
-  GPIO.out_w1ts = (1 << pinWR_Y_cached_);
+  GPIO.out_w1ts = maskWR_Y_;
   lastWriteTime_ = micros();
+  ymBusyUs_ = timing_.ymBusyUs;
 
 #else
-  waitIfNeeded(YM_BUSY_US);
+  waitYMReady();
   shiftOut8(sample);
   pulseLow(pinWR_Y_);
   lastWriteTime_ = micros();
+  ymBusyUs_ = timing_.ymBusyUs;
 #endif
 }
 
+void GenesisBoard::writeDACRun(const uint8_t* samples, const uint8_t* waits, uint8_t count) {
+  if (count == 0) return;
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  if (holdingWrites_) {
+    // No pacing while fast-forwarding - only the last sample matters
+    shadow_.writeYM2612(0, YM2612_DAC_DATA, samples[count - 1]);
+    GENESIS_PROFILE_HELD(count);
+    return;
+  }
+#endif
+
+  // Each sample is due a whole number of VGM samples after the first, so
+  // pace against the run's start instead of accumulating per-write error
+  uint32_t due = 0;  // VGM samples from the first write
+#if PLATFORM_HAS_CYCLE_COUNTER
+  // CPU cycles per VGM sample, 28.4 fixed point
+  const uint32_t cyclesPerSample16 =
+      (uint32_t)(((uint64_t)PLATFORM_CYCLES_PER_US() * 16000000ULL) / 44100);
+  uint32_t start = PLATFORM_CYCLE_COUNT();
+#else
+  uint32_t start = micros();
+#endif
+
+  writeDAC(samples[0]);
+  for (uint8_t i = 1; i < count; i++) {
+    due += waits[i - 1];
+#if PLATFORM_HAS_CYCLE_COUNTER
+    uint32_t target = (due * cyclesPerSample16) >> 4;
+    while (PLATFORM_CYCLE_COUNT() - start < target) {}
+#else
+    uint32_t target = (due * 5805UL) >> 8;  // 22.676us per sample (24.8 fixed)
+    while (micros() - start < target) {}
+#endif
+    writeDAC(samples[i]);
+  }
+}
+
 // =============================================================================
 // SN76489 Functions
 // =============================================================================
 
 void GenesisBoard::writePSG(uint8_t val) {
-  // Exit DAC stream mode if active (shares shift register)
-  if (dacStreamMode_) {
-    endDACStream();
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  if (holdingWrites_) {
+    shadow_.writePSG(val);
+    GENESIS_PROFILE_HELD(1);
+    return;
+  }
+#endif
+
+#if FILTER_WRITES
+  uint8_t bytes[2];
+  uint8_t count = shadow_.filterPSG(val, bytes);
+  skippedWrites_ = skippedWrites_ + 1 - count;
+  if (count > 0) {
+    writePSGBusBatch(bytes, count);
+  }
+#else
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  shadow_.writePSG(val);
+#endif
+  writePSGBus(val);
+#endif
+}
+
+void GenesisBoard::writePSGBatch(const uint8_t* data, uint16_t count) {
+  if (count == 0) return;
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  if (holdingWrites_) {
+    for (uint16_t i = 0; i < count; i++) {
+      shadow_.writePSG(data[i]);
+    }
+    GENESIS_PROFILE_HELD(count);
+    return;
+  }
+#endif
+
+#if FILTER_WRITES
+  uint8_t kept[FILTER_CHUNK + 1];
+  uint16_t keptCount = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t n = shadow_.filterPSG(data[i], kept + keptCount);
+    skippedWrites_ = skippedWrites_ + 1 - n;
+    keptCount += n;
+    if (keptCount >= FILTER_CHUNK) {
+      writePSGBusBatch(kept, keptCount);
+      keptCount = 0;
+    }
+  }
+  if (keptCount > 0) {
+    writePSGBusBatch(kept, keptCount);
+  }
+#else
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  for (uint16_t i = 0; i < count; i++) {
+    shadow_.writePSG(data[i]);
   }
+#endif
+  writePSGBusBatch(data, count);
+#endif
+}
 
-  waitIfNeeded(PSG_BUSY_US);
+void GenesisBoard::writePSGBus(uint8_t val) {
+  GENESIS_PROFILE_WRITES(1);
+
+  // DAC stream mode survives PSG writes: the YM2612 ignores the shared
+  // shift register while WR_Y is high, and 0x2A stays latched
+  waitIfNeeded(timing_.psgBusyUs);
 
   // SN76489 needs bit reversal due to board wiring (QA→D7 reversed)
   shiftOut8(reverseBits(val));
@@ -320,41 +756,91 @@ void GenesisBoard::writePSG(uint8_t val) {
   // Original: 8µs minimum pulse width
 #if defined(PLATFORM_AVR)
   *portWR_P_ &= ~maskWR_P_;
-  delayMicroseconds(8);  // PSG needs full pulse width
+  delayMicroseconds(timing_.psgPulseUs);  // PSG needs full pulse width
   *portWR_P_ |= maskWR_P_;
 #elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
   *portClearWR_P_ = maskWR_P_;
-  delayMicroseconds(8);  // Teensy is fast, needs real delay
+  delayMicroseconds(timing_.psgPulseUs);  // Teensy is fast, needs real delay
   *portSetWR_P_ = maskWR_P_;
 #elif defined(PLATFORM_ESP32)
-  GPIO.out_w1tc = (1 << pinWR_P_cached_);
-  delayMicroseconds(8);  // PSG needs full 8µs pulse width
-  GPIO.out_w1ts = (1 << pinWR_P_cached_);
+  GPIO.out_w1tc = maskWR_P_;
+  delayMicroseconds(timing_.psgPulseUs);  // PSG needs full 8µs pulse width
+  GPIO.out_w1ts = maskWR_P_;
 #else
   digitalWrite(pinWR_P_, LOW);
-  delayMicroseconds(8);
+  delayMicroseconds(timing_.psgPulseUs);
   digitalWrite(pinWR_P_, HIGH);
 #endif
 
   lastWriteTime_ = micros();
 }
 
+void GenesisBoard::writePSGBusBatch(const uint8_t* data, uint16_t count) {
+#if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3) || defined(PLATFORM_ESP32)
+  const uint32_t cyclesPerUs = PLATFORM_CYCLES_PER_US();
+  const uint32_t pulseCycles = timing_.psgPulseUs * cyclesPerUs;  // WR pulse width
+  const uint32_t busyCycles = timing_.psgBusyUs * cyclesPerUs;    // Delay between writes
+  GENESIS_PROFILE_WRITES(count);
+
+  waitIfNeeded(timing_.psgBusyUs);
+  shiftOut8(reverseBits(data[0]));
+
+  for (uint16_t i = 0; i < count; i++) {
+    uint32_t strobe = PLATFORM_CYCLE_COUNT();
+#if defined(PLATFORM_ESP32)
+    GPIO.out_w1tc = maskWR_P_;
+    waitCyclesSince(strobe, pulseCycles);
+    GPIO.out_w1ts = maskWR_P_;
+#else
+    *portClearWR_P_ = maskWR_P_;
+    waitCyclesSince(strobe, pulseCycles);
+    *portSetWR_P_ = maskWR_P_;
+#endif
+
+    // Load the next byte while the PSG finishes this one
+    if (i + 1 < count) {
+      uint32_t released = PLATFORM_CYCLE_COUNT();
+      shiftOut8(reverseBits(data[i + 1]));
+      waitCyclesSince(released, busyCycles);
+    }
+  }
+  lastWriteTime_ = micros();
+
+#else
+  for (uint16_t i = 0; i < count; i++) {
+    writePSGBus(data[i]);
+  }
+#endif
+}
+
 void GenesisBoard::silencePSG() {
   // Maximum attenuation on all 4 channels
   // Channel 0 (tone 1): 0x9F
   // Channel 1 (tone 2): 0xBF
   // Channel 2 (tone 3): 0xDF
   // Channel 3 (noise):  0xFF
-  writePSG(0x9F);
-  writePSG(0xBF);
-  writePSG(0xDF);
-  writePSG(0xFF);
+  static const uint8_t silence[4] = { 0x9F, 0xBF, 0xDF, 0xFF };
+  writePSGBatch(silence, 4);
 }
 
 // =============================================================================
 // Utility
 // =============================================================================
 
+GenesisBoard::BusTiming GenesisBoard::defaultBusTiming() {
+  BusTiming timing;
+  timing.ymBusyUs = GENESIS_ENGINE_YM_BUSY_US;
+  timing.ymChannelBusyUs = GENESIS_ENGINE_YM_CHANNEL_BUSY_US;
+  timing.ymSetupUs = GENESIS_ENGINE_YM_SETUP_US;
+  timing.psgPulseUs = GENESIS_ENGINE_PSG_PULSE_US;
+  timing.psgBusyUs = GENESIS_ENGINE_PSG_BUSY_US;
+  return timing;
+}
+
+bool GenesisBoard::usesHardwareSPI() const {
+  return !parallelBus_ && USE_HARDWARE_SPI;
+}
+
 void GenesisBoard::muteAll() {
   silencePSG();
 
@@ -367,6 +853,45 @@ void GenesisBoard::muteAll() {
   setDACEnabled(false);
 }
 
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+// =============================================================================
+// Register Shadow
+// =============================================================================
+
+void GenesisBoard::holdWrites(bool fromReset) {
+  holdingWrites_ = true;
+  holdFromReset_ = fromReset;
+  if (fromReset) {
+    shadow_.clear();
+  }
+  shadow_.clearChanged();
+}
+
+void GenesisBoard::releaseWrites() {
+  if (!holdingWrites_) return;
+  holdingWrites_ = false;
+
+  // reset() clears the shadow - restoring the image fills it in again
+  RegisterShadow image = shadow_;
+  reset();
+  image.restore(*this);
+}
+
+void GenesisBoard::flushWrites() {
+  if (!holdingWrites_) return;
+  if (holdFromReset_) {
+    releaseWrites();
+    return;
+  }
+  holdingWrites_ = false;
+
+  // The chips still have the rest of the image
+  RegisterShadow image = shadow_;
+  shadow_.forgetChanged();
+  image.restoreChanged(*this);
+}
+#endif
+
 // =============================================================================
 // Internal Functions
 // =============================================================================
@@ -377,31 +902,39 @@ void GenesisBoard::muteAll() {
 void GenesisBoard::initFastGPIO() {
 #if defined(PLATFORM_AVR)
   // Cache port addresses and bitmasks for AVR
-  portSCK_ = portOutputRegister(digitalPinToPort(pinSCK_));
-  portSDI_ = portOutputRegister(digitalPinToPort(pinSDI_));
+  if (!parallelBus_) {
+    portSCK_ = portOutputRegister(digitalPinToPort(pinSCK_));
+    portSDI_ = portOutputRegister(digitalPinToPort(pinSDI_));
+    maskSCK_ = digitalPinToBitMask(pinSCK_);
+    maskSDI_ = digitalPinToBitMask(pinSDI_);
+  }
   portWR_Y_ = portOutputRegister(digitalPinToPort(pinWR_Y_));
   portWR_P_ = portOutputRegister(digitalPinToPort(pinWR_P_));
   portA0_Y_ = portOutputRegister(digitalPinToPort(pinA0_Y_));
   portA1_Y_ = portOutputRegister(digitalPinToPort(pinA1_Y_));
-  maskSCK_ = digitalPinToBitMask(pinSCK_);
-  maskSDI_ = digitalPinToBitMask(pinSDI_);
   maskWR_Y_ = digitalPinToBitMask(pinWR_Y_);
   maskWR_P_ = digitalPinToBitMask(pinWR_P_);
   maskA0_Y_ = digitalPinToBitMask(pinA0_Y_);
   maskA1_Y_ = digitalPinToBitMask(pinA1_Y_);
+  for (uint8_t i = 0; i < mirrorCount_; i++) {
+    maskWR_P_ |= digitalPinToBitMask(mirrorWR_P_[i]);
+    maskWR_Y_ |= digitalPinToBitMask(mirrorWR_Y_[i]);
+  }
 
 #elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
   // Teensy: cache set/clear registers
-  maskSCK_ = digitalPinToBitMask(pinSCK_);
-  maskSDI_ = digitalPinToBitMask(pinSDI_);
+  if (!parallelBus_) {
+    maskSCK_ = digitalPinToBitMask(pinSCK_);
+    maskSDI_ = digitalPinToBitMask(pinSDI_);
+    portSetSCK_ = portSetRegister(pinSCK_);
+    portClearSCK_ = portClearRegister(pinSCK_);
+    portSetSDI_ = portSetRegister(pinSDI_);
+    portClearSDI_ = portClearRegister(pinSDI_);
+  }
   maskWR_Y_ = digitalPinToBitMask(pinWR_Y_);
   maskWR_P_ = digitalPinToBitMask(pinWR_P_);
   maskA0_Y_ = digitalPinToBitMask(pinA0_Y_);
   maskA1_Y_ = digitalPinToBitMask(pinA1_Y_);
-  portSetSCK_ = portSetRegister(pinSCK_);
-  portClearSCK_ = portClearRegister(pinSCK_);
-  portSetSDI_ = portSetRegister(pinSDI_);
-  portClearSDI_ = portClearRegister(pinSDI_);
   portSetWR_Y_ = portSetRegister(pinWR_Y_);
   portClearWR_Y_ = portClearRegister(pinWR_Y_);
   portSetWR_P_ = portSetRegister(pinWR_P_);
@@ -410,24 +943,128 @@ void GenesisBoard::initFastGPIO() {
   portClearA0_Y_ = portClearRegister(pinA0_Y_);
   portSetA1_Y_ = portSetRegister(pinA1_Y_);
   portClearA1_Y_ = portClearRegister(pinA1_Y_);
+  for (uint8_t i = 0; i < mirrorCount_; i++) {
+    maskWR_P_ |= digitalPinToBitMask(mirrorWR_P_[i]);
+    maskWR_Y_ |= digitalPinToBitMask(mirrorWR_Y_[i]);
+  }
+  if (hasBusyReadback()) {
+    maskRD_Y_ = digitalPinToBitMask(pinRD_Y_);
+    maskBusy_ = digitalPinToBitMask(pinBusy_);
+    portSetRD_Y_ = portSetRegister(pinRD_Y_);
+    portClearRD_Y_ = portClearRegister(pinRD_Y_);
+    portInBusy_ = portInputRegister(pinBusy_);
+  }
 
 #elif defined(PLATFORM_ESP32)
-  // ESP32 - cache pin numbers
+  // ESP32 - cache pin numbers and the write strobe bits
   pinSCK_cached_ = pinSCK_;
   pinSDI_cached_ = pinSDI_;
-  pinWR_Y_cached_ = pinWR_Y_;
-  pinWR_P_cached_ = pinWR_P_;
   pinA0_Y_cached_ = pinA0_Y_;
   pinA1_Y_cached_ = pinA1_Y_;
+  pinRD_Y_cached_ = pinRD_Y_;
+  pinBusy_cached_ = pinBusy_;
+  maskWR_Y_ = 1UL << pinWR_Y_;
+  maskWR_P_ = 1UL << pinWR_P_;
+  for (uint8_t i = 0; i < mirrorCount_; i++) {
+    maskWR_P_ |= 1UL << mirrorWR_P_[i];
+    maskWR_Y_ |= 1UL << mirrorWR_Y_[i];
+  }
 
 #endif
   // Other platforms use standard digitalWrite (no caching needed)
+
+  if (parallelBus_) {
+    initDataBus();
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Parallel Data Bus
+// -----------------------------------------------------------------------------
+void GenesisBoard::initDataBus() {
+#if defined(PLATFORM_AVR)
+  // One port write if D0-D7 are bits 0-7 of the same port
+  portData_ = portOutputRegister(digitalPinToPort(dataPins_[0]));
+  for (uint8_t i = 0; i < 8; i++) {
+    if (portOutputRegister(digitalPinToPort(dataPins_[i])) != portData_ ||
+        digitalPinToBitMask(dataPins_[i]) != (uint8_t)(1 << i)) {
+      portData_ = nullptr;
+      break;
+    }
+  }
+
+#elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+  // One clear and one set if D0-D7 are consecutive bits of the same port
+  // (Teensy 3 pin registers are bit-band aliases, so it goes pin by pin)
+  portSetData_ = nullptr;
+  portClearData_ = nullptr;
+  dataShift_ = 0;
+#if defined(PLATFORM_TEENSY4)
+  uint32_t mask = digitalPinToBitMask(dataPins_[0]);
+  while (mask > 1 && !(mask & 1)) {
+    mask >>= 1;
+    dataShift_++;
+  }
+  if (dataShift_ <= 24) {
+    portSetData_ = portSetRegister(dataPins_[0]);
+    portClearData_ = portClearRegister(dataPins_[0]);
+    for (uint8_t i = 0; i < 8; i++) {
+      if (portSetRegister(dataPins_[i]) != portSetData_ ||
+          digitalPinToBitMask(dataPins_[i]) != (1UL << (dataShift_ + i))) {
+        portSetData_ = nullptr;
+        break;
+      }
+    }
+  }
+#endif
+
+#elif defined(PLATFORM_ESP32)
+  for (uint8_t i = 0; i < 8; i++) {
+    dataMask_[i] = 1UL << dataPins_[i];
+  }
+#endif
+}
+
+inline void GenesisBoard::writeDataBus(uint8_t data) {
+#if defined(PLATFORM_ESP32)
+  // Clear the 0 bits and set the 1 bits, each in one register write
+  uint32_t set = 0;
+  uint32_t clear = 0;
+  for (uint8_t i = 0; i < 8; i++, data >>= 1) {
+    if (data & 1) set |= dataMask_[i]; else clear |= dataMask_[i];
+  }
+  GPIO.out_w1tc = clear;
+  GPIO.out_w1ts = set;
+
+#else
+#if defined(PLATFORM_AVR)
+  if (portData_) {
+    *portData_ = data;
+    return;
+  }
+#elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+  if (portSetData_) {
+    // WR is high, so the chips don't see the bus between the two writes
+    *portClearData_ = (uint32_t)(uint8_t)~data << dataShift_;
+    *portSetData_ = (uint32_t)data << dataShift_;
+    return;
+  }
+#endif
+  for (uint8_t i = 0; i < 8; i++, data >>= 1) {
+    digitalWrite(dataPins_[i], (data & 1) ? HIGH : LOW);
+  }
+#endif
 }
 
 // -----------------------------------------------------------------------------
 // Optimized Shift Out - Platform Specific
 // -----------------------------------------------------------------------------
 void GenesisBoard::shiftOut8(uint8_t data) {
+  if (parallelBus_) {
+    writeDataBus(data);
+    return;
+  }
+
 #if USE_HARDWARE_SPI
   // Hardware SPI - blazing fast (~1µs per byte at 8MHz)
   SPI.transfer(data);
@@ -501,6 +1138,32 @@ void GenesisBoard::shiftOut8(uint8_t data) {
 #endif
 }
 
+// -----------------------------------------------------------------------------
+// Split Shift Out - start a byte, do other waiting, then finish
+// Only Teensy 4 hardware SPI actually overlaps; elsewhere shiftStart() blocks
+// -----------------------------------------------------------------------------
+inline void GenesisBoard::shiftStart(uint8_t data) {
+#if USE_LPSPI_FIFO
+  if (parallelBus_) {
+    writeDataBus(data);
+    return;
+  }
+  IMXRT_LPSPI4_S.TDR = data;
+#else
+  shiftOut8(data);
+#endif
+}
+
+inline void GenesisBoard::shiftFinish() {
+#if USE_LPSPI_FIFO
+  if (parallelBus_) return;
+  // The received byte arrives once the last bit has clocked out, so an
+  // empty RX FIFO means the shift register outputs aren't settled yet
+  while (IMXRT_LPSPI4_S.RSR & LPSPI_RSR_RXEMPTY) { }
+  (void)IMXRT_LPSPI4_S.RDR;
+#endif
+}
+
 uint8_t GenesisBoard::reverseBits(uint8_t b) {
   // Fast bit reversal using parallel swaps
   b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
@@ -516,6 +1179,54 @@ inline void GenesisBoard::waitIfNeeded(uint32_t minMicros) {
   }
 }
 
+inline void GenesisBoard::waitYMReady() {
+  if (hasBusyReadback()) {
+    waitYMStatus();
+  } else {
+    waitIfNeeded(ymBusyUs_);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// YM2612 Status Read-Back
+// The YM2612 returns its status at every address, so A0/A1 stay where the
+// write left them. Gives up after GENESIS_ENGINE_YM_BUSY_TIMEOUT_US so an
+// unwired busy line can't stall the bus.
+// -----------------------------------------------------------------------------
+void GenesisBoard::waitYMStatus() {
+#if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+  const uint32_t timeout = GENESIS_ENGINE_YM_BUSY_TIMEOUT_US * PLATFORM_CYCLES_PER_US();
+  const uint32_t start = PLATFORM_CYCLE_COUNT();
+  bool busy;
+  do {
+    *portClearRD_Y_ = maskRD_Y_;
+    delayNanoseconds(200);  // Status is valid after the RD access time
+    busy = (*portInBusy_ & maskBusy_) != 0;
+    *portSetRD_Y_ = maskRD_Y_;
+  } while (busy && (uint32_t)(PLATFORM_CYCLE_COUNT() - start) < timeout);
+
+#elif defined(PLATFORM_ESP32)
+  const uint32_t timeout = GENESIS_ENGINE_YM_BUSY_TIMEOUT_US * PLATFORM_CYCLES_PER_US();
+  const uint32_t start = PLATFORM_CYCLE_COUNT();
+  bool busy;
+  do {
+    GPIO.out_w1tc = (1 << pinRD_Y_cached_);
+    delayNanoseconds(200);  // Status is valid after the RD access time
+    busy = (GPIO.in >> pinBusy_cached_) & 1;
+    GPIO.out_w1ts = (1 << pinRD_Y_cached_);
+  } while (busy && (uint32_t)(PLATFORM_CYCLE_COUNT() - start) < timeout);
+
+#else
+  const uint32_t start = micros();
+  bool busy;
+  do {
+    digitalWrite(pinRD_Y_, LOW);
+    busy = digitalRead(pinBusy_) == HIGH;
+    digitalWrite(pinRD_Y_, HIGH);
+  } while (busy && micros() - start < GENESIS_ENGINE_YM_BUSY_TIMEOUT_US);
+#endif
+}
+
 inline void GenesisBoard::pulseLow(uint8_t pin) {
   digitalWrite(pin, LOW);
   delayMicroseconds(1);  // Minimum pulse width
@@ -3,6 +3,10 @@
 
 #include <Arduino.h>
 #include "config/platform_detect.h"
+#include "config/feature_config.h"
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+#include "RegisterShadow.h"
+#endif
 
 // =============================================================================
 // GenesisBoard - Hardware driver for FM-90s Genesis Engine
@@ -25,6 +29,54 @@ public:
     uint8_t pinSDI      // SDI  - Shift register data in
   );
 
+  // Board revisions with YM2612 status read-back: RD_Y strobes a status
+  // read and pinBusy reads data line D7 (the busy bit), so writes wait
+  // for the chip instead of the worst case.
+  // REQUIRED: a 4.7k series resistor between the CD74HCT164E's D7 output
+  // and the YM2612's D7 pin, with pinBusy on the YM2612 side. The 164 has
+  // no output enable and keeps driving D7 through every read, so without
+  // the resistor the two outputs short whenever the bit differs. On boards
+  // whose pins aren't 5V tolerant (Teensy 4.x, Teensy 3.6, ESP32), pinBusy
+  // also needs a divider (e.g. 10k from D7, 20k to ground).
+  GenesisBoard(
+    uint8_t pinWR_P, uint8_t pinWR_Y, uint8_t pinIC_Y,
+    uint8_t pinA0_Y, uint8_t pinA1_Y, uint8_t pinSCK, uint8_t pinSDI,
+    uint8_t pinRD_Y,    // RD_Y - YM2612 read strobe (active low)
+    uint8_t pinBusy     // YM2612 D7, read while RD_Y is low
+  );
+
+  // Parallel data bus: D0-D7 wired to GPIOs instead of the CD74HCT164E
+  // (status read-back needs the shift register constructor). A byte is one
+  // port write when the pins are bits 0-7 of one AVR port (Mega PORTA:
+  // pins 22-29) or eight consecutive bits of one Teensy 4 GPIO port
+  // (Teensy 4.1 GPIO6 bits 16-23: pins 19, 18, 14, 15, 40, 41, 17, 16);
+  // other pins are set one by one (ESP32: GPIO 0-31 only). SPI is left
+  // free for an SD card.
+  GenesisBoard(
+    uint8_t pinWR_P, uint8_t pinWR_Y, uint8_t pinIC_Y,
+    uint8_t pinA0_Y, uint8_t pinA1_Y,
+    const uint8_t dataPins[8]   // D0-D7 (copied)
+  );
+
+  static constexpr uint8_t NO_PIN = 0xFF;
+
+  // -------------------------------------------------------------------------
+  // Mirrored Boards
+  // Further boards playing the same writes: D0-D7 (from the shift register
+  // or the parallel bus), A0_Y, A1_Y and IC_Y wired in parallel with this
+  // board's, each with its own WR_P and WR_Y. Their strobes are set in the
+  // same port writes as this board's, so a write reaches every board in the
+  // time it takes to reach one. The pins must be on the port of this
+  // board's WR_P/WR_Y (same AVR port, same Teensy 4 GPIO port; ESP32
+  // GPIO 0-31). Status read-back only reads this board's YM2612.
+  // -------------------------------------------------------------------------
+
+  // Add a mirrored board - call before begin()
+  // Returns false if GENESIS_ENGINE_MAX_MIRRORS are already added or a pin
+  // isn't on the right port (Teensy 3 and other platforms: never)
+  bool addMirror(uint8_t pinWR_P, uint8_t pinWR_Y);
+  uint8_t getMirrorCount() const { return mirrorCount_; }
+
   // -------------------------------------------------------------------------
   // Initialization
   // Call once in setup() before any playback
@@ -47,10 +99,22 @@ public:
   // val: value to write
   void writeYM2612(uint8_t port, uint8_t reg, uint8_t val);
 
+  // Write a burst of registers on one YM2612 port
+  // pairs: count (reg, val) byte pairs
+  // Faster than repeated writeYM2612() calls: A1 is latched once and each
+  // shift-register load overlaps the previous write's busy window
+  void writeYM2612Batch(uint8_t port, const uint8_t* pairs, uint16_t count);
+
   // Write DAC sample (for PCM playback on channel 6)
   // Optimized for streaming - latches address once
   void writeDAC(uint8_t sample);
 
+  // Write a run of DAC samples paced by the VGM sample clock
+  // waits[i]: VGM samples (1/44100 s) between samples[i] and samples[i + 1]
+  // (the last wait is left to the caller). Address 0x2A stays latched with
+  // A0 high for the whole run; blocks for the sum of the other waits.
+  void writeDACRun(const uint8_t* samples, const uint8_t* waits, uint8_t count);
+
   // Enable/disable DAC mode on channel 6
   void setDACEnabled(bool enabled);
 
@@ -69,6 +133,10 @@ public:
   // Handles bit reversal automatically (board wiring quirk)
   void writePSG(uint8_t val);
 
+  // Write a burst of bytes to SN76489
+  // Each byte is shifted in while the previous write's busy window runs
+  void writePSGBatch(const uint8_t* data, uint16_t count);
+
   // Silence all PSG channels
   void silencePSG();
 
@@ -79,6 +147,65 @@ public:
   // Mute all sound (both chips)
   void muteAll();
 
+  // Bus timing in microseconds (defaults from feature_config.h)
+  // With status read-back the two YM2612 busy waits aren't used
+  struct BusTiming {
+    uint8_t ymBusyUs;         // Wait after a YM2612 data write
+    uint8_t ymChannelBusyUs;  // Wait after a data write to 0xA0-0xB6
+    uint8_t ymSetupUs;        // Data setup before WR_Y (Teensy, ESP32)
+    uint8_t psgPulseUs;       // WR_P pulse width
+    uint8_t psgBusyUs;        // Wait after a PSG write
+  };
+
+  // Change the bus timing (values below the chips' datasheet figures can
+  // drop or corrupt writes - see the BusBenchmark example)
+  void setBusTiming(const BusTiming& timing) { timing_ = timing; }
+  const BusTiming& getBusTiming() const { return timing_; }
+  static BusTiming defaultBusTiming();
+
+  // True if the shift register is loaded through hardware SPI (false when
+  // it is bit-banged on pinSCK/pinSDI, or with a parallel bus)
+  bool usesHardwareSPI() const;
+
+  // True if bytes go out on a parallel D0-D7 bus
+  bool hasParallelBus() const { return parallelBus_; }
+
+  // True if writes wait on the YM2612 busy bit (read-back constructor;
+  // AVR doesn't wait for the YM2612 at all)
+  bool hasBusyReadback() const { return pinBusy_ != NO_PIN; }
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  // -------------------------------------------------------------------------
+  // Register Shadow
+  // Every write is recorded, so the board knows the chips' current state
+  // -------------------------------------------------------------------------
+
+  // Hold writes back from the bus - they only update the shadow
+  // (used to fast-forward playback silently)
+  // fromReset: start from the state right after a chip reset
+  void holdWrites(bool fromReset);
+
+  // Stop holding writes: reset the chips and write the shadowed register
+  // image to them in one batch
+  void releaseWrites();
+
+  // Stop holding writes without a chip reset: only the registers written
+  // while held that ended up changed are sent, in one batch (used to catch
+  // up after a stall). Same as releaseWrites() if the hold began from
+  // reset or reset() was called during it.
+  void flushWrites();
+
+  bool isHoldingWrites() const { return holdingWrites_; }
+
+  // Register image the chips have (or will have once writes are released)
+  const RegisterShadow& getShadow() const { return shadow_; }
+
+#if GENESIS_ENGINE_SKIP_REDUNDANT_WRITES
+  // Writes dropped because they would not have changed a register
+  uint32_t getSkippedWrites() const { return skippedWrites_; }
+#endif
+#endif
+
 private:
   // Pin assignments
   uint8_t pinWR_P_;   // WR_P - PSG write
@@ -88,6 +215,17 @@ private:
   uint8_t pinA1_Y_;   // A1_Y - YM2612 address bit 1
   uint8_t pinSCK_;    // SCK  - Shift register clock
   uint8_t pinSDI_;    // SDI  - Shift register data
+  uint8_t pinRD_Y_;   // RD_Y - YM2612 read strobe (NO_PIN without read-back)
+  uint8_t pinBusy_;   // YM2612 D7 (NO_PIN without read-back)
+
+  // Parallel data bus (instead of the shift register)
+  bool parallelBus_;
+  uint8_t dataPins_[8];   // D0-D7
+
+  // Mirrored boards' write strobes (folded into the WR masks)
+  uint8_t mirrorWR_P_[GENESIS_ENGINE_MAX_MIRRORS];
+  uint8_t mirrorWR_Y_[GENESIS_ENGINE_MAX_MIRRORS];
+  uint8_t mirrorCount_;
 
   // Timing tracking (smart timing pattern)
   uint32_t lastWriteTime_;
@@ -95,14 +233,16 @@ private:
   // DAC streaming state
   bool dacStreamMode_;
 
-  // Timing constants (microseconds)
-  // Note: Teensy needs these full values, AVR is slow enough it doesn't
-#if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
-  static constexpr uint32_t YM_BUSY_US = 5;    // YM2612 busy flag duration
-  static constexpr uint32_t PSG_BUSY_US = 9;   // SN76489 write delay
-#else
-  static constexpr uint32_t YM_BUSY_US = 0;    // AVR GPIO is slow enough
-  static constexpr uint32_t PSG_BUSY_US = 0;   // AVR GPIO is slow enough
+  BusTiming timing_;
+  uint8_t ymBusyUs_;  // Wait owed after the last YM2612 data write
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  RegisterShadow shadow_;
+  bool holdingWrites_;
+  bool holdFromReset_;        // The chips need a reset when writes go out
+#if GENESIS_ENGINE_SKIP_REDUNDANT_WRITES
+  uint32_t skippedWrites_;
+#endif
 #endif
 
   // Fast GPIO - cached port/bitmask for direct port manipulation
@@ -119,6 +259,7 @@ private:
   uint8_t maskWR_P_;
   uint8_t maskA0_Y_;
   uint8_t maskA1_Y_;
+  volatile uint8_t* portData_;      // Parallel bus port (nullptr: pin by pin)
 #elif defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
   volatile uint32_t* portSetSCK_;
   volatile uint32_t* portClearSCK_;
@@ -138,22 +279,49 @@ private:
   uint32_t maskWR_P_;
   uint32_t maskA0_Y_;
   uint32_t maskA1_Y_;
+  volatile uint32_t* portSetRD_Y_;
+  volatile uint32_t* portClearRD_Y_;
+  volatile uint32_t* portInBusy_;
+  uint32_t maskRD_Y_;
+  uint32_t maskBusy_;
+  volatile uint32_t* portSetData_;  // Parallel bus port (nullptr: pin by pin)
+  volatile uint32_t* portClearData_;
+  uint8_t dataShift_;               // Port bit of D0
 #elif defined(PLATFORM_ESP32)
   uint8_t pinSCK_cached_;
   uint8_t pinSDI_cached_;
-  uint8_t pinWR_Y_cached_;
-  uint8_t pinWR_P_cached_;
+  uint32_t maskWR_Y_;               // WR_Y and WR_P GPIO bits (with mirrors)
+  uint32_t maskWR_P_;
   uint8_t pinA0_Y_cached_;
   uint8_t pinA1_Y_cached_;
+  uint8_t pinRD_Y_cached_;
+  uint8_t pinBusy_cached_;
+  uint32_t dataMask_[8];            // Parallel bus GPIO bits
 #endif
 
   // -------------------------------------------------------------------------
   // Internal Functions
   // -------------------------------------------------------------------------
 
+  // Bus writes (the public write functions record and filter first)
+  void writeYM2612Bus(uint8_t port, uint8_t reg, uint8_t val);
+  void writeYM2612BusBatch(uint8_t port, const uint8_t* pairs, uint16_t count);
+  void writePSGBus(uint8_t val);
+  void writePSGBusBatch(const uint8_t* data, uint16_t count);
+
   // Shift out 8 bits to the CD74HCT164E (optimized per platform)
   void shiftOut8(uint8_t data);
 
+  // Split shift out: shiftStart() begins sending a byte, shiftFinish()
+  // waits until it is on the outputs (Teensy 4 uses the LPSPI FIFO)
+  inline void shiftStart(uint8_t data);
+  inline void shiftFinish();
+
+  // Parallel bus: put a byte on D0-D7 (shiftOut8() does this when the
+  // board has one)
+  void initDataBus();
+  inline void writeDataBus(uint8_t data);
+
   // Initialize fast GPIO (called from begin())
   void initFastGPIO();
 
@@ -163,6 +331,16 @@ private:
   // Smart timing - only waits if needed
   inline void waitIfNeeded(uint32_t minMicros);
 
+  // Wait until the YM2612 takes a write: the busy bit with read-back,
+  // otherwise the time owed by the last data write
+  inline void waitYMReady();
+  void waitYMStatus();
+
+  // Busy wait after a data write to reg (fallback without read-back)
+  inline uint8_t ymBusyAfter(uint8_t reg) const {
+    return reg >= 0xA0 ? timing_.ymChannelBusyUs : timing_.ymBusyUs;
+  }
+
   // Pulse a pin low for a short duration
   inline void pulseLow(uint8_t pin);
 };
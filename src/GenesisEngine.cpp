@@ -1,4 +1,11 @@
 #include "GenesisEngine.h"
+#if defined(PLATFORM_AVR)
+#include <avr/sleep.h>
+#endif
+
+// Writes startNextTrack() needs queue room for (DAC off, PSG, FM key offs,
+// for each chip of a dual-chip setup)
+static constexpr uint16_t HANDOVER_WRITES = 22;
 
 // =============================================================================
 // Timing Constants
@@ -9,24 +16,149 @@
 // This gives us exact timing with no floating point
 // =============================================================================
 
+#if GENESIS_ENGINE_USE_TIMER
+// Engine owning the timer (IntervalTimer callbacks take no user data)
+static GenesisEngine* g_timerEngine = nullptr;
+#endif
+
 // =============================================================================
 // Constructor
 // =============================================================================
 
 GenesisEngine::GenesisEngine(GenesisBoard& board)
   : board_(board),
+    secondChip_(nullptr),
+    memoryArena_(nullptr),
     parser_(board),
+#if GENESIS_ENGINE_USE_INFO_CACHE
+    infoFileSize_(0),
+    infoPending_(false),
+#endif
     state_(GenesisEngineState::STOPPED),
     looping_(false),
+    trackNumber_(0),
+    catchUpLate_(GENESIS_ENGINE_CATCHUP_LATE),
+    catchUpMax_(GENESIS_ENGINE_CATCHUP_MAX),
+    catchingUp_(false),
+    readingAhead_(false),
+#if GENESIS_ENGINE_USE_SD
+    nextQueued_(false),
+    handoverFailed_(false),
+#endif
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+    enqueueCount_(0),
+    nextVGZCount_(0),
+    nextVGZSource_(nullptr),
+#endif
     currentSample_(0),
     waitSamples_(0),
     playbackStartTime_(0),
-    samplesPlayed_(0)
+    samplesPlayed_(0),
+    clockSample_(0),
+    clockBase_(0),
+    decodeSample_(0),
+    decodeFinished_(false),
+    clockRunning_(false),
+    queuedPlayback_(false),
+    trackBase_(0),
+    pendingBase_(0),
+    trackPending_(false)
+#if GENESIS_ENGINE_USE_TIMER
+    , timerDriven_(false)
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+    , dualCore_(false)
+    , decodeTask_(nullptr)
+    , busTask_(nullptr)
+    , tasksRunning_(false)
+    , decodeTaskAlive_(false)
+    , busTaskAlive_(false)
+#endif
 {
   // PCM data for DAC playback is now handled dynamically by PCMDataBank
   // inside VGMParser - no pre-allocated buffer needed
+#if GENESIS_ENGINE_USE_SD
+  nextPath_[0] = '\0';
+#endif
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  memset(&info_, 0, sizeof(info_));
+  infoPath_[0] = '\0';
+#endif
+#if GENESIS_ENGINE_USE_PROFILING
+  PlaybackProfiler::reset();
+#endif
 }
 
+bool GenesisEngine::setMemoryArena(MemoryArena* arena) {
+  if (state_ == GenesisEngineState::PLAYING || state_ == GenesisEngineState::PAUSED) {
+    return false;
+  }
+
+  // Buffers already handed out must go back to where they came from
+  VGMSource* source = parser_.getSource();
+  if (source) {
+    source->close();
+  }
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  closeNextFile();
+#endif
+  PCMDataBank& bank = parser_.getPCMDataBank();
+  bank.clear();
+
+  memoryArena_ = arena;
+  bank.setMemoryArena(arena);
+#if GENESIS_ENGINE_USE_SD
+  sdSource_.setMemoryArena(arena);
+#endif
+#if GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
+  for (VGZSource& vgz : vgzSources_) {
+    vgz.setMemoryArena(arena);
+  }
+#endif
+  return true;
+}
+
+bool GenesisEngine::setSecondChip(GenesisBoard* board) {
+  if (state_ == GenesisEngineState::PLAYING || state_ == GenesisEngineState::PAUSED ||
+      board == &board_) {
+    return false;
+  }
+  secondChip_ = board;
+  parser_.setSecondChip(board);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Both Boards
+// -----------------------------------------------------------------------------
+
+void GenesisEngine::muteBoards() {
+  board_.muteAll();
+  if (secondChip_) secondChip_->muteAll();
+}
+
+void GenesisEngine::resetBoards() {
+  board_.reset();
+  if (secondChip_) secondChip_->reset();
+}
+
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+void GenesisEngine::holdBoards(bool fromReset) {
+  board_.holdWrites(fromReset);
+  if (secondChip_) secondChip_->holdWrites(fromReset);
+}
+
+void GenesisEngine::releaseBoards() {
+  board_.releaseWrites();
+  if (secondChip_) secondChip_->releaseWrites();
+}
+
+void GenesisEngine::flushBoards() {
+  board_.flushWrites();
+  if (secondChip_) secondChip_->flushWrites();
+}
+#endif
+
 // =============================================================================
 // Playback Control
 // =============================================================================
@@ -56,7 +188,7 @@ bool GenesisEngine::play(const uint8_t* data, size_t length) {
 }
 
 bool GenesisEngine::playChunked(const uint8_t* const* chunks, const uint16_t* chunkSizes,
-                                 uint8_t numChunks, uint32_t totalLength) {
+                                 uint16_t numChunks, uint32_t totalLength) {
   // Stop any current playback
   stop();
 
@@ -88,20 +220,39 @@ bool GenesisEngine::startPlayback() {
     return false;
   }
 
+  beginPlayback();
+  return true;
+}
+
+void GenesisEngine::beginPlayback() {
   // Reset timing
   currentSample_ = 0;
   waitSamples_ = 0;
   samplesPlayed_ = 0;
   playbackStartTime_ = micros();
 
+  // Reset queued playback (decoding starts on the first update(), after
+  // the caller has finished setting up the source)
+  writeQueue_.clear();
+  clockSample_ = 0;
+  clockBase_ = 0;
+  decodeSample_ = 0;
+  decodeFinished_ = false;
+  clockRunning_ = false;
+  trackNumber_ = 0;
+  trackBase_ = 0;
+  trackPending_ = false;
+#if GENESIS_ENGINE_USE_SD
+  handoverFailed_ = false;
+#endif
+
   // Reset hardware
-  board_.muteAll();
+  muteBoards();
 
   // Start playing
   state_ = GenesisEngineState::PLAYING;
 
   GENESIS_DEBUG_PRINTLN("Playback started");
-  return true;
 }
 
 void GenesisEngine::stop() {
@@ -109,11 +260,24 @@ void GenesisEngine::stop() {
     return;
   }
 
+  // Stop the consumer before touching the board or the queue
+  stopClock();
+  writeQueue_.clear();
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  updateInfoCache();
+#endif
+
   // Full hardware reset to clear any hanging notes
-  board_.reset();
+  resetBoards();
 
   // Reset state
   parser_.reset();
+#if GENESIS_ENGINE_USE_SD
+  nextQueued_ = false;
+#endif
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  closeNextFile();
+#endif
   state_ = GenesisEngineState::STOPPED;
   currentSample_ = 0;
   waitSamples_ = 0;
@@ -124,7 +288,9 @@ void GenesisEngine::stop() {
 void GenesisEngine::pause() {
   if (state_ == GenesisEngineState::PLAYING) {
     state_ = GenesisEngineState::PAUSED;
-    board_.muteAll();
+    // Freeze the playback clock - queued writes resume where they left off
+    stopClock();
+    muteBoards();
     GENESIS_DEBUG_PRINTLN("Playback paused");
   }
 }
@@ -132,6 +298,7 @@ void GenesisEngine::pause() {
 void GenesisEngine::resume() {
   if (state_ == GenesisEngineState::PAUSED) {
     state_ = GenesisEngineState::PLAYING;
+    // Queued modes restart their clock on the next update()
     // Adjust start time so timing continues correctly
     // We pretend playback started (now - time_already_played)
     uint32_t elapsedSamplesMicros = (samplesPlayed_ * 10000UL) / 441UL;
@@ -140,6 +307,146 @@ void GenesisEngine::resume() {
   }
 }
 
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+bool GenesisEngine::seekToSample(uint32_t sample) {
+  if (state_ != GenesisEngineState::PLAYING && state_ != GenesisEngineState::PAUSED) {
+    return false;
+  }
+
+  // Stop the consumer - from here on writes only update the board's shadow
+  stopClock();
+  holdBoards(false);
+
+  // Sample position the parser has decoded up to
+  uint32_t position;
+  if (writeQueue_.isAllocated()) {
+    // Writes decoded ahead are part of the state at that position
+    writeQueue_.drain(board_, decodeSample_, 0xFFFF, false, secondChip_);
+    writeQueue_.clear();
+
+    // An enqueue()d file already decoded into the queue is the one seeked in
+    if (trackPending_) {
+      trackBase_ = pendingBase_;
+      trackPending_ = false;
+      trackNumber_++;
+    }
+    position = decodeSample_ - trackBase_;
+    trackBase_ = 0;
+  } else {
+    position = currentSample_ + waitSamples_;
+  }
+
+  bool ok = true;
+  bool ended = false;
+  if (sample < position) {
+    // Replay from the start, beginning with chips fresh from reset
+    ok = parser_.rewind();
+    if (ok) {
+      holdBoards(true);
+      position = 0;
+    }
+  }
+
+  if (ok) {
+    // Fast-forward with writes going to the board (and its shadow)
+    RegisterWriteQueue* queue = parser_.getOutputQueue();
+    parser_.setOutputQueue(nullptr);
+
+    while (position < sample) {
+      uint32_t wait = parser_.processUntilWait();
+      if (parser_.isFinished()) {
+        if (looping_ && parser_.hasLoop() && parser_.seekToLoop()) {
+          continue;
+        }
+        ended = true;
+        break;
+      }
+      position += wait;
+    }
+
+    parser_.setOutputQueue(queue);
+  }
+
+  releaseBoards();
+
+  if (ended) {
+    finishPlayback();
+    return true;
+  }
+
+  if (ok) {
+    currentSample_ = sample;
+  }
+
+  // The rest of the wait that crossed the position is still to play
+  waitSamples_ = position - currentSample_;
+  samplesPlayed_ = 0;
+  playbackStartTime_ = micros();
+
+  // Queued modes decode from the new position and restart their clock on
+  // the next update() (after resume() if paused)
+  decodeSample_ = position;
+  clockSample_ = currentSample_;
+  decodeFinished_ = false;
+
+  if (state_ == GenesisEngineState::PAUSED) {
+    muteBoards();
+  }
+
+  GENESIS_DEBUG_PRINTLN(ok ? "Seek done" : "Seek failed");
+  return ok;
+}
+#else
+bool GenesisEngine::seekToSample(uint32_t sample) {
+  if ((state_ != GenesisEngineState::PLAYING && state_ != GenesisEngineState::PAUSED) ||
+      !parser_.isGEC()) {
+    return false;
+  }
+
+  // Loops played through come back to the same place in the file
+  uint32_t inFile = sample;
+  uint32_t total = parser_.getTotalSamples();
+  uint32_t loopLength = parser_.getLoopSamples();
+  if (inFile >= total) {
+    if (!looping_ || !parser_.hasLoop() || loopLength == 0 || loopLength > total) {
+      finishPlayback();
+      return true;
+    }
+    inFile = total - loopLength + (inFile - total) % loopLength;
+  }
+
+  stopClock();
+  writeQueue_.clear();
+  // An enqueue()d file already decoded into the queue is the one seeked in
+  if (trackPending_) {
+    trackPending_ = false;
+    trackNumber_++;
+  }
+  trackBase_ = 0;
+
+  // No register image to restore - silence the chips and let the music
+  // bring them back up
+  uint32_t reached;
+  bool ok = parser_.seekNear(inFile, reached);
+  muteBoards();
+  if (!ok) {
+    GENESIS_DEBUG_PRINTLN("Seek failed");
+    return false;
+  }
+
+  currentSample_ = reached + (sample - inFile);
+  waitSamples_ = 0;
+  samplesPlayed_ = 0;
+  playbackStartTime_ = micros();
+  decodeSample_ = currentSample_;
+  clockSample_ = currentSample_;
+  decodeFinished_ = false;
+
+  GENESIS_DEBUG_PRINTLN("Seek done");
+  return true;
+}
+#endif
+
 // =============================================================================
 // Update
 // =============================================================================
@@ -148,6 +455,12 @@ void GenesisEngine::update() {
   if (state_ != GenesisEngineState::PLAYING) {
     return;
   }
+  GENESIS_PROFILE_TICK();
+
+  if (writeQueue_.isAllocated()) {
+    updateQueued();
+    return;
+  }
 
   uint32_t now = micros();
   uint32_t elapsed = now - playbackStartTime_;
@@ -165,6 +478,14 @@ void GenesisEngine::update() {
   // samples = elapsed_micros * 44100 / 1000000 = elapsed_micros * 441 / 10000
   uint32_t targetSamples = (elapsed / 10000UL) * 441UL + ((elapsed % 10000UL) * 441UL) / 10000UL;
 
+  // Fallen behind - play the backlog quietly, skipping past the oldest part
+  uint32_t due = samplesPlayed_ + waitSamples_;
+  if (catchUpLate_ > 0 && targetSamples > due && targetSamples - due > catchUpLate_) {
+    uint32_t slip = beginCatchUp(targetSamples - due);
+    playbackStartTime_ += (slip / 441UL) * 10000UL + ((slip % 441UL) * 10000UL) / 441UL;
+    targetSamples -= slip;
+  }
+
   // Process commands until we catch up
   while (samplesPlayed_ < targetSamples) {
     // If we have pending wait samples, consume them
@@ -179,12 +500,12 @@ void GenesisEngine::update() {
       currentSample_ += samplesToAdvance;
 
       if (waitSamples_ > 0) {
-        // Still waiting, done for now
-        return;
+        break;
       }
     }
 
-    // Process commands until next wait
+    // Process commands until next wait (due at samplesPlayed_)
+    GENESIS_PROFILE_LATE(targetSamples - samplesPlayed_);
     processCommands();
 
     if (state_ != GenesisEngineState::PLAYING) {
@@ -192,6 +513,121 @@ void GenesisEngine::update() {
       return;
     }
   }
+  endCatchUp();
+
+  // Still waiting - use the gap to read ahead
+  readingAhead_ = waitSamples_ >= GENESIS_ENGINE_PREFETCH_MIN_WAIT && prefetch();
+}
+
+// -----------------------------------------------------------------------------
+// CPU Idle
+// -----------------------------------------------------------------------------
+
+// Samples to microseconds, rounded up (the sample clock reaches sample n
+// at this many microseconds)
+static inline uint32_t samplesToMicros(uint32_t samples) {
+  return (uint32_t)(((uint64_t)samples * 10000UL + 440UL) / 441UL);
+}
+
+uint32_t GenesisEngine::microsUntilDue() const {
+  if (state_ != GenesisEngineState::PLAYING) {
+    return NOTHING_DUE;
+  }
+
+  if (!writeQueue_.isAllocated()) {
+    // Direct playback: the end of the current wait (the next sample if
+    // there is none)
+    if (readingAhead_) {
+      return 0;
+    }
+    uint32_t due = samplesToMicros(samplesPlayed_ + (waitSamples_ ? waitSamples_ : 1));
+    uint32_t elapsed = micros() - playbackStartTime_;
+    return due > elapsed ? due - elapsed : 0;
+  }
+
+  if (!clockRunning_ || readingAhead_) {
+    return 0;
+  }
+
+  // Queued modes: the next write, or the sample the decoder may run ahead
+  // from (the last wait once everything is decoded)
+  uint32_t due;
+  bool scheduled = writeQueue_.peekSample(due);
+  if (!decodeFinished_ && !writeQueue_.isFull()) {
+    uint32_t decode = decodeSample_ - GENESIS_ENGINE_QUEUE_LOOKAHEAD + 1;
+    if (!scheduled || (int32_t)(decode - due) < 0) {
+      due = decode;
+    }
+  } else if (!scheduled) {
+    due = decodeSample_;
+  }
+#if GENESIS_ENGINE_USE_TIMER || GENESIS_ENGINE_USE_DUAL_CORE
+  bool ownClock = false;
+#if GENESIS_ENGINE_USE_TIMER
+  ownClock = ownClock || timerDriven_;
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  ownClock = ownClock || dualCore_;
+#endif
+  if (ownClock) {
+    // The ISR or bus task advances the clock
+    int32_t ahead = (int32_t)(due - clockSample_);
+    return ahead > 0 ? samplesToMicros((uint32_t)ahead) : 0;
+  }
+#endif
+
+  // update() clock: clockBase_ at playbackStartTime_
+  int32_t sinceBase = (int32_t)(due - clockBase_);
+  if (sinceBase <= 0) {
+    return 0;
+  }
+  uint32_t dueMicros = samplesToMicros((uint32_t)sinceBase);
+  uint32_t elapsed = micros() - playbackStartTime_;
+  return dueMicros > elapsed ? dueMicros - elapsed : 0;
+}
+
+void GenesisEngine::sleepUntilDue() {
+#if PLATFORM_HAS_IDLE
+  uint32_t wait = microsUntilDue();
+  if (wait == 0) {
+    return;
+  }
+  uint32_t start = micros();
+
+  if (wait > PLATFORM_IDLE_WAKE_US + GENESIS_ENGINE_IDLE_MARGIN_US) {
+    // The next interrupt comes before the deadline
+    PLATFORM_IDLE();
+    GENESIS_PROFILE_IDLE(micros() - start);
+    return;
+  }
+
+  // Too close to rest through a wake interval
+  while (micros() - start < wait) {
+  }
+#endif
+}
+
+uint32_t GenesisEngine::beginCatchUp(uint32_t backlog) {
+  uint32_t slip = (catchUpMax_ > 0 && backlog > catchUpMax_) ? backlog - catchUpMax_ : 0;
+  GENESIS_PROFILE_CATCH_UP(slip);
+
+  parser_.setSkipDAC(true);
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  holdBoards(false);
+#endif
+  catchingUp_ = true;
+  return slip;
+}
+
+void GenesisEngine::endCatchUp() {
+  if (!catchingUp_) {
+    return;
+  }
+  catchingUp_ = false;
+  parser_.setSkipDAC(false);
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  flushBoards();
+#endif
 }
 
 void GenesisEngine::processCommands() {
@@ -209,12 +645,433 @@ void GenesisEngine::processCommands() {
       }
     }
 
-    // Playback finished - full reset to clear any hanging notes
-    board_.reset();
-    state_ = GenesisEngineState::FINISHED;
-    GENESIS_DEBUG_PRINTLN("Playback finished");
+#if GENESIS_ENGINE_USE_SD
+    if (startNextTrack()) {
+      waitSamples_ = parser_.processUntilWait();
+      if (!parser_.isFinished()) {
+        return;
+      }
+    }
+    if (handoverFailed_) {
+      stop();
+      return;
+    }
+#endif
+
+    finishPlayback();
+  }
+}
+
+void GenesisEngine::finishPlayback() {
+  endCatchUp();
+  stopClock();
+  writeQueue_.clear();
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  updateInfoCache();
+#endif
+
+  // Playback finished - full reset to clear any hanging notes
+  resetBoards();
+#if GENESIS_ENGINE_USE_SD
+  nextQueued_ = false;
+#endif
+  state_ = GenesisEngineState::FINISHED;
+  GENESIS_DEBUG_PRINTLN("Playback finished");
+}
+
+// =============================================================================
+// Queued Playback
+// =============================================================================
+
+bool GenesisEngine::setQueuedPlayback(bool enabled) {
+  if (state_ == GenesisEngineState::PLAYING || state_ == GenesisEngineState::PAUSED) {
+    return false;
+  }
+  bool previous = queuedPlayback_;
+  queuedPlayback_ = enabled;
+  if (!configureQueue(queueNeeded())) {
+    queuedPlayback_ = previous;
+    return false;
+  }
+  return true;
+}
+
+bool GenesisEngine::queueNeeded() const {
+#if GENESIS_ENGINE_USE_TIMER
+  if (timerDriven_) {
+    return true;
+  }
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  if (dualCore_) {
+    return true;
+  }
+#endif
+  return queuedPlayback_;
+}
+
+bool GenesisEngine::configureQueue(bool needed) {
+  if (needed == writeQueue_.isAllocated()) {
+    return true;
+  }
+
+  if (needed) {
+    if (!writeQueue_.allocate(GENESIS_ENGINE_QUEUE_SIZE)) {
+      GENESIS_DEBUG_PRINTLN("Failed to allocate write queue");
+      return false;
+    }
+    parser_.setOutputQueue(&writeQueue_);
+  } else {
+    parser_.setOutputQueue(nullptr);
+    writeQueue_.release();
+  }
+  return true;
+}
+
+void GenesisEngine::updateQueued() {
+  if (!clockRunning_) {
+    // First update after start/resume: prime the queue, then start the clock
+    // so header parsing and PCM loading don't count as playback time
+    fillQueue();
+    startClock();
+    if (!clockRunning_) {
+      GENESIS_DEBUG_PRINTLN("Failed to start playback clock");
+      stop();
+      return;
+    }
+  }
+
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  if (dualCore_) {
+    // Decode and bus tasks do the work, just follow the clock
+    profileLateness();
+    updatePosition();
+    checkQueueFinished();
+    return;
+  }
+#endif
+
+  // Consumer: everything due by now goes to the chips first
+  drainQueue();
+
+  // Producer: decode ahead (drains in between so long refills stay on time)
+  fillQueue();
+
+  // Queue is topped up - use the slack to read ahead
+  readingAhead_ = prefetch();
+
+  updatePosition();
+  checkQueueFinished();
+}
+
+void GenesisEngine::updatePosition() {
+  // The next file starts once the clock has played out the previous one
+  if (trackPending_ && (int32_t)(clockSample_ - pendingBase_) >= 0) {
+    trackBase_ = pendingBase_;
+    trackPending_ = false;
+    trackNumber_++;
+  }
+  currentSample_ = clockSample_ - trackBase_;
+}
+
+void GenesisEngine::drainQueue() {
+#if GENESIS_ENGINE_USE_TIMER
+  if (timerDriven_) {
+    profileLateness();
+    return;  // ISR is the consumer
+  }
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  if (dualCore_) {
+    return;  // Bus task is the consumer
+  }
+#endif
+  if (!clockRunning_) {
+    return;
+  }
+
+  updateClock();
+  profileLateness();
+
+  // Fallen behind - drop the backlog's DAC samples and collapse its writes,
+  // and let the clock slip past the oldest part
+  uint32_t next;
+  if (catchUpLate_ > 0 && writeQueue_.peekSample(next) &&
+      (int32_t)(clockSample_ - next) > (int32_t)catchUpLate_) {
+    uint32_t slip = beginCatchUp(clockSample_ - next);
+    clockBase_ -= slip;
+    clockSample_ -= slip;
+    writeQueue_.drain(board_, clockSample_, 0xFFFF, true, secondChip_);
+    endCatchUp();
+    return;
+  }
+
+  writeQueue_.drain(board_, clockSample_, 0xFFFF, false, secondChip_);
+}
+
+void GenesisEngine::updateClock() {
+  uint32_t elapsed = micros() - playbackStartTime_;
+
+  // Rebase every 10 seconds (exactly 441000 samples) so the elapsed
+  // microsecond count never overflows and no rounding error accumulates
+  while (elapsed >= 10000000UL) {
+    playbackStartTime_ += 10000000UL;
+    clockBase_ += 441000UL;
+    elapsed -= 10000000UL;
+  }
+
+  // samples = elapsed_micros * 441 / 10000
+  clockSample_ = clockBase_ + (elapsed / 10000UL) * 441UL + ((elapsed % 10000UL) * 441UL) / 10000UL;
+}
+
+void GenesisEngine::startClock() {
+  if (clockRunning_) {
+    return;
+  }
+#if GENESIS_ENGINE_USE_TIMER
+  if (timerDriven_) {
+    startTimer();
+    return;
+  }
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  if (dualCore_) {
+    startTasks();
+    return;
+  }
+#endif
+
+  // Continue from the current position (0 at start, paused position on resume)
+  clockBase_ = clockSample_;
+  playbackStartTime_ = micros();
+  clockRunning_ = true;
+}
+
+void GenesisEngine::stopClock() {
+#if GENESIS_ENGINE_USE_TIMER
+  stopTimer();
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  stopTasks();
+#endif
+  clockRunning_ = false;
+}
+
+void GenesisEngine::fillQueue() {
+  while (!decodeFinished_ && !writeQueue_.isFull() &&
+         (int32_t)(decodeSample_ - (clockSample_ + GENESIS_ENGINE_QUEUE_LOOKAHEAD)) < 0) {
+    // Everything decoded in this call is due at decodeSample_
+    parser_.setWriteTime(decodeSample_);
+    uint32_t wait = parser_.processUntilWait();
+
+    if (parser_.isFinished()) {
+      if (looping_ && parser_.hasLoop() && parser_.seekToLoop()) {
+        GENESIS_DEBUG_PRINTLN("Looping");
+        continue;
+      }
+#if GENESIS_ENGINE_USE_SD
+      if (nextQueued_) {
+        // Wait for room for the boundary writes (retried on the next call)
+        if (writeQueue_.capacity() - writeQueue_.count() < HANDOVER_WRITES) {
+          break;
+        }
+        if (startNextTrack()) {
+          continue;
+        }
+      }
+#endif
+      decodeFinished_ = true;
+      break;
+    }
+
+    // wait == 0 here means the queue filled up mid-frame
+    decodeSample_ += wait;
+
+    drainQueue();
+  }
+}
+
+#if GENESIS_ENGINE_USE_PROFILING
+void GenesisEngine::profileLateness() {
+  // Oldest write not out yet: the queue head, or the next one the decoder
+  // will produce if the queue has run dry. The consumer may be running on
+  // another core or in the ISR - a stale read only skews one sample.
+  uint32_t due;
+  if (!writeQueue_.peekSample(due)) {
+    if (decodeFinished_) {
+      GENESIS_PROFILE_LATE(0);
+      return;
+    }
+    due = decodeSample_;
+  }
+  int32_t late = (int32_t)(clockSample_ - due);
+  GENESIS_PROFILE_LATE(late > 0 ? (uint32_t)late : 0);
+}
+#endif
+
+void GenesisEngine::checkQueueFinished() {
+  // Finished once the last write is out and its trailing wait has elapsed
+  if (decodeFinished_ && writeQueue_.isEmpty() &&
+      (int32_t)(clockSample_ - decodeSample_) >= 0) {
+#if GENESIS_ENGINE_USE_SD
+    if (handoverFailed_) {
+      stop();
+      return;
+    }
+#endif
+    finishPlayback();
+  }
+}
+
+#if GENESIS_ENGINE_USE_TIMER
+// =============================================================================
+// Timer-Driven Playback
+// =============================================================================
+
+bool GenesisEngine::setTimerDriven(bool enabled) {
+  if (state_ == GenesisEngineState::PLAYING || state_ == GenesisEngineState::PAUSED) {
+    return false;
+  }
+  bool previous = timerDriven_;
+  timerDriven_ = enabled;
+  if (!configureQueue(queueNeeded())) {
+    timerDriven_ = previous;
+    return false;
+  }
+  return true;
+}
+
+void GenesisEngine::startTimer() {
+  if (g_timerEngine && g_timerEngine != this) {
+    return;  // Another engine owns the timer
+  }
+
+  g_timerEngine = this;
+  clockRunning_ = timer_.begin(timerISR, VGM_MICROS_PER_SAMPLE);
+  if (!clockRunning_) {
+    g_timerEngine = nullptr;
+  }
+}
+
+void GenesisEngine::stopTimer() {
+  if (clockRunning_ && timerDriven_) {
+    timer_.end();
+  }
+  if (g_timerEngine == this) {
+    g_timerEngine = nullptr;
+  }
+}
+
+void GenesisEngine::timerISR() {
+  GenesisEngine* engine = g_timerEngine;
+  if (!engine) {
+    return;
   }
+
+  // Writes stamped with sample N go out on tick N
+  uint32_t now = engine->clockSample_;
+  engine->writeQueue_.drain(engine->board_, now, GENESIS_ENGINE_TIMER_WRITES_PER_TICK,
+                            false, engine->secondChip_);
+  engine->clockSample_ = now + 1;
 }
+#endif // GENESIS_ENGINE_USE_TIMER
+
+#if GENESIS_ENGINE_USE_DUAL_CORE
+// =============================================================================
+// Dual-Core Playback
+// =============================================================================
+
+bool GenesisEngine::setDualCore(bool enabled) {
+  if (state_ == GenesisEngineState::PLAYING || state_ == GenesisEngineState::PAUSED) {
+    return false;
+  }
+  bool previous = dualCore_;
+  dualCore_ = enabled;
+  if (!configureQueue(queueNeeded())) {
+    dualCore_ = previous;
+    return false;
+  }
+  return true;
+}
+
+void GenesisEngine::startTasks() {
+  // Continue from the current position (0 at start, paused position on resume)
+  clockBase_ = clockSample_;
+  playbackStartTime_ = micros();
+  clockRunning_ = true;
+
+  tasksRunning_ = true;
+  decodeTaskAlive_ = true;
+  busTaskAlive_ = true;
+
+  if (xTaskCreatePinnedToCore(busTaskMain, "GenesisBus",
+                              GENESIS_ENGINE_BUS_TASK_STACK, this,
+                              GENESIS_ENGINE_BUS_TASK_PRIORITY, &busTask_,
+                              GENESIS_ENGINE_BUS_CORE) != pdPASS) {
+    busTaskAlive_ = false;
+  }
+  if (xTaskCreatePinnedToCore(decodeTaskMain, "GenesisDecode",
+                              GENESIS_ENGINE_DECODE_TASK_STACK, this,
+                              GENESIS_ENGINE_DECODE_TASK_PRIORITY, &decodeTask_,
+                              GENESIS_ENGINE_DECODE_CORE) != pdPASS) {
+    decodeTaskAlive_ = false;
+  }
+
+  if (!busTaskAlive_ || !decodeTaskAlive_) {
+    GENESIS_DEBUG_PRINTLN("Failed to create playback tasks");
+    stopTasks();
+    clockRunning_ = false;
+  }
+}
+
+void GenesisEngine::stopTasks() {
+  // Ask both tasks to exit and wait until they are done with the board,
+  // parser and queue (called from loop(), never from the tasks)
+  tasksRunning_ = false;
+  while (decodeTaskAlive_ || busTaskAlive_) {
+    vTaskDelay(1);
+  }
+  decodeTask_ = nullptr;
+  busTask_ = nullptr;
+}
+
+void GenesisEngine::decodeTaskMain(void* arg) {
+  GenesisEngine* engine = (GenesisEngine*)arg;
+
+  // Producer: refill up to the lookahead, then let the clock catch up
+  while (engine->tasksRunning_) {
+    engine->fillQueue();
+    engine->prefetch();
+    vTaskDelay(1);
+  }
+
+  engine->decodeTaskAlive_ = false;
+  vTaskDelete(nullptr);
+}
+
+void GenesisEngine::busTaskMain(void* arg) {
+  GenesisEngine* engine = (GenesisEngine*)arg;
+
+  // Samples per RTOS tick - gaps longer than two ticks are slept through,
+  // shorter ones are spun so writes stay sample-accurate
+  const int32_t sleepThreshold = (int32_t)((2UL * VGM_SAMPLE_RATE * portTICK_PERIOD_MS) / 1000UL);
+
+  while (engine->tasksRunning_) {
+    engine->updateClock();
+    engine->writeQueue_.drain(engine->board_, engine->clockSample_, 0xFFFF, false,
+                             engine->secondChip_);
+
+    uint32_t next;
+    if (!engine->writeQueue_.peekSample(next) ||
+        (int32_t)(next - engine->clockSample_) > sleepThreshold) {
+      vTaskDelay(1);
+    }
+  }
+
+  engine->busTaskAlive_ = false;
+  vTaskDelete(nullptr);
+}
+#endif // GENESIS_ENGINE_USE_DUAL_CORE
 
 // =============================================================================
 // SD Card Playback
@@ -225,43 +1082,95 @@ bool GenesisEngine::playFile(const char* path) {
   // Stop any current playback
   stop();
 
-  // Check file extension
+  if (!openFile(path)) {
+    return false;
+  }
+
+  beginPlayback();
+  return true;
+}
+
+bool GenesisEngine::enqueue(const char* path) {
+  if (state_ != GenesisEngineState::PLAYING && state_ != GenesisEngineState::PAUSED) {
+    return false;
+  }
+
+  size_t len = strlen(path);
+  if (len >= sizeof(nextPath_)) {
+    GENESIS_DEBUG_PRINTLN("Queued path too long");
+    return false;
+  }
+
+  // The decoder only reads the path while nextQueued_ is set
+  nextQueued_ = false;
+  memcpy(nextPath_, path, len + 1);
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  enqueueCount_++;
+#endif
+  GENESIS_MEMORY_BARRIER();
+  nextQueued_ = true;
+  return true;
+}
+
+static bool isVGZPath(const char* path) {
   size_t len = strlen(path);
-  bool isVGZ = false;
-  if (len >= 4) {
-    const char* ext = path + len - 4;
-    isVGZ = (strcasecmp(ext, ".vgz") == 0);
+  return len >= 4 && strcasecmp(path + len - 4, ".vgz") == 0;
+}
+
+bool GenesisEngine::openFile(const char* path) {
+  bool isVGZ = isVGZPath(path);
+
+  // Close the previous file and drop its PCM data before anything is
+  // allocated for the new one, so an arena is empty again and rewinds
+  VGMSource* previous = parser_.getSource();
+  if (previous) {
+    previous->close();
   }
+  parser_.getPCMDataBank().clear();
 
 #if GENESIS_ENGINE_USE_VGZ
   // Use VGZSource for VGZ files (streaming decompression)
   if (isVGZ) {
-    if (!vgzSource_.openFile(path)) {
+    VGZSource* source = &vgzSources_[0];
+    bool opened = false;
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+    // The queued file may have been opened and inflated already
+    if (nextVGZSource_ && nextVGZCount_ == enqueueCount_ && strcmp(path, nextPath_) == 0) {
+      source = nextVGZSource_;
+      nextVGZSource_ = nullptr;
+      opened = true;
+    } else {
+      closeNextFile();
+    }
+#endif
+
+    if (!opened && !source->openFile(path)) {
       GENESIS_DEBUG_PRINT("Failed to open VGZ: ");
       GENESIS_DEBUG_PRINTLN(path);
       return false;
     }
 
-    if (!vgzSource_.open()) {
+    if (!source->open()) {
       GENESIS_DEBUG_PRINTLN("Failed to prepare VGZ source");
       return false;
     }
 
-    parser_.setSource(&vgzSource_);
-    bool success = startPlayback();
+    parser_.setSource(source);
+    if (!loadHeader(path, source->getFileSize())) {
+      GENESIS_DEBUG_PRINTLN("Failed to parse VGM header");
+      return false;
+    }
 
     // After parsing header, notify VGZSource that we've reached data start
     // This resets currentDataPos_ to 0, so positions are relative to data start
-    if (success) {
-      vgzSource_.setDataStart();
+    source->setDataStart();
 
-      // Set loop offset relative to data start (VGMParser now calculates this)
-      if (parser_.hasLoop()) {
-        vgzSource_.setLoopOffset(parser_.getLoopOffsetInData());
-      }
+    // Set loop offset relative to data start (VGMParser now calculates this)
+    if (parser_.hasLoop()) {
+      source->setLoopOffset(parser_.getLoopOffsetInData());
     }
 
-    return success;
+    return true;
   }
 #else
   // VGZ not supported on this platform
@@ -286,13 +1195,215 @@ bool GenesisEngine::playFile(const char* path) {
   }
 
   parser_.setSource(&sdSource_);
-  bool success = startPlayback();
+  if (!loadHeader(path, sdSource_.size())) {
+    GENESIS_DEBUG_PRINTLN("Failed to parse VGM header");
+    return false;
+  }
 
   // After parsing header, set data start offset so seek positions are relative
-  if (success) {
-    sdSource_.setDataStart(parser_.getDataOffset());
+  sdSource_.setDataStart(parser_.getDataOffset());
+  return true;
+}
+bool GenesisEngine::loadHeader(const char* path, uint32_t fileSize) {
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  infoPending_ = false;
+  if (!infoCache_.isEnabled()) {
+    info_.title[0] = '\0';
+    return parser_.parseHeader();
   }
 
-  return success;
+  strncpy(infoPath_, path, sizeof(infoPath_) - 1);
+  infoPath_[sizeof(infoPath_) - 1] = '\0';
+  infoFileSize_ = fileSize;
+
+  if (infoCache_.lookup(path, fileSize, info_) && parser_.applyHeader(info_)) {
+    infoPending_ = (info_.pcmBlocks == 0);
+    return true;
+  }
+
+  // Not cached yet (or the record didn't fit this hardware) - parse it
+  if (!parser_.parseHeader()) {
+    info_.title[0] = '\0';
+    return false;
+  }
+  parser_.getFileInfo(info_);
+  infoCache_.store(path, fileSize, info_);
+  infoPending_ = (info_.pcmBlocks == 0);
+  return true;
+#else
+  (void)path;
+  (void)fileSize;
+  return parser_.parseHeader();
+#endif
+}
+
+#if GENESIS_ENGINE_USE_INFO_CACHE
+bool GenesisEngine::getFileInfo(const char* path, VGMFileInfo& info) {
+  if (!infoCache_.isEnabled()) {
+    return false;
+  }
+
+  // The directory entry gives the size - the file itself isn't read
+  File file = SD.open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  uint32_t fileSize = file.size();
+  file.close();
+
+  return infoCache_.lookup(path, fileSize, info);
+}
+
+void GenesisEngine::updateInfoCache() {
+  const PCMDataBank& bank = parser_.getPCMDataBank();
+  if (!infoPending_ || bank.getBlockCount() == 0) {
+    return;
+  }
+  infoPending_ = false;
+
+  info_.pcmSize = bank.getOriginalSize();
+  info_.pcmBlocks = bank.getBlockCount();
+  infoCache_.store(infoPath_, infoFileSize_, info_);
 }
+#endif
 #endif // GENESIS_ENGINE_USE_SD
+
+// =============================================================================
+// Gapless Playback
+// =============================================================================
+
+bool GenesisEngine::prefetch() {
+  if (parser_.getSource()->prefetch()) {
+    return true;
+  }
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  return prefetchNextFile();
+#else
+  return false;
+#endif
+}
+
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+bool GenesisEngine::prefetchNextFile() {
+  // Runs where the decoder runs, so the card is only used from one place
+  if (!nextQueued_ || memoryArena_) {
+    // An arena only rewinds once every file is closed
+    closeNextFile();
+    return false;
+  }
+
+  uint8_t count = enqueueCount_;
+  if (nextVGZCount_ == count) {
+    return nextVGZSource_ && nextVGZSource_->prefetch();
+  }
+
+  // Newly queued - open it in the VGZ source the current file isn't using
+  closeNextFile();
+  nextVGZCount_ = count;
+  GENESIS_MEMORY_BARRIER();
+  if (!nextQueued_ || !isVGZPath(nextPath_)) {
+    return false;
+  }
+  VGZSource* next = (parser_.getSource() == &vgzSources_[0]) ? &vgzSources_[1] : &vgzSources_[0];
+  if (!next->openFile(nextPath_)) {
+    return true;
+  }
+  if (!next->isInMemory()) {
+    // Streaming buffers would only be held until startNextTrack()
+    next->close();
+    return true;
+  }
+  nextVGZSource_ = next;
+  return true;
+}
+
+void GenesisEngine::closeNextFile() {
+  if (nextVGZSource_) {
+    nextVGZSource_->close();
+    nextVGZSource_ = nullptr;
+  }
+}
+#endif
+
+bool GenesisEngine::startNextTrack() {
+#if GENESIS_ENGINE_USE_SD
+  if (!nextQueued_) {
+    return false;
+  }
+  nextQueued_ = false;
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  updateInfoCache();
+#endif
+
+  // The previous file is fully decoded, so its source and PCM data can go
+  // (there's no RAM to hold both files). If the next one doesn't open,
+  // what's already queued plays out and then playback stops.
+  if (!openFile(nextPath_)) {
+    GENESIS_DEBUG_PRINTLN("Failed to open queued file");
+    handoverFailed_ = true;
+    return false;
+  }
+
+  // No reset - the previous file's last notes ring into the new one. The
+  // new file enables the DAC itself if it uses it.
+  handoverWrite(REG_WRITE_YM_PORT0, 0x2B, 0x00);
+  if (!parser_.hasSN76489()) {
+    static const uint8_t silence[4] = { 0x9F, 0xBF, 0xDF, 0xFF };
+    for (uint8_t i = 0; i < 4; i++) {
+      handoverWrite(REG_WRITE_PSG, 0, silence[i]);
+    }
+  }
+  if (!parser_.hasYM2612()) {
+    static const uint8_t slots[6] = { 0, 1, 2, 4, 5, 6 };
+    for (uint8_t i = 0; i < 6; i++) {
+      handoverWrite(REG_WRITE_YM_PORT0, 0x28, slots[i]);  // Key off
+    }
+  }
+  if (secondChip_) {
+    // The header doesn't say whether the new file uses the second chip -
+    // silence it, and the file's own writes bring it back
+    static const uint8_t silence[4] = { 0x9F, 0xBF, 0xDF, 0xFF };
+    static const uint8_t slots[6] = { 0, 1, 2, 4, 5, 6 };
+    handoverWrite(REG_WRITE_YM_PORT0 | REG_WRITE_CHIP2, 0x2B, 0x00);
+    for (uint8_t i = 0; i < 4; i++) {
+      handoverWrite(REG_WRITE_PSG | REG_WRITE_CHIP2, 0, silence[i]);
+    }
+    for (uint8_t i = 0; i < 6; i++) {
+      handoverWrite(REG_WRITE_YM_PORT0 | REG_WRITE_CHIP2, 0x28, slots[i]);
+    }
+  }
+
+  if (writeQueue_.isAllocated()) {
+    // Position and track number follow once the clock gets here
+    pendingBase_ = decodeSample_;
+    GENESIS_MEMORY_BARRIER();
+    trackPending_ = true;
+  } else {
+    currentSample_ = 0;
+    trackNumber_++;
+  }
+
+  GENESIS_DEBUG_PRINTLN("Next file queued in");
+  return true;
+#else
+  return false;
+#endif
+}
+
+void GenesisEngine::handoverWrite(uint8_t target, uint8_t reg, uint8_t val) {
+  if (writeQueue_.isAllocated()) {
+    writeQueue_.push(target, reg, val, decodeSample_);
+    return;
+  }
+
+  GenesisBoard* board = &board_;
+  if (target & REG_WRITE_CHIP2) {
+    board = secondChip_;
+    target &= ~REG_WRITE_CHIP2;
+  }
+  if (target == REG_WRITE_PSG) {
+    board->writePSG(val);
+  } else {
+    board->writeYM2612(0, reg, val);
+  }
+}
@@ -6,6 +6,9 @@
 #include "config/feature_config.h"
 #include "GenesisBoard.h"
 #include "VGMParser.h"
+#include "RegisterWriteQueue.h"
+#include "PlaybackProfiler.h"
+#include "MemoryArena.h"
 #include "sources/VGMSource.h"
 #include "sources/ProgmemSource.h"
 #include "sources/ChunkedProgmemSource.h"
@@ -15,6 +18,16 @@
 #if GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
 #include "sources/VGZSource.h"
 #endif
+#if GENESIS_ENGINE_USE_INFO_CACHE
+#include "VGMInfoCache.h"
+#endif
+#if GENESIS_ENGINE_USE_TIMER
+#include <IntervalTimer.h>
+#endif
+#if GENESIS_ENGINE_USE_DUAL_CORE
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 // =============================================================================
 // GenesisEngine - VGM Player for FM-90s Genesis Engine
@@ -55,7 +68,7 @@ public:
   // totalLength: total size across all chunks
   // Returns true if playback started successfully
   bool playChunked(const uint8_t* const* chunks, const uint16_t* chunkSizes,
-                   uint8_t numChunks, uint32_t totalLength);
+                   uint16_t numChunks, uint32_t totalLength);
 
   // Stop playback
   void stop();
@@ -66,6 +79,22 @@ public:
   // Resume from pause
   void resume();
 
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  // Jump to a position (samples at 44100 Hz, counting loops)
+  // Commands up to the position run without touching the bus, then the
+  // chips are reset and loaded with the resulting register image in one
+  // batch. Going back replays from the start of the file. Works while
+  // playing or paused.
+  // Returns false if nothing is loaded or the source can't seek back.
+  // Seeking past the end of a file that doesn't loop finishes playback.
+  bool seekToSample(uint32_t sample);
+#else
+  // Jump to the second at or before a position (GEC files with a seek
+  // table only). Without a register shadow the chips are silenced and
+  // notes come back as they're played again.
+  bool seekToSample(uint32_t sample);
+#endif
+
   // -------------------------------------------------------------------------
   // Update - MUST BE CALLED FREQUENTLY
   // -------------------------------------------------------------------------
@@ -74,6 +103,23 @@ public:
   // Processes VGM commands and maintains timing
   void update();
 
+  // Microseconds until update() next has work: a write falls due, the
+  // decoder can run ahead again, or the source has reading ahead to do
+  // (0 = now). NOTHING_DUE while not playing.
+  static constexpr uint32_t NOTHING_DUE = 0xFFFFFFFF;
+  uint32_t microsUntilDue() const;
+
+  // Rest the CPU until update() next has work or an interrupt fires
+  // (serial or MIDI input, the system tick), whichever comes first: WFI on
+  // Teensy, idle mode on AVR, one RTOS tick on ESP32 (a light sleep when
+  // power management enables automatic light sleep). Waits shorter than
+  // the platform's wake interval are spun out, so writes stay on their
+  // sample. Call at the end of loop() instead of busy-polling update();
+  // while stopped or paused it idles until the next interrupt. With the
+  // timer ISR running every sample the CPU only rests between ticks.
+  // Does nothing on other platforms.
+  void sleepUntilDue();
+
   // -------------------------------------------------------------------------
   // Status
   // -------------------------------------------------------------------------
@@ -95,6 +141,62 @@ public:
   void setLooping(bool loop) { looping_ = loop; }
   bool isLooping() const { return looping_; }
 
+  // Catch-up after update() falls behind (a long SD stall, a slow loop())
+  // Once the next write is more than lateSamples behind the clock, the
+  // backlog is played in one go with its DAC samples dropped and, where the
+  // board has a register shadow, its register writes collapsed to the
+  // values they end up at (sent as one batch, without a chip reset).
+  // Backlog beyond maxSamples is skipped by letting the clock slip, so the
+  // music resumes slightly late instead of racing. Applies to direct and
+  // queued playback (the timer ISR and ESP32 bus task don't fall behind
+  // update()). lateSamples = 0 replays every write (no catch-up), and
+  // maxSamples = 0 never slips.
+  void setCatchUp(uint16_t lateSamples, uint16_t maxSamples = GENESIS_ENGINE_CATCHUP_MAX) {
+    catchUpLate_ = lateSamples;
+    catchUpMax_ = maxSamples;
+  }
+
+  // Enable/disable queued playback
+  // The parser decodes a few frames ahead into a queue of timestamped
+  // writes, and update() drains the queue against the playback clock.
+  // Slow source reads (SD sectors, VGZ inflate) then happen ahead of time
+  // instead of in the middle of a frame. Works on all platforms; queue
+  // size and lookahead are set in feature_config.h.
+  // Can only be changed while stopped. Returns false if the queue could
+  // not be allocated or playback is active.
+  bool setQueuedPlayback(bool enabled);
+  bool isQueuedPlayback() const { return writeQueue_.isAllocated(); }
+
+#if GENESIS_ENGINE_USE_TIMER
+  // Enable/disable timer-driven playback
+  // A hardware timer drains pre-decoded writes at the VGM sample rate, so
+  // chip timing no longer depends on how often loop() calls update().
+  // update() must still be called regularly to decode ahead into the queue.
+  // Only one engine can be timer-driven at a time. The board must not be
+  // written from loop() while playing, and SD cards must not share the
+  // shift register's SPI bus (Teensy 4.1 built-in SD is fine).
+  // Can only be changed while stopped. Returns false if the queue could
+  // not be allocated or playback is active.
+  bool setTimerDriven(bool enabled);
+  bool isTimerDriven() const { return timerDriven_; }
+#endif
+
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  // Enable/disable dual-core playback (ESP32)
+  // A decode task on GENESIS_ENGINE_DECODE_CORE reads the source and fills
+  // the write queue, while a higher-priority bus task on
+  // GENESIS_ENGINE_BUS_CORE drains it against the playback clock. SD/VGZ
+  // stalls then never delay chip writes, and update() only tracks position
+  // and end of playback.
+  // While playing, neither the board nor the SD card may be used from
+  // loop(). loop() shares the bus core and only runs while the bus task
+  // is idle, so keep it light during dense DAC passages.
+  // Can only be changed while stopped. Returns false if the queue could
+  // not be allocated or playback is active.
+  bool setDualCore(bool enabled);
+  bool isDualCore() const { return dualCore_; }
+#endif
+
   // -------------------------------------------------------------------------
   // Information
   // -------------------------------------------------------------------------
@@ -127,6 +229,26 @@ public:
   // Get number of times the file has looped (0 = first play through)
   uint16_t getLoopCount() const { return parser_.getLoopCount(); }
 
+  // Get number of enqueue()d files started since the last play call
+  // (0 = still the first one). Position and loop count restart with each.
+  uint16_t getTrackNumber() const { return trackNumber_; }
+
+#if GENESIS_ENGINE_USE_PROFILING
+  // -------------------------------------------------------------------------
+  // Profiling (build with GENESIS_ENGINE_PROFILE defined)
+  // -------------------------------------------------------------------------
+
+  // Section timers and write counters since the last reset (shared by all
+  // engines). Lateness is measured against the playback clock the way each
+  // mode sees it.
+  const PlaybackProfile& getProfile() const { return PlaybackProfiler::data(); }
+  void resetProfile() { PlaybackProfiler::reset(); }
+
+  // Print them as a table, e.g. printProfile(Serial) - takes a few ms, so
+  // call it between tracks or expect one late update()
+  void printProfile(Print& out) const { PlaybackProfiler::print(out); }
+#endif
+
 #if GENESIS_ENGINE_USE_SD
   // -------------------------------------------------------------------------
   // SD Card Playback (if available)
@@ -134,10 +256,101 @@ public:
 
   // Play VGM file from SD card
   bool playFile(const char* path);
+
+  // Queue a file to follow the current one without a gap
+  // When the current file ends (looping off, or no loop point), the next
+  // one is opened, its header parsed and its PCM data loaded while the
+  // chips keep playing. It starts at the end sample of the current file
+  // without a chip reset - only the DAC, and the PSG or FM channels if the
+  // new file doesn't use them, are silenced at the boundary.
+  // In queued, timer-driven and dual-core modes this happens a lookahead
+  // ahead of the end while the tail plays out, so file info (duration,
+  // chips, loop) switches to the new file slightly before it is heard.
+  // Replaces any file already queued. Returns false if nothing is playing
+  // or the path is longer than GENESIS_ENGINE_ENQUEUE_PATH_MAX - 1.
+  bool enqueue(const char* path);
+
+  // Check for / drop a file waiting to follow the current one
+  bool hasEnqueued() const { return nextQueued_; }
+  void clearEnqueued() { nextQueued_ = false; }
+
+  // True if playback stopped because the enqueue()d file failed to open
+  // at the handover (the current file had already ended). Cleared by the
+  // next play call.
+  bool enqueueFailed() const { return handoverFailed_; }
+
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  // Keep the parsed headers of played files in a cache file on the card
+  // (GENESIS_ENGINE_INFO_CACHE_PATH). Cached files start without header
+  // parsing and with their PCM data bank sized up front, and
+  // getFileInfo() can list them without parsing. Records are added as
+  // files are first played. Off by default.
+  void setInfoCache(bool enabled) {
+    infoCache_.setPath(enabled ? GENESIS_ENGINE_INFO_CACHE_PATH : nullptr);
+  }
+
+  // Cached header fields and GD3 title of a file
+  // Returns false if the file isn't in the cache (or it is off)
+  bool getFileInfo(const char* path, VGMFileInfo& info);
+
+  // Delete the cache file
+  void clearInfoCache() { infoCache_.clear(); }
+
+  // GD3 title of the current file ("" if unknown)
+  const char* getTitle() const { return info_.title; }
+#endif
+
+#if GENESIS_ENGINE_USE_VGZ
+  // Save VGZ decompressor checkpoints every intervalKB of output so VGZ
+  // files can seek anywhere (0 = off). sidecar keeps them in an index file
+  // next to the VGZ instead of RAM. Applies from the next playFile().
+  void setVGZCheckpoints(uint16_t intervalKB, bool sidecar = false) {
+    for (VGZSource& source : vgzSources_) {
+      source.setCheckpoints(intervalKB, sidecar);
+    }
+  }
+#endif
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  // Inflate VGZ files whole into PSRAM ahead of the playhead (on by
+  // default, Teensy 4.1 with PSRAM). An enqueue()d VGZ file is opened and
+  // inflated while the current one plays, unless a memory arena is set.
+  // Applies from the next playFile().
+  void setVGZPrefetch(bool enabled) {
+    for (VGZSource& source : vgzSources_) {
+      source.setPrefetch(enabled);
+    }
+  }
+#endif
 #endif
 
+  // Take per-track buffers (PCM data bank, SD read buffer, VGZ
+  // decompressor and checkpoints) from an arena instead of the heap, so
+  // playback doesn't fragment it. The arena is rewound at every file
+  // change. Only while stopped; closes the current file. nullptr = heap.
+  bool setMemoryArena(MemoryArena* arena);
+  MemoryArena* getMemoryArena() const { return memoryArena_; }
+
+  // -------------------------------------------------------------------------
+  // Second Chip
+  // -------------------------------------------------------------------------
+
+  // Play the second YM2612 and SN76489 of dual-chip VGM files (commands
+  // 0xA2/0xA3 and 0x30) on another board, begin()'d by the caller. It needs
+  // its own WR, IC and address pins but may share SCK/SDI (or D0-D7) with
+  // the first board. Each board only waits out its own chips' busy time,
+  // so writes to one go out while the other is busy. Both boards are
+  // muted, reset and seeked together; the second chip is silenced at
+  // enqueue()d file boundaries. Without one, second chip writes are
+  // dropped. Mirrored boards (same music on every board) need no second
+  // engine or board object - see GenesisBoard::addMirror().
+  // Only while stopped. nullptr detaches.
+  bool setSecondChip(GenesisBoard* board);
+  GenesisBoard* getSecondChip() const { return secondChip_; }
+
 private:
   GenesisBoard& board_;
+  GenesisBoard* secondChip_;       // Dual-chip files (nullptr = none)
+  MemoryArena* memoryArena_;
   VGMParser parser_;
 
   // Sources
@@ -147,12 +360,42 @@ private:
   SDSource sdSource_;
 #endif
 #if GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
-  VGZSource vgzSource_;
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  VGZSource vgzSources_[2];        // The current file and the queued one
+#else
+  VGZSource vgzSources_[1];
+#endif
+#endif
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  VGMInfoCache infoCache_;
+  VGMFileInfo info_;               // Header of the current file
+  char infoPath_[GENESIS_ENGINE_ENQUEUE_PATH_MAX];  // Its path and size
+  uint32_t infoFileSize_;
+  bool infoPending_;               // Its record still lacks the PCM sizes
 #endif
 
   // State
   GenesisEngineState state_;
   bool looping_;
+  uint16_t trackNumber_;           // enqueue()d files started so far
+
+  // Catch-up policy (see setCatchUp)
+  uint16_t catchUpLate_;
+  uint16_t catchUpMax_;
+  bool catchingUp_;                // DAC skipped, writes held in the shadow
+  bool readingAhead_;              // The last prefetch() had work
+
+#if GENESIS_ENGINE_USE_SD
+  // Next file for gapless playback
+  char nextPath_[GENESIS_ENGINE_ENQUEUE_PATH_MAX];
+  volatile bool nextQueued_;
+  volatile bool handoverFailed_;   // The queued file didn't open - stop() once played out
+#endif
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  volatile uint8_t enqueueCount_;  // enqueue() calls so far
+  uint8_t nextVGZCount_;           // enqueueCount_ the next file was looked at for
+  VGZSource* nextVGZSource_;       // The queued file, already inflating (nullptr = none)
+#endif
 
   // Timing - using fixed-point for AVR compatibility
   // VGM runs at 44100 Hz = 22.675736961 microseconds per sample
@@ -163,6 +406,44 @@ private:
   uint32_t playbackStartTime_;  // micros() when playback started
   uint32_t samplesPlayed_;      // total samples worth of time elapsed
 
+  // Queued playback - parser decodes ahead into writeQueue_, which is
+  // drained against the playback clock
+  RegisterWriteQueue writeQueue_;
+  volatile uint32_t clockSample_;  // Playback clock (samples since start)
+  uint32_t clockBase_;             // clockSample_ at playbackStartTime_
+  volatile uint32_t decodeSample_; // Sample time of the next decoded write
+  volatile bool decodeFinished_;   // Parser reached the end (no loop)
+  bool clockRunning_;              // Playback clock advancing
+  bool queuedPlayback_;            // setQueuedPlayback() requested
+  uint32_t trackBase_;             // clockSample_ where the current file began
+  volatile uint32_t pendingBase_;  // clockSample_ where the next file begins
+  volatile bool trackPending_;     // Next file decoded, clock not there yet
+
+#if GENESIS_ENGINE_USE_TIMER
+  IntervalTimer timer_;
+  bool timerDriven_;
+
+  // Timer ISR - advances clockSample_ and drains due writes
+  static void timerISR();
+  void startTimer();
+  void stopTimer();
+#endif
+
+#if GENESIS_ENGINE_USE_DUAL_CORE
+  bool dualCore_;
+  TaskHandle_t decodeTask_;
+  TaskHandle_t busTask_;
+  volatile bool tasksRunning_;     // Cleared to ask both tasks to exit
+  volatile bool decodeTaskAlive_;  // Cleared by each task as it exits
+  volatile bool busTaskAlive_;
+
+  // FreeRTOS task bodies (arg is the engine)
+  static void decodeTaskMain(void* arg);
+  static void busTaskMain(void* arg);
+  void startTasks();
+  void stopTasks();
+#endif
+
   // Note: PCM data for DAC playback is handled dynamically by PCMDataBank
   // inside VGMParser. It allocates memory as needed (PSRAM if available,
   // otherwise RAM) and automatically downsamples if memory is limited.
@@ -174,8 +455,94 @@ private:
   // Start playback from current source
   bool startPlayback();
 
+  // Reset timing and state for a source whose header has been parsed
+  void beginPlayback();
+
+  // Board calls made on the second chip's board too
+  void muteBoards();
+  void resetBoards();
+#if GENESIS_ENGINE_USE_REGISTER_SHADOW
+  void holdBoards(bool fromReset);
+  void releaseBoards();
+  void flushBoards();
+#endif
+
+#if GENESIS_ENGINE_USE_SD
+  // Open a file on the SD card as the parser's source and parse its header
+  bool openFile(const char* path);
+
+  // Parse the header of the file just opened, or take it from the cache
+  bool loadHeader(const char* path, uint32_t fileSize);
+#endif
+
+#if GENESIS_ENGINE_USE_INFO_CACHE
+  // Add the PCM sizes to the current file's record once its blocks have
+  // loaded (VGZ files can't be scanned ahead)
+  void updateInfoCache();
+#endif
+
+  // Background work between commands: the current source reads ahead, or
+  // (once it has nothing left to do) the queued VGZ file is inflated
+  // Returns true if there was any work
+  bool prefetch();
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH
+  bool prefetchNextFile();
+  void closeNextFile();
+#endif
+
+  // Continue with the enqueue()d file once the current one has ended
+  // Returns false if none is queued or it could not be opened
+  bool startNextTrack();
+
+  // Chip write at the boundary between two files (queued at decodeSample_
+  // in queued modes)
+  void handoverWrite(uint8_t target, uint8_t reg, uint8_t val);
+
+  // Follow the playback clock into the next file (queued modes)
+  void updatePosition();
+
   // Process pending samples
   void processCommands();
+
+  // Start a catch-up for a backlog of samples
+  // Returns the samples the clock should slip past
+  uint32_t beginCatchUp(uint32_t backlog);
+
+  // Send the collapsed writes and resume DAC output
+  void endCatchUp();
+
+  // Whether any queued mode is enabled
+  bool queueNeeded() const;
+
+  // Allocate/free writeQueue_ and attach it to the parser
+  bool configureQueue(bool needed);
+
+  // update() for queued, timer-driven and dual-core modes
+  void updateQueued();
+
+  // Decode ahead into writeQueue_ up to the lookahead horizon
+  void fillQueue();
+
+  // Perform queued writes that are due (update()-driven modes only)
+  void drainQueue();
+
+  // Playback clock for queued modes
+  void updateClock();
+  void startClock();
+  void stopClock();
+
+  // Check whether queued playback has played out its last write
+  void checkQueueFinished();
+
+  // Record how far the oldest write not yet out is behind the clock
+#if GENESIS_ENGINE_USE_PROFILING
+  void profileLateness();
+#else
+  void profileLateness() {}
+#endif
+
+  // End of file reached (not looping)
+  void finishPlayback();
 };
 
 #endif // GENESIS_ENGINE_H
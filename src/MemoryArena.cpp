@@ -0,0 +1,74 @@
+#include "MemoryArena.h"
+
+MemoryArena::MemoryArena()
+  : base_(nullptr)
+  , size_(0)
+  , used_(0)
+  , newest_(0)
+  , blocks_(0)
+  , peak_(0)
+  , failed_(0)
+  , psram_(false)
+{
+}
+
+void MemoryArena::begin(void* buffer, uint32_t size, bool psram) {
+  // Start on an aligned address
+  uint8_t* base = (uint8_t*)buffer;
+  if (base) {
+    uint32_t skip = (ALIGN - ((uintptr_t)base & (ALIGN - 1))) & (ALIGN - 1);
+    if (size > skip) {
+      base += skip;
+      size -= skip;
+    } else {
+      base = nullptr;
+    }
+  }
+
+  base_ = base;
+  size_ = base ? size : 0;
+  psram_ = base ? psram : false;
+  peak_ = 0;
+  failed_ = 0;
+  reset();
+}
+
+uint8_t* MemoryArena::allocate(uint32_t size) {
+  if (!base_ || size == 0) {
+    return nullptr;
+  }
+
+  uint32_t start = (used_ + ALIGN - 1) & ~(ALIGN - 1);
+  if (start > size_ || size > size_ - start) {
+    failed_++;
+    return nullptr;
+  }
+
+  newest_ = start;
+  used_ = start + size;
+  blocks_++;
+  if (used_ > peak_) {
+    peak_ = used_;
+  }
+  return base_ + start;
+}
+
+void MemoryArena::release(void* ptr) {
+  if (!owns(ptr) || blocks_ == 0) {
+    return;
+  }
+
+  if (--blocks_ == 0) {
+    reset();
+  } else if ((uint8_t*)ptr == base_ + newest_) {
+    // The block before it may be anywhere below, so only this one's space
+    // comes back
+    used_ = newest_;
+  }
+}
+
+void MemoryArena::reset() {
+  used_ = 0;
+  newest_ = 0;
+  blocks_ = 0;
+}
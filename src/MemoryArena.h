@@ -0,0 +1,78 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <Arduino.h>
+
+// =============================================================================
+// MemoryArena - One block of memory for the buffers of the file playing
+//
+// The sketch hands GenesisEngine a buffer it owns (a static array, or PSRAM
+// from extmem_malloc()/ps_malloc()) with setMemoryArena(). The SD and VGZ
+// sources and the PCM data bank then carve their buffers from it instead of
+// the heap, so a long playlist can't fragment the heap and later files get
+// the same memory as the first.
+//
+// Bump allocation: blocks are handed out in order, aligned to 8 bytes.
+// release() gives the space back only for the newest block; once every
+// block is released (each track change) the arena starts over from empty.
+// A full arena returns nullptr - nothing falls back to the heap.
+// =============================================================================
+
+class MemoryArena {
+public:
+  MemoryArena();
+
+  // Use a buffer of size bytes (nullptr = off). psram: the buffer is in
+  // PSRAM (reported by the users of the arena)
+  void begin(void* buffer, uint32_t size, bool psram = false);
+
+  // Stop using the buffer (only once nothing holds a block)
+  void end() { begin(nullptr, 0); }
+
+  bool isEnabled() const { return base_ != nullptr; }
+  bool isPSRAM() const { return psram_; }
+
+  // Carve a block, or nullptr if it doesn't fit
+  uint8_t* allocate(uint32_t size);
+
+  // Give a block back (space before the newest block is reused once all
+  // blocks have been released)
+  void release(void* ptr);
+
+  // Whether ptr is a block of this arena
+  bool owns(const void* ptr) const {
+    return base_ && (const uint8_t*)ptr >= base_ && (const uint8_t*)ptr < base_ + size_;
+  }
+
+  // Drop every block (only call when nothing uses them)
+  void reset();
+
+  // -------------------------------------------------------------------------
+  // Usage
+  // -------------------------------------------------------------------------
+
+  uint32_t getSize() const { return size_; }
+  uint32_t getUsed() const { return used_; }
+  uint32_t getFree() const { return size_ - used_; }
+  uint16_t getBlockCount() const { return blocks_; }
+
+  // Most bytes in use at once since begin()
+  uint32_t getPeak() const { return peak_; }
+
+  // Allocations that didn't fit since begin()
+  uint32_t getFailedAllocations() const { return failed_; }
+
+private:
+  static const uint32_t ALIGN = 8;
+
+  uint8_t* base_;
+  uint32_t size_;
+  uint32_t used_;     // Bytes handed out (end of the newest block)
+  uint32_t newest_;   // Offset of the newest block
+  uint16_t blocks_;   // Blocks not released yet
+  uint32_t peak_;
+  uint32_t failed_;
+  bool psram_;
+};
+
+#endif // MEMORY_ARENA_H
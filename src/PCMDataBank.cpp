@@ -1,5 +1,7 @@
 #include "PCMDataBank.h"
 #include "config/feature_config.h"
+#include "PlaybackProfiler.h"
+#include "MemoryArena.h"
 
 // =============================================================================
 // Free Memory Detection (cross-platform)
@@ -28,7 +30,10 @@ extern "C" void extmem_free(void* ptr);
 #endif
 
 int PCMDataBank::getFreeMemory() {
-#if defined(PLATFORM_ESP32)
+#if defined(PLATFORM_NATIVE)
+  // Host build - the RAM of a large board
+  return PLATFORM_RAM_KB * 1024;
+#elif defined(PLATFORM_ESP32)
   return heap_caps_get_free_size(MALLOC_CAP_8BIT);
 #elif defined(__arm__)
   char top;
@@ -51,15 +56,24 @@ int PCMDataBank::getFreeMemory() {
 // =============================================================================
 
 PCMDataBank::PCMDataBank()
-  : dataBank_(nullptr)
-  , allocatedSize_(0)
-  , dataSize_(0)
-  , originalSize_(0)
+  : memoryArena_(nullptr)
+  , arena_(nullptr)
+  , blocks_(nullptr)
+  , blockCount_(0)
+  , blockCapacity_(0)
+  , data_(nullptr)
+  , dataCapacity_(0)
+  , dataUsed_(0)
+  , bankSize_(0)
   , position_(0)
-  , downsampleRatio_(1)
-  , readCount_(0)
+  , current_(0)
+  , sourceEnd_(0)
+  , downsampleShift_(0)
   , usingPSRAM_(false)
   , dacDisabled_(false)
+  , streamSource_(nullptr)
+  , cacheStart_(0)
+  , cacheLength_(0)
 {
 }
 
@@ -74,6 +88,12 @@ PCMDataBank::~PCMDataBank() {
 uint8_t* PCMDataBank::tryAllocate(uint32_t size, bool& isPSRAM) {
   isPSRAM = false;
 
+  // The sketch sized the arena - no heap fallback
+  if (memoryArena_) {
+    isPSRAM = memoryArena_->isPSRAM();
+    return memoryArena_->allocate(size);
+  }
+
   // Try PSRAM first (Teensy 4.1 with PSRAM chip)
 #if defined(PCM_USE_PSRAM)
   // extmem_malloc returns nullptr if no PSRAM installed
@@ -120,99 +140,125 @@ uint8_t* PCMDataBank::tryAllocate(uint32_t size, bool& isPSRAM) {
 #endif
 }
 
-// =============================================================================
-// Data Loading
-// =============================================================================
-
-bool PCMDataBank::loadDataBlock(uint32_t originalSize,
-                                 int (*readFunc)(void* context),
-                                 void* context) {
-  // Skip empty data blocks (some VGM files have these)
-  if (originalSize == 0) {
-    return true;
+bool PCMDataBank::allocateArena(uint16_t blockCapacity, uint32_t dataCapacity) {
+  // Index first - Block entries are 4-byte aligned, so the data after is too
+  uint32_t indexBytes = (uint32_t)blockCapacity * sizeof(Block);
+  bool isPSRAM = false;
+  uint8_t* arena = tryAllocate(indexBytes + dataCapacity, isPSRAM);
+  if (!arena) {
+    return false;
   }
+  GENESIS_PROFILE_ALLOC(indexBytes + dataCapacity);
 
-  // Store original size
-  originalSize_ = originalSize;
+  Block* blocks = reinterpret_cast<Block*>(arena);
+  uint8_t* data = arena + indexBytes;
 
-  // If we already have a buffer and data, skip (only load first data block)
-  if (dataBank_ && dataSize_ > 0) {
-    // Skip this block - just read and discard
-    for (uint32_t i = 0; i < originalSize; i++) {
-      readFunc(context);
+  // Growing - move the index and stored samples (the stream cache refills)
+  if (arena_) {
+    memcpy(blocks, blocks_, blockCount_ * sizeof(Block));
+    if (!streamSource_) {
+      memcpy(data, data_, dataUsed_);
     }
-    Serial.println("PCM: Skipping additional data block (already have data)");
-    return true;
+    freeArena();
   }
 
-  // Try allocation sizes: full, half (2x downsample), quarter (4x downsample)
-  uint32_t trySizes[] = { originalSize, originalSize / 2, originalSize / 4 };
-  uint8_t ratios[] = { 1, 2, 4 };
+  arena_ = arena;
+  usingPSRAM_ = isPSRAM;
+  blocks_ = blocks;
+  blockCapacity_ = blockCapacity;
+  data_ = data;
+  dataCapacity_ = dataCapacity;
+  cacheLength_ = 0;
+  return true;
+}
 
-  for (int attempt = 0; attempt < 3; attempt++) {
-    uint32_t trySize = trySizes[attempt];
-    if (trySize == 0) continue;
+void PCMDataBank::freeArena() {
+  if (!arena_) {
+    return;
+  }
+  if (memoryArena_ && memoryArena_->owns(arena_)) {
+    memoryArena_->release(arena_);
+  } else {
+#if defined(PCM_USE_PSRAM)
+    if (usingPSRAM_) {
+      extmem_free(arena_);
+    } else {
+      delete[] arena_;
+    }
+#elif defined(ARDUINO_ARCH_AVR)
+    free(arena_);
+#else
+    delete[] arena_;
+#endif
+  }
+  arena_ = nullptr;
+  blocks_ = nullptr;
+  data_ = nullptr;
+}
 
-    bool isPSRAM = false;
-    uint8_t* buffer = tryAllocate(trySize, isPSRAM);
+// =============================================================================
+// Data Loading
+// =============================================================================
 
-    if (buffer) {
-      dataBank_ = buffer;
-      allocatedSize_ = trySize;
-      usingPSRAM_ = isPSRAM;
-      downsampleRatio_ = ratios[attempt];
-      dacDisabled_ = false;  // Clear in case a previous empty block set it
+bool PCMDataBank::reserve(VGMSource& source, uint32_t totalSize,
+                          uint16_t blockCount) {
+  if (arena_ || totalSize == 0 || blockCount == 0) {
+    return true;
+  }
 
-      // Read and possibly downsample the data
-      uint32_t stored = 0;
-      for (uint32_t i = 0; i < originalSize; i++) {
-        int byte = readFunc(context);
-        if (byte < 0) break;
+  // Full quality in memory
+  downsampleShift_ = 0;
+  if (allocateArena(blockCount, totalSize)) {
+    Serial.print("PCM: Reserved ");
+    Serial.print(totalSize);
+    Serial.print(" bytes for ");
+    Serial.print(blockCount);
+    Serial.print(" data block(s) in ");
+    Serial.println(usingPSRAM_ ? "PSRAM" : "RAM");
+    return true;
+  }
 
-        // Only store every Nth sample based on ratio
-        if ((i % downsampleRatio_) == 0 && stored < allocatedSize_) {
-          dataBank_[stored++] = (uint8_t)byte;
-        }
-      }
+  // Doesn't fit at full quality - stream it if the source allows
+  uint8_t probe;
+  if (source.readAt(source.position(), &probe, 1) == 1 &&
+      allocateArena(blockCount, GENESIS_ENGINE_PCM_CACHE_SIZE)) {
+    streamSource_ = &source;
+    Serial.print("PCM: Streaming ");
+    Serial.print(totalSize);
+    Serial.print(" bytes from source (");
+    Serial.print(dataCapacity_);
+    Serial.println(" byte cache)");
+    return true;
+  }
 
-      dataSize_ = stored;
-      position_ = 0;
-
-      // Print status
-      Serial.print("PCM: Loaded ");
-      Serial.print(dataSize_);
-      Serial.print(" bytes");
-      if (downsampleRatio_ > 1) {
-        Serial.print(" (downsampled ");
-        Serial.print(downsampleRatio_);
-        Serial.print("x from ");
-        Serial.print(originalSize);
-        Serial.print(")");
-      }
-      Serial.print(" into ");
+  // Try half (2x downsample), then quarter (4x downsample)
+  // Rounding up each block adds at most one byte per block
+  for (uint8_t shift = 1; shift <= 2; shift++) {
+    downsampleShift_ = shift;
+    if (allocateArena(blockCount, (totalSize >> shift) + blockCount)) {
+      Serial.print("PCM: Reserved ");
+      Serial.print(dataCapacity_);
+      Serial.print(" bytes (downsampled ");
+      Serial.print(1 << shift);
+      Serial.print("x from ");
+      Serial.print(totalSize);
+      Serial.print(") in ");
       Serial.println(usingPSRAM_ ? "PSRAM" : "RAM");
 
-      if (downsampleRatio_ > 1) {
-        Serial.println("PCM: TIP - For better quality, use vgm_prep.py:");
-        Serial.print("PCM:   python vgm_prep.py song.vgz --dac-rate ");
-        Serial.print(downsampleRatio_);
-        Serial.println(" -o song.vgm");
-      }
-
+      Serial.println("PCM: TIP - For better quality, use vgm_prep.py:");
+      Serial.print("PCM:   python vgm_prep.py song.vgz --dac-rate ");
+      Serial.print(1 << shift);
+      Serial.println(" -o song.vgm");
       return true;
     }
   }
 
   // All allocation attempts failed
+  downsampleShift_ = 0;
   dacDisabled_ = true;
 
-  // Still need to read and discard the data
-  for (uint32_t i = 0; i < originalSize; i++) {
-    readFunc(context);
-  }
-
   Serial.print("PCM: WARNING - Could not allocate memory for ");
-  Serial.print(originalSize);
+  Serial.print(totalSize);
   Serial.println(" bytes of DAC data");
   Serial.print("PCM: Free RAM: ");
   Serial.print(getFreeMemory());
@@ -224,70 +270,233 @@ bool PCMDataBank::loadDataBlock(uint32_t originalSize,
   return false;
 }
 
-void PCMDataBank::clear() {
-  if (dataBank_) {
-#if defined(PCM_USE_PSRAM)
-    if (usingPSRAM_) {
-      extmem_free(dataBank_);
+bool PCMDataBank::loadDataBlock(VGMSource& source, uint32_t size) {
+  // Skip empty data blocks (some VGM files have these)
+  if (size == 0) {
+    return true;
+  }
+  GENESIS_PROFILE_SCOPE(PCM_LOAD);
+
+  // Replayed after looping back before the data blocks - already loaded
+  uint32_t sourcePos = source.position();
+  if (blockCount_ > 0 && source.canSeek() && sourcePos < sourceEnd_) {
+    skipData(source, size);
+    return true;
+  }
+
+  if (dacDisabled_ || (!arena_ && !reserve(source, size, 1))) {
+    skipData(source, size);
+    return false;
+  }
+
+  // Grow the arena for blocks the pre-scan didn't see
+  uint32_t needed = streamSource_ ? 0 : storedSize(size);
+  if (blockCount_ == blockCapacity_ || dataUsed_ + needed > dataCapacity_) {
+    uint16_t capacity = blockCapacity_;
+    if (blockCount_ == capacity) {
+      capacity += 4;
+    }
+    uint32_t dataCapacity = streamSource_ ? dataCapacity_ : dataUsed_ + needed;
+    if (!allocateArena(capacity, dataCapacity)) {
+      // Keep the bank offsets of the blocks after this one right
+      bankSize_ += size;
+      skipData(source, size);
+      Serial.print("PCM: WARNING - No memory for data block of ");
+      Serial.print(size);
+      Serial.println(" bytes, skipped");
+      return false;
+    }
+  }
+
+  Block& block = blocks_[blockCount_++];
+  block.start = bankSize_;
+  block.length = size;
+  bankSize_ += size;
+
+  if (streamSource_) {
+    // Only the offset is needed - samples are read back through the cache
+    block.location = sourcePos;
+    skipData(source, size);
+  } else {
+    block.location = dataUsed_;
+    uint8_t* dest = data_ + dataUsed_;
+    uint32_t stored = storedSize(size);
+    uint32_t got = 0;
+
+    if (downsampleShift_ == 0) {
+      got = source.read(dest, size);
     } else {
-      delete[] dataBank_;
+      // Only store every Nth sample based on ratio
+      uint32_t mask = (1UL << downsampleShift_) - 1;
+      for (uint32_t i = 0; i < size; i++) {
+        int byte = source.read();
+        if (byte < 0) break;
+        if ((i & mask) == 0) {
+          dest[got++] = (uint8_t)byte;
+        }
+      }
     }
-#else
-    delete[] dataBank_;
-#endif
-    dataBank_ = nullptr;
+
+    // Truncated file - pad with silence so offsets stay valid
+    if (got < stored) {
+      memset(dest + got, 0x80, stored - got);
+    }
+    dataUsed_ += stored;
   }
+  sourceEnd_ = source.position();
+  current_ = findBlock(position_);
+
+  Serial.print("PCM: Loaded data block ");
+  Serial.print(blockCount_);
+  Serial.print(" (");
+  Serial.print(size);
+  Serial.println(" bytes)");
+  return true;
+}
+
+void PCMDataBank::skipData(VGMSource& source, uint32_t size) {
+  // Seeking is only cheap on random-access sources
+  if (streamSource_ == &source) {
+    source.skip(size);
+    return;
+  }
+  for (uint32_t i = 0; i < size; i++) {
+    source.read();
+  }
+}
+
+void PCMDataBank::clear() {
+  freeArena();
 
-  allocatedSize_ = 0;
-  dataSize_ = 0;
-  originalSize_ = 0;
+  blockCount_ = 0;
+  blockCapacity_ = 0;
+  dataCapacity_ = 0;
+  dataUsed_ = 0;
+  bankSize_ = 0;
   position_ = 0;
-  downsampleRatio_ = 1;
-  readCount_ = 0;
+  current_ = 0;
+  sourceEnd_ = 0;
+  downsampleShift_ = 0;
   usingPSRAM_ = false;
   dacDisabled_ = false;
+  streamSource_ = nullptr;
+  cacheStart_ = 0;
+  cacheLength_ = 0;
 }
 
 // =============================================================================
 // Data Access
 // =============================================================================
 
+uint16_t PCMDataBank::findBlock(uint32_t position) const {
+  // Sequential playback runs straight into the next block
+  uint16_t next = current_ + 1;
+  if (next < blockCount_ && position >= blocks_[next].start &&
+      position - blocks_[next].start < blocks_[next].length) {
+    return next;
+  }
+
+  // Binary search for the last block starting at or before position
+  uint16_t lo = 0;
+  uint16_t hi = blockCount_;
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    if (blocks_[mid].start <= position) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0 || position - blocks_[lo - 1].start >= blocks_[lo - 1].length) {
+    return blockCount_;  // Before the first block or in a skipped one
+  }
+  return lo - 1;
+}
+
+bool PCMDataBank::fillCache(uint32_t position) {
+  const Block& block = blocks_[current_];
+  uint32_t offset = position - block.start;
+  uint32_t length = block.length - offset;
+  if (length > dataCapacity_) {
+    length = dataCapacity_;
+  }
+  cacheStart_ = position;
+  cacheLength_ = streamSource_->readAt(block.location + offset, data_, length);
+  return cacheLength_ > 0;
+}
+
+uint8_t PCMDataBank::sampleAt(uint32_t position) {
+  // Moved out of the current block (playback or seek)
+  if (current_ >= blockCount_ ||
+      position - blocks_[current_].start >= blocks_[current_].length) {
+    current_ = findBlock(position);
+    if (current_ >= blockCount_) {
+      return 0x80;
+    }
+  }
+
+  if (streamSource_) {
+    // Serve from the window, refilling it when we run off the end
+    if (position - cacheStart_ >= cacheLength_ && !fillCache(position)) {
+      return 0x80;
+    }
+    return data_[position - cacheStart_];
+  }
+
+  // When downsampled, consecutive positions share a stored sample
+  const Block& block = blocks_[current_];
+  return data_[block.location + ((position - block.start) >> downsampleShift_)];
+}
+
 uint8_t PCMDataBank::readByte() {
-  if (!dataBank_ || position_ >= dataSize_) {
+  if (position_ >= bankSize_) {
     return 0x80;  // Silence (center value for unsigned 8-bit audio)
   }
+  return sampleAt(position_++);
+}
 
-  // When downsampled, we need to return the same sample multiple times
-  // to maintain correct timing. readCount_ tracks how many times we've
-  // returned the current sample.
-  uint8_t sample = dataBank_[position_];
-
-  readCount_++;
-  if (readCount_ >= downsampleRatio_) {
-    readCount_ = 0;
-    position_++;
+const uint8_t* PCMDataBank::contiguousSamples(uint32_t& length) {
+  length = 0;
+  if (streamSource_ || downsampleShift_ > 0 || position_ >= bankSize_) {
+    return nullptr;
+  }
+  if (current_ >= blockCount_ ||
+      position_ - blocks_[current_].start >= blocks_[current_].length) {
+    current_ = findBlock(position_);
+    if (current_ >= blockCount_) {
+      return nullptr;
+    }
   }
 
-  return sample;
+  const Block& block = blocks_[current_];
+  uint32_t offset = position_ - block.start;
+  length = block.length - offset;
+  return data_ + block.location + offset;
 }
 
-void PCMDataBank::seek(uint32_t position) {
-  // Convert from original position to stored position
-  uint32_t storedPos = position / downsampleRatio_;
+uint8_t PCMDataBank::readByteAt(uint32_t position) {
+  if (position >= bankSize_) {
+    return 0x80;
+  }
+  return sampleAt(position);
+}
 
-  if (storedPos < dataSize_) {
-    position_ = storedPos;
-  } else {
-    position_ = dataSize_;
+bool PCMDataBank::getBlock(uint16_t index, uint32_t& start, uint32_t& length) const {
+  if (index >= blockCount_) {
+    return false;
   }
+  start = blocks_[index].start;
+  length = blocks_[index].length;
+  return true;
+}
 
-  // Reset read counter - start fresh at new position
-  readCount_ = 0;
+void PCMDataBank::seek(uint32_t position) {
+  // Block lookup happens on the next read
+  position_ = position < bankSize_ ? position : bankSize_;
 }
 
 uint32_t PCMDataBank::getPosition() const {
-  // Convert from stored position back to original position
-  return position_ * downsampleRatio_;
+  return position_;
 }
 
 // =============================================================================
@@ -299,21 +508,31 @@ void PCMDataBank::printStatus() const {
 
   if (dacDisabled_) {
     Serial.println("  Status: DAC DISABLED (no memory)");
-  } else if (dataBank_) {
-    Serial.print("  Status: Active (");
-    Serial.print(usingPSRAM_ ? "PSRAM" : "RAM");
-    Serial.println(")");
-    Serial.print("  Stored: ");
-    Serial.print(dataSize_);
-    Serial.print(" / ");
-    Serial.print(allocatedSize_);
-    Serial.println(" bytes");
-    if (downsampleRatio_ > 1) {
+  } else if (arena_) {
+    if (streamSource_) {
+      Serial.println("  Status: Streaming from source");
+      Serial.print("  Cache: ");
+      Serial.print(dataCapacity_);
+      Serial.println(" bytes");
+    } else {
+      Serial.print("  Status: Active (");
+      Serial.print(usingPSRAM_ ? "PSRAM" : "RAM");
+      Serial.println(")");
+      Serial.print("  Stored: ");
+      Serial.print(dataUsed_);
+      Serial.print(" / ");
+      Serial.print(dataCapacity_);
+      Serial.println(" bytes");
+    }
+    Serial.print("  Blocks: ");
+    Serial.print(blockCount_);
+    Serial.print(" (");
+    Serial.print(bankSize_);
+    Serial.println(" bytes)");
+    if (downsampleShift_ > 0) {
       Serial.print("  Downsample: ");
-      Serial.print(downsampleRatio_);
-      Serial.print("x (original: ");
-      Serial.print(originalSize_);
-      Serial.println(" bytes)");
+      Serial.print(1 << downsampleShift_);
+      Serial.println("x");
     }
     Serial.print("  Position: ");
     Serial.println(position_);
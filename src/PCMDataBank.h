@@ -3,16 +3,29 @@
 
 #include <Arduino.h>
 #include "config/platform_detect.h"
+#include "sources/VGMSource.h"
+
+class MemoryArena;
 
 // =============================================================================
 // PCMDataBank - Dynamic PCM sample storage for DAC playback
 //
-// Memory strategy:
+// A VGM file may contain several YM2612 PCM data blocks. Together they form
+// one data bank: each block is appended after the previous one and 0xE0
+// seeks address the combined data. A small index records where each block
+// starts in the bank and where its bytes live.
+//
+// Memory strategy (one arena holding the index and sample data, sized from
+// the blocks the parser found ahead of playback):
 // 1. Try PSRAM first (if available on Teensy 4.1)
 // 2. Fall back to regular RAM
 // 3. Try progressively smaller allocations until one succeeds
-// 4. Downsample PCM data if needed to fit available memory
-// 5. If no memory available, DAC playback is disabled gracefully
+// 4. Stream from the source if it supports random access (SD card files)
+// 5. Downsample PCM data if needed to fit available memory
+// 6. If no memory available, DAC playback is disabled gracefully
+//
+// With a MemoryArena set, the arena takes the place of PSRAM and RAM in
+// steps 1-2 (the heap is not used).
 //
 // This approach works on any platform - from Uno to Teensy 4.1
 // =============================================================================
@@ -26,18 +39,26 @@ public:
   // Data Loading
   // -------------------------------------------------------------------------
 
-  // Load PCM data block from VGM file
-  // Allocates memory on first call, downsamples if needed
-  // originalSize: size of data in VGM file
-  // readFunc: function to read bytes from source
-  // Returns true if data was loaded (even if downsampled)
-  bool loadDataBlock(uint32_t originalSize,
-                     int (*readFunc)(void* context),
-                     void* context);
+  // Allocate the arena for the data blocks ahead of the first one
+  // totalSize: combined size of the blocks in the VGM file
+  // blockCount: number of blocks totalSize covers
+  // source: source holding the blocks (used for streaming if they don't fit)
+  // Returns false if DAC playback had to be disabled
+  bool reserve(VGMSource& source, uint32_t totalSize, uint16_t blockCount);
+
+  // Load PCM data block from VGM file and append it to the bank
+  // The source must be positioned at the block data (after the 0x67 header)
+  // Grows the arena if the block wasn't covered by reserve()
+  // Returns true if data was loaded (even if downsampled or streamed)
+  bool loadDataBlock(VGMSource& source, uint32_t size);
 
   // Clear all data and free memory
   void clear();
 
+  // Carve sample storage from an arena instead of the heap (nullptr = heap)
+  // Only change while the bank is clear
+  void setMemoryArena(MemoryArena* arena) { memoryArena_ = arena; }
+
   // -------------------------------------------------------------------------
   // Data Access (for DAC playback)
   // -------------------------------------------------------------------------
@@ -46,7 +67,16 @@ public:
   // Returns 0x80 (silence) if no data available
   uint8_t readByte();
 
-  // Seek to position in original data space
+  // Stored samples from the current position to the end of its block, for
+  // reading straight from the buffer (advance with seek() afterwards)
+  // Returns nullptr if samples aren't stored 1:1 (streamed or downsampled)
+  const uint8_t* contiguousSamples(uint32_t& length);
+
+  // Read byte at a bank position without moving the current position
+  // (DAC streams keep their own read positions)
+  uint8_t readByteAt(uint32_t position);
+
+  // Seek to position in original data space (all blocks combined)
   // (automatically adjusts for downsample ratio)
   void seek(uint32_t position);
 
@@ -58,40 +88,93 @@ public:
   // -------------------------------------------------------------------------
 
   // Check if data bank has data
-  bool hasData() const { return dataSize_ > 0; }
+  bool hasData() const { return blockCount_ > 0; }
 
   // Check if DAC is disabled (no memory available)
   bool isDACDisabled() const { return dacDisabled_; }
 
   // Get actual stored size
-  uint32_t getStoredSize() const { return dataSize_; }
+  uint32_t getStoredSize() const { return dataUsed_; }
+
+  // Get original size before downsampling (all blocks combined)
+  uint32_t getOriginalSize() const { return bankSize_; }
+
+  // Get number of data blocks in the bank
+  uint16_t getBlockCount() const { return blockCount_; }
 
-  // Get original size before downsampling
-  uint32_t getOriginalSize() const { return originalSize_; }
+  // Get bank offset and size of a data block (in load order)
+  // Returns false if there is no such block
+  bool getBlock(uint16_t index, uint32_t& start, uint32_t& length) const;
 
   // Get downsample ratio (1, 2, or 4)
-  uint8_t getDownsampleRatio() const { return downsampleRatio_; }
+  uint8_t getDownsampleRatio() const { return 1 << downsampleShift_; }
 
   // Check if using PSRAM
   bool isPSRAM() const { return usingPSRAM_; }
 
+  // Check if samples are streamed from the source instead of stored
+  bool isStreaming() const { return streamSource_ != nullptr; }
+
   // Print status to Serial
   void printStatus() const;
 
 private:
-  uint8_t* dataBank_;       // PCM data storage
-  uint32_t allocatedSize_;  // Size of allocated buffer
-  uint32_t dataSize_;       // Actual data stored
-  uint32_t originalSize_;   // Original size before downsampling
-  uint32_t position_;       // Current read position (in stored data)
-  uint8_t downsampleRatio_; // 1, 2, or 4
-  uint8_t readCount_;       // Counter for repeating samples when downsampled
+  // Block index entry
+  struct Block {
+    uint32_t start;         // Offset of the block in the bank
+    uint32_t length;        // Block size in the VGM file
+    uint32_t location;      // Offset in data_, or source position when streaming
+  };
+
+  MemoryArena* memoryArena_; // Where arena_ comes from (nullptr = heap)
+  uint8_t* arena_;          // Single allocation: blocks_ then data_
+  Block* blocks_;           // Block index, sorted by start
+  uint16_t blockCount_;     // Blocks in the index
+  uint16_t blockCapacity_;  // Index entries the arena has room for
+  uint8_t* data_;           // Sample storage (window cache when streaming)
+  uint32_t dataCapacity_;   // Size of data_
+  uint32_t dataUsed_;       // Sample bytes stored in data_
+  uint32_t bankSize_;       // Original size of all blocks combined
+  uint32_t position_;       // Current read position (in original data space)
+  uint16_t current_;        // Block containing position_ (blockCount_ = none)
+  uint32_t sourceEnd_;      // Source position after the last block loaded
+  uint8_t downsampleShift_; // 0, 1, or 2 (ratio 1, 2, or 4)
   bool usingPSRAM_;         // True if allocated from PSRAM
   bool dacDisabled_;        // True if allocation failed
 
+  // Streaming mode (null source = data is stored in data_)
+  VGMSource* streamSource_; // Source holding the block data
+  uint32_t cacheStart_;     // Bank position of data_[0]
+  uint32_t cacheLength_;    // Valid bytes in the cache
+
   // Try to allocate memory, returns nullptr if failed
   uint8_t* tryAllocate(uint32_t size, bool& isPSRAM);
 
+  // Allocate an arena with room for the given index entries and sample
+  // bytes, moving over the current index and data
+  bool allocateArena(uint16_t blockCapacity, uint32_t dataCapacity);
+
+  // Free the arena (RAM or PSRAM)
+  void freeArena();
+
+  // Bytes stored in data_ for a block of the given original size
+  uint32_t storedSize(uint32_t length) const {
+    return (length + (1UL << downsampleShift_) - 1) >> downsampleShift_;
+  }
+
+  // Find the block containing position (blockCount_ if none) - O(log n)
+  uint16_t findBlock(uint32_t position) const;
+
+  // Refill the cache starting at position (inside block current_)
+  // Returns false if the source returned no data
+  bool fillCache(uint32_t position);
+
+  // Sample at a position inside the bank (silence in skipped blocks)
+  uint8_t sampleAt(uint32_t position);
+
+  // Skip over block data we are not keeping
+  void skipData(VGMSource& source, uint32_t size);
+
   // Get available free memory estimate
   static int getFreeMemory();
 };
@@ -0,0 +1,150 @@
+#include "PlaybackProfiler.h"
+
+#if GENESIS_ENGINE_USE_PROFILING
+
+#include <string.h>
+
+PlaybackProfile PlaybackProfiler::data_;
+uint32_t PlaybackProfiler::windowStart_ = 0;
+uint32_t PlaybackProfiler::windowWrites_ = 0;
+uint32_t PlaybackProfiler::windowIdle_ = 0;
+bool PlaybackProfiler::behind_ = false;
+
+// Names for print(), in ProfileSection order
+static const char* const SECTION_NAMES[] = {
+  "decode", "vgz inflate", "sd read", "pcm load", "ym write"
+};
+
+// =============================================================================
+// Counters
+// =============================================================================
+
+void PlaybackProfiler::reset() {
+  memset(&data_, 0, sizeof(data_));
+#if PLATFORM_HAS_CYCLE_COUNTER
+  data_.cyclesPerUs = PLATFORM_CYCLES_PER_US();
+#else
+  data_.cyclesPerUs = 1;
+#endif
+  windowStart_ = micros();
+  windowWrites_ = 0;
+  windowIdle_ = 0;
+  behind_ = false;
+}
+
+void PlaybackProfiler::late(uint32_t samples) {
+  if (samples > data_.maxLateSamples) {
+    data_.maxLateSamples = samples;
+  }
+
+  // One underrun per stretch of lateness, however long it lasts
+  bool behind = samples > GENESIS_ENGINE_PROFILE_LATE_SAMPLES;
+  if (behind && !behind_) {
+    data_.underruns++;
+  }
+  behind_ = behind;
+}
+
+void PlaybackProfiler::tick() {
+  uint32_t now = micros();
+  if (now - windowStart_ < 1000000UL) {
+    return;
+  }
+
+  // Scaled to a second in case update() wasn't called for a while
+  uint32_t elapsed = now - windowStart_;
+  uint32_t writes = data_.writes - windowWrites_;
+  data_.writesPerSecond = (uint32_t)(((uint64_t)writes * 1000000UL) / elapsed);
+  if (data_.writesPerSecond > data_.peakWritesPerSecond) {
+    data_.peakWritesPerSecond = data_.writesPerSecond;
+  }
+  data_.idlePercent = windowIdle_ < elapsed ? (uint32_t)((uint64_t)windowIdle_ * 100 / elapsed) : 100;
+  windowStart_ = now;
+  windowWrites_ = data_.writes;
+  windowIdle_ = 0;
+}
+
+// =============================================================================
+// Output
+// =============================================================================
+
+// Right-aligned in width columns
+static void printColumn(Print& out, uint32_t value, uint8_t width) {
+  uint8_t digits = 1;
+  for (uint32_t v = value; v >= 10; v /= 10) {
+    digits++;
+  }
+  while (digits++ < width) {
+    out.print(' ');
+  }
+  out.print(value);
+}
+
+void PlaybackProfiler::print(Print& out) {
+  uint32_t perUs = data_.cyclesPerUs ? data_.cyclesPerUs : 1;
+
+  out.println(F("section         calls    avg us    max us  total ms"));
+  for (uint8_t i = 0; i < (uint8_t)ProfileSection::COUNT; i++) {
+    const ProfileTimer& timer = data_.timers[i];
+    uint32_t avgUs = timer.calls ? (uint32_t)(timer.totalCycles / timer.calls / perUs) : 0;
+
+    out.print(SECTION_NAMES[i]);
+    for (uint8_t pad = strlen(SECTION_NAMES[i]); pad < 11; pad++) {
+      out.print(' ');
+    }
+    printColumn(out, timer.calls, 10);
+    printColumn(out, avgUs, 10);
+    printColumn(out, timer.maxCycles / perUs, 10);
+    printColumn(out, (uint32_t)(timer.totalCycles / perUs / 1000UL), 10);
+    out.println();
+  }
+
+  // Decode speed: commands per second spent decoding
+  const ProfileTimer& decode = data_.timers[(uint8_t)ProfileSection::DECODE];
+  uint64_t decodeUs = decode.totalCycles / perUs;
+  out.print(F("commands      "));
+  out.print(data_.commands);
+  out.print(F(" ("));
+  out.print(decodeUs ? (uint32_t)((uint64_t)data_.commands * 1000000UL / decodeUs) : 0);
+  out.println(F("/sec of decode time)"));
+  out.print(F("source bytes  "));
+  out.println(data_.sourceBytes);
+  out.print(F("allocations   "));
+  out.print(data_.allocations);
+  out.print(F(" ("));
+  out.print(data_.allocatedBytes);
+  out.println(F(" bytes)"));
+
+  out.print(F("writes/sec    "));
+  out.print(data_.writesPerSecond);
+  out.print(F(" (peak "));
+  out.print(data_.peakWritesPerSecond);
+  out.print(F(", total "));
+  out.print(data_.writes);
+  out.println(')');
+  out.print(F("max late      "));
+  out.print(data_.maxLateSamples);
+  out.println(F(" samples"));
+  out.print(F("underruns     "));
+  out.println(data_.underruns);
+  out.print(F("source stalls "));
+  out.println(data_.sourceStalls);
+  out.print(F("catch-ups     "));
+  out.print(data_.catchUps);
+  out.print(F(" (dropped "));
+  out.print(data_.droppedDAC);
+  out.print(F(" DAC, held "));
+  out.print(data_.heldWrites);
+  out.print(F(" writes, slipped "));
+  out.print(data_.slippedSamples);
+  out.println(F(" samples)"));
+  out.print(F("cpu idle      "));
+  out.print(data_.idlePercent);
+  out.print(F("% (sleeps "));
+  out.print(data_.sleeps);
+  out.print(F(", total "));
+  out.print((uint32_t)(data_.idleMicros / 1000UL));
+  out.println(F(" ms)"));
+}
+
+#endif // GENESIS_ENGINE_USE_PROFILING
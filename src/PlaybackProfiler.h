@@ -0,0 +1,160 @@
+#ifndef PLAYBACK_PROFILER_H
+#define PLAYBACK_PROFILER_H
+
+#include <Arduino.h>
+#include "config/feature_config.h"
+
+// =============================================================================
+// PlaybackProfiler - Timing and counters for the playback loop
+//
+// Compiled in with GENESIS_ENGINE_PROFILE. Timed sections use the CPU cycle
+// counter where there is one (DWT on Teensy, CCOUNT on ESP32) and micros()
+// elsewhere. Sections nest: decode time includes the SD reads, PCM loads
+// and (in direct playback) the chip writes made while decoding.
+// Without GENESIS_ENGINE_PROFILE the macros below compile to nothing.
+// =============================================================================
+
+// Timed sections
+enum class ProfileSection : uint8_t {
+  DECODE,       // VGMParser::processUntilWait()
+  VGZ_REFILL,   // VGZSource::refillBuffer() - one buffer of inflate
+  SD_READ,      // SDSource reads from the card
+  PCM_LOAD,     // PCMDataBank::loadDataBlock()
+  YM_WRITE,     // GenesisBoard::writeYM2612() / writeYM2612Batch()
+  COUNT
+};
+
+struct ProfileTimer {
+  uint32_t calls;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+};
+
+struct PlaybackProfile {
+  ProfileTimer timers[(uint8_t)ProfileSection::COUNT];
+  uint32_t cyclesPerUs;          // Timer units per microsecond (1 = micros())
+
+  uint32_t commands;             // VGM commands decoded (a run of DAC
+                                 // writes with waits counts once)
+  uint32_t sourceBytes;          // Bytes read from the SD card
+  uint32_t allocations;          // Buffers allocated for files (PCM bank,
+  uint32_t allocatedBytes;       // SD and VGZ buffers, VGZ checkpoints)
+
+  uint32_t writes;               // Chip writes that reached the bus
+  uint32_t writesPerSecond;      // Over the last whole second of update()s
+  uint32_t peakWritesPerSecond;
+
+  uint32_t maxLateSamples;       // Furthest writes fell behind the clock
+  uint32_t underruns;            // Times they fell behind by more than
+                                 // GENESIS_ENGINE_PROFILE_LATE_SAMPLES
+  uint32_t sourceStalls;         // SD reads the read-ahead missed (read()
+                                 // waited for the card)
+
+  // Catch-up (see GenesisEngine::setCatchUp)
+  uint32_t catchUps;             // update()s that played a backlog
+  uint32_t droppedDAC;           // DAC samples dropped while catching up
+  uint32_t heldWrites;           // Writes collapsed in the register shadow
+                                 // (catch-up and seeks)
+  uint32_t slippedSamples;       // Backlog skipped by letting the clock slip
+
+  // CPU idle (see GenesisEngine::sleepUntilDue)
+  uint32_t sleeps;               // Times the CPU was idled
+  uint64_t idleMicros;           // Time spent idle
+  uint32_t idlePercent;          // Share of the last whole second of update()s
+};
+
+#if GENESIS_ENGINE_USE_PROFILING
+
+class PlaybackProfiler {
+public:
+  static PlaybackProfile& data() { return data_; }
+
+  // Zero every timer and counter
+  static void reset();
+
+  // Table of timers and counters
+  static void print(Print& out);
+
+  static inline uint32_t now() {
+#if PLATFORM_HAS_CYCLE_COUNTER
+    return PLATFORM_CYCLE_COUNT();
+#else
+    return micros();
+#endif
+  }
+
+  static inline void record(ProfileSection section, uint32_t cycles) {
+    ProfileTimer& timer = data_.timers[(uint8_t)section];
+    timer.calls++;
+    timer.totalCycles += cycles;
+    if (cycles > timer.maxCycles) {
+      timer.maxCycles = cycles;
+    }
+  }
+
+  // Writes due this many samples ago haven't gone out yet
+  static void late(uint32_t samples);
+
+  // Once per GenesisEngine::update() - rolls the writes/sec and idle window
+  static void tick();
+
+  // The CPU was idle for us microseconds
+  static inline void idle(uint32_t us) {
+    data_.sleeps++;
+    data_.idleMicros += us;
+    windowIdle_ += us;
+  }
+
+private:
+  static PlaybackProfile data_;
+  static uint32_t windowStart_;   // micros() the writes/sec window began
+  static uint32_t windowWrites_;  // writes at windowStart_
+  static uint32_t windowIdle_;    // Idle microseconds since windowStart_
+  static bool behind_;            // Inside an underrun
+};
+
+// Times the rest of the enclosing scope
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileSection section)
+    : section_(section), start_(PlaybackProfiler::now()) {}
+  ~ProfileScope() { PlaybackProfiler::record(section_, PlaybackProfiler::now() - start_); }
+
+private:
+  ProfileSection section_;
+  uint32_t start_;
+};
+
+#define GENESIS_PROFILE_SCOPE(section) ProfileScope genesisProfileScope_(ProfileSection::section)
+#define GENESIS_PROFILE_COMMANDS(n) (PlaybackProfiler::data().commands += (n))
+#define GENESIS_PROFILE_SOURCE_BYTES(n) (PlaybackProfiler::data().sourceBytes += (n))
+#define GENESIS_PROFILE_ALLOC(bytes) \
+  (PlaybackProfiler::data().allocations++, PlaybackProfiler::data().allocatedBytes += (bytes))
+#define GENESIS_PROFILE_WRITES(n) (PlaybackProfiler::data().writes += (n))
+#define GENESIS_PROFILE_LATE(samples) PlaybackProfiler::late(samples)
+#define GENESIS_PROFILE_STALL() (PlaybackProfiler::data().sourceStalls++)
+#define GENESIS_PROFILE_DROPPED_DAC(n) (PlaybackProfiler::data().droppedDAC += (n))
+#define GENESIS_PROFILE_HELD(n) (PlaybackProfiler::data().heldWrites += (n))
+#define GENESIS_PROFILE_CATCH_UP(slipped) \
+  (PlaybackProfiler::data().catchUps++, PlaybackProfiler::data().slippedSamples += (slipped))
+#define GENESIS_PROFILE_TICK() PlaybackProfiler::tick()
+#define GENESIS_PROFILE_IDLE(us) PlaybackProfiler::idle(us)
+
+#else
+
+#define GENESIS_PROFILE_SCOPE(section)
+#define GENESIS_PROFILE_COMMANDS(n)
+#define GENESIS_PROFILE_SOURCE_BYTES(n)
+#define GENESIS_PROFILE_ALLOC(bytes)
+#define GENESIS_PROFILE_WRITES(n)
+#define GENESIS_PROFILE_LATE(samples)
+#define GENESIS_PROFILE_STALL()
+#define GENESIS_PROFILE_DROPPED_DAC(n)
+#define GENESIS_PROFILE_HELD(n)
+#define GENESIS_PROFILE_CATCH_UP(slipped)
+#define GENESIS_PROFILE_TICK()
+#define GENESIS_PROFILE_IDLE(us)
+
+#endif // GENESIS_ENGINE_USE_PROFILING
+
+#endif // PLAYBACK_PROFILER_H
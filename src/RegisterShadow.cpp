@@ -0,0 +1,311 @@
+#include "RegisterShadow.h"
+#include "GenesisBoard.h"
+
+#include <string.h>
+
+// Pairs sent per writeYM2612Batch() call during restore()
+static const uint16_t RESTORE_BATCH = 32;
+
+// =============================================================================
+// Constructor
+// =============================================================================
+
+RegisterShadow::RegisterShadow() {
+  clear();
+}
+
+void RegisterShadow::clear() {
+  memset(ym_, 0, sizeof(ym_));
+  memset(written_, 0, sizeof(written_));
+  for (uint8_t i = 0; i < 8; i++) {
+    keys_[i] = i;  // Key off, no operators
+  }
+  clearChanged();
+
+  for (uint8_t i = 0; i < 3; i++) {
+    psgTone_[i] = 0;
+  }
+  psgNoise_ = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    psgVolume_[i] = 0x0F;
+  }
+  psgLatch_ = 0;
+
+  for (uint8_t i = 0; i < 2; i++) {
+    freqLatch_[i] = 0xFF;
+    busLatch_[i] = 0xFF;
+  }
+  for (uint8_t i = 0; i < 9; i++) {
+    freqSent_[i] = 0xFFFF;
+  }
+  psgBusLatch_ = 0xFF;
+  psgKnown_ = 0;
+}
+
+// =============================================================================
+// Recording
+// =============================================================================
+
+void RegisterShadow::writeYM2612(uint8_t port, uint8_t reg, uint8_t val) {
+  port &= 1;
+  if (reg == 0x28) {
+    // Key on/off - port 0 only, channel slot in the low bits
+    keys_[val & 0x07] = val;
+    keysChanged_ |= 1 << (val & 0x07);
+    return;
+  }
+  if (reg >= YM_REGS) {
+    return;
+  }
+  ym_[port][reg] = val;
+  written_[port][reg >> 3] |= 1 << (reg & 7);
+  changed_[port][reg >> 3] |= 1 << (reg & 7);
+}
+
+void RegisterShadow::writePSG(uint8_t val) {
+  if (val & 0x80) {
+    // Latch byte: 1 cc t dddd
+    psgLatch_ = (val >> 4) & 0x07;
+  }
+
+  uint8_t channel = psgLatch_ >> 1;
+  bool volume = psgLatch_ & 1;
+  psgChanged_ |= 1 << psgLatch_;
+
+  if (volume) {
+    psgVolume_[channel] = val & 0x0F;
+  } else if (channel == 3) {
+    psgNoise_ = val & 0x07;
+  } else if (val & 0x80) {
+    psgTone_[channel] = (psgTone_[channel] & 0x3F0) | (val & 0x0F);
+  } else {
+    // Data byte: upper 6 bits of the tone period
+    psgTone_[channel] = (psgTone_[channel] & 0x00F) | ((uint16_t)(val & 0x3F) << 4);
+  }
+}
+
+// =============================================================================
+// Redundant Write Filter
+// =============================================================================
+
+uint8_t RegisterShadow::filterYM2612(uint8_t port, uint8_t reg, uint8_t val, uint8_t* pairs) {
+  port &= 1;
+  uint8_t count = 0;
+
+  if ((reg & 0xF0) == 0xA0 && (reg & 0x03) != 0x03 && !(port && reg >= 0xA8)) {
+    // Frequency: A4-A6 (or AC-AE for channel 3 operators) load a latch
+    // shared by both ports, which A0-A2 (A8-AA) then commit with the low
+    // byte. Only the committed value matters to the chip.
+    uint8_t latch = reg >= 0xA8 ? 1 : 0;
+    if (reg & 0x04) {
+      freqLatch_[latch] = val & 0x3F;
+    } else {
+      uint8_t slot = latch ? 6 + (reg & 0x03) : port * 3 + (reg & 0x03);
+      uint16_t freq = freqLatch_[latch] == 0xFF ? 0xFFFF
+                                                : ((uint16_t)freqLatch_[latch] << 8) | val;
+      if (freq == 0xFFFF || freq != freqSent_[slot]) {
+        if (busLatch_[latch] != freqLatch_[latch]) {
+          pairs[count * 2] = reg | 0x04;
+          pairs[count * 2 + 1] = freqLatch_[latch];
+          count++;
+          busLatch_[latch] = freqLatch_[latch];
+        }
+        pairs[count * 2] = reg;
+        pairs[count * 2 + 1] = val;
+        count++;
+        freqSent_[slot] = freq;
+      }
+    }
+  } else if ((reg == 0x22 || reg == 0x2B || (reg >= 0x30 && reg < YM_REGS)) &&
+             isWritten(port, reg) && ym_[port][reg] == val) {
+    // Same value as last time - nothing for the chip to do
+  } else {
+    pairs[0] = reg;
+    pairs[1] = val;
+    count = 1;
+  }
+
+  writeYM2612(port, reg, val);
+  return count;
+}
+
+uint8_t RegisterShadow::filterPSG(uint8_t val, uint8_t* bytes) {
+  bool latchByte = val & 0x80;
+  uint8_t index = latchByte ? (val >> 4) & 0x07 : psgLatch_;
+  uint8_t channel = index >> 1;
+  bool known = psgKnown_ & (1 << index);
+
+  bool redundant;
+  if (index == 6) {
+    redundant = false;
+  } else if (index & 1) {
+    redundant = known && psgVolume_[channel] == (val & 0x0F);
+  } else if (latchByte) {
+    redundant = known && (psgTone_[channel] & 0x0F) == (val & 0x0F);
+  } else {
+    redundant = (psgKnown_ & (0x100 << channel)) &&
+                (psgTone_[channel] >> 4) == (val & 0x3F);
+  }
+
+  uint8_t count = 0;
+  if (!redundant) {
+    if (!latchByte && psgBusLatch_ != index) {
+      // The latch byte this data byte belongs to was dropped
+      bytes[count++] = psgLatchByte(index);
+    }
+    bytes[count++] = val;
+    psgBusLatch_ = index;
+  }
+
+  writePSG(val);
+  if (latchByte || (index & 1) || index == 6) {
+    psgKnown_ |= 1 << index;
+  } else {
+    psgKnown_ |= 0x100 << channel;
+  }
+  return count;
+}
+
+// =============================================================================
+// Restore
+// =============================================================================
+
+void RegisterShadow::add(GenesisBoard& board, uint8_t port, uint8_t reg, bool changedOnly,
+                         uint8_t* pairs, uint16_t& count) const {
+  if (!isWritten(port, reg) || (changedOnly && !isChanged(port, reg))) {
+    return;
+  }
+  pairs[count * 2] = reg;
+  pairs[count * 2 + 1] = ym_[port][reg];
+  if (++count == RESTORE_BATCH) {
+    board.writeYM2612Batch(port, pairs, count);
+    count = 0;
+  }
+}
+
+void RegisterShadow::addFrequency(GenesisBoard& board, uint8_t port, uint8_t high, bool changedOnly,
+                                  uint8_t* pairs, uint16_t& count) const {
+  uint8_t low = high - 4;
+  if (changedOnly && !isChanged(port, high) && !isChanged(port, low)) {
+    return;
+  }
+  add(board, port, high, false, pairs, count);
+  add(board, port, low, false, pairs, count);
+}
+
+void RegisterShadow::restore(GenesisBoard& board) const {
+  write(board, false);
+}
+
+void RegisterShadow::restoreChanged(GenesisBoard& board) const {
+  write(board, true);
+}
+
+void RegisterShadow::write(GenesisBoard& board, bool changedOnly) const {
+  uint8_t pairs[RESTORE_BATCH * 2];
+  uint16_t count = 0;
+
+  // Global: LFO, timers / channel 3 mode, DAC enable
+  static const uint8_t globals[] = { 0x22, 0x24, 0x25, 0x26, 0x27, 0x2B };
+  for (uint8_t i = 0; i < sizeof(globals); i++) {
+    add(board, 0, globals[i], changedOnly, pairs, count);
+  }
+
+  for (uint8_t port = 0; port < 2; port++) {
+    // Operators
+    for (uint8_t reg = 0x30; reg < 0xA0; reg++) {
+      add(board, port, reg, changedOnly, pairs, count);
+    }
+
+    // Frequencies - the high byte goes to a latch shared by all channels,
+    // so each channel's pair is written together
+    for (uint8_t ch = 0; ch < 3; ch++) {
+      addFrequency(board, port, 0xA4 + ch, changedOnly, pairs, count);
+    }
+    if (port == 0) {
+      // Channel 3 special mode operator frequencies (own latch)
+      for (uint8_t op = 0; op < 3; op++) {
+        addFrequency(board, 0, 0xAC + op, changedOnly, pairs, count);
+      }
+    }
+
+    // Algorithm/feedback, panning/LFO sensitivity
+    for (uint8_t reg = 0xB0; reg < YM_REGS; reg++) {
+      add(board, port, reg, changedOnly, pairs, count);
+    }
+
+    if (count > 0) {
+      board.writeYM2612Batch(port, pairs, count);
+      count = 0;
+    }
+  }
+
+  // DAC sample and key states (after a reset every key is off already)
+  if (isWritten(0, 0x2A) && (!changedOnly || isChanged(0, 0x2A))) {
+    board.writeYM2612(0, 0x2A, ym_[0][0x2A]);
+  }
+  for (uint8_t slot = 0; slot < 8; slot++) {
+    if (changedOnly ? (keysChanged_ & (1 << slot)) : (keys_[slot] & 0xF0)) {
+      board.writeYM2612(0, 0x28, keys_[slot]);
+    }
+  }
+
+  // PSG - the latched register goes last so data bytes that follow still
+  // reach it
+  uint8_t psg = changedOnly ? psgChanged_ : 0xFF;
+  if (psg == 0) {
+    return;
+  }
+  for (uint8_t index = 0; index < 8; index++) {
+    if (index != psgLatch_ && (psg & (1 << index))) {
+      restorePSG(board, index);
+    }
+  }
+  restorePSG(board, psgLatch_);
+}
+
+void RegisterShadow::clearChanged() {
+  memset(changed_, 0, sizeof(changed_));
+  keysChanged_ = 0;
+  psgChanged_ = 0;
+}
+
+void RegisterShadow::forgetChanged() {
+  for (uint8_t port = 0; port < 2; port++) {
+    for (uint8_t i = 0; i < YM_REGS / 8; i++) {
+      written_[port][i] &= ~changed_[port][i];
+    }
+  }
+  for (uint8_t index = 0; index < 8; index++) {
+    if (psgChanged_ & (1 << index)) {
+      psgKnown_ &= ~((1 << index) | (0x100 << (index >> 1)));
+    }
+  }
+  // Frequencies compare against what was sent, which a hold doesn't touch
+}
+
+uint8_t RegisterShadow::psgLatchByte(uint8_t index) const {
+  uint8_t channel = index >> 1;
+  uint8_t latch = 0x80 | (index << 4);
+
+  if (index & 1) {
+    return latch | psgVolume_[channel];
+  } else if (channel == 3) {
+    return latch | psgNoise_;
+  }
+  return latch | (psgTone_[channel] & 0x0F);
+}
+
+void RegisterShadow::restorePSG(GenesisBoard& board, uint8_t index) const {
+  uint8_t channel = index >> 1;
+
+  if ((index & 1) || channel == 3) {
+    board.writePSG(psgLatchByte(index));
+  } else {
+    uint8_t data[2] = {
+      psgLatchByte(index),
+      (uint8_t)((psgTone_[channel] >> 4) & 0x3F)
+    };
+    board.writePSGBatch(data, 2);
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef REGISTER_SHADOW_H
+#define REGISTER_SHADOW_H
+
+#include <Arduino.h>
+
+class GenesisBoard;
+
+// =============================================================================
+// RegisterShadow - Last value written to every YM2612/SN76489 register
+//
+// GenesisBoard feeds every write through here, so the shadow always holds
+// the register image the chips have (or would have, while writes are held
+// back for a seek). restore() replays that image onto freshly reset chips
+// in one batch, and restoreChanged() sends what changed since
+// clearChanged() to chips that are still running.
+//
+// The filter*() calls also track what the chips were actually sent, so
+// GenesisBoard can drop writes that would leave a register unchanged.
+// =============================================================================
+
+class RegisterShadow {
+public:
+  RegisterShadow();
+
+  // Forget everything - the state right after a chip reset
+  void clear();
+
+  // Record a write
+  void writeYM2612(uint8_t port, uint8_t reg, uint8_t val);
+  void writePSG(uint8_t val);
+
+  // Check if a YM2612 register has been written since clear()
+  bool isWritten(uint8_t port, uint8_t reg) const {
+    return reg < YM_REGS && (written_[port & 1][reg >> 3] & (1 << (reg & 7)));
+  }
+
+  // Last value written to a YM2612 register (0 if never written)
+  uint8_t getYM2612(uint8_t port, uint8_t reg) const {
+    return reg < YM_REGS ? ym_[port & 1][reg] : 0;
+  }
+
+  // Write the image to chips that have just been reset
+  // Global settings first, then each channel's operators and frequency
+  // (high byte before low, channel by channel for the shared latch), the
+  // DAC sample, key states, and last the PSG with its latch restored.
+  void restore(GenesisBoard& board) const;
+
+  // Start tracking which registers change
+  void clearChanged();
+
+  // Write the registers changed since clearChanged() to chips that hold
+  // the rest of the image already, in restore() order (key on/off and PSG
+  // registers included). Call it on a copy, after forgetChanged() on the
+  // board's shadow, so the filter lets every one of them through.
+  void restoreChanged(GenesisBoard& board) const;
+
+  // Mark the changed registers as unknown to the filter
+  void forgetChanged();
+
+  // -------------------------------------------------------------------------
+  // Redundant Write Filter
+  // -------------------------------------------------------------------------
+
+  // Record a write and work out what the bus needs for it
+  // Returns the (reg, val) pairs stored in pairs (0 = drop the write, up to
+  // 2 when a frequency high byte held back earlier has to go first)
+  // Key on/off, timers and the DAC always pass. Frequency high bytes only
+  // load the chip's latch, so they are held until a low byte commits them.
+  uint8_t filterYM2612(uint8_t port, uint8_t reg, uint8_t val, uint8_t* pairs);
+
+  // Record a PSG write and work out the bytes the bus needs for it
+  // Returns the bytes stored in bytes (0 = drop, up to 2 when a dropped
+  // latch byte has to be repeated for a data byte)
+  // Noise writes always pass - they restart the noise generator.
+  uint8_t filterPSG(uint8_t val, uint8_t* bytes);
+
+private:
+  static const uint8_t YM_REGS = 0xB8;  // 0x00-0xB7
+
+  uint8_t ym_[2][YM_REGS];              // YM2612 registers per port
+  uint8_t written_[2][YM_REGS / 8];     // Registers written since clear()
+  uint8_t keys_[8];                     // Last 0x28 value per channel slot
+
+  // Changed since clearChanged()
+  uint8_t changed_[2][YM_REGS / 8];
+  uint8_t keysChanged_;                 // Per channel slot
+  uint8_t psgChanged_;                  // Per PSG register (channel * 2 + type)
+
+  uint16_t psgTone_[3];                 // 10-bit tone periods
+  uint8_t psgNoise_;                    // Noise control (3 bits)
+  uint8_t psgVolume_[4];                // Attenuation (0xF = off)
+  uint8_t psgLatch_;                    // Latched register (channel * 2 + type)
+
+  // Bus state for the filter (all bits set = unknown)
+  uint8_t freqLatch_[2];                // Frequency high byte written (A4-A6, AC-AE)
+  uint8_t busLatch_[2];                 // High byte the chip's latch holds
+  uint16_t freqSent_[9];                // Frequency committed per channel / ch3 operator
+  uint8_t psgBusLatch_;                 // Register the PSG's latch points at
+  uint16_t psgKnown_;                   // PSG registers sent (bits 8-10: tone high bits)
+
+  bool isChanged(uint8_t port, uint8_t reg) const {
+    return changed_[port & 1][reg >> 3] & (1 << (reg & 7));
+  }
+
+  // restore() / restoreChanged()
+  void write(GenesisBoard& board, bool changedOnly) const;
+
+  // Append a register to a batch of (reg, val) pairs if it was written
+  // (and changed, if changedOnly), flushing to the board when full
+  void add(GenesisBoard& board, uint8_t port, uint8_t reg, bool changedOnly,
+           uint8_t* pairs, uint16_t& count) const;
+
+  // Same for a frequency register pair (high byte first), sent whole if
+  // either byte changed
+  void addFrequency(GenesisBoard& board, uint8_t port, uint8_t high, bool changedOnly,
+                    uint8_t* pairs, uint16_t& count) const;
+
+  // Latch byte for a PSG register holding its shadowed value
+  uint8_t psgLatchByte(uint8_t index) const;
+
+  // Write one PSG register (latch byte, plus data byte for tones)
+  void restorePSG(GenesisBoard& board, uint8_t index) const;
+};
+
+#endif // REGISTER_SHADOW_H
@@ -0,0 +1,111 @@
+#include "RegisterWriteQueue.h"
+#include "GenesisBoard.h"
+#include "PlaybackProfiler.h"
+
+// =============================================================================
+// Constructor / Destructor
+// =============================================================================
+
+RegisterWriteQueue::RegisterWriteQueue()
+  : entries_(nullptr)
+  , mask_(0)
+  , head_(0)
+  , tail_(0)
+{
+}
+
+RegisterWriteQueue::~RegisterWriteQueue() {
+  release();
+}
+
+// =============================================================================
+// Storage
+// =============================================================================
+
+bool RegisterWriteQueue::allocate(uint16_t capacity) {
+  release();
+
+  // Round down to a power of two so indices can wrap with a mask
+  uint16_t size = 1;
+  while (size <= capacity / 2 && size < 0x8000) {
+    size <<= 1;
+  }
+  if (size < 2) {
+    return false;
+  }
+
+#if defined(ARDUINO_ARCH_AVR)
+  entries_ = (RegisterWrite*)malloc(size * sizeof(RegisterWrite));
+#else
+  entries_ = new (std::nothrow) RegisterWrite[size];
+#endif
+  if (!entries_) {
+    return false;
+  }
+
+  mask_ = size - 1;
+  clear();
+  return true;
+}
+
+void RegisterWriteQueue::release() {
+  if (entries_) {
+#if defined(ARDUINO_ARCH_AVR)
+    free(entries_);
+#else
+    delete[] entries_;
+#endif
+    entries_ = nullptr;
+  }
+  mask_ = 0;
+  clear();
+}
+
+// =============================================================================
+// Consumer
+// =============================================================================
+
+uint16_t RegisterWriteQueue::drain(GenesisBoard& board, uint32_t sample, uint16_t maxWrites,
+                                   bool dropDAC, GenesisBoard* second) {
+  uint16_t written = 0;
+  uint16_t tail = tail_;
+
+  while (written < maxWrites && tail != head_) {
+    GENESIS_MEMORY_BARRIER();
+    const RegisterWrite& w = entries_[tail & mask_];
+
+    // Not due yet (wrap-safe comparison)
+    if ((int32_t)(w.sample - sample) > 0) {
+      break;
+    }
+
+    switch (w.target) {
+      case REG_WRITE_YM_PORT0: board.writeYM2612(0, w.reg, w.val); break;
+      case REG_WRITE_YM_PORT1: board.writeYM2612(1, w.reg, w.val); break;
+      case REG_WRITE_PSG:      board.writePSG(w.val); break;
+      case REG_WRITE_DAC:
+        if (dropDAC) {
+          GENESIS_PROFILE_DROPPED_DAC(1);
+        } else {
+          board.writeDAC(w.val);
+        }
+        break;
+      case REG_WRITE_YM_PORT0 | REG_WRITE_CHIP2:
+        if (second) second->writeYM2612(0, w.reg, w.val);
+        break;
+      case REG_WRITE_YM_PORT1 | REG_WRITE_CHIP2:
+        if (second) second->writeYM2612(1, w.reg, w.val);
+        break;
+      case REG_WRITE_PSG | REG_WRITE_CHIP2:
+        if (second) second->writePSG(w.val);
+        break;
+    }
+
+    tail++;
+    GENESIS_MEMORY_BARRIER();
+    tail_ = tail;
+    written++;
+  }
+
+  return written;
+}
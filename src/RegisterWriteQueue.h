@@ -0,0 +1,127 @@
+#ifndef REGISTER_WRITE_QUEUE_H
+#define REGISTER_WRITE_QUEUE_H
+
+#include <Arduino.h>
+#include "config/platform_detect.h"
+
+class GenesisBoard;
+
+// =============================================================================
+// RegisterWriteQueue - Timestamped chip writes between decoder and bus
+//
+// Single-producer / single-consumer ring buffer. The producer (VGMParser,
+// running from loop() or the ESP32 decode task) pushes pre-decoded writes
+// tagged with the sample at which they are due. The consumer (timer ISR,
+// ESP32 bus task or update()) pops them once the playback clock reaches
+// that sample.
+//
+// Lock-free: head_ is only written by the producer, tail_ only by the
+// consumer. Capacity must be a power of two.
+// =============================================================================
+
+// Compiler/CPU barrier so slot contents are visible before the index moves
+#if defined(PLATFORM_AVR)
+  #define GENESIS_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+  #define GENESIS_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+// Destination of a queued write
+enum RegisterWriteTarget : uint8_t {
+  REG_WRITE_YM_PORT0 = 0,  // YM2612 port 0 (reg, val)
+  REG_WRITE_YM_PORT1 = 1,  // YM2612 port 1 (reg, val)
+  REG_WRITE_PSG      = 2,  // SN76489 (val)
+  REG_WRITE_DAC      = 3,  // YM2612 DAC sample (val)
+  REG_WRITE_CHIP2    = 4   // Flag on the YM/PSG targets: second chip of a
+                           // dual-chip file
+};
+
+// One pre-decoded write (8 bytes)
+struct RegisterWrite {
+  uint32_t sample;  // Playback sample at which this write is due
+  uint8_t target;   // RegisterWriteTarget (| REG_WRITE_CHIP2)
+  uint8_t reg;      // YM2612 register (unused for PSG/DAC)
+  uint8_t val;      // Register value, PSG byte or DAC sample
+};
+
+class RegisterWriteQueue {
+public:
+  RegisterWriteQueue();
+  ~RegisterWriteQueue();
+
+  // -------------------------------------------------------------------------
+  // Storage
+  // -------------------------------------------------------------------------
+
+  // Allocate storage for capacity entries (rounded down to a power of two)
+  // Returns true on success
+  bool allocate(uint16_t capacity);
+
+  // Free storage
+  void release();
+
+  bool isAllocated() const { return entries_ != nullptr; }
+  uint16_t capacity() const { return mask_ + 1; }
+
+  // Discard all entries
+  // Only call while the consumer is not running
+  void clear() { head_ = 0; tail_ = 0; }
+
+  // -------------------------------------------------------------------------
+  // Status (safe from either side)
+  // -------------------------------------------------------------------------
+
+  uint16_t count() const { return (uint16_t)(head_ - tail_); }
+  bool isEmpty() const { return head_ == tail_; }
+  bool isFull() const { return !entries_ || count() > mask_; }
+
+  // -------------------------------------------------------------------------
+  // Producer
+  // -------------------------------------------------------------------------
+
+  // Append a write, returns false if the queue is full
+  bool push(uint8_t target, uint8_t reg, uint8_t val, uint32_t sample) {
+    uint16_t head = head_;
+    if (!entries_ || (uint16_t)(head - tail_) > mask_) {
+      return false;
+    }
+    RegisterWrite& w = entries_[head & mask_];
+    w.sample = sample;
+    w.target = target;
+    w.reg = reg;
+    w.val = val;
+    GENESIS_MEMORY_BARRIER();
+    head_ = head + 1;
+    return true;
+  }
+
+  // -------------------------------------------------------------------------
+  // Consumer
+  // -------------------------------------------------------------------------
+
+  // Perform writes that are due at or before sample, up to maxWrites
+  // dropDAC: discard due DAC writes instead (catching up after a stall)
+  // second: board for REG_WRITE_CHIP2 writes (nullptr = drop them)
+  // Returns number of entries removed
+  uint16_t drain(GenesisBoard& board, uint32_t sample, uint16_t maxWrites,
+                 bool dropDAC = false, GenesisBoard* second = nullptr);
+
+  // Get the due sample of the oldest entry, returns false if empty
+  bool peekSample(uint32_t& sample) const {
+    uint16_t tail = tail_;
+    if (tail == head_) {
+      return false;
+    }
+    GENESIS_MEMORY_BARRIER();
+    sample = entries_[tail & mask_].sample;
+    return true;
+  }
+
+private:
+  RegisterWrite* entries_;
+  uint16_t mask_;             // capacity - 1
+  volatile uint16_t head_;    // Next slot to write (producer)
+  volatile uint16_t tail_;    // Next slot to read (consumer)
+};
+
+#endif // REGISTER_WRITE_QUEUE_H
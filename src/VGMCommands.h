@@ -43,6 +43,11 @@ static constexpr uint8_t VGM_CMD_YM2413     = 0x51;  // YM2413 (Master System FM
 static constexpr uint8_t VGM_CMD_YM2151     = 0x54;  // YM2151
 static constexpr uint8_t VGM_CMD_YM2203     = 0x55;  // YM2203
 
+// Second chip of a dual-chip file (bit 30 of the chip's header clock)
+static constexpr uint8_t VGM_CMD_PSG_2ND       = 0x30;  // Write to the second SN76489
+static constexpr uint8_t VGM_CMD_YM2612_2ND_P0 = 0xA2;  // Second YM2612 port 0 write
+static constexpr uint8_t VGM_CMD_YM2612_2ND_P1 = 0xA3;  // Second YM2612 port 1 write
+
 // Wait commands
 static constexpr uint8_t VGM_CMD_WAIT       = 0x61;  // Wait N samples (16-bit)
 static constexpr uint8_t VGM_CMD_WAIT_735   = 0x62;  // Wait 735 samples (1/60 sec NTSC)
@@ -73,6 +78,71 @@ static constexpr uint8_t VGM_CMD_DAC_START_FAST = 0x95; // Start stream (fast)
 // PCM data seek
 static constexpr uint8_t VGM_CMD_PCM_SEEK   = 0xE0;  // Seek in PCM data bank
 
+// -----------------------------------------------------------------------------
+// Command Table
+// Every command byte maps to a class (how the parser handles it) and the
+// number of argument bytes that follow it, packed as (class << 4) | length.
+// VGMParser builds its 256-entry dispatch table from vgmCommandInfo().
+// -----------------------------------------------------------------------------
+enum VGMCommandClass : uint8_t {
+  VGM_CLASS_UNKNOWN     = 0,   // Not in the spec (no arguments assumed)
+  VGM_CLASS_PSG         = 1,   // 0x50 - SN76489 write
+  VGM_CLASS_YM2612      = 2,   // 0x52/0x53 - YM2612 port 0/1 write
+  VGM_CLASS_WAIT        = 3,   // 0x61 - wait N samples
+  VGM_CLASS_WAIT_NTSC   = 4,   // 0x62 - wait 735 samples
+  VGM_CLASS_WAIT_PAL    = 5,   // 0x63 - wait 882 samples
+  VGM_CLASS_WAIT_SHORT  = 6,   // 0x70-0x7F - wait 1-16 samples
+  VGM_CLASS_DAC_WAIT    = 7,   // 0x80-0x8F - DAC write + wait 0-15 samples
+  VGM_CLASS_END         = 8,   // 0x66 - end of data
+  VGM_CLASS_DATA_BLOCK  = 9,   // 0x67 - data block (variable length)
+  VGM_CLASS_PCM_SEEK    = 10,  // 0xE0 - PCM data bank seek
+  VGM_CLASS_DAC_STREAM  = 11,  // 0x90-0x95 - DAC stream control
+  VGM_CLASS_OTHER_CHIP  = 12,  // 0x51/0x54/0x55 - FM chips for the unsupported callback
+  VGM_CLASS_SKIP        = 13,  // Other chips - skipped
+  VGM_CLASS_PSG_2ND     = 14,  // 0x30 - second SN76489 write
+  VGM_CLASS_YM2612_2ND  = 15   // 0xA2/0xA3 - second YM2612 port 0/1 write
+};
+
+static constexpr uint8_t vgmCommandEntry(uint8_t cls, uint8_t length) {
+  return (uint8_t)((cls << 4) | length);
+}
+
+static constexpr uint8_t vgmCommandInfo(uint8_t cmd) {
+  return
+    cmd == VGM_CMD_PSG                    ? vgmCommandEntry(VGM_CLASS_PSG, 1) :
+    cmd == VGM_CMD_YM2612_P0 ||
+    cmd == VGM_CMD_YM2612_P1              ? vgmCommandEntry(VGM_CLASS_YM2612, 2) :
+    cmd == VGM_CMD_YM2413 ||
+    cmd == VGM_CMD_YM2151 ||
+    cmd == VGM_CMD_YM2203                 ? vgmCommandEntry(VGM_CLASS_OTHER_CHIP, 2) :
+    cmd == VGM_CMD_WAIT                   ? vgmCommandEntry(VGM_CLASS_WAIT, 2) :
+    cmd == VGM_CMD_WAIT_735               ? vgmCommandEntry(VGM_CLASS_WAIT_NTSC, 0) :
+    cmd == VGM_CMD_WAIT_882               ? vgmCommandEntry(VGM_CLASS_WAIT_PAL, 0) :
+    cmd == VGM_CMD_END                    ? vgmCommandEntry(VGM_CLASS_END, 0) :
+    cmd == VGM_CMD_DATA_BLOCK             ? vgmCommandEntry(VGM_CLASS_DATA_BLOCK, 0) :
+    cmd == 0x68                           ? vgmCommandEntry(VGM_CLASS_SKIP, 11) :  // PCM RAM write
+    (cmd & 0xF0) == 0x70                  ? vgmCommandEntry(VGM_CLASS_WAIT_SHORT, 0) :
+    (cmd & 0xF0) == 0x80                  ? vgmCommandEntry(VGM_CLASS_DAC_WAIT, 0) :
+    cmd == VGM_CMD_DAC_SETUP              ? vgmCommandEntry(VGM_CLASS_DAC_STREAM, 4) :
+    cmd == VGM_CMD_DAC_DATA               ? vgmCommandEntry(VGM_CLASS_DAC_STREAM, 4) :
+    cmd == VGM_CMD_DAC_FREQ               ? vgmCommandEntry(VGM_CLASS_DAC_STREAM, 5) :
+    cmd == VGM_CMD_DAC_START              ? vgmCommandEntry(VGM_CLASS_DAC_STREAM, 10) :
+    cmd == VGM_CMD_DAC_STOP               ? vgmCommandEntry(VGM_CLASS_DAC_STREAM, 1) :
+    cmd == VGM_CMD_DAC_START_FAST         ? vgmCommandEntry(VGM_CLASS_DAC_STREAM, 4) :
+    cmd == VGM_CMD_PCM_SEEK               ? vgmCommandEntry(VGM_CLASS_PCM_SEEK, 4) :
+    cmd == VGM_CMD_PSG_2ND                ? vgmCommandEntry(VGM_CLASS_PSG_2ND, 1) :
+    cmd == VGM_CMD_YM2612_2ND_P0 ||
+    cmd == VGM_CMD_YM2612_2ND_P1          ? vgmCommandEntry(VGM_CLASS_YM2612_2ND, 2) :
+    (cmd >= 0x30 && cmd <= 0x3F)          ? vgmCommandEntry(VGM_CLASS_SKIP, 1) :
+    (cmd >= 0x40 && cmd <= 0x4E)          ? vgmCommandEntry(VGM_CLASS_SKIP, 2) :
+    cmd == 0x4F                           ? vgmCommandEntry(VGM_CLASS_SKIP, 1) :  // Game Gear stereo
+    (cmd >= 0x51 && cmd <= 0x5F)          ? vgmCommandEntry(VGM_CLASS_SKIP, 2) :
+    (cmd >= 0xA0 && cmd <= 0xBF)          ? vgmCommandEntry(VGM_CLASS_SKIP, 2) :
+    (cmd >= 0xC0 && cmd <= 0xDF)          ? vgmCommandEntry(VGM_CLASS_SKIP, 3) :
+    (cmd >= 0xE1)                         ? vgmCommandEntry(VGM_CLASS_SKIP, 4) :
+                                            vgmCommandEntry(VGM_CLASS_UNKNOWN, 0);
+}
+
 // -----------------------------------------------------------------------------
 // Timing Constants
 // -----------------------------------------------------------------------------
@@ -96,6 +166,25 @@ static constexpr uint32_t SN76489_CLOCK_PAL  = 3546895;  // 3.55 MHz (PAL)
 // -----------------------------------------------------------------------------
 static constexpr uint8_t VGM_DATA_YM2612_PCM = 0x00;  // YM2612 PCM data
 
+// -----------------------------------------------------------------------------
+// DAC Stream Control (0x90-0x95 arguments)
+// -----------------------------------------------------------------------------
+static constexpr uint8_t VGM_STREAM_CHIP_YM2612 = 0x02;   // Chip type in 0x90
+static constexpr uint8_t VGM_STREAM_ALL = 0xFF;           // Stream ID for 0x94
+static constexpr uint32_t VGM_STREAM_KEEP_OFFSET = 0xFFFFFFFF;  // 0x93 offset
+
+// 0x93 length mode (low bits) and flags
+static constexpr uint8_t VGM_STREAM_LEN_IGNORE   = 0x00;  // Only set position
+static constexpr uint8_t VGM_STREAM_LEN_COMMANDS = 0x01;  // Length in writes
+static constexpr uint8_t VGM_STREAM_LEN_MSEC     = 0x02;  // Length in ms
+static constexpr uint8_t VGM_STREAM_LEN_TO_END   = 0x03;  // Until end of data
+static constexpr uint8_t VGM_STREAM_REVERSE      = 0x10;  // Play backwards
+static constexpr uint8_t VGM_STREAM_LOOP         = 0x80;  // Restart when done
+
+// 0x95 flags
+static constexpr uint8_t VGM_STREAM_FAST_LOOP    = 0x01;
+static constexpr uint8_t VGM_STREAM_FAST_REVERSE = 0x10;
+
 // -----------------------------------------------------------------------------
 // VGM Header Structure (for reference)
 // -----------------------------------------------------------------------------
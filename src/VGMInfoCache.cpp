@@ -0,0 +1,195 @@
+#include "VGMInfoCache.h"
+
+#if GENESIS_ENGINE_USE_INFO_CACHE
+
+#include <string.h>
+#include <new>
+
+// Records are appended (FILE_WRITE truncates on ESP32)
+#if defined(FILE_APPEND)
+  #define INFO_CACHE_APPEND FILE_APPEND
+#else
+  #define INFO_CACHE_APPEND FILE_WRITE
+#endif
+
+// =============================================================================
+// Constructor / Destructor
+// =============================================================================
+
+VGMInfoCache::VGMInfoCache()
+  : path_(nullptr)
+  , keys_(nullptr)
+  , keyCount_(0)
+  , loaded_(false)
+{
+}
+
+VGMInfoCache::~VGMInfoCache() {
+  delete[] keys_;
+}
+
+void VGMInfoCache::setPath(const char* path) {
+  path_ = path;
+  loaded_ = false;
+  keyCount_ = 0;
+  if (!path && keys_) {
+    delete[] keys_;
+    keys_ = nullptr;
+  }
+}
+
+void VGMInfoCache::clear() {
+  if (path_ && SD.exists(path_)) {
+    SD.remove(path_);
+  }
+  keyCount_ = 0;
+}
+
+// =============================================================================
+// Lookup / Store
+// =============================================================================
+
+bool VGMInfoCache::lookup(const char* path, uint32_t fileSize, VGMFileInfo& info) {
+  if (!load() || keyCount_ == 0) {
+    return false;
+  }
+
+  uint32_t key = keyOf(path, fileSize);
+  File cache;
+  bool found = false;
+
+  // Newest record first
+  for (uint16_t i = keyCount_; i-- > 0 && !found; ) {
+    if (keys_[i] != key) {
+      continue;
+    }
+    if (!cache) {
+      cache = SD.open(path_, FILE_READ);
+      if (!cache) {
+        return false;
+      }
+    }
+
+    Record record;
+    found = cache.seek(sizeof(Header) + (uint32_t)i * sizeof(Record)) &&
+            cache.read((uint8_t*)&record, sizeof(record)) == sizeof(record) &&
+            record.fileSize == fileSize &&
+            strncmp(record.path, path, NAME_LEN - 1) == 0;
+    if (found) {
+      info = record.info;
+    }
+  }
+
+  if (cache) {
+    cache.close();
+  }
+  return found;
+}
+
+bool VGMInfoCache::store(const char* path, uint32_t fileSize, const VGMFileInfo& info) {
+  if (!load() || keyCount_ >= GENESIS_ENGINE_INFO_CACHE_MAX) {
+    return false;
+  }
+
+  // Start a new cache file with its header
+  if (!SD.exists(path_)) {
+    File cache = SD.open(path_, INFO_CACHE_APPEND);
+    if (!cache) {
+      return false;
+    }
+    Header header;
+    memcpy(header.magic, "VGC1", 4);
+    header.recordSize = sizeof(Record);
+    header.reserved = 0;
+    bool ok = cache.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    cache.close();
+    if (!ok) {
+      return false;
+    }
+  }
+
+  Record record;
+  memset(&record, 0, sizeof(record));
+  record.key = keyOf(path, fileSize);
+  record.fileSize = fileSize;
+  strncpy(record.path, path, NAME_LEN - 1);
+  record.info = info;
+
+  File cache = SD.open(path_, INFO_CACHE_APPEND);
+  if (!cache) {
+    return false;
+  }
+  bool ok = cache.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+  cache.close();
+
+  if (ok) {
+    keys_[keyCount_++] = record.key;
+  }
+  return ok;
+}
+
+// =============================================================================
+// Internal Functions
+// =============================================================================
+
+bool VGMInfoCache::load() {
+  if (!path_) {
+    return false;
+  }
+  if (loaded_) {
+    return true;
+  }
+
+  if (!keys_) {
+    keys_ = new (std::nothrow) uint32_t[GENESIS_ENGINE_INFO_CACHE_MAX];
+    if (!keys_) {
+      return false;
+    }
+  }
+  keyCount_ = 0;
+
+  File cache = SD.open(path_, FILE_READ);
+  if (cache) {
+    Header header;
+    uint32_t recordBytes = cache.size() > sizeof(header) ? cache.size() - sizeof(header) : 0;
+    bool valid = cache.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 memcmp(header.magic, "VGC1", 4) == 0 &&
+                 header.recordSize == sizeof(Record) &&
+                 recordBytes % sizeof(Record) == 0;
+
+    uint32_t records = valid ? recordBytes / sizeof(Record) : 0;
+    if (records > GENESIS_ENGINE_INFO_CACHE_MAX) {
+      records = GENESIS_ENGINE_INFO_CACHE_MAX;
+    }
+    for (uint32_t i = 0; valid && i < records; i++) {
+      valid = cache.seek(sizeof(header) + i * sizeof(Record)) &&
+              cache.read((uint8_t*)&keys_[i], 4) == 4;
+      keyCount_ = valid ? i + 1 : 0;
+    }
+    cache.close();
+
+    // Not a cache file for this build - start over
+    if (!valid) {
+      GENESIS_DEBUG_PRINTLN("Rebuilding header cache");
+      SD.remove(path_);
+      keyCount_ = 0;
+    }
+  }
+
+  loaded_ = true;
+  return true;
+}
+
+uint32_t VGMInfoCache::keyOf(const char* path, uint32_t fileSize) {
+  // FNV-1a over the stored part of the path, then the size
+  uint32_t hash = 2166136261UL;
+  for (uint8_t i = 0; i < NAME_LEN - 1 && path[i]; i++) {
+    hash = (hash ^ (uint8_t)path[i]) * 16777619UL;
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    hash = (hash ^ (uint8_t)(fileSize >> (i * 8))) * 16777619UL;
+  }
+  return hash;
+}
+
+#endif // GENESIS_ENGINE_USE_INFO_CACHE
@@ -0,0 +1,74 @@
+#ifndef VGM_INFO_CACHE_H
+#define VGM_INFO_CACHE_H
+
+#include "config/feature_config.h"
+
+// Only compile if the header cache is enabled
+#if GENESIS_ENGINE_USE_INFO_CACHE
+
+#include <Arduino.h>
+#include <SD.h>
+#include "VGMParser.h"
+
+// =============================================================================
+// VGMInfoCache - Parsed VGM headers kept in a file on the SD card
+//
+// One fixed-size record per file, keyed by path and file size (the Arduino
+// SD API has no portable modification time). Records are appended as files
+// are first opened, and a newer record for the same path and size replaces
+// an older one. Only a 4-byte key per record is held in RAM; lookups read
+// the one matching record.
+// =============================================================================
+
+class VGMInfoCache {
+public:
+  VGMInfoCache();
+  ~VGMInfoCache();
+
+  // Cache file to use (nullptr = off). The file is created on first store().
+  void setPath(const char* path);
+  bool isEnabled() const { return path_ != nullptr; }
+
+  // Find the record for a file
+  // Returns false if there is none for this path and size
+  bool lookup(const char* path, uint32_t fileSize, VGMFileInfo& info);
+
+  // Add or replace the record for a file
+  bool store(const char* path, uint32_t fileSize, const VGMFileInfo& info);
+
+  // Delete the cache file
+  void clear();
+
+private:
+  static const uint8_t NAME_LEN = 48;  // Path characters kept per record
+
+  // Cache file layout: Header, then Records
+  struct Header {
+    char magic[4];        // "VGC1"
+    uint16_t recordSize;  // sizeof(Record) - rebuilt if it changes
+    uint16_t reserved;
+  };
+  struct Record {
+    uint32_t key;         // keyOf(path, fileSize)
+    uint32_t fileSize;
+    char path[NAME_LEN];  // Truncated if longer
+    VGMFileInfo info;
+  };
+
+  const char* path_;
+
+  // Key of every record, in file order
+  uint32_t* keys_;
+  uint16_t keyCount_;
+  bool loaded_;           // keys_ reflects the cache file
+
+  // Read the keys in, recreating the file if it isn't a cache file
+  bool load();
+
+  // Hash of path and size
+  static uint32_t keyOf(const char* path, uint32_t fileSize);
+};
+
+#endif // GENESIS_ENGINE_USE_INFO_CACHE
+
+#endif // VGM_INFO_CACHE_H
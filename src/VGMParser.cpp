@@ -1,11 +1,19 @@
 #include "VGMParser.h"
 #include "config/feature_config.h"
+#include "PlaybackProfiler.h"
+
+// Little-endian 32-bit value at bytes[offset]
+static inline uint32_t gecUInt32(const uint8_t* bytes, uint8_t offset) {
+  return (uint32_t)bytes[offset] | ((uint32_t)bytes[offset + 1] << 8) |
+         ((uint32_t)bytes[offset + 2] << 16) | ((uint32_t)bytes[offset + 3] << 24);
+}
 
 // =============================================================================
 // Constructor
 // =============================================================================
 VGMParser::VGMParser(GenesisBoard& board)
   : board_(board),
+    secondChip_(nullptr),
     source_(nullptr),
     version_(0),
     totalSamples_(0),
@@ -13,12 +21,26 @@ VGMParser::VGMParser(GenesisBoard& board)
     dataOffset_(0),
     loopOffset_(0),
     loopOffsetInData_(0),
+    gd3Offset_(0),
     hasLoop_(false),
     hasYM2612_(false),
     hasSN76489_(false),
+    gec_(false),
+    gecAtStart_(false),
+    gecPCMSize_(0),
+    gecSeekOffset_(0),
+    gecSeekCount_(0),
+    gecFrame_(),
     finished_(true),
     loopCount_(0),
     psgAttenuation_(0),
+    pcmHintSize_(0),
+    pcmHintBlocks_(0),
+    dacStreams_(pcmDataBank_),
+    streamWaitLeft_(0),
+    outputQueue_(nullptr),
+    writeTime_(0),
+    skipDAC_(false),
     unsupportedCallback_(nullptr)
 {
 }
@@ -44,6 +66,9 @@ bool VGMParser::parseHeader() {
 
   // Check magic number
   uint32_t magic = source_->readUInt32();
+  if (magic == GEC_MAGIC) {
+    return parseGECHeader();
+  }
   if (magic != VGM_MAGIC) {
     GENESIS_DEBUG_PRINTLN("Invalid VGM magic");
     return false;
@@ -53,6 +78,10 @@ bool VGMParser::parseHeader() {
   source_->seek(VGM_OFF_VERSION);
   version_ = source_->readUInt32();
 
+  source_->seek(VGM_OFF_GD3);
+  uint32_t gd3OffsetRel = source_->readUInt32();
+  gd3Offset_ = gd3OffsetRel ? VGM_OFF_GD3 + gd3OffsetRel : 0;
+
   source_->seek(VGM_OFF_SN76489);
   uint32_t sn76489Clock = source_->readUInt32();
   hasSN76489_ = (sn76489Clock != 0);
@@ -90,6 +119,131 @@ bool VGMParser::parseHeader() {
     dataOffset_ = 0x40;
   }
 
+  // PCM blocks are sized when the first one arrives
+  pcmHintSize_ = 0;
+  pcmHintBlocks_ = 0;
+  gec_ = false;
+
+  return finishHeader();
+}
+
+bool VGMParser::parseGECHeader() {
+  uint8_t header[GEC_HEADER_SIZE];
+  if (!source_->seek(0) || source_->read(header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  if (header[GEC_OFF_VERSION] != GEC_VERSION) {
+    GENESIS_DEBUG_PRINTLN("Unsupported GEC version");
+    return false;
+  }
+
+  uint8_t flags = header[GEC_OFF_FLAGS];
+  version_ = gecUInt32(header, GEC_OFF_VGM_VERSION);
+  totalSamples_ = gecUInt32(header, GEC_OFF_SAMPLES);
+  loopSamples_ = gecUInt32(header, GEC_OFF_LOOP_SAMP);
+  dataOffset_ = gecUInt32(header, GEC_OFF_DATA);
+  hasLoop_ = (flags & GEC_FLAG_LOOP) != 0;
+  loopOffset_ = hasLoop_ ? dataOffset_ + gecUInt32(header, GEC_OFF_LOOP) : 0;
+  gd3Offset_ = 0;
+  hasYM2612_ = (flags & GEC_FLAG_YM2612) != 0;
+  hasSN76489_ = (flags & GEC_FLAG_SN76489) != 0;
+
+  gecPCMSize_ = gecUInt32(header, GEC_OFF_PCM_SIZE);
+  gecSeekOffset_ = gecUInt32(header, GEC_OFF_SEEK);
+  gecSeekCount_ = (uint16_t)header[GEC_OFF_SEEK_COUNT] |
+                  ((uint16_t)header[GEC_OFF_SEEK_COUNT + 1] << 8);
+  gecAtStart_ = true;
+  gecFrame_.open = false;
+  pcmHintSize_ = 0;
+  pcmHintBlocks_ = 0;
+  gec_ = true;
+
+  return finishHeader();
+}
+
+bool VGMParser::applyHeader(const VGMFileInfo& info) {
+  if (!source_ || !source_->isOpen()) {
+    return false;
+  }
+  if (info.chips & VGM_INFO_GEC) {
+    return parseHeader();
+  }
+
+  gec_ = false;
+  version_ = info.version;
+  totalSamples_ = info.totalSamples;
+  loopSamples_ = info.loopSamples;
+  hasLoop_ = (info.loopOffset != 0);
+  loopOffset_ = info.loopOffset;
+  dataOffset_ = info.dataOffset;
+  gd3Offset_ = 0;
+  hasYM2612_ = (info.chips & VGM_INFO_YM2612) != 0;
+  hasSN76489_ = (info.chips & VGM_INFO_SN76489) != 0;
+  pcmHintSize_ = info.pcmSize;
+  pcmHintBlocks_ = info.pcmBlocks;
+
+  return finishHeader();
+}
+
+void VGMParser::getFileInfo(VGMFileInfo& info) {
+  info.version = version_;
+  info.totalSamples = totalSamples_;
+  info.loopSamples = loopSamples_;
+  info.loopOffset = hasLoop_ ? loopOffset_ : 0;
+  info.dataOffset = dataOffset_;
+  info.chips = (hasYM2612_ ? VGM_INFO_YM2612 : 0) | (hasSN76489_ ? VGM_INFO_SN76489 : 0);
+  info.pcmSize = pcmHintSize_;
+  info.pcmBlocks = pcmHintBlocks_;
+  info.title[0] = '\0';
+
+  if (gec_) {
+    // All of it is in the header
+    info.chips |= VGM_INFO_GEC;
+    info.pcmSize = gecPCMSize_;
+    info.pcmBlocks = gecPCMSize_ ? 1 : 0;
+    size_t length = GEC_TITLE_SIZE < GENESIS_ENGINE_INFO_TITLE_LEN - 1 ?
+                    GEC_TITLE_SIZE : GENESIS_ENGINE_INFO_TITLE_LEN - 1;
+    length = source_->readAt(GEC_OFF_TITLE, (uint8_t*)info.title, length);
+    info.title[length] = '\0';
+    return;
+  }
+
+  // The rest needs random access (not on VGZ - PCM sizes are filled in
+  // from the data bank once the blocks have loaded)
+  uint8_t header[7];  // 0x67 0x66 tt ss ss ss ss
+  if (info.pcmBlocks == 0 &&
+      source_->readAt(dataOffset_, header, sizeof(header)) == sizeof(header) &&
+      header[0] == VGM_CMD_DATA_BLOCK && header[1] == 0x66) {
+    uint32_t totalSize = 0;
+    uint16_t blockCount = 0;
+    scanDataBlocks(dataOffset_, totalSize, blockCount);
+    info.pcmSize = totalSize;
+    info.pcmBlocks = blockCount;
+  }
+
+  if (gd3Offset_ != 0) {
+    // "Gd3 ", version, length, then UTF-16LE strings - the English track
+    // title comes first
+    uint8_t text[(GENESIS_ENGINE_INFO_TITLE_LEN - 1) * 2];
+    size_t length = 0;
+    uint8_t magic[4];
+    if (source_->readAt(gd3Offset_, magic, 4) == 4 && memcmp(magic, "Gd3 ", 4) == 0) {
+      length = source_->readAt(gd3Offset_ + 12, text, sizeof(text));
+    }
+
+    uint8_t n = 0;
+    for (size_t i = 0; i + 1 < length; i += 2) {
+      uint16_t c = text[i] | ((uint16_t)text[i + 1] << 8);
+      if (c == 0) {
+        break;
+      }
+      info.title[n++] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+    }
+    info.title[n] = '\0';
+  }
+}
+
+bool VGMParser::finishHeader() {
   // Calculate loop offset relative to data start (for seeking)
   // This is used by VGZSource which tracks positions relative to data start
   if (hasLoop_ && loopOffset_ >= dataOffset_) {
@@ -135,6 +289,12 @@ void VGMParser::reset() {
   loopCount_ = 0;
   psgAttenuation_ = 0;
   pcmDataBank_.clear();
+  pcmHintSize_ = 0;
+  pcmHintBlocks_ = 0;
+  dacStreams_.reset();
+  streamWaitLeft_ = 0;
+  gec_ = false;
+  gecFrame_.open = false;
 }
 
 // =============================================================================
@@ -145,9 +305,25 @@ uint32_t VGMParser::processUntilWait() {
   if (finished_ || !source_) {
     return 0;
   }
+  GENESIS_PROFILE_SCOPE(DECODE);
+
+  if (gec_) {
+    return processGEC();
+  }
+
+  // Still inside a wait that a DAC stream split up
+  if (streamWaitLeft_ > 0) {
+    return streamWait();
+  }
 
   while (source_->available()) {
+    // Yield before the next command if it could not be queued
+    if (outputQueue_ && outputQueue_->isFull()) {
+      return 0;
+    }
+
     int32_t waitSamples = processCommand();
+    GENESIS_PROFILE_COMMANDS(1);
 
     if (waitSamples < 0) {
       // End of file or error
@@ -156,6 +332,10 @@ uint32_t VGMParser::processUntilWait() {
     }
 
     if (waitSamples > 0) {
+      if (dacStreams_.isActive()) {
+        streamWaitLeft_ = waitSamples;
+        return streamWait();
+      }
       return waitSamples;
     }
 
@@ -167,6 +347,34 @@ uint32_t VGMParser::processUntilWait() {
   return 0;
 }
 
+uint32_t VGMParser::streamWait() {
+  // Returns 0 (queue full) if a stream write didn't fit
+  uint32_t step = dacStreams_.update(streamWaitLeft_, streamWrite, this);
+  streamWaitLeft_ -= step;
+  return step;
+}
+
+bool VGMParser::streamWrite(void* context, uint8_t port, uint8_t reg, uint8_t val) {
+  VGMParser* parser = static_cast<VGMParser*>(context);
+  bool dac = (port == 0 && reg == 0x2A);  // DAC data - use the board's DAC path
+
+  if (dac && parser->skipDAC_) {
+    GENESIS_PROFILE_DROPPED_DAC(1);
+    return true;
+  }
+  if (parser->outputQueue_) {
+    uint8_t target = dac ? REG_WRITE_DAC : (port ? REG_WRITE_YM_PORT1 : REG_WRITE_YM_PORT0);
+    return parser->outputQueue_->push(target, dac ? 0 : reg, val, parser->writeTime_);
+  }
+
+  if (dac) {
+    parser->board_.writeDAC(val);
+  } else {
+    parser->board_.writeYM2612(port, reg, val);
+  }
+  return true;
+}
+
 bool VGMParser::seekToLoop() {
   if (!hasLoop_ || !source_ || !source_->canSeek()) {
     return false;
@@ -178,174 +386,684 @@ bool VGMParser::seekToLoop() {
   if (source_->seek(loopOffsetInData_)) {
     finished_ = false;
     loopCount_++;
+    gecFrame_.open = false;
     return true;
   }
 
   return false;
 }
 
-// =============================================================================
-// Command Processing
-// =============================================================================
+bool VGMParser::rewind() {
+  if (!source_ || !source_->canSeek()) {
+    return false;
+  }
 
-int32_t VGMParser::processCommand() {
-  int cmdByte = source_->read();
-  if (cmdByte < 0) {
-    return -1;  // End of data
+  // Positions are relative to the data start, like the loop offset
+  if (!source_->seek(0)) {
+    return false;
   }
 
-  uint8_t cmd = (uint8_t)cmdByte;
+  finished_ = false;
+  loopCount_ = 0;
+  dacStreams_.reset();
+  streamWaitLeft_ = 0;
+  pcmDataBank_.seek(0);
+  gecAtStart_ = gec_;
+  gecFrame_.open = false;
+  return true;
+}
 
-  // -------------------------------------------------------------------------
-  // PSG Write (0x50)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_PSG) {
-    uint8_t val = source_->read();
-
-    // Apply PSG attenuation for FM+PSG mix
-    // PSG attenuation command format: 1cc1aaaa (bit 7=1, bit 4=1, bits 0-3=attenuation)
-    if (psgAttenuation_ > 0 && (val & 0x90) == 0x90) {
-      uint8_t currentAtten = val & 0x0F;
-      // If already silent (15), leave it. Otherwise increase but cap at 14.
-      if (currentAtten < 15) {
-        uint8_t newAtten = currentAtten + psgAttenuation_;
-        if (newAtten > 14) newAtten = 14;  // Don't silence, cap at 14
-        val = (val & 0xF0) | newAtten;
-      }
+bool VGMParser::seekNear(uint32_t sample, uint32_t& reached) {
+  if (!gec_ || gecSeekCount_ == 0 || !source_ || !source_->canSeek()) {
+    return false;
+  }
+
+  // Entry i is the first frame at or after i seconds - step back one if
+  // that frame starts after the sample
+  uint32_t index = sample / GEC_SEEK_INTERVAL;
+  if (index >= gecSeekCount_) {
+    index = gecSeekCount_ - 1;
+  }
+  uint8_t entry[GEC_SEEK_ENTRY_SIZE];
+  for (;;) {
+    if (source_->readAt(gecSeekOffset_ + index * GEC_SEEK_ENTRY_SIZE,
+                        entry, sizeof(entry)) != sizeof(entry)) {
+      return false;
+    }
+    if (gecUInt32(entry, 0) <= sample || index == 0) {
+      break;
     }
+    index--;
+  }
 
+  // The frames address the data bank, so it has to be there first
+  if (gecAtStart_) {
+    gecLoadPCM();
+  }
+  if (!source_->seek(gecUInt32(entry, 4))) {
+    return false;
+  }
+
+  reached = gecUInt32(entry, 0);
+  finished_ = false;
+  gecFrame_.open = false;
+  return true;
+}
+
+// =============================================================================
+// Chip Writes
+// =============================================================================
+
+inline void VGMParser::emitYM2612(uint8_t port, uint8_t reg, uint8_t val) {
+  if (outputQueue_) {
+    outputQueue_->push(port ? REG_WRITE_YM_PORT1 : REG_WRITE_YM_PORT0, reg, val, writeTime_);
+  } else {
+    board_.writeYM2612(port, reg, val);
+  }
+}
+
+inline void VGMParser::emitPSG(uint8_t val) {
+  if (outputQueue_) {
+    outputQueue_->push(REG_WRITE_PSG, 0, val, writeTime_);
+  } else {
     board_.writePSG(val);
-    return 0;
   }
+}
 
-  // -------------------------------------------------------------------------
-  // YM2612 Port 0 Write (0x52)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_YM2612_P0) {
-    uint8_t reg = source_->read();
-    uint8_t val = source_->read();
-    board_.writeYM2612(0, reg, val);
-    return 0;
+inline void VGMParser::emitDAC(uint8_t sample) {
+  if (skipDAC_) {
+    GENESIS_PROFILE_DROPPED_DAC(1);
+  } else if (outputQueue_) {
+    outputQueue_->push(REG_WRITE_DAC, 0, sample, writeTime_);
+  } else {
+    board_.writeDAC(sample);
   }
+}
 
-  // -------------------------------------------------------------------------
-  // YM2612 Port 1 Write (0x53)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_YM2612_P1) {
-    uint8_t reg = source_->read();
-    uint8_t val = source_->read();
-    board_.writeYM2612(1, reg, val);
-    return 0;
+void VGMParser::emitSecondYM2612(uint8_t port, uint8_t reg, uint8_t val) {
+  if (!secondChip_) {
+    return;
+  }
+  if (outputQueue_) {
+    outputQueue_->push((port ? REG_WRITE_YM_PORT1 : REG_WRITE_YM_PORT0) | REG_WRITE_CHIP2,
+                       reg, val, writeTime_);
+  } else {
+    secondChip_->writeYM2612(port, reg, val);
   }
+}
 
-  // -------------------------------------------------------------------------
-  // Wait N samples (0x61)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_WAIT) {
-    uint16_t samples = source_->readUInt16();
-    return samples;
+void VGMParser::emitSecondPSG(uint8_t val) {
+  if (!secondChip_) {
+    return;
   }
+  if (outputQueue_) {
+    outputQueue_->push(REG_WRITE_PSG | REG_WRITE_CHIP2, 0, val, writeTime_);
+  } else {
+    secondChip_->writePSG(val);
+  }
+}
 
-  // -------------------------------------------------------------------------
-  // Wait 735 samples / 60Hz frame (0x62)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_WAIT_735) {
-    return VGM_WAIT_NTSC;
+// =============================================================================
+// Command Processing
+// =============================================================================
+
+// Dispatch table: (class << 4) | argument length for every command byte.
+// Generated at compile time from vgmCommandInfo() in VGMCommands.h
+#define VGM_CMD_ROW(hi) \
+  vgmCommandInfo(hi + 0x0), vgmCommandInfo(hi + 0x1), vgmCommandInfo(hi + 0x2), vgmCommandInfo(hi + 0x3), \
+  vgmCommandInfo(hi + 0x4), vgmCommandInfo(hi + 0x5), vgmCommandInfo(hi + 0x6), vgmCommandInfo(hi + 0x7), \
+  vgmCommandInfo(hi + 0x8), vgmCommandInfo(hi + 0x9), vgmCommandInfo(hi + 0xA), vgmCommandInfo(hi + 0xB), \
+  vgmCommandInfo(hi + 0xC), vgmCommandInfo(hi + 0xD), vgmCommandInfo(hi + 0xE), vgmCommandInfo(hi + 0xF)
+
+static const uint8_t VGM_COMMAND_TABLE[256] GENESIS_PROGMEM = {
+  VGM_CMD_ROW(0x00), VGM_CMD_ROW(0x10), VGM_CMD_ROW(0x20), VGM_CMD_ROW(0x30),
+  VGM_CMD_ROW(0x40), VGM_CMD_ROW(0x50), VGM_CMD_ROW(0x60), VGM_CMD_ROW(0x70),
+  VGM_CMD_ROW(0x80), VGM_CMD_ROW(0x90), VGM_CMD_ROW(0xA0), VGM_CMD_ROW(0xB0),
+  VGM_CMD_ROW(0xC0), VGM_CMD_ROW(0xD0), VGM_CMD_ROW(0xE0), VGM_CMD_ROW(0xF0)
+};
+
+#undef VGM_CMD_ROW
+
+static inline uint8_t commandInfo(uint8_t cmd) {
+  return GENESIS_READ_BYTE(&VGM_COMMAND_TABLE[cmd]);
+}
+
+// Bytes processCommand() asks the source to have contiguous (covers every
+// fixed-length command, the longest being 0x68 with 11 argument bytes)
+static constexpr size_t VGM_MAX_BUFFERED_COMMAND = 12;
+
+// Read byte i of a span (PROGMEM spans need pgm_read_byte on AVR)
+static inline uint8_t spanByte(const VGMSpan& span, size_t i) {
+#if defined(PLATFORM_AVR)
+  return span.progmem ? GENESIS_READ_BYTE(span.data + i) : span.data[i];
+#else
+  return span.data[i];
+#endif
+}
+
+inline uint8_t VGMParser::attenuatePSG(uint8_t val) const {
+  // Apply PSG attenuation for FM+PSG mix
+  // PSG attenuation command format: 1cc1aaaa (bit 7=1, bit 4=1, bits 0-3=attenuation)
+  if (psgAttenuation_ > 0 && (val & 0x90) == 0x90) {
+    uint8_t currentAtten = val & 0x0F;
+    // If already silent (15), leave it. Otherwise increase but cap at 14.
+    if (currentAtten < 15) {
+      uint8_t newAtten = currentAtten + psgAttenuation_;
+      if (newAtten > 14) newAtten = 14;  // Don't silence, cap at 14
+      val = (val & 0xF0) | newAtten;
+    }
   }
+  return val;
+}
 
-  // -------------------------------------------------------------------------
-  // Wait 882 samples / 50Hz frame (0x63)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_WAIT_882) {
-    return VGM_WAIT_PAL;
+int32_t VGMParser::processDACRun(const VGMSpan& span) {
+  uint16_t limit = GENESIS_ENGINE_DAC_RUN_MAX;
+  if (outputQueue_) {
+    uint16_t room = outputQueue_->capacity() - outputQueue_->count();
+    if (room < limit) {
+      limit = room;
+    }
+  }
+  if (limit > span.length) {
+    limit = span.length;
   }
 
-  // -------------------------------------------------------------------------
-  // End of VGM data (0x66)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_END) {
-    return -1;
+  // Collect the waits - the board blocks for all but the last one
+  uint8_t waits[GENESIS_ENGINE_DAC_RUN_MAX];
+  uint8_t count = 0;
+  uint32_t total = 0;
+  while (count < limit) {
+    uint8_t cmd = spanByte(span, count);
+    if ((cmd & 0xF0) != VGM_CMD_DAC_WAIT_BASE ||
+        (!outputQueue_ && total > GENESIS_ENGINE_DAC_RUN_MAX_WAIT)) {
+      break;
+    }
+    waits[count++] = cmd & 0x0F;
+    total += cmd & 0x0F;
+  }
+  if (count < 2) {
+    return VGM_NOT_BUFFERED;
   }
 
-  // -------------------------------------------------------------------------
-  // Data block (0x67)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_DATA_BLOCK) {
-    handleDataBlock();
-    return 0;
+  // Straight from the bank's buffer when it holds the samples 1:1
+  uint8_t copy[GENESIS_ENGINE_DAC_RUN_MAX];
+  uint32_t available;
+  const uint8_t* samples = pcmDataBank_.contiguousSamples(available);
+  if (samples && available >= count) {
+    pcmDataBank_.seek(pcmDataBank_.getPosition() + count);
+  } else {
+    for (uint8_t i = 0; i < count; i++) {
+      copy[i] = pcmDataBank_.readByte();
+    }
+    samples = copy;
   }
 
-  // -------------------------------------------------------------------------
-  // Short wait (0x70-0x7F = wait 1-16 samples)
-  // -------------------------------------------------------------------------
-  if (cmd >= 0x70 && cmd <= 0x7F) {
-    return (cmd & 0x0F) + 1;
+  if (skipDAC_) {
+    GENESIS_PROFILE_DROPPED_DAC(count);
+  } else if (outputQueue_) {
+    // Stamp each sample with its own due time
+    uint32_t due = writeTime_;
+    for (uint8_t i = 0; i < count; i++) {
+      outputQueue_->push(REG_WRITE_DAC, 0, samples[i], due);
+      due += waits[i];
+    }
+  } else {
+    board_.writeDACRun(samples, waits, count);
   }
 
-  // -------------------------------------------------------------------------
-  // YM2612 DAC + wait (0x80-0x8F)
-  // -------------------------------------------------------------------------
-  if (cmd >= 0x80 && cmd <= 0x8F) {
-    // Write PCM sample from data bank
-    if (pcmDataBank_.hasData()) {
-      board_.writeDAC(pcmDataBank_.readByte());
+  source_->consume(count);
+  return total;
+}
+
+int32_t VGMParser::processBuffered(const VGMSpan& span) {
+  uint8_t cmd = spanByte(span, 0);
+  uint8_t info = commandInfo(cmd);
+  uint8_t length = info & 0x0F;
+
+  if ((size_t)length + 1 > span.length) {
+    return VGM_NOT_BUFFERED;  // Command runs past the buffer
+  }
+
+  switch (info >> 4) {
+    case VGM_CLASS_YM2612:
+      emitYM2612(cmd & 0x01, spanByte(span, 1), spanByte(span, 2));
+      source_->consume(3);
+      return 0;
+
+    case VGM_CLASS_DAC_WAIT: {
+      // Streams need every wait on its own to interleave their writes
+      if (pcmDataBank_.hasData() && !dacStreams_.isActive()) {
+        int32_t wait = processDACRun(span);
+        if (wait != VGM_NOT_BUFFERED) {
+          return wait;
+        }
+      }
+      if (pcmDataBank_.hasData()) {
+        emitDAC(pcmDataBank_.readByte());
+      }
+      source_->consume(1);
+      return cmd & 0x0F;
     }
-    // Return wait count (0-15 samples)
-    return cmd & 0x0F;
+
+    case VGM_CLASS_WAIT_SHORT:
+      source_->consume(1);
+      return (cmd & 0x0F) + 1;
+
+    case VGM_CLASS_PSG:
+      emitPSG(attenuatePSG(spanByte(span, 1)));
+      source_->consume(2);
+      return 0;
+
+    case VGM_CLASS_YM2612_2ND:
+      emitSecondYM2612(cmd & 0x01, spanByte(span, 1), spanByte(span, 2));
+      source_->consume(3);
+      return 0;
+
+    case VGM_CLASS_PSG_2ND:
+      emitSecondPSG(attenuatePSG(spanByte(span, 1)));
+      source_->consume(2);
+      return 0;
+
+    case VGM_CLASS_WAIT:
+      source_->consume(3);
+      return (uint16_t)spanByte(span, 1) | ((uint16_t)spanByte(span, 2) << 8);
+
+    case VGM_CLASS_WAIT_NTSC:
+      source_->consume(1);
+      return VGM_WAIT_NTSC;
+
+    case VGM_CLASS_WAIT_PAL:
+      source_->consume(1);
+      return VGM_WAIT_PAL;
+
+    case VGM_CLASS_PCM_SEEK:
+      pcmDataBank_.seek((uint32_t)spanByte(span, 1) |
+                        ((uint32_t)spanByte(span, 2) << 8) |
+                        ((uint32_t)spanByte(span, 3) << 16) |
+                        ((uint32_t)spanByte(span, 4) << 24));
+      source_->consume(5);
+      return 0;
+
+    case VGM_CLASS_OTHER_CHIP:
+      if (unsupportedCallback_) {
+        unsupportedCallback_(cmd, spanByte(span, 1), spanByte(span, 2));
+      }
+      source_->consume(3);
+      return 0;
+
+    case VGM_CLASS_DAC_STREAM: {
+      uint8_t args[VGM_MAX_BUFFERED_COMMAND];
+      for (uint8_t i = 0; i < length; i++) {
+        args[i] = spanByte(span, i + 1);
+      }
+      source_->consume(length + 1);
+      dacStreams_.command(cmd, args);
+      return 0;
+    }
+
+    case VGM_CLASS_SKIP:
+      // Fast skip - step over the whole command at once
+      source_->consume(length + 1);
+      return 0;
   }
 
-  // -------------------------------------------------------------------------
-  // PCM data seek (0xE0)
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_PCM_SEEK) {
-    uint32_t seekPos = source_->readUInt32();
-    pcmDataBank_.seek(seekPos);
-    return 0;
+  // End, data blocks and unknown commands
+  return VGM_NOT_BUFFERED;
+}
+
+int32_t VGMParser::processCommand() {
+  // Fast path: decode from the source's buffer without per-byte calls
+  VGMSpan span = source_->acquire(VGM_MAX_BUFFERED_COMMAND);
+  if (span.length > 0) {
+    int32_t result = processBuffered(span);
+    if (result != VGM_NOT_BUFFERED) {
+      return result;
+    }
   }
 
-  // -------------------------------------------------------------------------
-  // DAC stream commands (0x90-0x95) - skip for now
-  // These require more complex handling
-  // -------------------------------------------------------------------------
-  if (cmd >= 0x90 && cmd <= 0x95) {
-    skipCommand(cmd);
-    return 0;
+  int cmdByte = source_->read();
+  if (cmdByte < 0) {
+    return -1;  // End of data
   }
 
-  // -------------------------------------------------------------------------
-  // Unsupported chip writes - call callback or skip
-  // -------------------------------------------------------------------------
-  if (cmd == VGM_CMD_YM2413 || cmd == VGM_CMD_YM2151 || cmd == VGM_CMD_YM2203) {
-    uint8_t reg = source_->read();
-    uint8_t val = source_->read();
-    if (unsupportedCallback_) {
-      unsupportedCallback_(cmd, reg, val);
+  uint8_t cmd = (uint8_t)cmdByte;
+  uint8_t info = commandInfo(cmd);
+
+  switch (info >> 4) {
+    // -----------------------------------------------------------------------
+    // PSG Write (0x50)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_PSG: {
+      uint8_t val = source_->read();
+      emitPSG(attenuatePSG(val));
+      return 0;
     }
-    return 0;
+
+    // -----------------------------------------------------------------------
+    // YM2612 Port 0/1 Write (0x52/0x53)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_YM2612: {
+      uint8_t reg = source_->read();
+      uint8_t val = source_->read();
+      emitYM2612(cmd & 0x01, reg, val);
+      return 0;
+    }
+
+    // -----------------------------------------------------------------------
+    // Second chip of a dual-chip file (0x30, 0xA2/0xA3)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_PSG_2ND: {
+      uint8_t val = source_->read();
+      emitSecondPSG(attenuatePSG(val));
+      return 0;
+    }
+
+    case VGM_CLASS_YM2612_2ND: {
+      uint8_t reg = source_->read();
+      uint8_t val = source_->read();
+      emitSecondYM2612(cmd & 0x01, reg, val);
+      return 0;
+    }
+
+    // -----------------------------------------------------------------------
+    // Waits (0x61, 0x62, 0x63, 0x70-0x7F)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_WAIT:
+      return source_->readUInt16();
+
+    case VGM_CLASS_WAIT_NTSC:
+      return VGM_WAIT_NTSC;
+
+    case VGM_CLASS_WAIT_PAL:
+      return VGM_WAIT_PAL;
+
+    case VGM_CLASS_WAIT_SHORT:
+      return (cmd & 0x0F) + 1;
+
+    // -----------------------------------------------------------------------
+    // End of VGM data (0x66)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_END:
+      return -1;
+
+    // -----------------------------------------------------------------------
+    // Data block (0x67)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_DATA_BLOCK:
+      handleDataBlock();
+      return 0;
+
+    // -----------------------------------------------------------------------
+    // YM2612 DAC + wait (0x80-0x8F)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_DAC_WAIT:
+      // Write PCM sample from data bank
+      if (pcmDataBank_.hasData()) {
+        emitDAC(pcmDataBank_.readByte());
+      }
+      // Return wait count (0-15 samples)
+      return cmd & 0x0F;
+
+    // -----------------------------------------------------------------------
+    // PCM data seek (0xE0)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_PCM_SEEK:
+      pcmDataBank_.seek(source_->readUInt32());
+      return 0;
+
+    // -----------------------------------------------------------------------
+    // DAC stream control (0x90-0x95)
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_DAC_STREAM: {
+      uint8_t args[VGM_MAX_BUFFERED_COMMAND];
+      source_->read(args, info & 0x0F);
+      dacStreams_.command(cmd, args);
+      return 0;
+    }
+
+    // -----------------------------------------------------------------------
+    // Unsupported chip writes - call callback or skip
+    // -----------------------------------------------------------------------
+    case VGM_CLASS_OTHER_CHIP:
+      if (unsupportedCallback_) {
+        uint8_t reg = source_->read();
+        uint8_t val = source_->read();
+        unsupportedCallback_(cmd, reg, val);
+        return 0;
+      }
+      break;
   }
 
   // -------------------------------------------------------------------------
-  // Unknown command - try to skip it
+  // Other chips and unknown commands
   // -------------------------------------------------------------------------
   skipCommand(cmd);
   return 0;
 }
 
 // =============================================================================
-// Data Block Handling
+// GEC Frames
 // =============================================================================
 
-// Static callback wrapper for PCMDataBank::loadDataBlock
-static VGMSource* g_dataBlockSource = nullptr;
+uint32_t VGMParser::processGEC() {
+  if (gecAtStart_) {
+    gecLoadPCM();
+  }
+
+  GECFrame& frame = gecFrame_;
+  for (;;) {
+    if (!frame.open) {
+      uint8_t header[GEC_FRAME_HEADER_SIZE];
+      if (source_->read(header, sizeof(header)) != sizeof(header) ||
+          (header[0] | header[1] | header[2] | header[3] | header[4]) == 0) {
+        finished_ = true;  // Empty frame - end of data
+        return 0;
+      }
+      uint16_t word = (uint16_t)header[0] | ((uint16_t)header[1] << 8);
+      frame.wait = word & GEC_FRAME_WAIT_MASK;
+      frame.writes[GEC_GROUP_YM0] = header[2] & 0x0F;
+      frame.writes[GEC_GROUP_YM1] = header[2] >> 4;
+      frame.writes[GEC_GROUP_YM0_AFTER] = header[3] & 0x0F;
+      frame.writes[GEC_GROUP_PSG] = header[3] >> 4;
+      frame.dac = header[4];
+      frame.dacTimed = false;
+      frame.gapHigh = false;
+      if (word & GEC_FRAME_BANK_SEEK) {
+        pcmDataBank_.seek(source_->readUInt32());
+      }
+      frame.open = true;
+    }
+
+    if (!gecWrites()) {
+      return 0;
+    }
+
+    // DAC samples due now (gaps come after the writes)
+    uint32_t elapsed = 0;
+    if (frame.dac > 0) {
+      if (!frame.dacTimed) {
+        frame.dacWait = gecGap(0);
+        frame.dacTimed = true;
+      }
+      if (frame.dacWait == 0 && !gecDAC(elapsed)) {
+        return 0;
+      }
+    }
+
+    // Up to the end of the frame or the next DAC sample
+    uint32_t wait = frame.wait;
+    if (frame.dac > 0 && frame.dacWait < wait) {
+      wait = frame.dacWait;
+    }
+    frame.wait -= wait;
+    if (frame.dac > 0) {
+      frame.dacWait -= wait;
+    } else if (frame.wait == 0) {
+      frame.open = false;
+    }
+
+    if (elapsed + wait > 0) {
+      return elapsed + wait;
+    }
+    // Nothing left to wait for at this time - go on
+  }
+}
+
+bool VGMParser::gecWrites() {
+  for (uint8_t group = 0; group < GEC_GROUP_COUNT; group++) {
+    uint8_t& left = gecFrame_.writes[group];
+    uint8_t width = (group == GEC_GROUP_PSG) ? 1 : 2;
+    uint8_t port = (group == GEC_GROUP_YM1) ? 1 : 0;
+
+    while (left > 0) {
+      uint16_t count = left;
+      if (outputQueue_) {
+        uint16_t room = outputQueue_->capacity() - outputQueue_->count();
+        if (room == 0) {
+          return false;
+        }
+        if (room < count) {
+          count = room;
+        }
+      }
+
+      VGMSpan span = source_->acquire((size_t)count * width);
+      if (span.length >= width) {
+        // Straight from the source's buffer
+        if (span.length / width < count) {
+          count = span.length / width;
+        }
+        if (group == GEC_GROUP_PSG) {
+          for (uint16_t i = 0; i < count; i++) {
+            emitPSG(attenuatePSG(spanByte(span, i)));
+          }
+        } else {
+          for (uint16_t i = 0; i < count; i++) {
+            emitYM2612(port, spanByte(span, i * 2), spanByte(span, i * 2 + 1));
+          }
+        }
+        source_->consume((size_t)count * width);
+      } else {
+        count = 1;
+        if (group == GEC_GROUP_PSG) {
+          emitPSG(attenuatePSG(source_->read()));
+        } else {
+          uint8_t reg = source_->read();
+          uint8_t val = source_->read();
+          emitYM2612(port, reg, val);
+        }
+      }
+      left -= count;
+    }
+  }
+  return true;
+}
+
+bool VGMParser::gecDAC(uint32_t& elapsed) {
+  GECFrame& frame = gecFrame_;
+  uint16_t limit = GENESIS_ENGINE_DAC_RUN_MAX;
+  if (outputQueue_) {
+    uint16_t room = outputQueue_->capacity() - outputQueue_->count();
+    if (room == 0) {
+      return false;
+    }
+    if (room < limit) {
+      limit = room;
+    }
+  }
+  if (frame.dac < limit) {
+    limit = frame.dac;
+  }
+
+  // Gaps up to the next sample not played now - the board blocks for all
+  // of them but the last
+  uint8_t waits[GENESIS_ENGINE_DAC_RUN_MAX];
+  uint8_t count = 0;
+  elapsed = 0;
+  for (;;) {
+    bool more = frame.dac > count + 1;
+    uint8_t gap = more ? gecGap(elapsed) : 0;
+    waits[count++] = gap;
+    if (!more || count == limit ||
+        (!outputQueue_ && elapsed + gap > GENESIS_ENGINE_DAC_RUN_MAX_WAIT)) {
+      frame.dacWait = gap;
+      break;
+    }
+    elapsed += gap;
+  }
+
+  // Straight from the bank's buffer when it holds the samples 1:1
+  uint8_t copy[GENESIS_ENGINE_DAC_RUN_MAX];
+  uint32_t available;
+  const uint8_t* samples = pcmDataBank_.contiguousSamples(available);
+  if (samples && available >= count) {
+    pcmDataBank_.seek(pcmDataBank_.getPosition() + count);
+  } else {
+    for (uint8_t i = 0; i < count; i++) {
+      copy[i] = pcmDataBank_.readByte();
+    }
+    samples = copy;
+  }
+
+  if (skipDAC_) {
+    GENESIS_PROFILE_DROPPED_DAC(count);
+  } else if (outputQueue_) {
+    uint32_t due = writeTime_;
+    for (uint8_t i = 0; i < count; i++) {
+      outputQueue_->push(REG_WRITE_DAC, 0, samples[i], due);
+      due += waits[i];
+    }
+  } else if (count == 1) {
+    board_.writeDAC(samples[0]);
+  } else {
+    board_.writeDACRun(samples, waits, count);
+  }
+
+  frame.dac -= count;
+  frame.wait -= elapsed;
+  return true;
+}
+
+uint8_t VGMParser::gecGap(uint32_t elapsed) {
+  GECFrame& frame = gecFrame_;
+  uint8_t gap;
+  if (frame.gapHigh) {
+    gap = frame.gaps >> 4;
+  } else {
+    frame.gaps = source_->read();
+    gap = frame.gaps & 0x0F;
+  }
+  frame.gapHigh = !frame.gapHigh;
+
+  // A bad file can't leave samples past the end of the frame
+  if (gap > frame.wait - elapsed) {
+    gap = frame.wait - elapsed;
+  }
+  return gap;
+}
+
+void VGMParser::gecLoadPCM() {
+  gecAtStart_ = false;
+  if (gecPCMSize_ == 0) {
+    return;
+  }
+
+  // Kept from before a rewind() or seekNear()
+  if (pcmDataBank_.hasData()) {
+    source_->seek(gecPCMSize_);
+    return;
+  }
 
-static int dataBlockReadCallback(void* context) {
-  (void)context;
-  if (g_dataBlockSource) {
-    return g_dataBlockSource->read();
+  if (!pcmDataBank_.isDACDisabled()) {
+    pcmDataBank_.reserve(*source_, gecPCMSize_, 1);
   }
-  return -1;
+  pcmDataBank_.loadDataBlock(*source_, gecPCMSize_);
 }
 
+// =============================================================================
+// Data Block Handling
+// =============================================================================
+
 void VGMParser::handleDataBlock() {
   // Format: 0x67 0x66 tt ss ss ss ss [data]
   // tt = data type
@@ -362,11 +1080,23 @@ void VGMParser::handleDataBlock() {
 
   // Handle YM2612 PCM data (type 0x00)
   if (dataType == VGM_DATA_YM2612_PCM) {
+    // Size the arena from the blocks that follow the first one (or from
+    // the sizes a header cache had for this file)
+    if (!pcmDataBank_.hasData() && !pcmDataBank_.isDACDisabled()) {
+      uint32_t totalSize = pcmHintSize_;
+      uint16_t blockCount = pcmHintBlocks_;
+      if (blockCount == 0) {
+        totalSize = dataSize;
+        blockCount = 1;
+        scanDataBlocks(source_->position() + dataSize, totalSize, blockCount);
+      }
+      pcmDataBank_.reserve(*source_, totalSize, blockCount);
+    }
+
     // Use PCMDataBank to load the data
-    // It will automatically handle memory allocation and downsampling
-    g_dataBlockSource = source_;
-    pcmDataBank_.loadDataBlock(dataSize, dataBlockReadCallback, nullptr);
-    g_dataBlockSource = nullptr;
+    // It will automatically handle memory allocation, streaming from
+    // seekable sources and downsampling
+    pcmDataBank_.loadDataBlock(*source_, dataSize);
   } else {
     // Skip unsupported data block types
     Serial.print("Skipping unsupported data block type 0x");
@@ -377,68 +1107,41 @@ void VGMParser::handleDataBlock() {
   }
 }
 
+void VGMParser::scanDataBlocks(uint32_t pos, uint32_t& totalSize,
+                               uint16_t& blockCount) {
+  // Games put their samples in consecutive blocks at the start of the data,
+  // so follow the run of 0x67 commands from pos. Needs random access - on
+  // other sources the bank grows as blocks arrive.
+  uint8_t header[7];  // 0x67 0x66 tt ss ss ss ss
+  while (source_->readAt(pos, header, sizeof(header)) == sizeof(header) &&
+         header[0] == VGM_CMD_DATA_BLOCK && header[1] == 0x66) {
+    uint32_t size = (uint32_t)header[3] | ((uint32_t)header[4] << 8) |
+                    ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 24);
+    if (header[2] == VGM_DATA_YM2612_PCM && size > 0) {
+      totalSize += size;
+      blockCount++;
+    }
+    pos += sizeof(header) + size;
+  }
+}
+
 // =============================================================================
 // Skip Unknown Commands
 // =============================================================================
 
 void VGMParser::skipCommand(uint8_t cmd) {
-  // Determine how many bytes to skip based on command
-  // This is based on the VGM specification
-
-  // Single-byte commands (0x30-0x3F) - 1 data byte
-  if (cmd >= 0x30 && cmd <= 0x3F) {
-    source_->read();
+  // Argument length comes from the command table (VGM specification)
+  uint8_t info = commandInfo(cmd);
+  uint8_t length = info & 0x0F;
+
+  if ((info >> 4) == VGM_CLASS_UNKNOWN) {
+    // Unknown - skip nothing and hope for the best
+    GENESIS_DEBUG_PRINT("Unknown VGM command: ");
+    GENESIS_DEBUG_PRINTLN(cmd, HEX);
     return;
   }
 
-  // Two-byte commands (0x40-0x4E) - 2 data bytes
-  if (cmd >= 0x40 && cmd <= 0x4E) {
+  while (length-- > 0) {
     source_->read();
-    source_->read();
-    return;
   }
-
-  // 0x4F - Game Boy DMG (1 byte)
-  if (cmd == 0x4F) {
-    source_->read();
-    return;
-  }
-
-  // Chip writes (0x51-0x5F) - 2 data bytes each
-  if (cmd >= 0x51 && cmd <= 0x5F) {
-    source_->read();
-    source_->read();
-    return;
-  }
-
-  // DAC stream commands
-  if (cmd == 0x90) { source_->skip(4); return; }  // Setup stream
-  if (cmd == 0x91) { source_->skip(4); return; }  // Set data
-  if (cmd == 0x92) { source_->skip(5); return; }  // Set frequency
-  if (cmd == 0x93) { source_->skip(10); return; } // Start stream
-  if (cmd == 0x94) { source_->skip(1); return; }  // Stop stream
-  if (cmd == 0x95) { source_->skip(4); return; }  // Start stream fast
-
-  // Various 3-byte commands (0xA0-0xBF)
-  if (cmd >= 0xA0 && cmd <= 0xBF) {
-    source_->read();
-    source_->read();
-    return;
-  }
-
-  // 4-byte commands (0xC0-0xDF)
-  if (cmd >= 0xC0 && cmd <= 0xDF) {
-    source_->skip(3);
-    return;
-  }
-
-  // 5-byte commands (0xE1-0xFF)
-  if (cmd >= 0xE1 && cmd <= 0xFF) {
-    source_->skip(4);
-    return;
-  }
-
-  // Unknown - skip nothing and hope for the best
-  GENESIS_DEBUG_PRINT("Unknown VGM command: ");
-  GENESIS_DEBUG_PRINTLN(cmd, HEX);
 }
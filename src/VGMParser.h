@@ -2,15 +2,36 @@
 #define VGM_PARSER_H
 
 #include <Arduino.h>
+#include "config/feature_config.h"
 #include "VGMCommands.h"
+#include "GECFormat.h"
 #include "sources/VGMSource.h"
 #include "GenesisBoard.h"
 #include "PCMDataBank.h"
+#include "DACStreamControl.h"
+#include "RegisterWriteQueue.h"
 
 // =============================================================================
 // VGMParser - Parses and executes VGM commands
 // =============================================================================
 
+// Header fields of a VGM file, as kept by VGMInfoCache
+struct VGMFileInfo {
+  uint32_t version;
+  uint32_t totalSamples;
+  uint32_t loopSamples;
+  uint32_t loopOffset;      // Absolute loop position (0 = no loop)
+  uint32_t dataOffset;
+  uint32_t pcmSize;         // Combined size of the YM2612 PCM data blocks
+  uint16_t pcmBlocks;       // Blocks pcmSize covers (0 = none or not known yet)
+  uint8_t chips;            // VGM_INFO_YM2612 | VGM_INFO_SN76489 (| VGM_INFO_GEC)
+  char title[GENESIS_ENGINE_INFO_TITLE_LEN];  // GD3 track title ("" = unknown)
+};
+
+static constexpr uint8_t VGM_INFO_YM2612  = 0x01;
+static constexpr uint8_t VGM_INFO_SN76489 = 0x02;
+static constexpr uint8_t VGM_INFO_GEC     = 0x04;  // Compiled file (see GECFormat.h)
+
 // Callback for unsupported chip writes (for future expansion)
 typedef void (*UnsupportedChipCallback)(uint8_t cmd, uint8_t reg, uint8_t val);
 
@@ -24,11 +45,24 @@ public:
 
   // Set the data source
   void setSource(VGMSource* source);
+  VGMSource* getSource() const { return source_; }
 
   // Parse header and prepare for playback
-  // Returns true if valid VGM file for this hardware
+  // Returns true if valid VGM or GEC file for this hardware
   bool parseHeader();
 
+  // Prepare for playback from header fields cached earlier instead of
+  // reading them - the source only has to be opened
+  // Cached PCM sizes also size the data bank before the first block
+  // (GEC headers are small enough to be read again instead)
+  bool applyHeader(const VGMFileInfo& info);
+
+  // Header fields of the file just parsed, for caching
+  // With random access (not VGZ) this also reads the GD3 title and adds up
+  // the PCM blocks at the start of the data. Call right after
+  // parseHeader(), while source positions are still absolute.
+  void getFileInfo(VGMFileInfo& info);
+
   // -------------------------------------------------------------------------
   // Playback Control
   // -------------------------------------------------------------------------
@@ -37,7 +71,8 @@ public:
   void reset();
 
   // Process commands until a wait is encountered
-  // Returns number of samples to wait (0 = end of file or error)
+  // Returns number of samples to wait (0 = end of file, error, or the
+  // output queue is full - check isFinished() to tell them apart)
   uint32_t processUntilWait();
 
   // Check if playback has reached the end
@@ -53,6 +88,16 @@ public:
   // Get number of times the file has looped (0 = first play through)
   uint16_t getLoopCount() const { return loopCount_; }
 
+  // Seek back to the first command for a replay from the start
+  // PCM data blocks already loaded are kept and skipped on the way
+  bool rewind();
+
+  // Jump to the seek table entry at or before a sample (GEC files only)
+  // sample counts from the start of the file; reached is set to the sample
+  // the entry's frame starts at. Chip registers are not brought up to date.
+  // Returns false without a seek table or random access.
+  bool seekNear(uint32_t sample, uint32_t& reached);
+
   // -------------------------------------------------------------------------
   // File Information
   // -------------------------------------------------------------------------
@@ -65,6 +110,7 @@ public:
   uint32_t getVersion() const { return version_; }
   bool hasYM2612() const { return hasYM2612_; }
   bool hasSN76489() const { return hasSN76489_; }
+  bool isGEC() const { return gec_; }
 
   // -------------------------------------------------------------------------
   // PCM Data Bank (for DAC playback)
@@ -74,6 +120,35 @@ public:
   PCMDataBank& getPCMDataBank() { return pcmDataBank_; }
   const PCMDataBank& getPCMDataBank() const { return pcmDataBank_; }
 
+  // -------------------------------------------------------------------------
+  // Queued Output
+  // -------------------------------------------------------------------------
+
+  // Route chip writes into a queue instead of writing the board directly
+  // Pass nullptr to write the board immediately (default)
+  void setOutputQueue(RegisterWriteQueue* queue) { outputQueue_ = queue; }
+  RegisterWriteQueue* getOutputQueue() const { return outputQueue_; }
+
+  // Sample time stamped on queued writes
+  // Set before each processUntilWait() call - all writes up to the wait
+  // that ends the call are due at this sample
+  void setWriteTime(uint32_t sample) { writeTime_ = sample; }
+
+  // Drop DAC samples instead of writing them (catching up after a stall)
+  // The data bank still reads on, and DAC runs don't block.
+  void setSkipDAC(bool skip) { skipDAC_ = skip; }
+  bool isSkippingDAC() const { return skipDAC_; }
+
+  // -------------------------------------------------------------------------
+  // Second Chip
+  // -------------------------------------------------------------------------
+
+  // Board for the second YM2612 and SN76489 of dual-chip files (0xA2/0xA3,
+  // 0x30). Queued writes to it carry REG_WRITE_CHIP2. nullptr drops them
+  // (default).
+  void setSecondChip(GenesisBoard* board) { secondChip_ = board; }
+  GenesisBoard* getSecondChip() const { return secondChip_; }
+
   // -------------------------------------------------------------------------
   // Callbacks
   // -------------------------------------------------------------------------
@@ -85,6 +160,7 @@ public:
 
 private:
   GenesisBoard& board_;
+  GenesisBoard* secondChip_;   // Dual-chip writes (nullptr = dropped)
   VGMSource* source_;
 
   // Header info
@@ -94,10 +170,31 @@ private:
   uint32_t dataOffset_;
   uint32_t loopOffset_;        // Absolute loop position in file
   uint32_t loopOffsetInData_;  // Loop position relative to data start (for seeking)
+  uint32_t gd3Offset_;         // Absolute GD3 tag position (0 = none)
   bool hasLoop_;
   bool hasYM2612_;
   bool hasSN76489_;
 
+  // GEC files (gec_ = false for VGM)
+  bool gec_;
+  bool gecAtStart_;            // PCM data still ahead of the first frame
+  uint32_t gecPCMSize_;
+  uint32_t gecSeekOffset_;     // Relative to data start, like the loop offset
+  uint16_t gecSeekCount_;
+
+  // Frame being played (GEC) - kept across calls when the queue fills up
+  struct GECFrame {
+    uint16_t wait;             // Rest of the frame
+    uint8_t writes[GEC_GROUP_COUNT];  // Writes left per group
+    uint8_t dac;               // DAC samples left
+    uint8_t dacWait;           // Samples until the next one (if dacTimed)
+    bool dacTimed;             // Its gap has been read
+    uint8_t gaps;              // Byte of gaps being read
+    bool gapHigh;              // Its high nibble is next
+    bool open;                 // Header read, writes, samples or wait left
+  };
+  GECFrame gecFrame_;
+
   // Playback state
   bool finished_;
   uint16_t loopCount_;  // Number of times seekToLoop() has been called
@@ -107,6 +204,17 @@ private:
 
   // PCM data bank for DAC playback
   PCMDataBank pcmDataBank_;
+  uint32_t pcmHintSize_;    // PCM block sizes from applyHeader() (0 blocks = scan)
+  uint16_t pcmHintBlocks_;
+
+  // DAC streams (0x90-0x95) reading from pcmDataBank_
+  DACStreamControl dacStreams_;
+  uint32_t streamWaitLeft_;  // Rest of a wait split at stream writes
+
+  // Queued output (nullptr = write board directly)
+  RegisterWriteQueue* outputQueue_;
+  uint32_t writeTime_;
+  bool skipDAC_;
 
   // Callback
   UnsupportedChipCallback unsupportedCallback_;
@@ -120,9 +228,64 @@ private:
   // Returns -1 on end/error (sets finished_ flag)
   int32_t processCommand();
 
+  // Decode one command straight from the source's buffer (zero-copy)
+  // Returns VGM_NOT_BUFFERED without consuming anything if the command is
+  // variable-length or runs past the buffer; processCommand() then reads
+  // it bytewise
+  static constexpr int32_t VGM_NOT_BUFFERED = -2;
+  int32_t processBuffered(const VGMSpan& span);
+
+  // Decode a run of 0x8n commands at the start of the span in one go
+  // Returns the run's total wait, or VGM_NOT_BUFFERED if it is too short
+  int32_t processDACRun(const VGMSpan& span);
+
+  // Apply psgAttenuation_ to a PSG attenuation command
+  inline uint8_t attenuatePSG(uint8_t val) const;
+
+  // Chip writes - go to the output queue if set, else straight to the board
+  inline void emitYM2612(uint8_t port, uint8_t reg, uint8_t val);
+  inline void emitPSG(uint8_t val);
+  inline void emitDAC(uint8_t sample);
+  void emitSecondYM2612(uint8_t port, uint8_t reg, uint8_t val);
+  void emitSecondPSG(uint8_t val);
+
+  // Play stream writes inside the current wait, return the wait up to the
+  // next one
+  uint32_t streamWait();
+
+  // DACStreamControl write callback
+  static bool streamWrite(void* context, uint8_t port, uint8_t reg, uint8_t val);
+
   // Handle data block command (loads PCM data)
   void handleDataBlock();
 
+  // Add up the run of PCM blocks starting at pos (needs readAt())
+  void scanDataBlocks(uint32_t pos, uint32_t& totalSize, uint16_t& blockCount);
+
+  // Validate the header fields and seek to the data start
+  bool finishHeader();
+
+  // Read a GEC header (magic already checked)
+  bool parseGECHeader();
+
+  // processUntilWait() for GEC files
+  uint32_t processGEC();
+
+  // Play the writes left in the current frame
+  // Returns false if the queue filled up first
+  bool gecWrites();
+
+  // Play the DAC sample due now and those right after it
+  // Returns false if the queue is full, else sets the time they span
+  bool gecDAC(uint32_t& elapsed);
+
+  // Next DAC sample gap of the current frame (at most the rest of it)
+  uint8_t gecGap(uint32_t elapsed);
+
+  // Load the PCM data ahead of the first frame, or step over it if the
+  // bank already has it
+  void gecLoadPCM();
+
   // Skip unknown command
   void skipCommand(uint8_t cmd);
 };
@@ -38,13 +38,46 @@
   #endif
 #endif
 
+// Longest path GenesisEngine::enqueue() can hold for the next track
+#ifndef GENESIS_ENGINE_ENQUEUE_PATH_MAX
+  #define GENESIS_ENGINE_ENQUEUE_PATH_MAX 64
+#endif
+
+// Header cache (see GenesisEngine::setInfoCache): one record per file in a
+// cache file on the card, so starting and listing files skips header
+// parsing. Off on AVR, where the RAM index doesn't fit.
+#ifndef GENESIS_ENGINE_DISABLE_INFO_CACHE
+  #if GENESIS_ENGINE_USE_SD && !defined(PLATFORM_AVR)
+    #define GENESIS_ENGINE_USE_INFO_CACHE 1
+  #endif
+#endif
+
+// Ensure GENESIS_ENGINE_USE_INFO_CACHE is defined (as 0) if not enabled
+#ifndef GENESIS_ENGINE_USE_INFO_CACHE
+  #define GENESIS_ENGINE_USE_INFO_CACHE 0
+#endif
+
+#ifndef GENESIS_ENGINE_INFO_CACHE_PATH
+  #define GENESIS_ENGINE_INFO_CACHE_PATH "/vgminfo.bin"
+#endif
+
+// Records the cache can look up (4 bytes of RAM each)
+#ifndef GENESIS_ENGINE_INFO_CACHE_MAX
+  #define GENESIS_ENGINE_INFO_CACHE_MAX 512
+#endif
+
+// GD3 title characters kept per file (including the terminator)
+#ifndef GENESIS_ENGINE_INFO_TITLE_LEN
+  #define GENESIS_ENGINE_INFO_TITLE_LEN 32
+#endif
+
 // -----------------------------------------------------------------------------
 // VGZ Decompression (gzip)
 // Only on platforms with enough RAM for decompression buffer (~45KB)
 // -----------------------------------------------------------------------------
 #ifndef GENESIS_ENGINE_DISABLE_VGZ
   #if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3) || \
-      defined(PLATFORM_ESP32) || defined(PLATFORM_RP2040)
+      defined(PLATFORM_ESP32) || defined(PLATFORM_RP2040) || defined(PLATFORM_NATIVE)
     #define GENESIS_ENGINE_USE_VGZ 1
   #endif
 #endif
@@ -54,6 +87,37 @@
   #define GENESIS_ENGINE_USE_VGZ 0
 #endif
 
+// VGZ seek checkpoints (see VGZSource::setCheckpoints) cost ~33KB each in
+// RAM. When the limit is reached, every other one is dropped and the
+// interval doubles. PSRAM (Teensy 4.1) holds more; sidecar index files on
+// the SD card have no limit.
+#ifndef GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS
+  #if defined(PLATFORM_TEENSY4)
+    #define GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS 8
+  #else
+    #define GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS 2
+  #endif
+#endif
+#ifndef GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS_PSRAM
+  #define GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS_PSRAM 64
+#endif
+
+// VGZ prefetch (Teensy 4.1 with PSRAM): the whole file is inflated into
+// PSRAM, GENESIS_ENGINE_VGZ_PREFETCH_SLICE bytes per prefetch() ahead of
+// the playhead, and played from there. Seeks and loops are then free, and
+// a queued VGZ file is inflated before its turn comes.
+#ifndef GENESIS_ENGINE_DISABLE_VGZ_PREFETCH
+  #if defined(PLATFORM_TEENSY4) && GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
+    #define GENESIS_ENGINE_USE_VGZ_PREFETCH 1
+  #endif
+#endif
+#ifndef GENESIS_ENGINE_USE_VGZ_PREFETCH
+  #define GENESIS_ENGINE_USE_VGZ_PREFETCH 0
+#endif
+#ifndef GENESIS_ENGINE_VGZ_PREFETCH_SLICE
+  #define GENESIS_ENGINE_VGZ_PREFETCH_SLICE 16384
+#endif
+
 // -----------------------------------------------------------------------------
 // USB MIDI Support
 // Only on Teensy (native USB MIDI)
@@ -77,13 +141,248 @@
 // -----------------------------------------------------------------------------
 // Timer-based Accurate Timing
 // Uses IntervalTimer on Teensy for sample-accurate playback
+// Opt-in at runtime with GenesisEngine::setTimerDriven(true)
 // -----------------------------------------------------------------------------
-#if PLATFORM_HAS_INTERVAL_TIMER
-  #define GENESIS_ENGINE_USE_TIMER 1
-#else
+#ifndef GENESIS_ENGINE_DISABLE_TIMER
+  #if PLATFORM_HAS_INTERVAL_TIMER
+    #define GENESIS_ENGINE_USE_TIMER 1
+  #endif
+#endif
+
+// Ensure GENESIS_ENGINE_USE_TIMER is defined (as 0) if not enabled
+#ifndef GENESIS_ENGINE_USE_TIMER
   #define GENESIS_ENGINE_USE_TIMER 0
 #endif
 
+// -----------------------------------------------------------------------------
+// Dual-Core Playback
+// ESP32 only: one FreeRTOS task decodes on one core while another performs
+// bus writes on the other core
+// Opt-in at runtime with GenesisEngine::setDualCore(true)
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_DISABLE_DUAL_CORE
+  #if defined(PLATFORM_ESP32) && !defined(CONFIG_FREERTOS_UNICORE)
+    #define GENESIS_ENGINE_USE_DUAL_CORE 1
+  #endif
+#endif
+
+// Ensure GENESIS_ENGINE_USE_DUAL_CORE is defined (as 0) if not enabled
+#ifndef GENESIS_ENGINE_USE_DUAL_CORE
+  #define GENESIS_ENGINE_USE_DUAL_CORE 0
+#endif
+
+// Core running source I/O and VGM decoding (WiFi/BT also live on core 0)
+#ifndef GENESIS_ENGINE_DECODE_CORE
+  #define GENESIS_ENGINE_DECODE_CORE 0
+#endif
+
+// Core performing chip writes (Arduino's loop() also runs on core 1)
+#ifndef GENESIS_ENGINE_BUS_CORE
+  #define GENESIS_ENGINE_BUS_CORE 1
+#endif
+
+// Task priorities - the bus task must outrank loop() (priority 1)
+#ifndef GENESIS_ENGINE_DECODE_TASK_PRIORITY
+  #define GENESIS_ENGINE_DECODE_TASK_PRIORITY 2
+#endif
+#ifndef GENESIS_ENGINE_BUS_TASK_PRIORITY
+  #define GENESIS_ENGINE_BUS_TASK_PRIORITY 5
+#endif
+
+// Task stack sizes in bytes (decoding needs room for SD/VGZ calls)
+#ifndef GENESIS_ENGINE_DECODE_TASK_STACK
+  #define GENESIS_ENGINE_DECODE_TASK_STACK 8192
+#endif
+#ifndef GENESIS_ENGINE_BUS_TASK_STACK
+  #define GENESIS_ENGINE_BUS_TASK_STACK 4096
+#endif
+
+// -----------------------------------------------------------------------------
+// Register Write Queue
+// Pre-decoded writes waiting for their sample time (8 bytes per entry).
+// Must be a power of two. Only allocated while a queued mode is enabled.
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_QUEUE_SIZE
+  #if defined(PLATFORM_TEENSY4)
+    #define GENESIS_ENGINE_QUEUE_SIZE 2048
+  #elif defined(PLATFORM_TEENSY3) || defined(PLATFORM_ESP32) || defined(PLATFORM_NATIVE)
+    #define GENESIS_ENGINE_QUEUE_SIZE 1024
+  #elif defined(PLATFORM_RP2040) || defined(PLATFORM_SAM)
+    #define GENESIS_ENGINE_QUEUE_SIZE 512
+  #elif defined(PLATFORM_AVR) && defined(__AVR_ATmega2560__)
+    #define GENESIS_ENGINE_QUEUE_SIZE 64
+  #else
+    #define GENESIS_ENGINE_QUEUE_SIZE 32
+  #endif
+#endif
+
+// How far ahead of the playback clock the decoder may run (in samples)
+// Default is three 60Hz frames
+#ifndef GENESIS_ENGINE_QUEUE_LOOKAHEAD
+  #define GENESIS_ENGINE_QUEUE_LOOKAHEAD 2205
+#endif
+
+// Maximum writes the timer ISR performs per sample tick
+// Bounds ISR time so loop() keeps running during large write bursts
+#ifndef GENESIS_ENGINE_TIMER_WRITES_PER_TICK
+  #define GENESIS_ENGINE_TIMER_WRITES_PER_TICK 8
+#endif
+
+// -----------------------------------------------------------------------------
+// Synth Write Queue (see synth/GenesisSynth.h)
+// Register writes GenesisSynth holds per port until flush() (3 bytes each
+// with the key event list). A full queue flushes early.
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_SYNTH_QUEUE_SIZE
+  #if defined(PLATFORM_AVR) && !defined(__AVR_ATmega2560__)
+    #define GENESIS_SYNTH_QUEUE_SIZE 16
+  #else
+    #define GENESIS_SYNTH_QUEUE_SIZE 48
+  #endif
+#endif
+
+// Tick rate of the synth modulation engine (see synth/ModulationEngine.h).
+// Must be a multiple of 60, the rate PSG envelope steps are written at.
+#ifndef GENESIS_SYNTH_MOD_TICK_HZ
+  #define GENESIS_SYNTH_MOD_TICK_HZ 240
+#endif
+
+// Patch slots in an FMPatchBank (30 bytes each, see synth/FMPatchBank.h)
+#ifndef GENESIS_SYNTH_PATCH_SLOTS
+  #define GENESIS_SYNTH_PATCH_SLOTS 16
+#endif
+
+// FM patch library on the SD card (see synth/FMPatchLibrary.h): a directory
+// of TFI files behind an index file, loaded on demand. Off on AVR boards
+// smaller than the Mega, where the SD library leaves no room for the cache.
+#ifndef GENESIS_SYNTH_DISABLE_PATCH_LIBRARY
+  #if GENESIS_ENGINE_USE_SD && !(defined(PLATFORM_AVR) && !defined(__AVR_ATmega2560__))
+    #define GENESIS_SYNTH_USE_PATCH_LIBRARY 1
+  #endif
+#endif
+
+// Ensure GENESIS_SYNTH_USE_PATCH_LIBRARY is defined (as 0) if not enabled
+#ifndef GENESIS_SYNTH_USE_PATCH_LIBRARY
+  #define GENESIS_SYNTH_USE_PATCH_LIBRARY 0
+#endif
+
+#ifndef GENESIS_SYNTH_LIBRARY_INDEX_PATH
+  #define GENESIS_SYNTH_LIBRARY_INDEX_PATH "/patches.idx"
+#endif
+
+// Library patches kept in RAM (33 bytes each)
+#ifndef GENESIS_SYNTH_LIBRARY_CACHE
+  #if defined(PLATFORM_AVR)
+    #define GENESIS_SYNTH_LIBRARY_CACHE 8
+  #else
+    #define GENESIS_SYNTH_LIBRARY_CACHE 32
+  #endif
+#endif
+
+// -----------------------------------------------------------------------------
+// DAC Stream Control
+// Number of VGM DAC streams (0x90-0x95) tracked at once (~40 bytes each).
+// The YM2612 has one DAC, so files rarely use more than one stream.
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_DAC_STREAMS
+  #if defined(PLATFORM_AVR)
+    #define GENESIS_ENGINE_DAC_STREAMS 1
+  #else
+    #define GENESIS_ENGINE_DAC_STREAMS 4
+  #endif
+#endif
+
+// -----------------------------------------------------------------------------
+// Register Shadow
+// GenesisBoard records the last value of every chip register (~430 bytes),
+// which lets GenesisEngine::seekToSample() rebuild the chip state after a
+// silent fast-forward. Off on boards with 2KB of RAM.
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_USE_REGISTER_SHADOW
+  #if defined(PLATFORM_AVR) && !defined(__AVR_ATmega2560__)
+    #define GENESIS_ENGINE_USE_REGISTER_SHADOW 0
+  #else
+    #define GENESIS_ENGINE_USE_REGISTER_SHADOW 1
+  #endif
+#endif
+
+// Drop writes that would leave a register unchanged (VGM rips and emulator
+// streams rewrite the same levels and frequencies every frame). Key on/off,
+// timers, the DAC and PSG noise always reach the chips.
+#ifndef GENESIS_ENGINE_SKIP_REDUNDANT_WRITES
+  #define GENESIS_ENGINE_SKIP_REDUNDANT_WRITES 1
+#endif
+
+// -----------------------------------------------------------------------------
+// Bus Timing (microseconds, see GenesisBoard::setBusTiming)
+// Teensy needs the full busy waits; AVR GPIO is slow enough that it doesn't,
+// and its YM2612 writes skip the setup delay too. The YM2612 is busy for 83
+// cycles after a data write to 0x21-0x9E and 47 after 0xA0-0xB6; an address
+// write needs no more than the setup time. The BusBenchmark example measures
+// what a board gets with other values.
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_YM_BUSY_US
+  #if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+    #define GENESIS_ENGINE_YM_BUSY_US 5     // YM2612 busy after a data write
+  #else
+    #define GENESIS_ENGINE_YM_BUSY_US 0
+  #endif
+#endif
+#ifndef GENESIS_ENGINE_YM_CHANNEL_BUSY_US
+  #if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+    #define GENESIS_ENGINE_YM_CHANNEL_BUSY_US 3   // After 0xA0-0xB6 (47 of 83 cycles)
+  #else
+    #define GENESIS_ENGINE_YM_CHANNEL_BUSY_US 0
+  #endif
+#endif
+#ifndef GENESIS_ENGINE_YM_SETUP_US
+  #define GENESIS_ENGINE_YM_SETUP_US 4      // Data setup before WR_Y
+#endif
+// Longest wait for the busy bit on boards with status read-back
+#ifndef GENESIS_ENGINE_YM_BUSY_TIMEOUT_US
+  #define GENESIS_ENGINE_YM_BUSY_TIMEOUT_US 32
+#endif
+#ifndef GENESIS_ENGINE_PSG_PULSE_US
+  #define GENESIS_ENGINE_PSG_PULSE_US 8     // WR_P pulse width
+#endif
+#ifndef GENESIS_ENGINE_PSG_BUSY_US
+  #if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+    #define GENESIS_ENGINE_PSG_BUSY_US 9    // SN76489 write delay
+  #else
+    #define GENESIS_ENGINE_PSG_BUSY_US 0
+  #endif
+#endif
+
+// Boards mirrored on one board's bus (see GenesisBoard::addMirror)
+#ifndef GENESIS_ENGINE_MAX_MIRRORS
+  #define GENESIS_ENGINE_MAX_MIRRORS 3
+#endif
+
+// -----------------------------------------------------------------------------
+// Catch-up (see GenesisEngine::setCatchUp)
+// Writes this far behind the clock start a catch-up, which plays at most
+// CATCHUP_MAX samples of backlog and lets the clock slip past the rest
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_CATCHUP_LATE
+  #define GENESIS_ENGINE_CATCHUP_LATE 441     // 10ms
+#endif
+#ifndef GENESIS_ENGINE_CATCHUP_MAX
+  #define GENESIS_ENGINE_CATCHUP_MAX 11025    // 250ms
+#endif
+
+// -----------------------------------------------------------------------------
+// DAC Runs
+// Consecutive 0x8n commands are decoded together and written with the DAC
+// address latched. A run stops at this many commands, or once the board
+// would block for more than DAC_RUN_MAX_WAIT samples (direct playback).
+// -----------------------------------------------------------------------------
+#ifndef GENESIS_ENGINE_DAC_RUN_MAX
+  #define GENESIS_ENGINE_DAC_RUN_MAX 32
+#endif
+#ifndef GENESIS_ENGINE_DAC_RUN_MAX_WAIT
+  #define GENESIS_ENGINE_DAC_RUN_MAX_WAIT 64   // ~1.5ms
+#endif
+
 // -----------------------------------------------------------------------------
 // Buffer Sizes
 // Larger buffers on platforms with more RAM
@@ -91,7 +390,7 @@
 #ifndef GENESIS_ENGINE_BUFFER_SIZE
   #if defined(PLATFORM_TEENSY4)
     #define GENESIS_ENGINE_BUFFER_SIZE 8192
-  #elif defined(PLATFORM_TEENSY3) || defined(PLATFORM_ESP32)
+  #elif defined(PLATFORM_TEENSY3) || defined(PLATFORM_ESP32) || defined(PLATFORM_NATIVE)
     #define GENESIS_ENGINE_BUFFER_SIZE 4096
   #elif defined(PLATFORM_RP2040) || defined(PLATFORM_SAM)
     #define GENESIS_ENGINE_BUFFER_SIZE 2048
@@ -102,6 +401,46 @@
   #endif
 #endif
 
+// Most PROGMEM chunks playChunked() takes (4 bytes of RAM each for the
+// offset table). vgm2header.py makes 30KB chunks.
+#ifndef GENESIS_ENGINE_MAX_CHUNKS
+  #if defined(PLATFORM_AVR)
+    #define GENESIS_ENGINE_MAX_CHUNKS 8
+  #else
+    #define GENESIS_ENGINE_MAX_CHUNKS 255
+  #endif
+#endif
+
+// Chunk indices are 8-bit
+#if GENESIS_ENGINE_MAX_CHUNKS > 255
+  #error "GENESIS_ENGINE_MAX_CHUNKS must be 255 or less"
+#endif
+
+// Minimum wait (in samples) before update() lets the source read ahead
+// Keeps a block read from landing right before a write is due
+#ifndef GENESIS_ENGINE_PREFETCH_MIN_WAIT
+  #define GENESIS_ENGINE_PREFETCH_MIN_WAIT 441   // 10ms
+#endif
+
+// Slack sleepUntilDue() keeps for waking up (microseconds): the CPU only
+// idles if the next write is further away than the platform's wake
+// interval plus this, and shorter waits are spun out
+#ifndef GENESIS_ENGINE_IDLE_MARGIN_US
+  #define GENESIS_ENGINE_IDLE_MARGIN_US 20
+#endif
+
+// Window cache for PCM data blocks streamed from SD (when they don't fit RAM)
+// Each refill is one SD read, so larger windows mean fewer seeks
+#ifndef GENESIS_ENGINE_PCM_CACHE_SIZE
+  #if defined(PLATFORM_AVR) && defined(__AVR_ATmega2560__)
+    #define GENESIS_ENGINE_PCM_CACHE_SIZE 256
+  #elif defined(PLATFORM_AVR)
+    #define GENESIS_ENGINE_PCM_CACHE_SIZE 128
+  #else
+    #define GENESIS_ENGINE_PCM_CACHE_SIZE 512
+  #endif
+#endif
+
 // -----------------------------------------------------------------------------
 // Maximum VGM File Size for PROGMEM
 // Used by the converter tool to warn about large files
@@ -130,6 +469,23 @@
   #define GENESIS_DEBUG_PRINTF(...)
 #endif
 
+// -----------------------------------------------------------------------------
+// Profiling
+// Define GENESIS_ENGINE_PROFILE to time decoding, SD reads, VGZ inflate, PCM
+// loading and YM2612 writes, and count writes and late writes (see
+// GenesisEngine::getProfile). Compiled out otherwise.
+// -----------------------------------------------------------------------------
+#ifdef GENESIS_ENGINE_PROFILE
+  #define GENESIS_ENGINE_USE_PROFILING 1
+#else
+  #define GENESIS_ENGINE_USE_PROFILING 0
+#endif
+
+// Writes more than this many samples behind the clock count as an underrun
+#ifndef GENESIS_ENGINE_PROFILE_LATE_SAMPLES
+  #define GENESIS_ENGINE_PROFILE_LATE_SAMPLES 44   // ~1ms
+#endif
+
 // =============================================================================
 // Testing / Simulation Settings
 // Use these to test memory-constrained behavior on larger boards
@@ -58,6 +58,15 @@
   #define PLATFORM_HAS_LARGE_RAM 1
   #define PLATFORM_RAM_KB 96
 
+// Desktop build for the host tests (test/host): stub Arduino core, SD card
+// mapped to a directory, chips replaced by a write log
+#elif defined(GENESIS_ENGINE_NATIVE)
+  #define PLATFORM_NATIVE
+  #define PLATFORM_NAME "Native"
+  #define PLATFORM_HAS_NATIVE_USB 0
+  #define PLATFORM_HAS_LARGE_RAM 1
+  #define PLATFORM_RAM_KB 1024
+
 // Unknown platform - try to work anyway
 #else
   #define PLATFORM_UNKNOWN
@@ -78,6 +87,49 @@
   #define PLATFORM_HAS_INTERVAL_TIMER 0
 #endif
 
+// CPU cycle counter for sub-microsecond timing without micros() calls
+#if defined(PLATFORM_TEENSY4)
+  #define PLATFORM_HAS_CYCLE_COUNTER 1
+  #define PLATFORM_CYCLE_COUNT() (ARM_DWT_CYCCNT)
+  #define PLATFORM_CYCLES_PER_US() (F_CPU_ACTUAL / 1000000UL)
+#elif defined(PLATFORM_TEENSY3)
+  #define PLATFORM_HAS_CYCLE_COUNTER 1
+  #define PLATFORM_CYCLE_COUNT() (ARM_DWT_CYCCNT)
+  #define PLATFORM_CYCLES_PER_US() (F_CPU / 1000000UL)
+#elif defined(PLATFORM_ESP32)
+  #define PLATFORM_HAS_CYCLE_COUNTER 1
+  #define PLATFORM_CYCLE_COUNT() ((uint32_t)ESP.getCycleCount())
+  #define PLATFORM_CYCLES_PER_US() ((uint32_t)ESP.getCpuFreqMHz())
+#else
+  #define PLATFORM_HAS_CYCLE_COUNTER 0
+#endif
+
+// =============================================================================
+// CPU Idle
+// PLATFORM_IDLE() stops the CPU until the next interrupt. A periodic
+// interrupt fires at least every PLATFORM_IDLE_WAKE_US, so no idle lasts
+// longer than that.
+// =============================================================================
+
+#if defined(PLATFORM_TEENSY4) || defined(PLATFORM_TEENSY3)
+  #define PLATFORM_HAS_IDLE 1
+  #define PLATFORM_IDLE() __asm__ volatile("wfi")
+  #define PLATFORM_IDLE_WAKE_US 1000UL    // SysTick
+#elif defined(PLATFORM_ESP32)
+  // Blocks loop() for one RTOS tick: the idle task halts the core, or
+  // light-sleeps it when power management enables automatic light sleep
+  #define PLATFORM_HAS_IDLE 1
+  #define PLATFORM_IDLE() vTaskDelay(1)
+  #define PLATFORM_IDLE_WAKE_US (portTICK_PERIOD_MS * 1000UL)
+#elif defined(PLATFORM_AVR)
+  // Idle mode keeps timers, UART and SPI running (needs <avr/sleep.h>)
+  #define PLATFORM_HAS_IDLE 1
+  #define PLATFORM_IDLE() do { set_sleep_mode(SLEEP_MODE_IDLE); sleep_mode(); } while (0)
+  #define PLATFORM_IDLE_WAKE_US (64UL * 256UL * 1000000UL / F_CPU)  // Timer0 (millis)
+#else
+  #define PLATFORM_HAS_IDLE 0
+#endif
+
 // =============================================================================
 // PROGMEM Handling
 // =============================================================================
@@ -88,12 +140,14 @@
   #define GENESIS_READ_BYTE(addr) pgm_read_byte(addr)
   #define GENESIS_READ_WORD(addr) pgm_read_word(addr)
   #define GENESIS_READ_DWORD(addr) pgm_read_dword(addr)
+  #define GENESIS_READ_BLOCK(dst, addr, len) memcpy_P(dst, addr, len)
 #else
   // Other platforms can read from flash directly
   #define GENESIS_PROGMEM
   #define GENESIS_READ_BYTE(addr) (*(const uint8_t*)(addr))
   #define GENESIS_READ_WORD(addr) (*(const uint16_t*)(addr))
   #define GENESIS_READ_DWORD(addr) (*(const uint32_t*)(addr))
+  #define GENESIS_READ_BLOCK(dst, addr, len) memcpy(dst, addr, len)
 #endif
 
 #endif // GENESIS_ENGINE_PLATFORM_DETECT_H
@@ -1,37 +1,51 @@
 #ifndef CHUNKED_PROGMEM_SOURCE_H
 #define CHUNKED_PROGMEM_SOURCE_H
 
+#include <string.h>
 #include "VGMSource.h"
-#include "../config/platform_detect.h"
+#include "../config/feature_config.h"
 
 // =============================================================================
 // ChunkedProgmemSource - Read VGM data from multiple PROGMEM chunks
 //
 // Used on AVR (Mega) to work around the 32KB per-array PROGMEM limit.
 // Allows storing up to 200KB+ of VGM data across multiple arrays.
+//
+// The pointer and size tables are read from flash once: setData() builds
+// a table of chunk start offsets in RAM, and the current chunk's pointer
+// and remaining length are kept while reading, so byte reads cost the
+// same as ProgmemSource and seeks are a binary search.
 // =============================================================================
 
 class ChunkedProgmemSource : public VGMSource {
 public:
   ChunkedProgmemSource()
-    : chunks_(nullptr), chunkSizes_(nullptr), numChunks_(0), totalLength_(0),
-      pos_(0), currentChunk_(0), posInChunk_(0), dataStartOffset_(0), isOpen_(false) {}
+    : chunks_(nullptr), numChunks_(0), totalLength_(0),
+      pos_(0), currentChunk_(0), cursor_(nullptr), chunkLeft_(0),
+      dataStartOffset_(0), isOpen_(false) {
+    chunkStart_[0] = 0;
+  }
 
   // Set the chunked PROGMEM data to read from
   // chunks: PROGMEM array of pointers to chunk arrays
   // chunkSizes: PROGMEM array of chunk sizes
-  // numChunks: number of chunks
+  // numChunks: number of chunks (open() fails above GENESIS_ENGINE_MAX_CHUNKS)
   // totalLength: total size across all chunks
   void setData(const uint8_t* const* chunks, const uint16_t* chunkSizes,
-               uint8_t numChunks, uint32_t totalLength) {
+               uint16_t numChunks, uint32_t totalLength) {
     chunks_ = chunks;
-    chunkSizes_ = chunkSizes;
     numChunks_ = numChunks;
     totalLength_ = totalLength;
-    pos_ = 0;
-    currentChunk_ = 0;
-    posInChunk_ = 0;
     dataStartOffset_ = 0;
+
+    // Start offset of every chunk, plus the end of the last one
+    uint32_t offset = 0;
+    chunkStart_[0] = 0;
+    for (uint8_t i = 0; i < numChunks && i < GENESIS_ENGINE_MAX_CHUNKS; i++) {
+      offset += GENESIS_READ_WORD(&chunkSizes[i]);
+      chunkStart_[i + 1] = offset;
+    }
+    rewindChunks();
   }
 
   // Set the data start offset (called after parsing VGM header)
@@ -45,21 +59,17 @@ public:
   // -------------------------------------------------------------------------
 
   bool open() override {
-    if (chunks_ == nullptr || numChunks_ == 0) {
+    if (chunks_ == nullptr || numChunks_ == 0 || numChunks_ > GENESIS_ENGINE_MAX_CHUNKS) {
       return false;
     }
-    pos_ = 0;
-    currentChunk_ = 0;
-    posInChunk_ = 0;
+    rewindChunks();
     isOpen_ = true;
     return true;
   }
 
   void close() override {
     isOpen_ = false;
-    pos_ = 0;
-    currentChunk_ = 0;
-    posInChunk_ = 0;
+    rewindChunks();
   }
 
   bool isOpen() const override {
@@ -67,54 +77,66 @@ public:
   }
 
   int read() override {
-    if (!isOpen_ || pos_ >= totalLength_) {
+    if (!isOpen_ || pos_ >= totalLength_ || (chunkLeft_ == 0 && !nextChunk())) {
       return -1;
     }
 
-    // Get current chunk pointer and size from PROGMEM
-    const uint8_t* chunkPtr = (const uint8_t*)pgm_read_ptr(&chunks_[currentChunk_]);
-    uint16_t chunkSize = pgm_read_word(&chunkSizes_[currentChunk_]);
-
-    // Read byte from current position in chunk
-    uint8_t value = GENESIS_READ_BYTE(chunkPtr + posInChunk_);
-
-    // Advance position
     pos_++;
-    posInChunk_++;
-
-    // Move to next chunk if needed
-    if (posInChunk_ >= chunkSize && currentChunk_ < numChunks_ - 1) {
-      currentChunk_++;
-      posInChunk_ = 0;
-    }
-
-    return value;
+    chunkLeft_--;
+    return GENESIS_READ_BYTE(cursor_++);
   }
 
   size_t read(uint8_t* buffer, size_t length) override {
     if (!isOpen_) return 0;
 
+    // One block copy per chunk touched
     size_t bytesRead = 0;
     while (bytesRead < length && pos_ < totalLength_) {
-      int b = read();
-      if (b < 0) break;
-      buffer[bytesRead++] = (uint8_t)b;
+      if (chunkLeft_ == 0 && !nextChunk()) {
+        break;
+      }
+      size_t n = length - bytesRead;
+      if (n > chunkLeft_) n = chunkLeft_;
+      if (n > totalLength_ - pos_) n = totalLength_ - pos_;
+
+      GENESIS_READ_BLOCK(buffer + bytesRead, cursor_, n);
+      bytesRead += n;
+      advance(n);
     }
     return bytesRead;
   }
 
   int peek() override {
-    if (!isOpen_ || pos_ >= totalLength_) {
+    if (!isOpen_ || pos_ >= totalLength_ || (chunkLeft_ == 0 && !nextChunk())) {
       return -1;
     }
-    const uint8_t* chunkPtr = (const uint8_t*)pgm_read_ptr(&chunks_[currentChunk_]);
-    return GENESIS_READ_BYTE(chunkPtr + posInChunk_);
+    return GENESIS_READ_BYTE(cursor_);
   }
 
   bool available() override {
     return isOpen_ && pos_ < totalLength_;
   }
 
+  VGMSpan acquire(size_t minBytes) override {
+    (void)minBytes;
+    VGMSpan span = { nullptr, 0, true };
+    if (!isOpen_ || pos_ >= totalLength_ || (chunkLeft_ == 0 && !nextChunk())) {
+      return span;
+    }
+
+    // Only the rest of the current chunk is contiguous
+    span.data = cursor_;
+    span.length = chunkLeft_;
+    if (span.length > totalLength_ - pos_) {
+      span.length = totalLength_ - pos_;
+    }
+    return span;
+  }
+
+  void consume(size_t n) override {
+    advance(n);
+  }
+
   bool seek(uint32_t position) override {
     // If dataStartOffset_ is set, seek positions are relative to data start
     uint32_t absolutePos = dataStartOffset_ + position;
@@ -123,32 +145,16 @@ public:
       return false;
     }
 
-    // Find which chunk contains this position
-    uint32_t offset = 0;
-    for (uint8_t i = 0; i < numChunks_; i++) {
-      uint16_t chunkSize = pgm_read_word(&chunkSizes_[i]);
-      if (absolutePos < offset + chunkSize) {
-        currentChunk_ = i;
-        posInChunk_ = absolutePos - offset;
-        pos_ = absolutePos;
-        return true;
-      }
-      offset += chunkSize;
-    }
-
-    // Position is at the very end
-    if (absolutePos == totalLength_) {
-      currentChunk_ = numChunks_ - 1;
-      posInChunk_ = pgm_read_word(&chunkSizes_[currentChunk_]);
-      pos_ = absolutePos;
-      return true;
-    }
-
-    return false;
+    // The end of the data is the end of the last chunk
+    uint8_t chunk = findChunk(absolutePos);
+    loadChunk(chunk, absolutePos - chunkStart_[chunk]);
+    pos_ = absolutePos;
+    return true;
   }
 
   uint32_t position() const override {
-    return pos_;
+    // Relative to data start, consistent with seek()
+    return pos_ >= dataStartOffset_ ? pos_ - dataStartOffset_ : 0;
   }
 
   uint32_t size() const override {
@@ -159,15 +165,89 @@ public:
     return true;
   }
 
+  size_t readAt(uint32_t position, uint8_t* buffer, size_t length) override {
+    uint32_t absolutePos = dataStartOffset_ + position;
+    if (!isOpen_ || absolutePos >= totalLength_) {
+      return 0;
+    }
+    if (length > totalLength_ - absolutePos) {
+      length = totalLength_ - absolutePos;
+    }
+
+    // Copy from the chunk holding absolutePos onwards
+    size_t bytesRead = 0;
+    for (uint8_t i = findChunk(absolutePos); i < numChunks_ && bytesRead < length; i++) {
+      uint32_t offset = absolutePos - chunkStart_[i];
+      size_t n = chunkStart_[i + 1] - absolutePos;
+      if (n > length - bytesRead) n = length - bytesRead;
+
+      const uint8_t* chunkPtr = (const uint8_t*)pgm_read_ptr(&chunks_[i]);
+      GENESIS_READ_BLOCK(buffer + bytesRead, chunkPtr + offset, n);
+      bytesRead += n;
+      absolutePos += n;
+    }
+    return bytesRead;
+  }
+
 private:
+  // Point the cursor at offset bytes into a chunk
+  void loadChunk(uint8_t index, uint32_t offset) {
+    currentChunk_ = index;
+    cursor_ = (const uint8_t*)pgm_read_ptr(&chunks_[index]) + offset;
+    chunkLeft_ = (uint16_t)(chunkStart_[index + 1] - chunkStart_[index] - offset);
+  }
+
+  void rewindChunks() {
+    pos_ = 0;
+    if (chunks_ && numChunks_ > 0 && numChunks_ <= GENESIS_ENGINE_MAX_CHUNKS) {
+      loadChunk(0, 0);
+    } else {
+      currentChunk_ = 0;
+      cursor_ = nullptr;
+      chunkLeft_ = 0;
+    }
+  }
+
+  // Step past the end of the current chunk (skipping empty ones)
+  bool nextChunk() {
+    while (chunkLeft_ == 0 && currentChunk_ + 1 < numChunks_) {
+      loadChunk(currentChunk_ + 1, 0);
+    }
+    return chunkLeft_ > 0;
+  }
+
+  // n is never more than chunkLeft_
+  void advance(size_t n) {
+    pos_ += n;
+    cursor_ += n;
+    chunkLeft_ -= (uint16_t)n;
+  }
+
+  // Last chunk starting at or before position (with data, unless position
+  // is the end)
+  uint8_t findChunk(uint32_t position) const {
+    uint8_t lo = 0;
+    uint8_t hi = (uint8_t)(numChunks_ - 1);
+    while (lo < hi) {
+      uint8_t mid = (uint8_t)((lo + hi + 1) / 2);
+      if (chunkStart_[mid] <= position && chunkStart_[mid] < totalLength_) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    return lo;
+  }
+
   const uint8_t* const* chunks_;  // PROGMEM array of chunk pointers
-  const uint16_t* chunkSizes_;    // PROGMEM array of chunk sizes
-  uint8_t numChunks_;
+  uint16_t numChunks_;            // Wider than a chunk index, so open() can reject too many
   uint32_t totalLength_;
+  uint32_t chunkStart_[GENESIS_ENGINE_MAX_CHUNKS + 1];  // Offset of each chunk, then the end
 
   uint32_t pos_;                  // Absolute position in data
   uint8_t currentChunk_;          // Current chunk index
-  uint16_t posInChunk_;           // Position within current chunk
+  const uint8_t* cursor_;         // Next byte in the current chunk
+  uint16_t chunkLeft_;            // Bytes left in the current chunk
   uint32_t dataStartOffset_;      // Offset to VGM data start (for relative seeking)
   bool isOpen_;
 };
@@ -82,6 +82,16 @@ public:
     return isOpen_ && pos_ < length_;
   }
 
+  VGMSpan acquire(size_t minBytes) override {
+    (void)minBytes;
+    VGMSpan span = { data_ + pos_, isOpen_ ? length_ - pos_ : 0, true };
+    return span;
+  }
+
+  void consume(size_t n) override {
+    pos_ += n;
+  }
+
   bool seek(uint32_t position) override {
     // If dataStartOffset_ is set, seek positions are relative to data start
     uint32_t absolutePos = dataStartOffset_ + position;
@@ -93,7 +103,8 @@ public:
   }
 
   uint32_t position() const override {
-    return pos_;
+    // Relative to data start, consistent with seek()
+    return pos_ >= dataStartOffset_ ? pos_ - dataStartOffset_ : 0;
   }
 
   uint32_t size() const override {
@@ -104,6 +115,20 @@ public:
     return true;
   }
 
+  size_t readAt(uint32_t position, uint8_t* buffer, size_t length) override {
+    uint32_t absolutePos = dataStartOffset_ + position;
+    if (!isOpen_ || absolutePos >= length_) {
+      return 0;
+    }
+    if (length > length_ - absolutePos) {
+      length = length_ - absolutePos;
+    }
+    for (size_t i = 0; i < length; i++) {
+      buffer[i] = GENESIS_READ_BYTE(data_ + absolutePos + i);
+    }
+    return length;
+  }
+
 private:
   const uint8_t* data_;
   size_t length_;
@@ -1,4 +1,5 @@
 #include "SDSource.h"
+#include "../PlaybackProfiler.h"
 
 // Only compile if SD support is enabled
 #if GENESIS_ENGINE_USE_SD
@@ -11,9 +12,17 @@ SDSource::SDSource()
   : fileSize_(0),
     dataStartOffset_(0),
     isOpen_(false),
-    isVGZ_(false)
+    isVGZ_(false),
+    memoryArena_(nullptr),
+    buffer_(nullptr),
+    current_(0),
+    bufferPos_(0),
+    fileCursor_(0)
 {
   filename_[0] = '\0';
+  blocks_[0].data = nullptr;
+  blocks_[1].data = nullptr;
+  resetBuffers(0);
 }
 
 SDSource::~SDSource() {
@@ -49,6 +58,24 @@ bool SDSource::openFile(const char* path) {
     isVGZ_ = false;
   }
 
+  // Double buffer - playback still works unbuffered if this fails
+  if (!buffer_ && memoryArena_) {
+    buffer_ = memoryArena_->allocate(GENESIS_ENGINE_BUFFER_SIZE);
+  } else if (!buffer_) {
+#if defined(PLATFORM_AVR)
+    buffer_ = (uint8_t*)malloc(GENESIS_ENGINE_BUFFER_SIZE);
+#else
+    buffer_ = new (std::nothrow) uint8_t[GENESIS_ENGINE_BUFFER_SIZE];
+#endif
+  }
+  if (buffer_) {
+    GENESIS_PROFILE_ALLOC(GENESIS_ENGINE_BUFFER_SIZE);
+  }
+  blocks_[0].data = buffer_;
+  blocks_[1].data = buffer_ ? buffer_ + HALF_SIZE : nullptr;
+  fileCursor_ = 0;
+  resetBuffers(0);
+
   isOpen_ = true;
   return true;
 }
@@ -88,6 +115,8 @@ bool SDSource::open() {
 
   // Seek to beginning
   file_.seek(0);
+  fileCursor_ = 0;
+  resetBuffers(0);
   return true;
 }
 
@@ -100,6 +129,21 @@ void SDSource::close() {
     filename_[0] = '\0';
     isVGZ_ = false;
   }
+
+  if (buffer_ && memoryArena_ && memoryArena_->owns(buffer_)) {
+    memoryArena_->release(buffer_);
+    buffer_ = nullptr;
+  } else if (buffer_) {
+#if defined(PLATFORM_AVR)
+    free(buffer_);
+#else
+    delete[] buffer_;
+#endif
+    buffer_ = nullptr;
+  }
+  blocks_[0].data = nullptr;
+  blocks_[1].data = nullptr;
+  resetBuffers(0);
 }
 
 bool SDSource::isOpen() const {
@@ -110,28 +154,90 @@ int SDSource::read() {
   if (!isOpen_) {
     return -1;
   }
-  return file_.read();
+  if (!buffer_) {
+    GENESIS_PROFILE_SCOPE(SD_READ);
+    int value = file_.read();
+    if (value >= 0) {
+      GENESIS_PROFILE_SOURCE_BYTES(1);
+    }
+    return value;
+  }
+  if (bufferPos_ >= blocks_[current_].length && !nextBlock()) {
+    return -1;
+  }
+  return blocks_[current_].data[bufferPos_++];
 }
 
 size_t SDSource::read(uint8_t* buffer, size_t length) {
   if (!isOpen_) {
     return 0;
   }
-  return file_.read(buffer, length);
+  if (!buffer_) {
+    GENESIS_PROFILE_SCOPE(SD_READ);
+    int n = file_.read(buffer, length);
+    if (n <= 0) {
+      return 0;
+    }
+    GENESIS_PROFILE_SOURCE_BYTES(n);
+    return (size_t)n;
+  }
+
+  size_t total = 0;
+  while (total < length) {
+    if (bufferPos_ >= blocks_[current_].length && !nextBlock()) {
+      break;
+    }
+    const Block& block = blocks_[current_];
+    size_t chunk = block.length - bufferPos_;
+    if (chunk > length - total) {
+      chunk = length - total;
+    }
+    memcpy(buffer + total, block.data + bufferPos_, chunk);
+    bufferPos_ += chunk;
+    total += chunk;
+  }
+  return total;
 }
 
 int SDSource::peek() {
   if (!isOpen_) {
     return -1;
   }
-  return file_.peek();
+  if (!buffer_) {
+    return file_.peek();
+  }
+  if (bufferPos_ >= blocks_[current_].length && !nextBlock()) {
+    return -1;
+  }
+  return blocks_[current_].data[bufferPos_];
 }
 
 bool SDSource::available() {
   if (!isOpen_) {
     return false;
   }
-  return file_.available() > 0;
+  if (!buffer_) {
+    return file_.available() > 0;
+  }
+  return filePosition() < fileSize_;
+}
+
+VGMSpan SDSource::acquire(size_t minBytes) {
+  (void)minBytes;
+  VGMSpan span = { nullptr, 0, false };
+  if (!isOpen_ || !buffer_) {
+    return span;
+  }
+  if (bufferPos_ >= blocks_[current_].length && !nextBlock()) {
+    return span;
+  }
+  span.data = blocks_[current_].data + bufferPos_;
+  span.length = blocks_[current_].length - bufferPos_;
+  return span;
+}
+
+void SDSource::consume(size_t n) {
+  bufferPos_ += n;
 }
 
 bool SDSource::seek(uint32_t pos) {
@@ -141,7 +247,138 @@ bool SDSource::seek(uint32_t pos) {
   // If dataStartOffset_ is set, seek positions are relative to data start
   // Convert to absolute file position
   uint32_t absolutePos = dataStartOffset_ + pos;
-  return file_.seek(absolutePos);
+  if (!buffer_) {
+    return file_.seek(absolutePos);
+  }
+  if (absolutePos > fileSize_) {
+    return false;
+  }
+
+  // Stay in the buffers if the target is already loaded (e.g. short loops)
+  for (uint8_t i = 0; i < 2; i++) {
+    const Block& block = blocks_[current_ ^ i];
+    if (absolutePos >= block.start && absolutePos < block.start + block.length) {
+      current_ ^= i;
+      bufferPos_ = absolutePos - block.start;
+      return true;
+    }
+  }
+
+  resetBuffers(absolutePos);
+  return true;
+}
+
+size_t SDSource::readAt(uint32_t pos, uint8_t* buffer, size_t length) {
+  if (!isOpen_) {
+    return 0;
+  }
+  uint32_t absolutePos = dataStartOffset_ + pos;
+  if (absolutePos >= fileSize_) {
+    return 0;
+  }
+  GENESIS_PROFILE_SCOPE(SD_READ);
+
+  // Unbuffered - put the file position back for the next read()
+  if (!buffer_) {
+    uint32_t resume = file_.position();
+    int n = file_.seek(absolutePos) ? file_.read(buffer, length) : 0;
+    file_.seek(resume);
+    if (n <= 0) {
+      return 0;
+    }
+    GENESIS_PROFILE_SOURCE_BYTES(n);
+    return (size_t)n;
+  }
+
+  // Buffered - the blocks stay valid, loadBlock() seeks back when needed
+  if (fileCursor_ != absolutePos) {
+    if (!file_.seek(absolutePos)) {
+      return 0;
+    }
+    fileCursor_ = absolutePos;
+  }
+  int n = file_.read(buffer, length);
+  if (n <= 0) {
+    return 0;
+  }
+  GENESIS_PROFILE_SOURCE_BYTES(n);
+  fileCursor_ += n;
+  return (size_t)n;
+}
+
+bool SDSource::prefetch() {
+  if (!isOpen_ || !buffer_) {
+    return false;
+  }
+
+  // Idle half already holds the next block, or there is nothing left
+  const Block& block = blocks_[current_];
+  Block& idle = blocks_[current_ ^ 1];
+  uint32_t nextStart = block.start + block.length;
+  if ((idle.length > 0 && idle.start == nextStart) || nextStart >= fileSize_) {
+    return false;
+  }
+
+  return loadBlock(idle, nextStart);
+}
+
+// =============================================================================
+// Buffer Management
+// =============================================================================
+
+bool SDSource::nextBlock() {
+  const Block& block = blocks_[current_];
+  uint32_t nextStart = block.start + block.length;
+  Block& idle = blocks_[current_ ^ 1];
+
+  // Normally prefetch() has already read it
+  if (idle.length == 0 || idle.start != nextStart) {
+    GENESIS_PROFILE_STALL();
+    if (!loadBlock(idle, nextStart)) {
+      return false;
+    }
+  }
+
+  current_ ^= 1;
+  bufferPos_ = 0;
+  return true;
+}
+
+bool SDSource::loadBlock(Block& block, uint32_t position) {
+  block.start = position;
+  block.length = 0;
+  if (position >= fileSize_) {
+    return false;
+  }
+  GENESIS_PROFILE_SCOPE(SD_READ);
+
+  if (fileCursor_ != position) {
+    if (!file_.seek(position)) {
+      return false;
+    }
+    fileCursor_ = position;
+  }
+
+  // Stop at the next HALF_SIZE boundary (whole sectors once aligned)
+  uint16_t toRead = HALF_SIZE - (uint16_t)(position % HALF_SIZE);
+  int n = file_.read(block.data, toRead);
+  if (n <= 0) {
+    return false;
+  }
+  GENESIS_PROFILE_SOURCE_BYTES(n);
+  block.length = (uint16_t)n;
+  fileCursor_ += n;
+  return true;
+}
+
+void SDSource::resetBuffers(uint32_t position) {
+  // Empty current block at position - the next read loads from there
+  current_ = 0;
+  bufferPos_ = 0;
+  blocks_[0].start = position;
+  blocks_[0].length = 0;
+  blocks_[1].start = 0;
+  blocks_[1].length = 0;
 }
 
 uint32_t SDSource::position() const {
@@ -149,7 +386,7 @@ uint32_t SDSource::position() const {
     return 0;
   }
   // Return position relative to data start (consistent with seek())
-  uint32_t absPos = file_.position();
+  uint32_t absPos = filePosition();
   if (absPos >= dataStartOffset_) {
     return absPos - dataStartOffset_;
   }
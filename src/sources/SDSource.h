@@ -7,6 +7,7 @@
 #if GENESIS_ENGINE_USE_SD
 
 #include "VGMSource.h"
+#include "../MemoryArena.h"
 #include <SD.h>
 
 // =============================================================================
@@ -29,6 +30,10 @@ public:
   // Check if file is VGZ (compressed)
   bool isVGZ() const { return isVGZ_; }
 
+  // Take the double buffer from an arena instead of the heap (nullptr =
+  // heap). Applies from the next openFile().
+  void setMemoryArena(MemoryArena* arena) { memoryArena_ = arena; }
+
   // Set the data start offset (called after parsing VGM header)
   // After this, seek positions are relative to data start
   void setDataStart(uint32_t dataOffset) {
@@ -48,13 +53,21 @@ public:
   int peek() override;
   bool available() override;
 
+  VGMSpan acquire(size_t minBytes) override;
+  void consume(size_t n) override;
+
   bool seek(uint32_t position) override;
   uint32_t position() const override;
   uint32_t size() const override;
   bool canSeek() const override { return true; }
+  size_t readAt(uint32_t position, uint8_t* buffer, size_t length) override;
+
+  // Read the next file block into the idle buffer half
+  // Called by GenesisEngine while it is waiting between commands
+  bool prefetch() override;
 
 private:
-  File file_;
+  mutable File file_;  // SD.h File::position() isn't const
   // AVR: Use short buffer to save RAM (8.3 names only)
   // Other platforms: Support long filenames
 #if defined(PLATFORM_AVR)
@@ -67,8 +80,40 @@ private:
   bool isOpen_;
   bool isVGZ_;
 
+  // Double buffer - GENESIS_ENGINE_BUFFER_SIZE bytes split in two halves,
+  // allocated by openFile(). One half is being read while prefetch() fills
+  // the other with the next file block. Without it every byte is a
+  // File::read() call.
+  static constexpr uint16_t HALF_SIZE = GENESIS_ENGINE_BUFFER_SIZE / 2;
+  struct Block {
+    uint8_t* data;
+    uint32_t start;           // Absolute file position of data[0]
+    uint16_t length;          // Valid bytes (0 = empty)
+  };
+  MemoryArena* memoryArena_;
+  uint8_t* buffer_;
+  Block blocks_[2];
+  uint8_t current_;           // Block being read
+  uint16_t bufferPos_;        // Next byte to read in the current block
+  uint32_t fileCursor_;       // Where the next File::read() will start
+
   // Extract filename from path
   void extractFilename(const char* path);
+
+  // Load the block following the current one (from prefetch if ready)
+  bool nextBlock();
+
+  // Read the file block starting at position into block
+  // Reads up to the next HALF_SIZE boundary so later reads stay aligned
+  bool loadBlock(Block& block, uint32_t position);
+
+  // Forget buffered data (next read starts at position)
+  void resetBuffers(uint32_t position);
+
+  // Absolute file position of the next byte to read
+  uint32_t filePosition() const {
+    return buffer_ ? blocks_[current_].start + bufferPos_ : (uint32_t)file_.position();
+  }
 };
 
 #endif // GENESIS_ENGINE_USE_SD
@@ -8,6 +8,13 @@
 // Allows playback from PROGMEM, SD card, serial, etc.
 // =============================================================================
 
+// Contiguous run of source bytes returned by VGMSource::acquire()
+struct VGMSpan {
+  const uint8_t* data;  // First byte at the current position
+  size_t length;        // Bytes readable at data (0 = not available)
+  bool progmem;         // data is in PROGMEM (read with GENESIS_READ_BYTE on AVR)
+};
+
 class VGMSource {
 public:
   virtual ~VGMSource() {}
@@ -45,13 +52,30 @@ public:
   // Check if more data is available
   virtual bool available() = 0;
 
+  // -------------------------------------------------------------------------
+  // Zero-copy access (optional - sources with an internal buffer)
+  // -------------------------------------------------------------------------
+
+  // Get the bytes at the current position without copying them
+  // Tries to make at least minBytes contiguous, but may return fewer near
+  // the end of data or at a buffer boundary. Returns length 0 if the source
+  // has no buffer to expose. Nothing is consumed until consume() is called.
+  virtual VGMSpan acquire(size_t minBytes) {
+    (void)minBytes;
+    VGMSpan span = { nullptr, 0, false };
+    return span;
+  }
+
+  // Advance past n bytes of the last acquire() (n <= span length)
+  virtual void consume(size_t n) { (void)n; }
+
   // -------------------------------------------------------------------------
   // Seeking (optional - not all sources support this)
   // -------------------------------------------------------------------------
 
   // Seek to absolute position
   // Returns true if seek succeeded
-  virtual bool seek(uint32_t position) { return false; }
+  virtual bool seek(uint32_t position) { (void)position; return false; }
 
   // Get current position
   virtual uint32_t position() const { return 0; }
@@ -62,6 +86,24 @@ public:
   // Check if source supports seeking
   virtual bool canSeek() const { return false; }
 
+  // Read length bytes at position (same space as seek()) without moving
+  // the current read position
+  // Returns number of bytes read (0 if random access is not supported)
+  virtual size_t readAt(uint32_t position, uint8_t* buffer, size_t length) {
+    (void)position;
+    (void)buffer;
+    (void)length;
+    return 0;
+  }
+
+  // -------------------------------------------------------------------------
+  // Background work (optional)
+  // -------------------------------------------------------------------------
+
+  // Read ahead while the player has nothing else to do
+  // Returns true if any work was done
+  virtual bool prefetch() { return false; }
+
   // -------------------------------------------------------------------------
   // Utility
   // -------------------------------------------------------------------------
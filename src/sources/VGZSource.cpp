@@ -1,18 +1,46 @@
 #include "VGZSource.h"
+#include "../PlaybackProfiler.h"
 
 #if GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
 
 #include <string.h>
 
-// Global pointer for uzlib callback
-VGZSource* g_streamingVGZSource = nullptr;
+// Checkpoint images go to PSRAM when a Teensy 4.1 has it fitted
+#if defined(PLATFORM_TEENSY4)
+extern "C" uint8_t external_psram_size;
+extern "C" void* extmem_malloc(size_t size);
+extern "C" void extmem_free(void* ptr);
+#define VGZ_USE_PSRAM 1
+#endif
+
+// Whole files are inflated into PSRAM ahead of playback
+#if GENESIS_ENGINE_USE_VGZ_PREFETCH && defined(VGZ_USE_PSRAM)
+#define VGZ_IN_MEMORY 1
+#endif
+
+// Sidecar index is appended to (FILE_WRITE truncates on ESP32)
+#if defined(FILE_APPEND)
+  #define VGZ_INDEX_APPEND FILE_APPEND
+#else
+  #define VGZ_INDEX_APPEND FILE_WRITE
+#endif
+
+static bool hasPSRAM() {
+#if defined(VGZ_USE_PSRAM)
+  return external_psram_size > 0;
+#else
+  return false;
+#endif
+}
 
 // =============================================================================
 // Constructor / Destructor
 // =============================================================================
 
 VGZSource::VGZSource()
-  : isOpen_(false)
+  : memoryArena_(nullptr)
+  , fileSize_(0)
+  , isOpen_(false)
   , buffer_(nullptr)
   , compressedBuffer_(nullptr)
   , dictBuffer_(nullptr)
@@ -21,10 +49,25 @@ VGZSource::VGZSource()
   , bufferSize_(0)
   , currentDataPos_(0)
   , dataStartReached_(false)
+  , dataStartOffset_(0)
+  , prefetch_(GENESIS_ENGINE_USE_VGZ_PREFETCH)
+  , inMemory_(false)
+  , inflatedSize_(0)
   , loopOffsetInData_(0)
+  , checkpoints_(nullptr)
+  , checkpointCount_(0)
+  , checkpointCapacity_(0)
+  , checkpointLimit_(0)
+  , checkpointKB_(0)
+  , useSidecar_(false)
+  , checkpointInterval_(0)
+  , nextCheckpointPos_(0)
+  , spareImages_(nullptr)
 {
   filename_[0] = '\0';
-  memset(&decompressor_, 0, sizeof(decompressor_));
+  indexPath_[0] = '\0';
+  memset(&decompressor_, 0, sizeof(uzlib_uncomp));
+  decompressor_.owner = this;
   memset(&loopSnapshot_, 0, sizeof(loopSnapshot_));
   loopSnapshot_.valid = false;
   loopSnapshot_.dictCopy = nullptr;
@@ -45,9 +88,6 @@ bool VGZSource::openFile(const char* path) {
   Serial.print("VGZSource: Opening ");
   Serial.println(path);
 
-  // Set global pointer for callback
-  g_streamingVGZSource = this;
-
   // Open file
   file_ = SD.open(path, FILE_READ);
   if (!file_) {
@@ -66,13 +106,17 @@ bool VGZSource::openFile(const char* path) {
     file_.close();
     return false;
   }
+  fileSize_ = compressedSize;
 
-  // Allocate buffers
-  buffer_ = new uint8_t[BUFFER_SIZE];
-  compressedBuffer_ = new uint8_t[COMPRESSED_BUFFER_SIZE];
-  dictBuffer_ = new uint8_t[DICT_SIZE];
+  // Allocate buffers - the whole file if it can be inflated into memory
+  inMemory_ = prefetch_ && allocateStream();
+  if (!inMemory_) {
+    buffer_ = allocateBuffer(BUFFER_SIZE);
+    dictBuffer_ = allocateBuffer(DICT_SIZE);
+  }
+  compressedBuffer_ = allocateBuffer(COMPRESSED_BUFFER_SIZE);
 
-  if (!buffer_ || !compressedBuffer_ || !dictBuffer_) {
+  if (!buffer_ || !compressedBuffer_ || (!inMemory_ && !dictBuffer_)) {
     Serial.println("VGZSource: Failed to allocate buffers");
     close();
     return false;
@@ -80,21 +124,64 @@ bool VGZSource::openFile(const char* path) {
 
   Serial.println("VGZSource: Buffers allocated");
 
-  // Initialize decompressor with dictionary
-  memset(&decompressor_, 0, sizeof(decompressor_));
-  uzlib_uncompress_init(&decompressor_, dictBuffer_, DICT_SIZE);
+  if (!startDecompressor()) {
+    close();
+    return false;
+  }
+
+  Serial.println("VGZSource: Gzip header parsed OK");
+
+  // Decompress initial data to fill buffer
+  if (inMemory_) {
+    inflateAhead(BUFFER_SIZE);
+  }
+  while (!inMemory_ && (size_t)(decompressor_.dest - buffer_) < BUFFER_SIZE / 2) {
+    int res = uzlib_uncompress(&decompressor_);
+    if (res == TINF_DONE) break;
+    if (res != TINF_OK) {
+      Serial.print("VGZSource: Decompression failed, res=");
+      Serial.println(res);
+      close();
+      return false;
+    }
+  }
+
+  bufferSize_ = decompressor_.dest - buffer_;
+  bufferPos_ = 0;
+  currentDataPos_ = 0;
+  isOpen_ = true;
+
+  Serial.print("VGZSource: Decompressed ");
+  Serial.print(bufferSize_);
+  Serial.println(" bytes initially");
+
+  initCheckpoints(path);
+
+  return true;
+}
+
+bool VGZSource::startDecompressor() {
+  decompressorActive_ = false;
 
   // Read initial compressed chunk
+  if (!file_.seek(0)) {
+    return false;
+  }
   size_t bytesRead = file_.read(compressedBuffer_, COMPRESSED_BUFFER_SIZE);
-  Serial.print("VGZSource: Read ");
-  Serial.print(bytesRead);
-  Serial.println(" bytes");
-
   if (bytesRead < 18) {
     Serial.println("VGZSource: Initial read too small");
-    close();
     return false;
   }
+  GENESIS_PROFILE_SOURCE_BYTES(bytesRead);
+
+  // Initialize decompressor with dictionary (in memory, matches are
+  // copied from the output itself)
+  memset(&decompressor_, 0, sizeof(uzlib_uncomp));
+  if (inMemory_) {
+    uzlib_uncompress_init(&decompressor_, nullptr, 0);
+  } else {
+    uzlib_uncompress_init(&decompressor_, dictBuffer_, DICT_SIZE);
+  }
 
   // Set up source for decompressor with callback
   decompressor_.source = compressedBuffer_;
@@ -111,35 +198,13 @@ bool VGZSource::openFile(const char* path) {
   if (res != TINF_OK) {
     Serial.print("VGZSource: Failed to parse gzip header, res=");
     Serial.println(res);
-    close();
     return false;
   }
 
-  Serial.println("VGZSource: Gzip header parsed OK");
-
   decompressorActive_ = true;
-
-  // Decompress initial data to fill buffer
-  while ((size_t)(decompressor_.dest - buffer_) < BUFFER_SIZE / 2) {
-    res = uzlib_uncompress(&decompressor_);
-    if (res == TINF_DONE) break;
-    if (res != TINF_OK) {
-      Serial.print("VGZSource: Decompression failed, res=");
-      Serial.println(res);
-      close();
-      return false;
-    }
-  }
-
-  bufferSize_ = decompressor_.dest - buffer_;
   bufferPos_ = 0;
+  bufferSize_ = 0;
   currentDataPos_ = 0;
-  isOpen_ = true;
-
-  Serial.print("VGZSource: Decompressed ");
-  Serial.print(bufferSize_);
-  Serial.println(" bytes initially");
-
   return true;
 }
 
@@ -172,48 +237,38 @@ bool VGZSource::open() {
 }
 
 void VGZSource::close() {
-  // Clear global pointer
-  if (g_streamingVGZSource == this) {
-    g_streamingVGZSource = nullptr;
-  }
-
   if (file_) {
     file_.close();
   }
 
   // Free buffers
-  if (buffer_) {
-    delete[] buffer_;
-    buffer_ = nullptr;
-  }
-  if (compressedBuffer_) {
-    delete[] compressedBuffer_;
-    compressedBuffer_ = nullptr;
-  }
-  if (dictBuffer_) {
-    delete[] dictBuffer_;
-    dictBuffer_ = nullptr;
+  if (inMemory_) {
+    freeStream();
   }
+  freeBuffer(buffer_);
+  freeBuffer(compressedBuffer_);
+  freeBuffer(dictBuffer_);
 
   // Free loop snapshot
-  if (loopSnapshot_.dictCopy) {
-    delete[] loopSnapshot_.dictCopy;
-    loopSnapshot_.dictCopy = nullptr;
-  }
-  if (loopSnapshot_.savedBufferData) {
-    delete[] loopSnapshot_.savedBufferData;
-    loopSnapshot_.savedBufferData = nullptr;
-  }
+  freeBuffer(loopSnapshot_.dictCopy);
+  freeBuffer(loopSnapshot_.savedBufferData);
+
+  freeCheckpoints();
+  checkpointInterval_ = 0;
+  indexPath_[0] = '\0';
 
   isOpen_ = false;
+  inMemory_ = false;
+  inflatedSize_ = 0;
   decompressorActive_ = false;
   bufferPos_ = 0;
   bufferSize_ = 0;
   currentDataPos_ = 0;
   dataStartReached_ = false;
+  dataStartOffset_ = 0;
   loopSnapshot_.valid = false;
   filename_[0] = '\0';
-  memset(&decompressor_, 0, sizeof(decompressor_));
+  memset(&decompressor_, 0, sizeof(uzlib_uncomp));
 }
 
 bool VGZSource::isOpen() const {
@@ -283,64 +338,138 @@ bool VGZSource::available() {
   if (bufferPos_ < bufferSize_) return true;
 
   // Try to refill
-  return refillBuffer() && bufferSize_ > 0;
+  return refillBuffer() && bufferPos_ < bufferSize_;
+}
+
+VGMSpan VGZSource::acquire(size_t minBytes) {
+  (void)minBytes;
+  VGMSpan span = { nullptr, 0, false };
+  if (!isOpen_) return span;
+
+  if (bufferPos_ >= bufferSize_ && !refillBuffer()) {
+    return span;
+  }
+
+  // Capture loop snapshot BEFORE reading at loop point
+  if (loopOffsetInData_ > 0 &&
+      !loopSnapshot_.valid &&
+      currentDataPos_ == loopOffsetInData_) {
+    captureLoopSnapshot();
+  }
+
+  span.data = buffer_ + bufferPos_;
+  span.length = bufferSize_ - bufferPos_;
+
+  // Stop at the loop point so its snapshot is taken at the right position
+  if (loopOffsetInData_ > currentDataPos_ && !loopSnapshot_.valid &&
+      loopOffsetInData_ - currentDataPos_ < span.length) {
+    span.length = loopOffsetInData_ - currentDataPos_;
+  }
+
+  return span;
+}
+
+void VGZSource::consume(size_t n) {
+  bufferPos_ += n;
+  currentDataPos_ += n;
 }
 
 bool VGZSource::seek(uint32_t position) {
   if (!isOpen_) return false;
 
-  // Seeking within current buffer (backward or forward within buffer bounds)
-  if (position < bufferSize_ && currentDataPos_ <= bufferSize_) {
-    // Simple case: position is within the initial buffer we still have
+  // Seeking within current buffer (either direction)
+  int64_t bufferStart = (int64_t)currentDataPos_ - (int64_t)bufferPos_;
+  if ((int64_t)position >= bufferStart &&
+      (int64_t)position < bufferStart + (int64_t)bufferSize_) {
+    bufferPos_ = (size_t)((int64_t)position - bufferStart);
     currentDataPos_ = position;
-    bufferPos_ = position;
     return true;
   }
+  if (position == currentDataPos_) {
+    return true;
+  }
+
+  int checkpoint = findCheckpoint(position);
 
-  // Forward seeking by reading and discarding bytes
-  // This is used when seeking to dataOffset_ which may be past the initial buffer
-  // (e.g., files with large PCM data blocks in the header)
   if (position > currentDataPos_) {
+    // Forward seeking by reading and discarding bytes
+    // This is used when seeking to dataOffset_ which may be past the initial buffer
+    // (e.g., files with large PCM data blocks in the header)
     Serial.print("VGZSource: Seeking forward from ");
     Serial.print(currentDataPos_);
     Serial.print(" to ");
     Serial.println(position);
 
-    while (currentDataPos_ < position) {
-      // Read and discard bytes
-      if (bufferPos_ >= bufferSize_) {
-        if (!refillBuffer()) {
-          Serial.println("VGZSource: Failed to refill during forward seek");
-          return false;
-        }
-      }
+    // Start from a checkpoint past this buffer instead (sidecar index)
+    if (checkpoint >= 0 &&
+        checkpoints_[checkpoint].dataPos > currentDataPos_ + (bufferSize_ - bufferPos_) &&
+        !restoreCheckpoint(checkpoint) && !rewind()) {
+      return false;
+    }
+    return skipTo(position);
+  }
+
+  // Seeking backward: restore the nearest saved state at or before the
+  // position (loop snapshot or checkpoint), or start over
+  bool restored = false;
+  if (loopSnapshot_.valid && loopOffsetInData_ <= position &&
+      (checkpoint < 0 || checkpoints_[checkpoint].dataPos <= loopOffsetInData_)) {
+    restored = restoreLoopSnapshot();
+  } else if (checkpoint >= 0) {
+    restored = restoreCheckpoint(checkpoint);
+  }
+
+  if (!restored) {
+    Serial.print("VGZSource: No checkpoint before ");
+    Serial.print(position);
+    Serial.println(", inflating from start");
+    if (!rewind()) {
+      return false;
+    }
+  }
 
-      // Skip as many bytes as possible in current buffer
-      uint32_t toSkip = position - currentDataPos_;
-      uint32_t available = bufferSize_ - bufferPos_;
-      if (toSkip > available) {
-        toSkip = available;
+  return skipTo(position);
+}
+
+bool VGZSource::skipTo(uint32_t position) {
+  while (currentDataPos_ < position) {
+    // Read and discard bytes
+    if (bufferPos_ >= bufferSize_) {
+      if (!refillBuffer()) {
+        Serial.println("VGZSource: Failed to refill during forward seek");
+        return false;
       }
+    }
 
-      bufferPos_ += toSkip;
-      currentDataPos_ += toSkip;
+    // Skip as many bytes as possible in current buffer
+    uint32_t toSkip = position - currentDataPos_;
+    uint32_t available = bufferSize_ - bufferPos_;
+    if (toSkip > available) {
+      toSkip = available;
     }
 
-    return true;
+    bufferPos_ += toSkip;
+    currentDataPos_ += toSkip;
+  }
+
+  return true;
+}
+
+bool VGZSource::rewind() {
+  if (!startDecompressor()) {
+    return false;
   }
 
-  // Seeking to loop point via snapshot (for looping playback)
-  if (loopOffsetInData_ > 0 && position == loopOffsetInData_ && loopSnapshot_.valid) {
-    return restoreLoopSnapshot();
+  if (dataStartReached_) {
+    // Positions are absolute until the data start
+    dataStartReached_ = false;
+    bool ok = skipTo(dataStartOffset_);
+    dataStartReached_ = true;
+    currentDataPos_ = 0;
+    return ok;
   }
 
-  // Cannot seek backwards to arbitrary positions in compressed stream
-  Serial.print("VGZSource: Cannot seek backward to position ");
-  Serial.print(position);
-  Serial.print(" (current=");
-  Serial.print(currentDataPos_);
-  Serial.println(")");
-  return false;
+  return true;
 }
 
 // =============================================================================
@@ -351,6 +480,19 @@ bool VGZSource::refillBuffer() {
   if (!decompressorActive_) {
     return false;
   }
+  GENESIS_PROFILE_SCOPE(VGZ_REFILL);
+
+  // In memory the output is appended - the playhead caught up with prefetch()
+  if (inMemory_) {
+    GENESIS_PROFILE_STALL();
+    inflateAhead(BUFFER_SIZE);
+    return bufferPos_ < bufferSize_;
+  }
+
+  // The decompressor is at a buffer boundary - save a checkpoint if due
+  if (checkpointInterval_ > 0 && dataStartReached_) {
+    captureCheckpoint();
+  }
 
   // Reset output buffer
   decompressor_.dest = buffer_;
@@ -372,6 +514,120 @@ bool VGZSource::refillBuffer() {
   return bufferSize_ > 0;
 }
 
+bool VGZSource::prefetch() {
+  if (!inMemory_ || !decompressorActive_) {
+    return false;
+  }
+  return inflateAhead(GENESIS_ENGINE_VGZ_PREFETCH_SLICE);
+}
+
+// =============================================================================
+// In Memory
+// =============================================================================
+
+bool VGZSource::allocateStream() {
+#if defined(VGZ_IN_MEMORY)
+  // The gzip trailer ends with the inflated size (modulo 4GB)
+  uint8_t trailer[4];
+  if (!file_.seek(fileSize_ - 4) || file_.read(trailer, 4) != 4) {
+    return false;
+  }
+  uint32_t size = (uint32_t)trailer[0] | ((uint32_t)trailer[1] << 8) |
+                  ((uint32_t)trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+  if (size < 64 || size > (uint32_t)external_psram_size * 1024UL * 1024UL) {
+    return false;
+  }
+
+  if (memoryArena_) {
+    buffer_ = memoryArena_->isPSRAM() ? memoryArena_->allocate(size) : nullptr;
+  } else if (hasPSRAM()) {
+    buffer_ = (uint8_t*)extmem_malloc(size);
+  }
+  if (!buffer_) {
+    Serial.println("VGZSource: No PSRAM for the whole file, streaming it");
+    return false;
+  }
+  GENESIS_PROFILE_ALLOC(size);
+  inflatedSize_ = size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void VGZSource::freeStream() {
+#if defined(VGZ_IN_MEMORY)
+  if (buffer_ && !(memoryArena_ && memoryArena_->owns(buffer_))) {
+    extmem_free(buffer_);
+    buffer_ = nullptr;
+  }
+#endif
+  freeBuffer(buffer_);
+}
+
+bool VGZSource::inflateAhead(size_t bytes) {
+  if (!decompressorActive_) {
+    return false;
+  }
+
+  size_t room = inflatedSize_ - (size_t)(decompressor_.dest - buffer_);
+  if (bytes > room) {
+    bytes = room;
+  }
+  decompressor_.dest_limit = decompressor_.dest + bytes;
+
+  while (decompressor_.dest < decompressor_.dest_limit) {
+    int res = uzlib_uncompress(&decompressor_);
+    if (res != TINF_OK) {
+      // TINF_DONE, or a damaged file that ends here
+      break;
+    }
+  }
+
+  bufferSize_ = decompressor_.dest - buffer_;
+  if (decompressor_.dest < decompressor_.dest_limit || bufferSize_ == inflatedSize_) {
+    finishInflate();
+  }
+  return true;
+}
+
+void VGZSource::finishInflate() {
+  // Everything is in memory - the card and the read buffer aren't needed
+  decompressorActive_ = false;
+  if (file_) {
+    file_.close();
+  }
+  freeBuffer(compressedBuffer_);
+  Serial.print("VGZSource: Inflated ");
+  Serial.print(bufferSize_);
+  Serial.println(" bytes into memory");
+}
+
+// =============================================================================
+// Buffers
+// =============================================================================
+
+uint8_t* VGZSource::allocateBuffer(size_t size) {
+  uint8_t* buffer = memoryArena_ ? memoryArena_->allocate(size)
+                                 : new (std::nothrow) uint8_t[size];
+  if (buffer) {
+    GENESIS_PROFILE_ALLOC(size);
+  }
+  return buffer;
+}
+
+void VGZSource::freeBuffer(uint8_t*& buffer) {
+  if (!buffer) {
+    return;
+  }
+  if (memoryArena_ && memoryArena_->owns(buffer)) {
+    memoryArena_->release(buffer);
+  } else {
+    delete[] buffer;
+  }
+  buffer = nullptr;
+}
+
 // =============================================================================
 // Loop Snapshot
 // =============================================================================
@@ -389,12 +645,12 @@ void VGZSource::captureLoopSnapshot() {
   loopSnapshot_.decompressedDataPos = currentDataPos_;
 
   // Copy decompressor state
-  memcpy(&loopSnapshot_.decompressorState, &decompressor_, sizeof(decompressor_));
+  memcpy(&loopSnapshot_.decompressorState, &decompressor_, sizeof(uzlib_uncomp));
 
   // Copy dictionary
   if (decompressor_.dict_ring && decompressor_.dict_size > 0) {
     if (!loopSnapshot_.dictCopy) {
-      loopSnapshot_.dictCopy = new uint8_t[decompressor_.dict_size];
+      loopSnapshot_.dictCopy = allocateBuffer(decompressor_.dict_size);
     }
     if (loopSnapshot_.dictCopy) {
       memcpy(loopSnapshot_.dictCopy, decompressor_.dict_ring, decompressor_.dict_size);
@@ -406,7 +662,7 @@ void VGZSource::captureLoopSnapshot() {
   size_t bytesRemaining = bufferSize_ - bufferPos_;
   if (bytesRemaining > 0) {
     if (!loopSnapshot_.savedBufferData) {
-      loopSnapshot_.savedBufferData = new uint8_t[bytesRemaining];
+      loopSnapshot_.savedBufferData = allocateBuffer(bytesRemaining);
     }
     if (loopSnapshot_.savedBufferData) {
       memcpy(loopSnapshot_.savedBufferData, buffer_ + bufferPos_, bytesRemaining);
@@ -434,12 +690,13 @@ bool VGZSource::restoreLoopSnapshot() {
   if (bytesRead <= 0) {
     return false;
   }
+  GENESIS_PROFILE_SOURCE_BYTES(bytesRead);
 
   // Save dict pointer before restoring state
   uint8_t* savedDictPtr = decompressor_.dict_ring;
 
   // Restore decompressor state
-  memcpy(&decompressor_, &loopSnapshot_.decompressorState, sizeof(decompressor_));
+  memcpy(&decompressor_, &loopSnapshot_.decompressorState, sizeof(uzlib_uncomp));
 
   // Fix up pointers
   decompressor_.dict_ring = savedDictPtr;
@@ -483,12 +740,383 @@ bool VGZSource::restoreLoopSnapshot() {
   return true;
 }
 
+// =============================================================================
+// Seek Checkpoints
+// =============================================================================
+
+void VGZSource::initCheckpoints(const char* path) {
+  // In memory every position is already at hand
+  if (checkpointKB_ == 0 || inMemory_) {
+    return;
+  }
+
+  checkpointInterval_ = (uint32_t)checkpointKB_ * 1024;
+  nextCheckpointPos_ = 0;
+  bool psram = memoryArena_ ? memoryArena_->isPSRAM() : hasPSRAM();
+  checkpointLimit_ = psram ? GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS_PSRAM
+                           : GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS;
+
+  if (useSidecar_) {
+    // song.vgz -> song.vgi
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+      if (*p == '/' || *p == '\\') {
+        name = p + 1;
+      }
+    }
+    const char* dot = strrchr(name, '.');
+    size_t stem = dot ? (size_t)(dot - path) : strlen(path);
+
+    if (stem + 5 <= sizeof(indexPath_)) {
+      memcpy(indexPath_, path, stem);
+      strcpy(indexPath_ + stem, ".vgi");
+      checkpointLimit_ = 0xFFFF;
+
+      if (!loadIndex()) {
+        freeCheckpoints();
+        if (!createIndex()) {
+          Serial.println("VGZSource: Can't write index, checkpoints kept in RAM");
+          indexPath_[0] = '\0';
+          checkpointLimit_ = hasPSRAM() ? GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS_PSRAM
+                                        : GENESIS_ENGINE_VGZ_MAX_CHECKPOINTS;
+        }
+      }
+    } else {
+      Serial.println("VGZSource: Path too long for index, checkpoints kept in RAM");
+    }
+  }
+
+  if (checkpointCount_ > 0) {
+    nextCheckpointPos_ = checkpoints_[checkpointCount_ - 1].dataPos + checkpointInterval_;
+    Serial.print("VGZSource: ");
+    Serial.print(checkpointCount_);
+    Serial.println(" checkpoints loaded from index");
+  }
+}
+
+void VGZSource::freeCheckpoints() {
+  for (uint16_t i = 0; i < checkpointCount_; i++) {
+    freeImage(checkpoints_[i]);
+  }
+  while (spareImages_) {
+    uint8_t* image = spareImages_;
+    memcpy(&spareImages_, image, sizeof(spareImages_));
+    memoryArena_->release(image);
+  }
+  if (checkpoints_ && memoryArena_ && memoryArena_->owns(checkpoints_)) {
+    memoryArena_->release(checkpoints_);
+    checkpoints_ = nullptr;
+  } else if (checkpoints_) {
+    delete[] checkpoints_;
+    checkpoints_ = nullptr;
+  }
+  checkpointCount_ = 0;
+  checkpointCapacity_ = 0;
+}
+
+bool VGZSource::loadIndex() {
+  File index = SD.open(indexPath_, FILE_READ);
+  if (!index) {
+    return false;
+  }
+
+  IndexHeader header;
+  uint32_t recordBytes = index.size() > sizeof(header) ? index.size() - sizeof(header) : 0;
+  bool valid = index.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+               memcmp(header.magic, "VGI1", 4) == 0 &&
+               header.compressedSize == file_.size() &&
+               header.interval == checkpointInterval_ &&
+               header.recordSize == CHECKPOINT_RECORD_SIZE &&
+               recordBytes % CHECKPOINT_RECORD_SIZE == 0;
+
+  // Only the positions are kept in RAM - the state is read on restore
+  uint32_t records = valid ? recordBytes / CHECKPOINT_RECORD_SIZE : 0;
+  for (uint32_t i = 0; valid && i < records; i++) {
+    uint32_t pos[2];
+    valid = index.seek(sizeof(header) + i * CHECKPOINT_RECORD_SIZE) &&
+            index.read((uint8_t*)pos, sizeof(pos)) == sizeof(pos) &&
+            (checkpointCount_ == 0 || pos[0] > checkpoints_[checkpointCount_ - 1].dataPos) &&
+            addCheckpoint(pos[0], pos[1], nullptr, false);
+  }
+
+  index.close();
+  return valid;
+}
+
+bool VGZSource::createIndex() {
+  if (SD.exists(indexPath_)) {
+    SD.remove(indexPath_);
+  }
+
+  File index = SD.open(indexPath_, VGZ_INDEX_APPEND);
+  if (!index) {
+    return false;
+  }
+
+  IndexHeader header;
+  memcpy(header.magic, "VGI1", 4);
+  header.compressedSize = file_.size();
+  header.interval = checkpointInterval_;
+  header.recordSize = CHECKPOINT_RECORD_SIZE;
+  bool ok = index.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+  index.close();
+  return ok;
+}
+
+bool VGZSource::addCheckpoint(uint32_t dataPos, uint32_t compressedPos,
+                              uint8_t* image, bool psram) {
+  if (checkpointCount_ == checkpointCapacity_) {
+    if (checkpointCapacity_ >= checkpointLimit_) {
+      return false;
+    }
+    uint32_t capacity = checkpointCapacity_ ? (uint32_t)checkpointCapacity_ * 2 : 16;
+    if (capacity > checkpointLimit_) {
+      capacity = checkpointLimit_;
+    }
+    Checkpoint* grown = memoryArena_
+        ? (Checkpoint*)memoryArena_->allocate(capacity * sizeof(Checkpoint))
+        : new (std::nothrow) Checkpoint[capacity];
+    if (!grown) {
+      return false;
+    }
+    GENESIS_PROFILE_ALLOC(capacity * sizeof(Checkpoint));
+    if (checkpoints_) {
+      memcpy(grown, checkpoints_, checkpointCount_ * sizeof(Checkpoint));
+      if (memoryArena_ && memoryArena_->owns(checkpoints_)) {
+        memoryArena_->release(checkpoints_);
+      } else {
+        delete[] checkpoints_;
+      }
+    }
+    checkpoints_ = grown;
+    checkpointCapacity_ = (uint16_t)capacity;
+  }
+
+  Checkpoint& checkpoint = checkpoints_[checkpointCount_++];
+  checkpoint.dataPos = dataPos;
+  checkpoint.compressedPos = compressedPos;
+  checkpoint.image = image;
+  checkpoint.psram = psram;
+  return true;
+}
+
+void VGZSource::thinCheckpoints() {
+  // Keep every other checkpoint and double the interval, so a long file
+  // stays evenly covered within the same memory
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < checkpointCount_; i++) {
+    if (i & 1) {
+      freeImage(checkpoints_[i]);
+    } else {
+      checkpoints_[kept++] = checkpoints_[i];
+    }
+  }
+  checkpointCount_ = kept;
+  checkpointInterval_ *= 2;
+  nextCheckpointPos_ = kept ? checkpoints_[kept - 1].dataPos + checkpointInterval_ : 0;
+}
+
+uint8_t* VGZSource::allocateImage(bool& psram) {
+  psram = false;
+
+  // Thinned images are reused - arena space only comes back at the next file
+  if (memoryArena_) {
+    uint8_t* image = spareImages_;
+    if (image) {
+      memcpy(&spareImages_, image, sizeof(spareImages_));
+      return image;
+    }
+    image = memoryArena_->allocate(CHECKPOINT_IMAGE_SIZE);
+    if (image) {
+      GENESIS_PROFILE_ALLOC(CHECKPOINT_IMAGE_SIZE);
+    }
+    return image;
+  }
+#if defined(VGZ_USE_PSRAM)
+  if (hasPSRAM()) {
+    uint8_t* ptr = (uint8_t*)extmem_malloc(CHECKPOINT_IMAGE_SIZE);
+    if (ptr) {
+      GENESIS_PROFILE_ALLOC(CHECKPOINT_IMAGE_SIZE);
+      psram = true;
+      return ptr;
+    }
+  }
+#endif
+  uint8_t* ptr = new (std::nothrow) uint8_t[CHECKPOINT_IMAGE_SIZE];
+  if (ptr) {
+    GENESIS_PROFILE_ALLOC(CHECKPOINT_IMAGE_SIZE);
+  }
+  return ptr;
+}
+
+void VGZSource::freeImage(Checkpoint& checkpoint) {
+  if (!checkpoint.image) {
+    return;
+  }
+  if (memoryArena_ && memoryArena_->owns(checkpoint.image)) {
+    memcpy(checkpoint.image, &spareImages_, sizeof(spareImages_));
+    spareImages_ = checkpoint.image;
+    checkpoint.image = nullptr;
+    return;
+  }
+#if defined(VGZ_USE_PSRAM)
+  if (checkpoint.psram) {
+    extmem_free(checkpoint.image);
+    checkpoint.image = nullptr;
+    return;
+  }
+#endif
+  delete[] checkpoint.image;
+  checkpoint.image = nullptr;
+}
+
+uint32_t VGZSource::compressedPosition() {
+  // Bytes read from the file minus those still waiting in compressedBuffer_
+  return file_.position() - (uint32_t)(decompressor_.source_limit - decompressor_.source);
+}
+
+void VGZSource::captureCheckpoint() {
+  uint32_t dataPos = currentDataPos_ + (bufferSize_ - bufferPos_);
+  if (dataPos < nextCheckpointPos_) {
+    return;
+  }
+  uint32_t compressedPos = compressedPosition();
+
+  if (indexPath_[0]) {
+    // Append a record to the sidecar index
+    File index = SD.open(indexPath_, VGZ_INDEX_APPEND);
+    bool ok = index &&
+              index.size() == sizeof(IndexHeader) + (uint32_t)checkpointCount_ * CHECKPOINT_RECORD_SIZE &&
+              addCheckpoint(dataPos, compressedPos, nullptr, false);
+    if (ok) {
+      uint32_t pos[2] = { dataPos, compressedPos };
+      index.seek(index.size());
+      ok = index.write((const uint8_t*)pos, sizeof(pos)) == sizeof(pos) &&
+           index.write((const uint8_t*)&decompressor_, sizeof(uzlib_uncomp)) == sizeof(uzlib_uncomp) &&
+           index.write(dictBuffer_, DICT_SIZE) == DICT_SIZE;
+      if (!ok) {
+        checkpointCount_--;
+      }
+    }
+    if (index) {
+      index.close();
+    }
+    if (!ok) {
+      // Index is out of step with the file - stop adding to it
+      Serial.println("VGZSource: Index write failed, no further checkpoints");
+      nextCheckpointPos_ = 0xFFFFFFFF;
+      return;
+    }
+  } else {
+    if (checkpointCount_ >= checkpointLimit_) {
+      thinCheckpoints();
+      if (dataPos < nextCheckpointPos_) {
+        return;
+      }
+    }
+
+    bool psram;
+    uint8_t* image = allocateImage(psram);
+    if (!image && checkpointCount_ > 1) {
+      // Out of memory before the limit - make room the same way
+      thinCheckpoints();
+      if (dataPos < nextCheckpointPos_) {
+        return;
+      }
+      image = allocateImage(psram);
+    }
+
+    Checkpoint unused = { 0, 0, image, psram };
+    if (!image || !addCheckpoint(dataPos, compressedPos, image, psram)) {
+      freeImage(unused);
+      nextCheckpointPos_ = dataPos + checkpointInterval_;
+      return;
+    }
+    memcpy(image, &decompressor_, sizeof(uzlib_uncomp));
+    memcpy(image + sizeof(uzlib_uncomp), dictBuffer_, DICT_SIZE);
+  }
+
+  nextCheckpointPos_ = dataPos + checkpointInterval_;
+}
+
+bool VGZSource::restoreCheckpoint(uint16_t index) {
+  const Checkpoint& checkpoint = checkpoints_[index];
+
+  if (checkpoint.image) {
+    memcpy(&decompressor_, checkpoint.image, sizeof(uzlib_uncomp));
+    memcpy(dictBuffer_, checkpoint.image + sizeof(uzlib_uncomp), DICT_SIZE);
+  } else {
+    File indexFile = SD.open(indexPath_, FILE_READ);
+    bool ok = indexFile &&
+              indexFile.seek(sizeof(IndexHeader) + (uint32_t)index * CHECKPOINT_RECORD_SIZE + 8) &&
+              indexFile.read((uint8_t*)&decompressor_, sizeof(uzlib_uncomp)) == sizeof(uzlib_uncomp) &&
+              indexFile.read(dictBuffer_, DICT_SIZE) == DICT_SIZE;
+    if (indexFile) {
+      indexFile.close();
+    }
+    if (!ok) {
+      decompressorActive_ = false;
+      return false;
+    }
+  }
+
+  // Pointers in the saved state belong to whoever saved it
+  decompressor_.dict_ring = dictBuffer_;
+  if (!resumeAt(checkpoint.compressedPos)) {
+    decompressorActive_ = false;
+    return false;
+  }
+
+  currentDataPos_ = checkpoint.dataPos;
+  bufferPos_ = 0;
+  bufferSize_ = 0;
+  return true;
+}
+
+int VGZSource::findCheckpoint(uint32_t position) const {
+  // Last checkpoint at or before position (-1 if none)
+  int lo = 0;
+  int hi = (int)checkpointCount_ - 1;
+  int found = -1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (checkpoints_[mid].dataPos <= position) {
+      found = mid;
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return found;
+}
+
+bool VGZSource::resumeAt(uint32_t compressedPos) {
+  if (!file_.seek(compressedPos)) {
+    return false;
+  }
+  int bytesRead = file_.read(compressedBuffer_, COMPRESSED_BUFFER_SIZE);
+  if (bytesRead < 0) {
+    return false;
+  }
+  GENESIS_PROFILE_SOURCE_BYTES(bytesRead);
+
+  decompressor_.source = compressedBuffer_;
+  decompressor_.source_limit = compressedBuffer_ + bytesRead;
+  decompressor_.source_read_cb = streamingReadCallback;
+  decompressor_.dest_start = buffer_;
+  decompressor_.dest = buffer_;
+  decompressor_.dest_limit = buffer_ + BUFFER_SIZE;
+  decompressorActive_ = true;
+  return true;
+}
+
 // =============================================================================
 // Static Callback
 // =============================================================================
 
 int VGZSource::streamingReadCallback(uzlib_uncomp* uncomp) {
-  if (!g_streamingVGZSource || !g_streamingVGZSource->file_) {
+  VGZSource* source = static_cast<Decompressor*>(uncomp)->owner;
+  if (!source->file_) {
     return -1;
   }
 
@@ -498,21 +1126,19 @@ int VGZSource::streamingReadCallback(uzlib_uncomp* uncomp) {
   }
 
   // Read more compressed data
-  if (!g_streamingVGZSource->file_.available()) {
+  if (!source->file_.available()) {
     return -1;
   }
 
-  int bytesRead = g_streamingVGZSource->file_.read(
-    g_streamingVGZSource->compressedBuffer_,
-    COMPRESSED_BUFFER_SIZE
-  );
+  int bytesRead = source->file_.read(source->compressedBuffer_, COMPRESSED_BUFFER_SIZE);
 
   if (bytesRead <= 0) {
     return -1;
   }
+  GENESIS_PROFILE_SOURCE_BYTES(bytesRead);
 
-  uncomp->source = g_streamingVGZSource->compressedBuffer_;
-  uncomp->source_limit = g_streamingVGZSource->compressedBuffer_ + bytesRead;
+  uncomp->source = source->compressedBuffer_;
+  uncomp->source_limit = source->compressedBuffer_ + bytesRead;
 
   return *uncomp->source++;
 }
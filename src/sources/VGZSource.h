@@ -8,12 +8,22 @@
 #if GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
 
 #include "VGMSource.h"
+#include "../MemoryArena.h"
 #include <SD.h>
 #include "../../lib/uzlib/uzlib.h"
 
 // =============================================================================
 // VGZSource - Streaming decompression of VGZ (gzipped VGM) files
 // Supports looping by capturing/restoring decompressor state at loop point
+//
+// With checkpoints enabled, the decompressor state is also saved every few
+// KB of output (in RAM/PSRAM or a sidecar index file on the SD card), so
+// seek() to any position only inflates from the nearest checkpoint.
+//
+// With prefetch (GENESIS_ENGINE_USE_VGZ_PREFETCH, Teensy 4.1 with PSRAM)
+// the file is inflated whole into PSRAM instead, a slice per prefetch()
+// ahead of the playhead, and read straight from there. Seeks and loops
+// within what has been inflated are then free - no snapshot or checkpoints.
 // =============================================================================
 
 class VGZSource : public VGMSource {
@@ -27,13 +37,54 @@ public:
   // Get the filename for display
   const char* getFilename() const { return filename_; }
 
+  // Size of the compressed file on the card
+  uint32_t getFileSize() const { return fileSize_; }
+
   // Set the loop point offset (relative to VGM data start)
   // Must be called after parsing VGM header but before reaching loop point
-  void setLoopOffset(uint32_t offset) { loopOffsetInData_ = offset; }
+  // (in memory the loop is a plain seek, so it needs no snapshot)
+  void setLoopOffset(uint32_t offset) { loopOffsetInData_ = inMemory_ ? 0 : offset; }
 
   // Notify that we've reached the VGM data start position
   // This resets currentDataPos_ to 0 so loop offsets are relative to data start
-  void setDataStart() { dataStartReached_ = true; currentDataPos_ = 0; }
+  void setDataStart() {
+    dataStartReached_ = true;
+    dataStartOffset_ = currentDataPos_;
+    currentDataPos_ = 0;
+  }
+
+  // Take the decompression buffers, the loop snapshot and RAM checkpoints
+  // from an arena instead of the heap/PSRAM (nullptr = heap). Applies from
+  // the next openFile().
+  void setMemoryArena(MemoryArena* arena) { memoryArena_ = arena; }
+
+  // Save decompressor checkpoints so seek() can reach any position
+  // intervalKB: decompressed KB between checkpoints (0 = off, the default -
+  //             backward seeks other than the loop point then re-inflate
+  //             from the start of the file)
+  // sidecar: keep checkpoints in an index file next to the VGZ (song.vgz ->
+  //          song.vgi) instead of RAM/PSRAM. A matching index is reused on
+  //          the next open, so seeks ahead of what has been played are
+  //          cheap too.
+  // Takes effect on the next openFile()
+  void setCheckpoints(uint16_t intervalKB, bool sidecar = false) {
+    checkpointKB_ = intervalKB;
+    useSidecar_ = sidecar;
+  }
+
+  // Number of checkpoints seek() can currently use
+  uint16_t getCheckpointCount() const { return checkpointCount_; }
+
+  // Inflate files into PSRAM ahead of playback when it is fitted and the
+  // file fits (on by default where supported). Takes effect on the next
+  // openFile().
+  void setPrefetch(bool enabled) { prefetch_ = enabled; }
+
+  // Whether the open file is being inflated into memory, and how much of
+  // it is ready (including the VGM header)
+  bool isInMemory() const { return inMemory_; }
+  uint32_t getInflatedSize() const { return inMemory_ ? bufferSize_ : 0; }
+  bool isFullyInflated() const { return inMemory_ && !decompressorActive_; }
 
   // -------------------------------------------------------------------------
   // VGMSource Interface
@@ -48,11 +99,18 @@ public:
   int peek() override;
   bool available() override;
 
-  // Seeking only supported to loop point (via snapshot restore)
+  VGMSpan acquire(size_t minBytes) override;
+  void consume(size_t n) override;
+
+  // In memory: inflate the next slice
+  bool prefetch() override;
+
+  // Backward seeks restore the loop snapshot or the nearest checkpoint
+  // (re-inflating from the start of the file if there is none)
   bool seek(uint32_t position) override;
   uint32_t position() const override { return currentDataPos_; }
   uint32_t size() const override { return 0xFFFFFFFF; }  // Unknown for streaming
-  bool canSeek() const override { return true; }  // Only to loop point
+  bool canSeek() const override { return true; }
 
 private:
   // Buffer sizes
@@ -60,21 +118,35 @@ private:
   static const size_t COMPRESSED_BUFFER_SIZE = 4096; // 4KB compressed input
   static const size_t DICT_SIZE = 32768;            // 32KB LZ77 dictionary
 
+  MemoryArena* memoryArena_;
+
   // File state
   File file_;
   char filename_[64];
+  uint32_t fileSize_;
   bool isOpen_;
 
+  // uzlib state plus the source it reads for (uzlib has no user data)
+  struct Decompressor : uzlib_uncomp {
+    VGZSource* owner;
+  };
+
   // Decompression state
-  uint8_t* buffer_;              // Decompressed output buffer
+  uint8_t* buffer_;              // Decompressed output buffer (whole file in memory)
   uint8_t* compressedBuffer_;    // Compressed input buffer
-  uint8_t* dictBuffer_;          // LZ77 sliding window dictionary
-  uzlib_uncomp decompressor_;
+  uint8_t* dictBuffer_;          // LZ77 sliding window dictionary (not in memory)
+  Decompressor decompressor_;
   bool decompressorActive_;
   size_t bufferPos_;
   size_t bufferSize_;
   uint32_t currentDataPos_;      // Position in decompressed stream (relative to data start after setDataStart())
   bool dataStartReached_;        // True after setDataStart() is called
+  uint32_t dataStartOffset_;     // Decompressed offset of the VGM data start
+
+  // In memory, bufferPos_ and bufferSize_ are absolute offsets into the file
+  bool prefetch_;                // Requested
+  bool inMemory_;                // buffer_ holds the whole file as it is inflated
+  uint32_t inflatedSize_;        // Size of the inflated file (gzip trailer)
 
   // Loop support - snapshot of decompressor state at loop point
   struct LoopSnapshot {
@@ -90,18 +162,74 @@ private:
   LoopSnapshot loopSnapshot_;
   uint32_t loopOffsetInData_;    // Where to capture snapshot
 
+  // Seek checkpoints - decompressor state at buffer refills, so restoring
+  // one needs no saved output. The image holds the uzlib state followed by
+  // the dictionary; sidecar records store dataPos and compressedPos first.
+  struct Checkpoint {
+    uint32_t dataPos;              // Decompressed position (relative to data start)
+    uint32_t compressedPos;        // File position of the next compressed byte
+    uint8_t* image;                // State + dictionary (nullptr = in sidecar)
+    bool psram;                    // image allocated from PSRAM
+  };
+  static const size_t CHECKPOINT_IMAGE_SIZE = sizeof(uzlib_uncomp) + DICT_SIZE;
+  static const size_t CHECKPOINT_RECORD_SIZE = 8 + CHECKPOINT_IMAGE_SIZE;
+
+  // Sidecar index file header (records follow)
+  struct IndexHeader {
+    char magic[4];                 // "VGI1"
+    uint32_t compressedSize;       // Size of the VGZ file it belongs to
+    uint32_t interval;             // Decompressed bytes between checkpoints
+    uint32_t recordSize;           // CHECKPOINT_RECORD_SIZE of the build that wrote it
+  };
+
+  Checkpoint* checkpoints_;
+  uint16_t checkpointCount_;
+  uint16_t checkpointCapacity_;
+  uint16_t checkpointLimit_;       // Most checkpoints kept (RAM/PSRAM budget)
+  uint16_t checkpointKB_;          // Requested interval (0 = off)
+  bool useSidecar_;                // Requested storage
+  uint32_t checkpointInterval_;    // Current interval in bytes (doubles when RAM is full)
+  uint32_t nextCheckpointPos_;     // Capture at the first refill at or after this
+  char indexPath_[96];             // Sidecar path ("" = checkpoints in RAM/PSRAM)
+  uint8_t* spareImages_;           // Arena images freed by thinning, linked through their first bytes
+
   // Helper methods
+  bool startDecompressor();
   bool refillBuffer();
+  bool skipTo(uint32_t position);
+  bool rewind();
   void captureLoopSnapshot();
   bool restoreLoopSnapshot();
   void extractFilename(const char* path);
 
+  // Buffers from the arena if one is set, otherwise the heap
+  uint8_t* allocateBuffer(size_t size);
+  void freeBuffer(uint8_t*& buffer);
+
+  // In memory
+  bool allocateStream();
+  void freeStream();
+  bool inflateAhead(size_t bytes);
+  void finishInflate();
+
+  // Checkpoints
+  void initCheckpoints(const char* path);
+  void freeCheckpoints();
+  bool loadIndex();
+  bool createIndex();
+  bool addCheckpoint(uint32_t dataPos, uint32_t compressedPos, uint8_t* image, bool psram);
+  void thinCheckpoints();
+  void captureCheckpoint();
+  bool restoreCheckpoint(uint16_t index);
+  int findCheckpoint(uint32_t position) const;
+  uint8_t* allocateImage(bool& psram);
+  void freeImage(Checkpoint& checkpoint);
+  uint32_t compressedPosition();
+  bool resumeAt(uint32_t compressedPos);
+
   // Static callback for uzlib streaming
   static int streamingReadCallback(uzlib_uncomp* uncomp);
 };
 
-// Global pointer for uzlib callback (uzlib doesn't support user data)
-extern VGZSource* g_streamingVGZSource;
-
 #endif // GENESIS_ENGINE_USE_VGZ && GENESIS_ENGINE_USE_SD
 #endif // VGZ_SOURCE_H
@@ -1,4 +1,5 @@
 #include "FMFrequency.h"
+#include "FinePitch.h"
 #include "../GenesisBoard.h"
 
 // Pre-calculated frequency table for MIDI notes 0-127
@@ -49,22 +50,31 @@ void midiToFM(uint8_t midiNote, uint16_t* fnum, uint8_t* block) {
     *block = GENESIS_READ_BYTE(&fmFreqTable[midiNote].block);
 }
 
+void midiToFMWithBend(uint8_t midiNote, int16_t bend, uint16_t* fnum, uint8_t* block,
+                      uint8_t bendRange) {
+    int8_t semitones;
+    uint16_t fine;
+    FinePitch::split(bend, bendRange, &semitones, &fine);
+
+    // Whole semitones pick the note, so the block follows the bend
+    int16_t note = (int16_t)midiNote + semitones;
+    if (note < 0) note = 0;
+    if (note > 127) note = 127;
+    midiToFM((uint8_t)note, fnum, block);
+
+    uint32_t result = FinePitch::scaleFine(*fnum, fine, true);
+    *fnum = (result > 2047) ? 2047 : (uint16_t)result;
+}
+
 uint16_t applyBend(uint16_t fnum, int16_t bend, uint8_t bendRange) {
     if (bend == 0) return fnum;
 
-    // Calculate bend amount
-    // For ±2 semitones (default): full bend = ±12% frequency change
-    // Scale factor: (2^(bendRange/12) - 1) ≈ 0.12 for 2 semitones
-    // Using integer math: bend * fnum / 68000 gives ~12% at full bend
-    int32_t scaleFactor = 68000 / bendRange;  // Adjust for bend range
-    int32_t bendAmount = ((int32_t)fnum * bend) / scaleFactor;
+    int8_t semitones;
+    uint16_t fine;
+    FinePitch::split(bend, bendRange, &semitones, &fine);
 
-    // Apply and clamp
-    int32_t result = fnum + bendAmount;
-    if (result < 0) result = 0;
-    if (result > 2047) result = 2047;
-
-    return (uint16_t)result;
+    uint32_t result = FinePitch::scale(fnum, semitones, fine, true);
+    return (result > 2047) ? 2047 : (uint16_t)result;
 }
 
 void writeToChannel(GenesisBoard& board, uint8_t channel, uint8_t midiNote) {
@@ -90,15 +100,10 @@ void writeToChannelWithBend(GenesisBoard& board, uint8_t channel,
                              uint8_t midiNote, int16_t bend) {
     if (channel > 5) return;
 
-    // Get base frequency
+    // Get bent frequency
     uint16_t fnum;
     uint8_t block;
-    midiToFM(midiNote, &fnum, &block);
-
-    // Apply pitch bend
-    if (bend != 0) {
-        fnum = applyBend(fnum, bend, 2);
-    }
+    midiToFMWithBend(midiNote, bend, &fnum, &block);
 
     // Determine port and channel register offset
     uint8_t port = (channel >= 3) ? 1 : 0;
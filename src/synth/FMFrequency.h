@@ -41,11 +41,29 @@ namespace FMFrequency {
      */
     void midiToFM(uint8_t midiNote, uint16_t* fnum, uint8_t* block);
 
+    /**
+     * Convert a bent MIDI note to F-number and block
+     *
+     * Whole semitones of bend move to the neighbouring note (and its
+     * block), the rest scales the F-number through the fine pitch tables
+     * in 1/64-semitone steps (see FinePitch.h). No division or float.
+     *
+     * @param midiNote MIDI note number (0-127)
+     * @param bend Pitch bend offset (-8192 to +8191, 0=no bend)
+     * @param fnum Output: F-number (0-2047)
+     * @param block Output: Block/octave (0-7)
+     * @param bendRange Bend range in semitones (default 2, standard MIDI)
+     */
+    void midiToFMWithBend(uint8_t midiNote, int16_t bend, uint16_t* fnum, uint8_t* block,
+                          uint8_t bendRange = 2);
+
     /**
      * Apply pitch bend to an F-number
      *
      * Standard MIDI pitch bend is 14-bit (0-16383) with 8192 as center.
      * This function expects the centered value (-8192 to +8191).
+     * The block stays the same, so prefer midiToFMWithBend() when the
+     * note is known.
      *
      * @param fnum Base F-number from midiToFM()
      * @param bend Pitch bend offset (-8192 to +8191, 0=no bend)
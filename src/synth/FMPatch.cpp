@@ -8,43 +8,86 @@ namespace FMPatchUtils {
 const uint8_t OPERATOR_OFFSETS[4] = {0, 8, 4, 12};
 
 void loadToChannel(GenesisBoard& board, uint8_t channel, const struct FMPatch& patch) {
+    FMPatchImage image;
+    compile(patch, image);
+    loadImage(board, channel, image);
+}
+
+void loadImage(GenesisBoard& board, uint8_t channel, const FMPatchImage& image) {
     if (channel > 5) return;
 
     // Determine port (0 for channels 0-2, 1 for channels 3-5) and channel register offset
     uint8_t port = (channel >= 3) ? 1 : 0;
     uint8_t chReg = channel % 3;
 
-    // Write algorithm and feedback (register 0xB0 + channel)
-    board.writeYM2612(port, 0xB0 + chReg, (patch.feedback << 3) | patch.algorithm);
+    // Pair each value with its register, then send all 30 as one burst
+    uint8_t pairs[FM_PATCH_IMAGE_SIZE * 2];
+    uint8_t* p = pairs;
+    const uint8_t* v = image.val;
 
-    // Write L/R/AMS/PMS (register 0xB4 + channel)
-    board.writeYM2612(port, 0xB4 + chReg, patch.getLRAMSPMS());
+    *p++ = 0xB0 + chReg; *p++ = *v++;
+    *p++ = 0xB4 + chReg; *p++ = *v++;
 
-    // Write all 4 operators
+    // Operator registers 0x30-0x90, one value per register block
     for (uint8_t i = 0; i < 4; i++) {
-        uint8_t regOff = OPERATOR_OFFSETS[i];
-        const FMOperator& op = patch.op[i];
+        uint8_t regOff = OPERATOR_OFFSETS[i] + chReg;
+        for (uint8_t reg = 0x30; reg <= 0x90; reg += 0x10) {
+            *p++ = reg + regOff; *p++ = *v++;
+        }
+    }
 
-        // DT/MUL (register 0x30)
-        board.writeYM2612(port, 0x30 + regOff + chReg, (op.dt << 4) | op.mul);
+    board.writeYM2612Batch(port, pairs, FM_PATCH_IMAGE_SIZE);
+}
 
-        // TL (register 0x40) - Total Level (volume)
-        board.writeYM2612(port, 0x40 + regOff + chReg, op.tl);
+void compile(const struct FMPatch& patch, FMPatchImage& image) {
+    uint8_t* v = image.val;
 
-        // RS/AR (register 0x50) - Rate Scaling / Attack Rate
-        board.writeYM2612(port, 0x50 + regOff + chReg, (op.rs << 6) | op.ar);
+    // Algorithm and feedback (register 0xB0)
+    *v++ = ((patch.feedback & 0x07) << 3) | (patch.algorithm & 0x07);
 
-        // AM/DR (register 0x60) - AM enable is bit 7, we don't set it here
-        board.writeYM2612(port, 0x60 + regOff + chReg, op.dr);
+    // L/R/AMS/PMS (register 0xB4)
+    *v++ = patch.getLRAMSPMS();
 
-        // SR (register 0x70) - Sustain Rate (also called "second decay")
-        board.writeYM2612(port, 0x70 + regOff + chReg, op.sr);
+    for (uint8_t i = 0; i < 4; i++) {
+        const FMOperator& op = patch.op[i];
+        *v++ = ((op.dt & 0x07) << 4) | (op.mul & 0x0F);  // DT/MUL (0x30)
+        *v++ = op.tl & 0x7F;                               // TL (0x40)
+        *v++ = ((op.rs & 0x03) << 6) | (op.ar & 0x1F);   // RS/AR (0x50)
+        *v++ = op.dr & 0x1F;                               // AM/DR (0x60) - AM bit not set
+        *v++ = op.sr & 0x1F;                               // SR (0x70)
+        *v++ = ((op.sl & 0x0F) << 4) | (op.rr & 0x0F);   // SL/RR (0x80)
+        *v++ = op.ssg & 0x0F;                              // SSG-EG (0x90)
+    }
+}
 
-        // SL/RR (register 0x80) - Sustain Level / Release Rate
-        board.writeYM2612(port, 0x80 + regOff + chReg, (op.sl << 4) | op.rr);
+void decompile(const FMPatchImage& image, struct FMPatch& patch) {
+    const uint8_t* v = image.val;
 
-        // SSG-EG (register 0x90)
-        board.writeYM2612(port, 0x90 + regOff + chReg, op.ssg);
+    patch.algorithm = v[0] & 0x07;
+    patch.feedback = (v[0] >> 3) & 0x07;
+
+    switch (v[1] & 0xC0) {
+        case 0x80: patch.pan = FM_PAN_LEFT;   break;
+        case 0x40: patch.pan = FM_PAN_RIGHT;  break;
+        default:   patch.pan = FM_PAN_CENTER; break;
+    }
+    patch.ams = (v[1] >> 4) & 0x03;
+    patch.pms = v[1] & 0x07;
+    v += 2;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        FMOperator& op = patch.op[i];
+        op.dt  = (v[0] >> 4) & 0x07;
+        op.mul = v[0] & 0x0F;
+        op.tl  = v[1] & 0x7F;
+        op.rs  = v[2] >> 6;
+        op.ar  = v[2] & 0x1F;
+        op.dr  = v[3] & 0x1F;
+        op.sr  = v[4] & 0x1F;
+        op.sl  = v[5] >> 4;
+        op.rr  = v[5] & 0x0F;
+        op.ssg = v[6] & 0x0F;
+        v += 7;
     }
 }
 
@@ -112,4 +155,20 @@ void getCarrierMask(uint8_t algorithm, bool* isCarrier) {
     }
 }
 
+void getCarrierLevels(const struct FMPatch& patch, uint8_t* levels) {
+    bool isCarrier[4];
+    getCarrierMask(patch.algorithm, isCarrier);
+    for (uint8_t op = 0; op < 4; op++) {
+        levels[op] = isCarrier[op] ? patch.op[op].tl : 0xFF;
+    }
+}
+
+void getCarrierLevels(const FMPatchImage& image, uint8_t* levels) {
+    bool isCarrier[4];
+    getCarrierMask(image.algorithm(), isCarrier);
+    for (uint8_t op = 0; op < 4; op++) {
+        levels[op] = isCarrier[op] ? image.tl(op) : 0xFF;
+    }
+}
+
 } // namespace FMPatchUtils
@@ -73,6 +73,32 @@ struct FMPatch {
 // Patch size constants
 #define FM_PATCH_SIZE_LEGACY   42  // TFI format (algorithm, feedback, 4 operators)
 #define FM_PATCH_SIZE_EXTENDED 45  // Full format (adds pan, ams, pms)
+#define FM_PATCH_IMAGE_SIZE    30  // Compiled register image
+
+/**
+ * Compiled FM Patch
+ *
+ * The 30 register values FMPatchUtils::loadToChannel() writes, already
+ * packed into register format:
+ *   [0] 0xB0 feedback/algorithm   [1] 0xB4 L/R/AMS/PMS
+ *   then for each operator (FMPatch::op order), 7 values:
+ *   0x30 DT/MUL, 0x40 TL, 0x50 RS/AR, 0x60 DR, 0x70 SR, 0x80 SL/RR, 0x90 SSG-EG
+ *
+ * The values don't depend on the channel, so one image loads on any of
+ * them with no field packing at load time (see FMPatchUtils::loadImage()).
+ *
+ * Size: 30 bytes
+ */
+struct FMPatchImage {
+    uint8_t val[FM_PATCH_IMAGE_SIZE];
+
+    uint8_t algorithm() const { return val[0] & 0x07; }
+
+    /**
+     * Total level of an operator (FMPatch::op index)
+     */
+    uint8_t tl(uint8_t op) const { return val[3 + op * 7] & 0x7F; }
+};
 
 /**
  * FM Patch Utility Functions
@@ -92,6 +118,32 @@ namespace FMPatchUtils {
      */
     void loadToChannel(GenesisBoard& board, uint8_t channel, const struct FMPatch& patch);
 
+    /**
+     * Load a compiled patch to an FM channel
+     *
+     * All 30 registers go out as one writeYM2612Batch(). With the register
+     * shadow and GENESIS_ENGINE_SKIP_REDUNDANT_WRITES on, the board drops
+     * the ones the channel already holds, so switching between patches
+     * that share most settings only costs the registers that differ.
+     *
+     * @param board GenesisBoard instance
+     * @param channel FM channel (0-5)
+     * @param image Compiled patch
+     */
+    void loadImage(GenesisBoard& board, uint8_t channel, const FMPatchImage& image);
+
+    /**
+     * Pack a patch into its register image
+     *
+     * Fields are masked to their register widths.
+     */
+    void compile(const struct FMPatch& patch, FMPatchImage& image);
+
+    /**
+     * Unpack a register image back into a patch
+     */
+    void decompile(const FMPatchImage& image, struct FMPatch& patch);
+
     /**
      * Parse patch data from raw bytes
      *
@@ -121,6 +173,15 @@ namespace FMPatchUtils {
      */
     void getCarrierMask(uint8_t algorithm, bool* isCarrier);
 
+    /**
+     * Get the carrier total levels of a patch
+     *
+     * @param patch Patch (or compiled patch)
+     * @param levels Output array of 4 TLs (FMPatch::op order), 0xFF for modulators
+     */
+    void getCarrierLevels(const struct FMPatch& patch, uint8_t* levels);
+    void getCarrierLevels(const FMPatchImage& image, uint8_t* levels);
+
     /**
      * YM2612 operator register offsets
      *
@@ -0,0 +1,37 @@
+#include "FMPatchBank.h"
+#include "DefaultPatches.h"
+
+FMPatchBank::FMPatchBank() {
+    FMPatch empty = {};
+    for (uint8_t slot = 0; slot < SLOTS; slot++) {
+        FMPatchUtils::compile(empty, images_[slot]);
+    }
+}
+
+void FMPatchBank::loadDefaults() {
+    FMPatch patch;
+    for (uint8_t slot = 0; slot < DEFAULT_FM_PATCH_COUNT && slot < SLOTS; slot++) {
+        // Copy out of PROGMEM, then pack
+        const uint8_t* src = (const uint8_t*)&defaultFMPatches[slot];
+        uint8_t* dst = (uint8_t*)&patch;
+        for (uint8_t i = 0; i < sizeof(FMPatch); i++) {
+            dst[i] = GENESIS_READ_BYTE(src + i);
+        }
+        FMPatchUtils::compile(patch, images_[slot]);
+    }
+}
+
+void FMPatchBank::set(uint8_t slot, const FMPatch& patch) {
+    if (slot >= SLOTS) return;
+    FMPatchUtils::compile(patch, images_[slot]);
+}
+
+void FMPatchBank::set(uint8_t slot, const FMPatchImage& image) {
+    if (slot >= SLOTS) return;
+    images_[slot] = image;
+}
+
+void FMPatchBank::get(uint8_t slot, FMPatch& patch) const {
+    if (slot >= SLOTS) return;
+    FMPatchUtils::decompile(images_[slot], patch);
+}
@@ -0,0 +1,61 @@
+#ifndef GENESIS_FM_PATCH_BANK_H
+#define GENESIS_FM_PATCH_BANK_H
+
+#include <stdint.h>
+#include "../config/feature_config.h"
+#include "FMPatch.h"
+
+/**
+ * Bank of Compiled FM Patches
+ *
+ * Patch slots kept as register images (FMPatchImage) instead of FMPatch
+ * structures. A patch is packed once when it is stored, so a program
+ * change is a copy of 30 ready values into one register burst - no field
+ * shifting while notes are waiting. It also saves 15 bytes of RAM per slot.
+ *
+ * Edits go through get()/set(): unpack, change a field, store again.
+ *
+ * Usage:
+ *   FMPatchBank bank;
+ *   bank.loadDefaults();
+ *   synth.loadPatch(channel, bank[program]);
+ */
+class FMPatchBank {
+public:
+    static const uint8_t SLOTS = GENESIS_SYNTH_PATCH_SLOTS;
+
+    /**
+     * All slots start as an empty patch (all fields zero, center pan)
+     */
+    FMPatchBank();
+
+    /**
+     * Compile the built-in patches (DefaultPatches.h) into the first slots
+     */
+    void loadDefaults();
+
+    /**
+     * Compile a patch into a slot
+     */
+    void set(uint8_t slot, const FMPatch& patch);
+
+    /**
+     * Copy an already compiled patch into a slot
+     */
+    void set(uint8_t slot, const FMPatchImage& image);
+
+    /**
+     * Unpack a slot into a patch
+     */
+    void get(uint8_t slot, FMPatch& patch) const;
+
+    /**
+     * Compiled patch in a slot (slot must be < SLOTS)
+     */
+    const FMPatchImage& operator[](uint8_t slot) const { return images_[slot]; }
+
+private:
+    FMPatchImage images_[SLOTS];
+};
+
+#endif // GENESIS_FM_PATCH_BANK_H
@@ -0,0 +1,229 @@
+#include "FMPatchLibrary.h"
+
+#if GENESIS_SYNTH_USE_PATCH_LIBRARY
+
+#include <string.h>
+
+// File name ends in .tfi (any case)
+static bool isTFIName(const char* name) {
+    size_t len = strlen(name);
+    if (len < 5) return false;
+    const char* ext = name + len - 4;
+    return ext[0] == '.' &&
+           (ext[1] | 0x20) == 't' && (ext[2] | 0x20) == 'f' && (ext[3] | 0x20) == 'i';
+}
+
+// =============================================================================
+// Constructor / Setup
+// =============================================================================
+
+FMPatchLibrary::FMPatchLibrary()
+    : dir_(nullptr),
+      indexPath_(nullptr),
+      count_(0),
+      hits_(0),
+      misses_(0)
+{
+    clearCache();
+}
+
+bool FMPatchLibrary::begin(const char* dir, const char* indexPath) {
+    end();
+    dir_ = dir;
+    indexPath_ = indexPath;
+
+    if (!openIndex()) {
+        GENESIS_DEBUG_PRINTLN("Building patch index");
+        if (!rebuild()) return false;
+    }
+    return count_ > 0;
+}
+
+void FMPatchLibrary::end() {
+    if (index_) index_.close();
+    count_ = 0;
+    clearCache();
+}
+
+bool FMPatchLibrary::rebuild() {
+    end();
+    if (!dir_ || !indexPath_) return false;
+
+    File dir = SD.open(dir_);
+    if (!dir) return false;
+    if (!dir.isDirectory()) {
+        dir.close();
+        return false;
+    }
+
+    if (SD.exists(indexPath_)) SD.remove(indexPath_);
+    File out = SD.open(indexPath_, FILE_WRITE);
+    if (!out) {
+        dir.close();
+        return false;
+    }
+
+    Header header;
+    memcpy(header.magic, "GPL1", 4);
+    header.recordSize = sizeof(Record);
+    header.reserved = 0;
+    bool ok = out.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+    uint16_t records = 0;
+    uint8_t data[FM_PATCH_SIZE_LEGACY];
+    while (ok && records < NO_PATCH) {
+        File entry = dir.openNextFile();
+        if (!entry) break;
+
+        // Some cores give the whole path
+        const char* name = entry.name();
+        const char* slash = strrchr(name, '/');
+        if (slash) name = slash + 1;
+
+        if (!entry.isDirectory() && entry.size() == FM_PATCH_SIZE_LEGACY && isTFIName(name) &&
+            entry.read(data, sizeof(data)) == sizeof(data)) {
+            Record record;
+            memset(&record, 0, sizeof(record));
+            size_t len = strlen(name) - 4;
+            if (len > NAME_LEN - 1) len = NAME_LEN - 1;
+            memcpy(record.name, name, len);
+
+            FMPatch patch;
+            FMPatchUtils::parseFromData(data, patch, false);
+            FMPatchUtils::compile(patch, record.image);
+
+            ok = out.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+            records++;
+        }
+        entry.close();
+    }
+
+    out.close();
+    dir.close();
+    return ok && openIndex();
+}
+
+// =============================================================================
+// Patches
+// =============================================================================
+
+const FMPatchImage* FMPatchLibrary::get(uint16_t program) {
+    if (program >= count_) return nullptr;
+
+    int8_t slot = find(program);
+    if (slot >= 0) {
+        hits_++;
+        promote(slot, 0);
+    } else {
+        misses_++;
+        slot = fetch(program, 0);
+        if (slot < 0) return nullptr;
+    }
+
+    // Patch browsing steps up or down one at a time
+    ahead_[0] = (program + 1 < count_) ? program + 1 : NO_PATCH;
+    ahead_[1] = (program > 0) ? program - 1 : NO_PATCH;
+    return &images_[slot];
+}
+
+bool FMPatchLibrary::getName(uint16_t program, char* name, uint8_t size) {
+    if (program >= count_ || size == 0) return false;
+
+    Record record;
+    if (!readRecord(program, record)) return false;
+    uint8_t len = (size < NAME_LEN) ? size : NAME_LEN;
+    memcpy(name, record.name, len - 1);
+    name[len - 1] = '\0';
+    return true;
+}
+
+void FMPatchLibrary::update() {
+    if (CACHE_SIZE < 2) return;
+
+    // One read per call, just behind the patch in use so it isn't replaced
+    for (uint8_t i = 0; i < 2; i++) {
+        uint16_t program = ahead_[i];
+        if (program == NO_PATCH) continue;
+        ahead_[i] = NO_PATCH;
+        if (find(program) < 0) {
+            fetch(program, 1);
+            return;
+        }
+    }
+}
+
+// =============================================================================
+// Cache
+// =============================================================================
+
+void FMPatchLibrary::clearCache() {
+    for (uint8_t i = 0; i < CACHE_SIZE; i++) {
+        programs_[i] = NO_PATCH;
+        order_[i] = i;
+    }
+    ahead_[0] = ahead_[1] = NO_PATCH;
+}
+
+int8_t FMPatchLibrary::find(uint16_t program) const {
+    for (uint8_t i = 0; i < CACHE_SIZE; i++) {
+        if (programs_[i] == program) return i;
+    }
+    return -1;
+}
+
+int8_t FMPatchLibrary::fetch(uint16_t program, uint8_t rank) {
+    uint8_t slot = order_[CACHE_SIZE - 1];
+
+    Record record;
+    if (!readRecord(program, record)) return -1;
+    images_[slot] = record.image;
+    programs_[slot] = program;
+    promote(slot, rank);
+    return slot;
+}
+
+void FMPatchLibrary::promote(uint8_t slot, uint8_t rank) {
+    uint8_t pos = 0;
+    while (order_[pos] != slot) pos++;
+
+    if (pos > rank) {
+        memmove(&order_[rank + 1], &order_[rank], pos - rank);
+    } else if (pos < rank) {
+        memmove(&order_[pos], &order_[pos + 1], rank - pos);
+    }
+    order_[rank] = slot;
+}
+
+// =============================================================================
+// Index File
+// =============================================================================
+
+bool FMPatchLibrary::readRecord(uint16_t program, Record& record) {
+    if (!index_) return false;
+    return index_.seek(sizeof(Header) + (uint32_t)program * sizeof(Record)) &&
+           index_.read((uint8_t*)&record, sizeof(record)) == sizeof(record);
+}
+
+bool FMPatchLibrary::openIndex() {
+    if (!indexPath_) return false;
+
+    index_ = SD.open(indexPath_, FILE_READ);
+    if (!index_) return false;
+
+    Header header;
+    uint32_t recordBytes = index_.size() > sizeof(header) ? index_.size() - sizeof(header) : 0;
+    bool valid = index_.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 memcmp(header.magic, "GPL1", 4) == 0 &&
+                 header.recordSize == sizeof(Record) &&
+                 recordBytes % sizeof(Record) == 0 &&
+                 recordBytes / sizeof(Record) < NO_PATCH;
+    if (!valid) {
+        index_.close();
+        return false;
+    }
+
+    count_ = recordBytes / sizeof(Record);
+    return true;
+}
+
+#endif // GENESIS_SYNTH_USE_PATCH_LIBRARY
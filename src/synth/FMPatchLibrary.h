@@ -0,0 +1,146 @@
+#ifndef GENESIS_FM_PATCH_LIBRARY_H
+#define GENESIS_FM_PATCH_LIBRARY_H
+
+#include "../config/feature_config.h"
+
+// Only compile if the patch library is enabled
+#if GENESIS_SYNTH_USE_PATCH_LIBRARY
+
+#include <Arduino.h>
+#include <SD.h>
+#include "FMPatch.h"
+
+/**
+ * FM Patch Library on the SD Card
+ *
+ * Turns a directory of TFI files into numbered patches, loaded on demand:
+ * - An index file is built once from the directory: one fixed-size record
+ *   per TFI file (name and compiled patch), so a patch is one seek and one
+ *   read instead of a directory search and a parse
+ * - The most recently used patches stay in a small RAM cache
+ *   (GENESIS_SYNTH_LIBRARY_CACHE entries, least recently used replaced)
+ * - The programs either side of the last one asked for are read ahead by
+ *   update(), so stepping through patches comes from the cache
+ *
+ * Patches are numbered in directory order. The index is rebuilt when it is
+ * missing or from another build; call rebuild() after changing the files.
+ * examples/MIDISynth/Test_Patches holds TFI files to start with: copy the
+ * folder to the card as /patches.
+ *
+ * Usage:
+ *   FMPatchLibrary library;
+ *   SD.begin(GENESIS_ENGINE_SD_CS_PIN);
+ *   library.begin("/patches");
+ *   const FMPatchImage* patch = library.get(program);
+ *   if (patch) synth.loadPatch(channel, *patch);
+ *   ...
+ *   library.update();   // in loop(), when idle
+ */
+class FMPatchLibrary {
+public:
+    static const uint16_t NO_PATCH = 0xFFFF;
+    static const uint8_t NAME_LEN = 18;  // Name characters kept per patch (including the terminator)
+
+    FMPatchLibrary();
+
+    /**
+     * Open a patch directory, building its index if needed
+     *
+     * @param dir Directory of .tfi files
+     * @param indexPath Index file
+     * @return true if the library holds at least one patch
+     */
+    bool begin(const char* dir, const char* indexPath = GENESIS_SYNTH_LIBRARY_INDEX_PATH);
+
+    /**
+     * Close the index file and empty the cache
+     */
+    void end();
+
+    /**
+     * Scan the directory again and rewrite the index
+     */
+    bool rebuild();
+
+    /**
+     * Patches in the library
+     */
+    uint16_t count() const { return count_; }
+
+    /**
+     * Get a patch, from the cache or the card
+     *
+     * The programs either side are queued for update() to read ahead.
+     *
+     * @param program Patch number (0 to count() - 1)
+     * @return Compiled patch, valid until the next get() or update(),
+     *         or nullptr if there is no such patch
+     */
+    const FMPatchImage* get(uint16_t program);
+
+    /**
+     * Read a patch's name (its file name without the extension)
+     *
+     * @param program Patch number
+     * @param name Output buffer
+     * @param size Buffer size (up to NAME_LEN is used)
+     * @return false if there is no such patch
+     */
+    bool getName(uint16_t program, char* name, uint8_t size);
+
+    /**
+     * Read ahead one queued neighbour that isn't cached yet (call from
+     * loop(); the read is skipped when nothing is queued)
+     */
+    void update();
+
+    uint32_t getHits() const { return hits_; }
+    uint32_t getMisses() const { return misses_; }
+
+private:
+    static const uint8_t CACHE_SIZE = GENESIS_SYNTH_LIBRARY_CACHE;
+
+    // Index file layout: Header, then Records
+    struct Header {
+        char magic[4];        // "GPL1"
+        uint16_t recordSize;  // sizeof(Record) - rebuilt if it changes
+        uint16_t reserved;
+    };
+    struct Record {
+        char name[NAME_LEN];
+        FMPatchImage image;
+    };
+
+    void clearCache();
+
+    // Slot caching a program, or -1
+    int8_t find(uint16_t program) const;
+
+    // Read a program into the least recently used slot and move it to a
+    // place in the recency order
+    int8_t fetch(uint16_t program, uint8_t rank);
+
+    // Move a slot to a place in the recency order (0 = most recent)
+    void promote(uint8_t slot, uint8_t rank);
+
+    bool readRecord(uint16_t program, Record& record);
+    bool openIndex();
+
+    const char* dir_;
+    const char* indexPath_;
+    File index_;
+    uint16_t count_;
+
+    FMPatchImage images_[CACHE_SIZE];
+    uint16_t programs_[CACHE_SIZE];   // Program in each slot (NO_PATCH = empty)
+    uint8_t order_[CACHE_SIZE];       // Slots, most recently used first
+
+    uint16_t ahead_[2];               // Neighbours to read ahead (NO_PATCH = none)
+
+    uint32_t hits_;
+    uint32_t misses_;
+};
+
+#endif // GENESIS_SYNTH_USE_PATCH_LIBRARY
+
+#endif // GENESIS_FM_PATCH_LIBRARY_H
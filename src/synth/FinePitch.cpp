@@ -0,0 +1,99 @@
+#include "FinePitch.h"
+
+// =============================================================================
+// Table Generation (evaluated by the compiler)
+// =============================================================================
+
+// e^x from its Taylor series
+static constexpr double expSeries(double x, double term, int n) {
+    return (term < 1e-10 && term > -1e-10) ? 0.0 : term + expSeries(x, term * x / n, n + 1);
+}
+
+static constexpr double expc(double x) {
+    return expSeries(x, 1.0, 1);
+}
+
+static constexpr double LN2 = 0.69314718055994530942;
+
+static constexpr uint16_t q15(double ratio) {
+    return (uint16_t)(ratio * 32768.0 + 0.5);
+}
+
+// 2^(+-k/768): k 1/64-semitone steps
+#define FINE_UP(k)   q15(expc((k) * LN2 / 768.0))
+#define FINE_DOWN(k) q15(expc(-(k) * LN2 / 768.0))
+
+// 2^(+-n/12): n semitones
+#define SEMI_UP(n)   q15(expc((n) * LN2 / 12.0))
+#define SEMI_DOWN(n) q15(expc(-(n) * LN2 / 12.0))
+
+#define ROW8(F, k) F(k), F(k + 1), F(k + 2), F(k + 3), F(k + 4), F(k + 5), F(k + 6), F(k + 7)
+
+static const uint16_t fineUpTable[65] GENESIS_PROGMEM = {
+    ROW8(FINE_UP, 0),  ROW8(FINE_UP, 8),  ROW8(FINE_UP, 16), ROW8(FINE_UP, 24),
+    ROW8(FINE_UP, 32), ROW8(FINE_UP, 40), ROW8(FINE_UP, 48), ROW8(FINE_UP, 56),
+    FINE_UP(64),
+};
+
+static const uint16_t fineDownTable[65] GENESIS_PROGMEM = {
+    ROW8(FINE_DOWN, 0),  ROW8(FINE_DOWN, 8),  ROW8(FINE_DOWN, 16), ROW8(FINE_DOWN, 24),
+    ROW8(FINE_DOWN, 32), ROW8(FINE_DOWN, 40), ROW8(FINE_DOWN, 48), ROW8(FINE_DOWN, 56),
+    FINE_DOWN(64),
+};
+
+static const uint16_t semitoneUpTable[12] GENESIS_PROGMEM = {
+    SEMI_UP(0), SEMI_UP(1), SEMI_UP(2), SEMI_UP(3), SEMI_UP(4),  SEMI_UP(5),
+    SEMI_UP(6), SEMI_UP(7), SEMI_UP(8), SEMI_UP(9), SEMI_UP(10), SEMI_UP(11),
+};
+
+static const uint16_t semitoneDownTable[12] GENESIS_PROGMEM = {
+    SEMI_DOWN(0), SEMI_DOWN(1), SEMI_DOWN(2), SEMI_DOWN(3), SEMI_DOWN(4),  SEMI_DOWN(5),
+    SEMI_DOWN(6), SEMI_DOWN(7), SEMI_DOWN(8), SEMI_DOWN(9), SEMI_DOWN(10), SEMI_DOWN(11),
+};
+
+namespace FinePitch {
+
+void split(int16_t bend, uint8_t bendRange, int8_t* semitones, uint16_t* fine) {
+    // bend / 8192 * range semitones, in 1/4096 semitones
+    int32_t units = ((int32_t)bend * bendRange) >> 1;
+    *semitones = (int8_t)(units >> 12);
+    *fine = (uint16_t)(units & 0x0FFF);
+}
+
+uint32_t scaleFine(uint16_t value, uint16_t fine, bool up) {
+    const uint16_t* table = up ? fineUpTable : fineDownTable;
+    uint8_t step = (fine >> 6) & 0x3F;
+    uint8_t frac = fine & 0x3F;
+
+    // Interpolate between this step and the next
+    int32_t a = GENESIS_READ_WORD(&table[step]);
+    int32_t b = GENESIS_READ_WORD(&table[step + 1]);
+    int32_t ratio = a + (((b - a) * frac) >> 6);
+
+    return ((uint32_t)value * (uint32_t)ratio + 0x4000) >> 15;
+}
+
+uint32_t scale(uint16_t value, int8_t semitones, uint16_t fine, bool up) {
+    // Whole octaves are shifts, the rest one semitone lookup
+    int8_t octaves = 0;
+    int8_t s = semitones;
+    while (s < 0) { s += 12; octaves--; }
+    while (s >= 12) { s -= 12; octaves++; }
+
+    uint32_t v = scaleFine(value, fine, up);
+    if (v > 0xFFFF) v = 0xFFFF;
+    const uint16_t* table = up ? semitoneUpTable : semitoneDownTable;
+    v = (v * GENESIS_READ_WORD(&table[s]) + 0x4000) >> 15;
+
+    // A tone divider halves per octave up, an F-number doubles
+    if (!up) octaves = -octaves;
+    if (octaves > 0) {
+        if (v > 0xFFFF) v = 0xFFFF;
+        v <<= (octaves > 15 ? 15 : octaves);
+    } else if (octaves < 0) {
+        v >>= (octaves < -31 ? 31 : -octaves);
+    }
+    return v;
+}
+
+} // namespace FinePitch
@@ -0,0 +1,59 @@
+#ifndef GENESIS_FINE_PITCH_H
+#define GENESIS_FINE_PITCH_H
+
+#include <stdint.h>
+#include "../config/platform_detect.h"
+
+/**
+ * Fixed-Point Pitch Bend Tables
+ *
+ * Pitch ratios in Q15 (32768 = 1.0), generated at compile time:
+ * - Fine steps of 1/64 semitone across one semitone (65 entries, so the
+ *   step above the last one is there to interpolate towards)
+ * - The 12 semitones of an octave
+ *
+ * "Up" tables hold 2^(+n/12) for F-numbers (higher pitch = larger value),
+ * "down" tables 2^(-n/12) for SN76489 tone dividers (higher pitch =
+ * smaller value). A bend is a semitone lookup plus a fine step
+ * interpolated by the remaining bend bits - no division or float at
+ * runtime.
+ *
+ * Bends use 1/4096 semitone units internally, the resolution of a 14-bit
+ * MIDI pitch bend over +/-2 semitones.
+ */
+namespace FinePitch {
+    static const uint8_t STEPS_PER_SEMITONE = 64;
+
+    /**
+     * Split a MIDI pitch bend into whole semitones and a fraction
+     *
+     * @param bend Pitch bend offset (-8192 to +8191)
+     * @param bendRange Bend range in semitones
+     * @param semitones Output: whole semitones (rounded down)
+     * @param fine Output: rest of the bend in 1/4096 semitones (0-4095)
+     */
+    void split(int16_t bend, uint8_t bendRange, int8_t* semitones, uint16_t* fine);
+
+    /**
+     * Scale a pitch value up or down by a fraction of a semitone
+     *
+     * @param value F-number or tone divider
+     * @param fine Fraction of a semitone in 1/4096 semitones (0-4095)
+     * @param up true for F-numbers (pitch up = larger), false for tone dividers
+     * @return Scaled value (not clamped)
+     */
+    uint32_t scaleFine(uint16_t value, uint16_t fine, bool up);
+
+    /**
+     * Scale a pitch value by an interval of any size
+     *
+     * @param value F-number or tone divider
+     * @param semitones Whole semitones (negative = down)
+     * @param fine Fraction of a semitone in 1/4096 semitones (0-4095)
+     * @param up true for F-numbers, false for tone dividers
+     * @return Scaled value (not clamped)
+     */
+    uint32_t scale(uint16_t value, int8_t semitones, uint16_t fine, bool up);
+}
+
+#endif // GENESIS_FINE_PITCH_H
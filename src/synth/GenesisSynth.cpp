@@ -0,0 +1,303 @@
+#include "GenesisSynth.h"
+#include "FMFrequency.h"
+#include "ModulationEngine.h"
+#include "../GenesisBoard.h"
+
+GenesisSynth::GenesisSynth(GenesisBoard& board)
+    : board_(board),
+      mod_(nullptr)
+{
+    reset();
+}
+
+void GenesisSynth::reset() {
+    free_.head = free_.tail = NO_VOICE;
+    busy_.head = busy_.tail = NO_VOICE;
+    for (uint8_t v = 0; v < NUM_VOICES; v++) {
+        voices_[v].note = 0;
+        voices_[v].velocity = 0;
+        voices_[v].on = false;
+        voices_[v].sustainPending = false;
+        append(free_, v);
+    }
+    for (uint8_t i = 0; i < sizeof(noteVoice_); i++) {
+        noteVoice_[i] = (NO_VOICE << 4) | NO_VOICE;
+    }
+    count_[0] = count_[1] = 0;
+    keyCount_ = 0;
+}
+
+// =============================================================================
+// Voice Lists
+// =============================================================================
+
+void GenesisSynth::unlink(VoiceList& list, uint8_t voice) {
+    Voice& v = voices_[voice];
+    if (v.prev != NO_VOICE) voices_[v.prev].next = v.next;
+    else list.head = v.next;
+    if (v.next != NO_VOICE) voices_[v.next].prev = v.prev;
+    else list.tail = v.prev;
+}
+
+void GenesisSynth::append(VoiceList& list, uint8_t voice) {
+    Voice& v = voices_[voice];
+    v.prev = list.tail;
+    v.next = NO_VOICE;
+    if (list.tail != NO_VOICE) voices_[list.tail].next = voice;
+    else list.head = voice;
+    list.tail = voice;
+}
+
+uint8_t GenesisSynth::lookup(uint8_t note) const {
+    uint8_t packed = noteVoice_[(note & 0x7F) >> 1];
+    return (note & 1) ? (packed >> 4) : (packed & 0x0F);
+}
+
+void GenesisSynth::setLookup(uint8_t note, uint8_t voice) {
+    uint8_t& packed = noteVoice_[(note & 0x7F) >> 1];
+    if (note & 1) packed = (packed & 0x0F) | (voice << 4);
+    else packed = (packed & 0xF0) | voice;
+}
+
+// =============================================================================
+// Voice Allocation
+// =============================================================================
+
+uint8_t GenesisSynth::allocateVoice(uint8_t note) {
+    // 1. Retrigger the voice already playing this note
+    uint8_t voice = lookup(note);
+    if (voice != NO_VOICE) {
+        return voice;
+    }
+
+    // 2. Free voice released longest ago
+    if (free_.head != NO_VOICE) {
+        return free_.head;
+    }
+
+    // 3. Steal the oldest note
+    voice = busy_.head;
+    release(voice);
+    return voice;
+}
+
+uint8_t GenesisSynth::findVoice(uint8_t note) const {
+    return lookup(note);
+}
+
+// =============================================================================
+// Voices
+// =============================================================================
+
+void GenesisSynth::noteOn(uint8_t voice, uint8_t note, uint8_t velocity,
+                          const FMPatch& patch, int16_t bend) {
+    uint8_t carrierTL[4];
+    FMPatchUtils::getCarrierLevels(patch, carrierTL);
+    startNote(voice, note, velocity, carrierTL, bend);
+}
+
+void GenesisSynth::noteOn(uint8_t voice, uint8_t note, uint8_t velocity,
+                          const FMPatchImage& patch, int16_t bend) {
+    uint8_t carrierTL[4];
+    FMPatchUtils::getCarrierLevels(patch, carrierTL);
+    startNote(voice, note, velocity, carrierTL, bend);
+}
+
+void GenesisSynth::startNote(uint8_t voice, uint8_t note, uint8_t velocity,
+                             const uint8_t* carrierTL, int16_t bend) {
+    if (voice >= NUM_VOICES) return;
+    Voice& v = voices_[voice];
+
+    if (v.on) {
+        unlink(busy_, voice);
+        if (lookup(v.note) == voice) setLookup(v.note, NO_VOICE);
+    } else {
+        unlink(free_, voice);
+        v.on = true;
+    }
+    append(busy_, voice);
+
+    v.note = note;
+    v.velocity = velocity;
+    v.sustainPending = false;
+    setLookup(note, voice);
+
+    // Velocity on the carrier TLs: 127 = patch level, 0 = ~42 steps down
+    uint8_t attenuation = (127 - velocity) / 3;
+    uint8_t block;
+    uint16_t fnum;
+    notePitch(note, bend, &block, &fnum);
+
+    writeCarrierLevel(voice, carrierTL, attenuation);
+    writeFrequency(voice, block, fnum);
+    keyOn(voice);
+    if (mod_) mod_->fmNoteOn(voice, block, fnum, carrierTL, attenuation);
+}
+
+bool GenesisSynth::noteOff(uint8_t voice, uint8_t note, bool sustain) {
+    if (voice >= NUM_VOICES) return false;
+    Voice& v = voices_[voice];
+    if (!v.on || v.note != note) return false;
+
+    if (sustain) {
+        v.sustainPending = true;
+        return false;
+    }
+    release(voice);
+    return true;
+}
+
+void GenesisSynth::releaseSustained(uint8_t voice) {
+    if (voice >= NUM_VOICES) return;
+    if (voices_[voice].sustainPending) {
+        release(voice);
+    }
+}
+
+void GenesisSynth::release(uint8_t voice) {
+    if (voice >= NUM_VOICES) return;
+    Voice& v = voices_[voice];
+
+    if (v.on) {
+        if (lookup(v.note) == voice) setLookup(v.note, NO_VOICE);
+        unlink(busy_, voice);
+        append(free_, voice);
+        v.on = false;
+        v.sustainPending = false;
+    }
+    keyOff(voice);
+    if (mod_) mod_->fmNoteOff(voice);
+}
+
+void GenesisSynth::setPitchBend(uint8_t voice, int16_t bend) {
+    if (voice >= NUM_VOICES || !voices_[voice].on) return;
+
+    uint8_t block;
+    uint16_t fnum;
+    notePitch(voices_[voice].note, bend, &block, &fnum);
+    writeFrequency(voice, block, fnum);
+    if (mod_) mod_->setFMPitch(voice, block, fnum);
+}
+
+void GenesisSynth::setCarrierLevel(uint8_t voice, const FMPatch& patch, uint8_t attenuation) {
+    uint8_t carrierTL[4];
+    FMPatchUtils::getCarrierLevels(patch, carrierTL);
+    writeCarrierLevel(voice, carrierTL, attenuation);
+}
+
+void GenesisSynth::setCarrierLevel(uint8_t voice, const FMPatchImage& patch, uint8_t attenuation) {
+    uint8_t carrierTL[4];
+    FMPatchUtils::getCarrierLevels(patch, carrierTL);
+    writeCarrierLevel(voice, carrierTL, attenuation);
+}
+
+void GenesisSynth::writeCarrierLevel(uint8_t voice, const uint8_t* carrierTL, uint8_t attenuation) {
+    if (voice >= NUM_VOICES) return;
+
+    uint8_t port = (voice >= 3) ? 1 : 0;
+    uint8_t chReg = voice % 3;
+
+    for (uint8_t op = 0; op < 4; op++) {
+        if (carrierTL[op] != 0xFF) {
+            uint16_t tl = carrierTL[op] + attenuation;
+            if (tl > 127) tl = 127;
+            writeYM2612(port, 0x40 + FMPatchUtils::OPERATOR_OFFSETS[op] + chReg, (uint8_t)tl);
+        }
+    }
+    if (mod_) mod_->setFMLevel(voice, carrierTL, attenuation);
+}
+
+void GenesisSynth::loadPatch(uint8_t voice, const FMPatch& patch) {
+    FMPatchImage image;
+    FMPatchUtils::compile(patch, image);
+    loadPatch(voice, image);
+}
+
+void GenesisSynth::loadPatch(uint8_t voice, const FMPatchImage& patch) {
+    // Queued writes were made before the patch, so they go out first
+    flush();
+    if (mod_) mod_->lock();
+    FMPatchUtils::loadImage(board_, voice, patch);
+    if (mod_) {
+        mod_->invalidateFM();
+        mod_->unlock();
+    }
+}
+
+void GenesisSynth::notePitch(uint8_t note, int16_t bend, uint8_t* block, uint16_t* fnum) {
+    FMFrequency::midiToFMWithBend(note, bend, fnum, block);
+}
+
+void GenesisSynth::writeFrequency(uint8_t voice, uint8_t block, uint16_t fnum) {
+    uint8_t port = (voice >= 3) ? 1 : 0;
+    uint8_t chReg = voice % 3;
+
+    // High byte first: 0xA4 latches until 0xA0 is written, and the queue
+    // keeps the pair in this order
+    writeYM2612(port, 0xA4 + chReg, (block << 3) | (fnum >> 8));
+    writeYM2612(port, 0xA0 + chReg, fnum & 0xFF);
+}
+
+void GenesisSynth::keyOn(uint8_t voice) {
+    uint8_t chBits = (voice >= 3) ? (voice - 3 + 4) : voice;
+    writeYM2612(0, 0x28, 0xF0 | chBits);
+}
+
+void GenesisSynth::keyOff(uint8_t voice) {
+    uint8_t chBits = (voice >= 3) ? (voice - 3 + 4) : voice;
+    writeYM2612(0, 0x28, chBits);
+}
+
+// =============================================================================
+// Write Queue
+// =============================================================================
+
+void GenesisSynth::writeYM2612(uint8_t port, uint8_t reg, uint8_t val) {
+    if (reg == 0x28) {
+        if (keyCount_ == GENESIS_SYNTH_QUEUE_SIZE) flush();
+        keys_[keyCount_++] = val;
+        return;
+    }
+
+    port &= 1;
+    uint8_t* pairs = pairs_[port];
+    for (uint8_t i = 0; i < count_[port]; i++) {
+        if (pairs[i * 2] == reg) {
+            pairs[i * 2 + 1] = val;
+            return;
+        }
+    }
+
+    if (count_[port] == GENESIS_SYNTH_QUEUE_SIZE) flush();
+    pairs[count_[port] * 2] = reg;
+    pairs[count_[port] * 2 + 1] = val;
+    count_[port]++;
+}
+
+void GenesisSynth::flush() {
+    if (pending() == 0) return;
+    if (mod_) mod_->lock();
+
+    for (uint8_t port = 0; port < 2; port++) {
+        if (count_[port] > 0) {
+            board_.writeYM2612Batch(port, pairs_[port], count_[port]);
+            count_[port] = 0;
+        }
+    }
+
+    if (keyCount_ > 0) {
+        uint8_t pairs[GENESIS_SYNTH_QUEUE_SIZE * 2];
+        for (uint8_t i = 0; i < keyCount_; i++) {
+            pairs[i * 2] = 0x28;
+            pairs[i * 2 + 1] = keys_[i];
+        }
+        board_.writeYM2612Batch(0, pairs, keyCount_);
+        keyCount_ = 0;
+    }
+
+    // Modulated channels get their values back on the next tick
+    if (mod_) {
+        mod_->invalidateFM();
+        mod_->unlock();
+    }
+}
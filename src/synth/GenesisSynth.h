@@ -0,0 +1,214 @@
+#ifndef GENESIS_SYNTH_H
+#define GENESIS_SYNTH_H
+
+#include <stdint.h>
+#include "../config/feature_config.h"
+#include "FMPatch.h"
+
+// Forward declarations
+class GenesisBoard;
+class ModulationEngine;
+
+/**
+ * FM Voice Allocator and Write Queue for MIDI Synthesis
+ *
+ * Manages the six YM2612 channels as voices:
+ * - Note to voice lookup through a 128-entry table (O(1) note off)
+ * - Free voices kept in release order, so a new note takes the voice
+ *   whose release tail has rung longest
+ * - Sounding voices kept in start order, so stealing takes the oldest note
+ *
+ * Register writes are queued instead of going straight to the chip.
+ * A write to a register already in the queue replaces the queued value,
+ * so a chord or an arpeggio costs one burst per flush() instead of a bus
+ * transaction per register. Key on/off events (0x28) keep their order and
+ * go out after the register writes. Call flush() once per pass of loop()
+ * after the MIDI input has been drained.
+ *
+ * Usage:
+ *   GenesisSynth synth(board);
+ *   uint8_t v = synth.allocateVoice(note);
+ *   synth.noteOn(v, note, velocity, patch);
+ *   ...
+ *   synth.flush();
+ */
+class GenesisSynth {
+public:
+    static const uint8_t NUM_VOICES = 6;
+    static const uint8_t NO_VOICE = 0x0F;
+
+    explicit GenesisSynth(GenesisBoard& board);
+
+    /**
+     * Hand FM notes to a modulation engine (software vibrato, tremolo and
+     * sweeps). flush() and loadPatch() then hold its tick off while they
+     * use the bus.
+     *
+     * @param mod Engine to feed, or nullptr to detach
+     */
+    void setModulation(ModulationEngine* mod) { mod_ = mod; }
+
+    /**
+     * Forget all voices and queued writes without touching the chip
+     * (used when patches are reloaded on every channel)
+     */
+    void reset();
+
+    // =========================================================================
+    // Voice Allocation
+    // =========================================================================
+
+    /**
+     * Pick a voice for a new note.
+     *   1. The voice already playing this note (retrigger)
+     *   2. The free voice released longest ago
+     *   3. The oldest sounding voice, keyed off (voice stealing)
+     *
+     * @param note MIDI note number (0-127)
+     * @return Voice (0-5)
+     */
+    uint8_t allocateVoice(uint8_t note);
+
+    /**
+     * Find the voice playing a note
+     *
+     * @param note MIDI note number (0-127)
+     * @return Voice (0-5), or NO_VOICE if the note isn't sounding
+     */
+    uint8_t findVoice(uint8_t note) const;
+
+    // =========================================================================
+    // Voices
+    // =========================================================================
+
+    /**
+     * Start a note: velocity on the carrier TLs, frequency, key on
+     *
+     * @param voice FM channel (0-5)
+     * @param note MIDI note number (0-127)
+     * @param velocity MIDI velocity (1-127)
+     * @param patch Patch loaded on the channel (for carrier TLs)
+     * @param bend Pitch bend offset (-8192 to +8191)
+     */
+    void noteOn(uint8_t voice, uint8_t note, uint8_t velocity,
+                const FMPatch& patch, int16_t bend = 0);
+    void noteOn(uint8_t voice, uint8_t note, uint8_t velocity,
+                const FMPatchImage& patch, int16_t bend = 0);
+
+    /**
+     * Release a note if it is the one the voice is playing
+     *
+     * @param voice FM channel (0-5)
+     * @param note MIDI note number (0-127)
+     * @param sustain Sustain pedal held: keep sounding until releaseSustained()
+     * @return true if the voice was keyed off
+     */
+    bool noteOff(uint8_t voice, uint8_t note, bool sustain = false);
+
+    /**
+     * Key off a voice held by the sustain pedal
+     */
+    void releaseSustained(uint8_t voice);
+
+    /**
+     * Key off a voice whatever it is playing
+     */
+    void release(uint8_t voice);
+
+    /**
+     * Re-pitch a sounding voice (does nothing if the voice is free)
+     */
+    void setPitchBend(uint8_t voice, int16_t bend);
+
+    /**
+     * Scale the carrier TLs of a channel
+     *
+     * @param voice FM channel (0-5)
+     * @param patch Patch loaded on the channel
+     * @param attenuation Added to each carrier's TL (clamped to 127)
+     */
+    void setCarrierLevel(uint8_t voice, const FMPatch& patch, uint8_t attenuation);
+    void setCarrierLevel(uint8_t voice, const FMPatchImage& patch, uint8_t attenuation);
+
+    /**
+     * Flush the queue and load a patch on a channel
+     * (a compiled patch skips the field packing, see FMPatchBank)
+     */
+    void loadPatch(uint8_t voice, const FMPatch& patch);
+    void loadPatch(uint8_t voice, const FMPatchImage& patch);
+
+    bool isNoteOn(uint8_t voice) const { return voices_[voice].on; }
+    uint8_t note(uint8_t voice) const { return voices_[voice].note; }
+    uint8_t velocity(uint8_t voice) const { return voices_[voice].velocity; }
+
+    // =========================================================================
+    // Write Queue
+    // =========================================================================
+
+    /**
+     * Queue a YM2612 register write (0x28 goes to the key event list)
+     */
+    void writeYM2612(uint8_t port, uint8_t reg, uint8_t val);
+
+    /**
+     * Send everything queued: port 0 and port 1 registers as one burst
+     * each, then the key events in the order they were made
+     */
+    void flush();
+
+    /**
+     * Writes waiting for flush()
+     */
+    uint8_t pending() const { return count_[0] + count_[1] + keyCount_; }
+
+private:
+    struct Voice {
+        uint8_t note;
+        uint8_t velocity;
+        bool on;
+        bool sustainPending;
+        uint8_t prev;   // Neighbours in the free or busy list
+        uint8_t next;
+    };
+
+    struct VoiceList {
+        uint8_t head;   // Oldest
+        uint8_t tail;   // Newest
+    };
+
+    void unlink(VoiceList& list, uint8_t voice);
+    void append(VoiceList& list, uint8_t voice);
+
+    uint8_t lookup(uint8_t note) const;
+    void setLookup(uint8_t note, uint8_t voice);
+
+    // Carrier TLs in FMPatch::op order, 0xFF for modulators
+    void startNote(uint8_t voice, uint8_t note, uint8_t velocity,
+                   const uint8_t* carrierTL, int16_t bend);
+    void writeCarrierLevel(uint8_t voice, const uint8_t* carrierTL, uint8_t attenuation);
+
+    static void notePitch(uint8_t note, int16_t bend, uint8_t* block, uint16_t* fnum);
+    void writeFrequency(uint8_t voice, uint8_t block, uint16_t fnum);
+    void keyOn(uint8_t voice);
+    void keyOff(uint8_t voice);
+
+    GenesisBoard& board_;
+    ModulationEngine* mod_;
+
+    Voice voices_[NUM_VOICES];
+    VoiceList free_;
+    VoiceList busy_;
+
+    // Voice playing each MIDI note, two notes per byte (NO_VOICE = none)
+    uint8_t noteVoice_[64];
+
+    // (reg, val) pairs per port, laid out for writeYM2612Batch()
+    uint8_t pairs_[2][GENESIS_SYNTH_QUEUE_SIZE * 2];
+    uint8_t count_[2];
+
+    // Key on/off register values in order
+    uint8_t keys_[GENESIS_SYNTH_QUEUE_SIZE];
+    uint8_t keyCount_;
+};
+
+#endif // GENESIS_SYNTH_H
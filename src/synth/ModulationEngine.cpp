@@ -0,0 +1,398 @@
+#include "ModulationEngine.h"
+#include "../GenesisBoard.h"
+#include "../RegisterWriteQueue.h"
+
+static const uint32_t TICK_MICROS = 1000000UL / GENESIS_SYNTH_MOD_TICK_HZ;
+static const uint8_t TICKS_PER_STEP = GENESIS_SYNTH_MOD_TICK_HZ / ModulationEngine::ENVELOPE_HZ;
+
+// Most ticks update() runs at once before it gives up on catching up
+static const uint8_t MAX_CATCHUP_TICKS = 8;
+
+#if GENESIS_ENGINE_USE_TIMER
+// Engine owning the timer (IntervalTimer callbacks take no user data)
+static ModulationEngine* g_modulationEngine = nullptr;
+#endif
+
+ModulationEngine::ModulationEngine(GenesisBoard& board)
+    : timerRunning_(false),
+      nextTickMicros_(0),
+      board_(board),
+      locked_(false),
+      ticksSkipped_(0),
+      ticksRun_(0)
+{
+    for (uint8_t c = 0; c < NUM_CHANNELS; c++) {
+        flags_[c] = 0;
+        pitch_[c] = 0;
+        level_[c] = 0;
+        lfoPhase_[c] = 0;
+        lfoRate_[c] = 0;
+        vibrato_[c] = 0;
+        tremolo_[c] = 0;
+        sweepRate_[c] = 0;
+        sweep_[c] = 0;
+        outPitch_[c] = 0xFFFF;
+        outLevel_[c] = 0xFF;
+    }
+    for (uint8_t c = 0; c < FM_CHANNELS; c++) {
+        block_[c] = 0;
+        for (uint8_t op = 0; op < 4; op++) {
+            carrierTL_[c][op] = 0xFF;
+        }
+    }
+    for (uint8_t c = 0; c < PSG_CHANNELS; c++) {
+        envelope_[c] = nullptr;
+        envPos_[c] = 0;
+        envTicks_[c] = 0;
+    }
+}
+
+// =============================================================================
+// Tick Source
+// =============================================================================
+
+bool ModulationEngine::begin() {
+    nextTickMicros_ = micros() + TICK_MICROS;
+
+#if GENESIS_ENGINE_USE_TIMER
+    if (g_modulationEngine && g_modulationEngine != this) {
+        return false;  // Another engine owns the timer: poll instead
+    }
+    g_modulationEngine = this;
+    timerRunning_ = timer_.begin(timerISR, TICK_MICROS);
+    if (!timerRunning_) {
+        g_modulationEngine = nullptr;
+    }
+#endif
+    return timerRunning_;
+}
+
+void ModulationEngine::end() {
+#if GENESIS_ENGINE_USE_TIMER
+    if (timerRunning_) {
+        timer_.end();
+        timerRunning_ = false;
+    }
+    if (g_modulationEngine == this) {
+        g_modulationEngine = nullptr;
+    }
+#endif
+}
+
+#if GENESIS_ENGINE_USE_TIMER
+void ModulationEngine::timerISR() {
+    ModulationEngine* engine = g_modulationEngine;
+    if (!engine) {
+        return;
+    }
+
+    // loop() is on the bus: unlock() runs this tick instead
+    if (engine->locked_) {
+        engine->ticksSkipped_ = engine->ticksSkipped_ + 1;
+        return;
+    }
+    engine->tick();
+}
+#endif
+
+void ModulationEngine::update() {
+    if (timerRunning_) {
+        return;
+    }
+
+    uint32_t now = micros();
+    uint8_t ran = 0;
+    while ((int32_t)(now - nextTickMicros_) >= 0) {
+        nextTickMicros_ += TICK_MICROS;
+        tick();
+
+        // After a long stall, drop the backlog rather than rushing through it
+        if (++ran == MAX_CATCHUP_TICKS) {
+            nextTickMicros_ = now + TICK_MICROS;
+            break;
+        }
+    }
+}
+
+void ModulationEngine::lock() {
+    locked_ = true;
+    GENESIS_MEMORY_BARRIER();
+}
+
+void ModulationEngine::unlock() {
+    GENESIS_MEMORY_BARRIER();
+    for (;;) {
+        while (ticksRun_ != ticksSkipped_) {
+            ticksRun_++;
+            tick();
+        }
+        locked_ = false;
+
+        // A tick skipped between the last check and the unlock is still owed
+        if (ticksRun_ == ticksSkipped_) {
+            return;
+        }
+        locked_ = true;
+    }
+}
+
+// =============================================================================
+// Modulation Settings
+// =============================================================================
+
+void ModulationEngine::setVibrato(uint8_t channel, uint8_t rate, uint8_t depth) {
+    if (channel >= NUM_CHANNELS) return;
+    lock();
+    lfoRate_[channel] = rate;
+    vibrato_[channel] = depth > 127 ? 127 : depth;
+    unlock();
+}
+
+void ModulationEngine::setTremolo(uint8_t channel, uint8_t depth) {
+    if (channel >= NUM_CHANNELS) return;
+    lock();
+    tremolo_[channel] = depth > 127 ? 127 : depth;
+    unlock();
+}
+
+void ModulationEngine::setSweep(uint8_t channel, int16_t rate) {
+    if (channel >= NUM_CHANNELS) return;
+    lock();
+    sweepRate_[channel] = rate;
+    unlock();
+}
+
+// =============================================================================
+// FM Channels
+// =============================================================================
+
+void ModulationEngine::fmNoteOn(uint8_t channel, uint8_t block, uint16_t fnum,
+                                const uint8_t* carrierTL, uint8_t attenuation) {
+    if (channel >= FM_CHANNELS) return;
+
+    lock();
+    block_[channel] = block;
+    pitch_[channel] = fnum;
+    level_[channel] = attenuation;
+    for (uint8_t op = 0; op < 4; op++) {
+        carrierTL_[channel][op] = carrierTL[op];
+    }
+    sweep_[channel] = 0;
+    outPitch_[channel] = 0xFFFF;
+    outLevel_[channel] = 0xFF;
+    flags_[channel] |= ACTIVE;
+    unlock();
+}
+
+void ModulationEngine::fmNoteOff(uint8_t channel) {
+    if (channel >= FM_CHANNELS) return;
+    lock();
+    flags_[channel] &= ~ACTIVE;
+    unlock();
+}
+
+void ModulationEngine::setFMPitch(uint8_t channel, uint8_t block, uint16_t fnum) {
+    if (channel >= FM_CHANNELS) return;
+    lock();
+    block_[channel] = block;
+    pitch_[channel] = fnum;
+    outPitch_[channel] = 0xFFFF;
+    unlock();
+}
+
+void ModulationEngine::setFMLevel(uint8_t channel, const uint8_t* carrierTL, uint8_t attenuation) {
+    if (channel >= FM_CHANNELS) return;
+
+    lock();
+    level_[channel] = attenuation;
+    for (uint8_t op = 0; op < 4; op++) {
+        carrierTL_[channel][op] = carrierTL[op];
+    }
+    outLevel_[channel] = 0xFF;
+    unlock();
+}
+
+void ModulationEngine::invalidateFM() {
+    // Called with the lock held, or from code the tick can't interrupt
+    for (uint8_t c = 0; c < FM_CHANNELS; c++) {
+        outPitch_[c] = 0xFFFF;
+        outLevel_[c] = 0xFF;
+    }
+}
+
+// =============================================================================
+// PSG Channels
+// =============================================================================
+
+void ModulationEngine::psgNoteOn(uint8_t channel, uint16_t tone, uint8_t attenuation,
+                                 const PSGEnvelope* envelope) {
+    if (channel >= PSG_CHANNELS) return;
+    uint8_t c = PSG_BASE + channel;
+
+    if (envelope && envelope->length == 0) envelope = nullptr;
+    uint8_t volume = attenuation;
+    if (envelope) volume += envelope->data[0] & 0x0F;
+    if (volume > 15) volume = 15;
+
+    lock();
+    pitch_[c] = tone;
+    level_[c] = attenuation;
+    sweep_[c] = 0;
+    envelope_[channel] = envelope;
+    envPos_[channel] = 0;
+    envTicks_[channel] = 0;
+    flags_[c] |= ACTIVE;
+
+    // Tone and first volume go out now, the tick takes over from there
+    uint8_t bytes[3];
+    uint8_t n = 0;
+    if (channel < 3) {
+        bytes[n++] = 0x80 | (channel << 5) | (tone & 0x0F);
+        bytes[n++] = (tone >> 4) & 0x3F;
+    } else {
+        bytes[n++] = 0xE0 | (tone & 0x07);
+    }
+    bytes[n++] = 0x90 | (channel << 5) | volume;
+    board_.writePSGBatch(bytes, n);
+    outPitch_[c] = tone;
+    outLevel_[c] = volume;
+    unlock();
+}
+
+void ModulationEngine::psgNoteOff(uint8_t channel) {
+    if (channel >= PSG_CHANNELS) return;
+    uint8_t c = PSG_BASE + channel;
+
+    lock();
+    flags_[c] &= ~ACTIVE;
+    board_.writePSG(0x90 | (channel << 5) | 0x0F);
+    outLevel_[c] = 15;
+    unlock();
+}
+
+void ModulationEngine::setPSGPitch(uint8_t channel, uint16_t tone) {
+    if (channel >= 3) return;
+    lock();
+    pitch_[PSG_BASE + channel] = tone;
+    unlock();
+}
+
+bool ModulationEngine::isPSGActive(uint8_t channel) const {
+    return channel < PSG_CHANNELS && (flags_[PSG_BASE + channel] & ACTIVE);
+}
+
+// =============================================================================
+// Tick
+// =============================================================================
+
+static inline int16_t clampSweep(int16_t sweep, int16_t rate) {
+    int16_t s = sweep + rate;
+    if (s > 2047) s = 2047;
+    if (s < -2047) s = -2047;
+    return s;
+}
+
+void ModulationEngine::tick() {
+    // Worst case: frequency and four carrier TLs on every FM channel,
+    // tone and volume on every PSG channel
+    uint8_t fm[2][3 * 6 * 2];
+    uint8_t fmCount[2] = {0, 0};
+    uint8_t psg[3 * 3 + 1];
+    uint8_t psgCount = 0;
+
+    // FM: vibrato and sweep on the F-number, tremolo on the carrier TLs
+    for (uint8_t c = 0; c < FM_CHANNELS; c++) {
+        if (!(flags_[c] & ACTIVE)) continue;
+        if (!(vibrato_[c] | tremolo_[c]) && sweepRate_[c] == 0 && sweep_[c] == 0) continue;
+
+        // Triangle LFO, -128..127
+        lfoPhase_[c] += lfoRate_[c];
+        uint8_t ph = lfoPhase_[c];
+        int16_t lfo = (ph < 128 ? ph : 255 - ph) * 2 - 128;
+
+        sweep_[c] = clampSweep(sweep_[c], sweepRate_[c]);
+        int32_t pitch = (int32_t)pitch_[c] + sweep_[c];
+        pitch += ((int32_t)pitch_[c] * lfo * vibrato_[c]) >> 17;
+        if (pitch < 0) pitch = 0;
+        if (pitch > 2047) pitch = 2047;
+
+        uint16_t atten = level_[c] + (((lfo + 128) * tremolo_[c]) >> 10);
+        if (atten > 127) atten = 127;
+
+        uint8_t port = (c >= 3) ? 1 : 0;
+        uint8_t chReg = c % 3;
+        uint8_t* out = fm[port] + fmCount[port] * 2;
+
+        if (pitch != outPitch_[c]) {
+            outPitch_[c] = pitch;
+            *out++ = 0xA4 + chReg; *out++ = (block_[c] << 3) | (pitch >> 8);
+            *out++ = 0xA0 + chReg; *out++ = pitch & 0xFF;
+            fmCount[port] += 2;
+        }
+        if (atten != outLevel_[c]) {
+            outLevel_[c] = atten;
+            for (uint8_t op = 0; op < 4; op++) {
+                if (carrierTL_[c][op] == 0xFF) continue;
+                uint16_t tl = carrierTL_[c][op] + atten;
+                *out++ = 0x40 + FMPatchUtils::OPERATOR_OFFSETS[op] + chReg;
+                *out++ = tl > 127 ? 127 : tl;
+                fmCount[port]++;
+            }
+        }
+    }
+
+    // PSG: envelope and tremolo on the volume, vibrato and sweep on the tone
+    for (uint8_t ch = 0; ch < PSG_CHANNELS; ch++) {
+        uint8_t c = PSG_BASE + ch;
+        if (!(flags_[c] & ACTIVE)) continue;
+
+        // Envelope step at ENVELOPE_HZ, counted from this channel's note on
+        uint8_t volume = level_[c];
+        const PSGEnvelope* env = envelope_[ch];
+        if (env) {
+            if (++envTicks_[ch] >= TICKS_PER_STEP) {
+                envTicks_[ch] = 0;
+                if (envPos_[ch] + 1 < env->length) {
+                    envPos_[ch]++;
+                } else if (env->loopStart != 0xFF) {
+                    envPos_[ch] = env->loopStart;
+                }
+            }
+            volume += env->data[envPos_[ch]] & 0x0F;
+        }
+
+        int16_t lfo = 0;
+        if (vibrato_[c] | tremolo_[c]) {
+            lfoPhase_[c] += lfoRate_[c];
+            uint8_t ph = lfoPhase_[c];
+            lfo = (ph < 128 ? ph : 255 - ph) * 2 - 128;
+            volume += ((lfo + 128) * tremolo_[c]) >> 12;
+        }
+        if (volume > 15) volume = 15;
+
+        if (ch < 3) {
+            // Tone period: a larger period is a lower pitch
+            sweep_[c] = clampSweep(sweep_[c], sweepRate_[c]);
+            int32_t tone = (int32_t)pitch_[c] - sweep_[c];
+            tone -= ((int32_t)pitch_[c] * lfo * vibrato_[c]) >> 17;
+            if (tone < 1) tone = 1;
+            if (tone > 1023) tone = 1023;
+
+            if (tone != outPitch_[c]) {
+                outPitch_[c] = tone;
+                psg[psgCount++] = 0x80 | (ch << 5) | (tone & 0x0F);
+                psg[psgCount++] = (tone >> 4) & 0x3F;
+            }
+        }
+        if (volume != outLevel_[c]) {
+            outLevel_[c] = volume;
+            psg[psgCount++] = 0x90 | (ch << 5) | volume;
+        }
+    }
+
+    board_.writeYM2612Batch(0, fm[0], fmCount[0]);
+    board_.writeYM2612Batch(1, fm[1], fmCount[1]);
+    if (psgCount > 0) {
+        board_.writePSGBatch(psg, psgCount);
+    }
+}
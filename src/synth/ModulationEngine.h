@@ -0,0 +1,230 @@
+#ifndef GENESIS_MODULATION_ENGINE_H
+#define GENESIS_MODULATION_ENGINE_H
+
+#include <stdint.h>
+#include "../config/feature_config.h"
+#include "FMPatch.h"
+#include "PSGEnvelope.h"
+
+#if GENESIS_ENGINE_USE_TIMER
+#include <IntervalTimer.h>
+#endif
+
+// Forward declaration
+class GenesisBoard;
+
+/**
+ * Software Modulation Engine
+ *
+ * Runs PSG volume envelopes, per-channel vibrato and tremolo (triangle
+ * LFO) and pitch sweeps at a fixed tick rate (GENESIS_SYNTH_MOD_TICK_HZ).
+ * Each tick computes every channel in one pass over struct-of-arrays
+ * state and sends only the values that changed, as one burst per chip.
+ *
+ * Channels 0-5 are the FM channels, 6-9 the PSG channels (6-8 tone,
+ * 9 noise).
+ *
+ * On boards with IntervalTimer (Teensy) begin() runs the tick from a
+ * timer interrupt, so envelope timing doesn't depend on how busy loop()
+ * is. Elsewhere call update() from loop(); it runs whatever ticks are due.
+ *
+ * The tick writes to the chips, so loop() must not use the bus while a
+ * tick can run. Every method here takes care of that itself. Other chip
+ * writes go between lock() and unlock() (GenesisSynth does this when a
+ * modulation engine is attached). Ticks that fall due while locked run
+ * in unlock().
+ *
+ * Usage:
+ *   ModulationEngine mod(board);
+ *   mod.begin();
+ *   mod.psgNoteOn(0, tone, 0, &envelope);
+ *   mod.setVibrato(ModulationEngine::PSG_BASE + 0, 20, 40);
+ *   ...
+ *   mod.update();   // in loop(), needed only without a timer
+ */
+class ModulationEngine {
+public:
+    static const uint8_t FM_CHANNELS = 6;
+    static const uint8_t PSG_CHANNELS = 4;
+    static const uint8_t PSG_BASE = FM_CHANNELS;
+    static const uint8_t NUM_CHANNELS = FM_CHANNELS + PSG_CHANNELS;
+
+    // PSG envelope data is written in 60Hz steps (see PSGEnvelope.h)
+    static const uint8_t ENVELOPE_HZ = 60;
+
+    explicit ModulationEngine(GenesisBoard& board);
+
+    /**
+     * Start ticking
+     *
+     * @return true if a hardware timer drives the ticks, false if
+     *         update() has to be called from loop()
+     */
+    bool begin();
+
+    /**
+     * Stop the timer (state is kept)
+     */
+    void end();
+
+    /**
+     * Run the ticks that are due. Does nothing while the timer runs.
+     */
+    void update();
+
+    /**
+     * Hold off the tick while loop() uses the bus (does not nest)
+     */
+    void lock();
+
+    /**
+     * Release the bus and run any ticks held off by lock()
+     */
+    void unlock();
+
+    // =========================================================================
+    // Modulation Settings (any channel)
+    // =========================================================================
+
+    /**
+     * Software vibrato
+     *
+     * @param channel 0-5 FM, 6-9 PSG
+     * @param rate LFO phase step per tick (256 = one cycle)
+     * @param depth 0 = off, 127 = about +/-2 semitones
+     */
+    void setVibrato(uint8_t channel, uint8_t rate, uint8_t depth);
+
+    /**
+     * Software tremolo (shares the vibrato LFO rate)
+     *
+     * @param channel 0-5 FM, 6-9 PSG
+     * @param depth 0 = off, 127 = 23dB on FM carriers, 14dB on the PSG
+     */
+    void setTremolo(uint8_t channel, uint8_t depth);
+
+    /**
+     * Pitch sweep, restarted by every note on
+     *
+     * @param channel 0-5 FM, 6-8 PSG tone
+     * @param rate Pitch register units per tick, positive sweeps up
+     *             (F-number on FM, tone period on the PSG)
+     */
+    void setSweep(uint8_t channel, int16_t rate);
+
+    // =========================================================================
+    // FM Channels (fed by GenesisSynth)
+    // =========================================================================
+
+    /**
+     * A note started: the base pitch and carrier levels the tick modulates
+     *
+     * @param channel FM channel (0-5)
+     * @param block Block the note plays in
+     * @param fnum F-number (with pitch bend)
+     * @param carrierTL Carrier TLs of the loaded patch, 0xFF for modulators
+     *                  (FMPatchUtils::getCarrierLevels())
+     * @param attenuation Added to each carrier's TL
+     */
+    void fmNoteOn(uint8_t channel, uint8_t block, uint16_t fnum,
+                  const uint8_t* carrierTL, uint8_t attenuation);
+
+    /**
+     * Stop modulating a channel (the release tail keeps its last pitch)
+     */
+    void fmNoteOff(uint8_t channel);
+
+    /**
+     * New base pitch (pitch bend)
+     */
+    void setFMPitch(uint8_t channel, uint8_t block, uint16_t fnum);
+
+    /**
+     * New carrier levels (volume)
+     */
+    void setFMLevel(uint8_t channel, const uint8_t* carrierTL, uint8_t attenuation);
+
+    /**
+     * Resend every modulated FM value on the next tick (call after
+     * something else wrote the same registers)
+     */
+    void invalidateFM();
+
+    // =========================================================================
+    // PSG Channels
+    // =========================================================================
+
+    /**
+     * Start a PSG note: writes tone and volume now, envelope runs from there
+     *
+     * @param channel PSG channel (0-2 tone, 3 noise)
+     * @param tone Tone period (0-1023), or the noise mode (0-7) on channel 3
+     * @param attenuation Added to the envelope volume (0-15)
+     * @param envelope Envelope to run (must remain valid), or nullptr to
+     *                 hold the note at attenuation
+     */
+    void psgNoteOn(uint8_t channel, uint16_t tone, uint8_t attenuation,
+                   const PSGEnvelope* envelope);
+
+    /**
+     * Silence a PSG channel now
+     */
+    void psgNoteOff(uint8_t channel);
+
+    /**
+     * New base tone (pitch bend), written on the next tick
+     *
+     * @param channel PSG tone channel (0-2)
+     * @param tone Tone period (1-1023)
+     */
+    void setPSGPitch(uint8_t channel, uint16_t tone);
+
+    bool isPSGActive(uint8_t channel) const;
+
+private:
+    enum : uint8_t {
+        ACTIVE = 0x01,  // Note playing, channel is being modulated
+    };
+
+    // One pass over every channel, changed values out as one burst per chip
+    void tick();
+
+#if GENESIS_ENGINE_USE_TIMER
+    static void timerISR();
+    IntervalTimer timer_;
+#endif
+    bool timerRunning_;
+    uint32_t nextTickMicros_;
+
+    GenesisBoard& board_;
+
+    // Tick hand-off: the ISR counts ticks it skipped, unlock() counts the
+    // ones it ran, each side writes only its own counter
+    volatile bool locked_;
+    volatile uint8_t ticksSkipped_;
+    uint8_t ticksRun_;
+
+    // Per-channel state, indexed by channel (0-9)
+    uint8_t flags_[NUM_CHANNELS];
+    uint16_t pitch_[NUM_CHANNELS];      // Base F-number or tone period
+    uint8_t level_[NUM_CHANNELS];       // Base attenuation
+    uint8_t lfoPhase_[NUM_CHANNELS];
+    uint8_t lfoRate_[NUM_CHANNELS];
+    uint8_t vibrato_[NUM_CHANNELS];
+    uint8_t tremolo_[NUM_CHANNELS];
+    int16_t sweepRate_[NUM_CHANNELS];
+    int16_t sweep_[NUM_CHANNELS];       // Sweep travelled since note on
+    uint16_t outPitch_[NUM_CHANNELS];   // Last pitch written
+    uint8_t outLevel_[NUM_CHANNELS];    // Last attenuation written
+
+    // FM only
+    uint8_t block_[FM_CHANNELS];
+    uint8_t carrierTL_[FM_CHANNELS][4]; // Patch TL, 0xFF for modulators
+
+    // PSG only
+    const PSGEnvelope* envelope_[PSG_CHANNELS];
+    uint8_t envPos_[PSG_CHANNELS];
+    uint8_t envTicks_[PSG_CHANNELS];     // Ticks spent on the current step
+};
+
+#endif // GENESIS_MODULATION_ENGINE_H
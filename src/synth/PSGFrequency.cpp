@@ -1,4 +1,5 @@
 #include "PSGFrequency.h"
+#include "FinePitch.h"
 #include "../GenesisBoard.h"
 
 // Pre-calculated tone table for MIDI notes 0-127
@@ -36,6 +37,34 @@ uint16_t midiToTone(uint8_t midiNote) {
     return GENESIS_READ_WORD(&psgToneTable[midiNote]);
 }
 
+// Dividers shrink as pitch rises: clamp to what the 10-bit counter holds
+static uint16_t clampTone(uint32_t tone) {
+    if (tone < 1) return 1;
+    if (tone > 1023) return 1023;
+    return (uint16_t)tone;
+}
+
+uint16_t midiToToneWithBend(uint8_t midiNote, int16_t bend, uint8_t bendRange) {
+    int8_t semitones;
+    uint16_t fine;
+    FinePitch::split(bend, bendRange, &semitones, &fine);
+
+    int16_t note = (int16_t)midiNote + semitones;
+    if (note < 0) note = 0;
+    if (note > 127) note = 127;
+
+    return clampTone(FinePitch::scaleFine(midiToTone((uint8_t)note), fine, false));
+}
+
+uint16_t applyBend(uint16_t tone, int16_t bend, uint8_t bendRange) {
+    if (bend == 0) return tone;
+
+    int8_t semitones;
+    uint16_t fine;
+    FinePitch::split(bend, bendRange, &semitones, &fine);
+    return clampTone(FinePitch::scale(tone, semitones, fine, false));
+}
+
 void writeToneValue(GenesisBoard& board, uint8_t channel, uint16_t tone) {
     if (channel > 2) return;  // Only tone channels 0-2
 
@@ -57,6 +86,14 @@ void writeToChannel(GenesisBoard& board, uint8_t channel, uint8_t midiNote) {
     writeToneValue(board, channel, tone);
 }
 
+void writeToChannelWithBend(GenesisBoard& board, uint8_t channel,
+                            uint8_t midiNote, int16_t bend) {
+    if (channel > 2) return;
+
+    uint16_t tone = midiToToneWithBend(midiNote, bend);
+    writeToneValue(board, channel, tone);
+}
+
 void setVolume(GenesisBoard& board, uint8_t channel, uint8_t volume) {
     if (channel > 3) return;  // Channels 0-3 (3 is noise)
     if (volume > 15) volume = 15;
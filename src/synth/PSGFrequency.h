@@ -29,6 +29,30 @@ namespace PSGFrequency {
      */
     uint16_t midiToTone(uint8_t midiNote);
 
+    /**
+     * Convert a bent MIDI note to SN76489 tone value
+     *
+     * Whole semitones of bend move to the neighbouring note, the rest
+     * scales the divider through the fine pitch tables in 1/64-semitone
+     * steps (see FinePitch.h). No division or float.
+     *
+     * @param midiNote MIDI note number (0-127)
+     * @param bend Pitch bend offset (-8192 to +8191, 0=no bend)
+     * @param bendRange Bend range in semitones (default 2, standard MIDI)
+     * @return 10-bit tone value (1-1023)
+     */
+    uint16_t midiToToneWithBend(uint8_t midiNote, int16_t bend, uint8_t bendRange = 2);
+
+    /**
+     * Apply pitch bend to a tone value
+     *
+     * @param tone Base tone value from midiToTone()
+     * @param bend Pitch bend offset (-8192 to +8191, 0=no bend)
+     * @param bendRange Bend range in semitones (default 2, standard MIDI)
+     * @return Modified tone value (clamped to 1-1023)
+     */
+    uint16_t applyBend(uint16_t tone, int16_t bend, uint8_t bendRange = 2);
+
     /**
      * Write tone to PSG channel
      *
@@ -41,6 +65,19 @@ namespace PSGFrequency {
      */
     void writeToChannel(GenesisBoard& board, uint8_t channel, uint8_t midiNote);
 
+    /**
+     * Write tone with pitch bend to PSG channel
+     *
+     * Same as writeToChannel but applies pitch bend to the tone.
+     *
+     * @param board GenesisBoard instance
+     * @param channel PSG tone channel (0-2 only, not noise)
+     * @param midiNote MIDI note number (0-127)
+     * @param bend Pitch bend offset (-8192 to +8191)
+     */
+    void writeToChannelWithBend(GenesisBoard& board, uint8_t channel,
+                                uint8_t midiNote, int16_t bend);
+
     /**
      * Write raw tone value to PSG channel
      *
@@ -0,0 +1,137 @@
+#include "MockBoard.h"
+#include <Arduino.h>
+
+namespace MockBoard {
+
+static const uint8_t MAX_CHIPS = 4;
+static const uint8_t NO_PIN = 0xFF;
+
+struct Chip {
+  Pins pins;
+  uint8_t shift;        // Shift register outputs (last SPI byte)
+  uint8_t address[2];   // Latched YM2612 register per port
+  uint64_t busyUntil;   // Host clock the busy bit clears at
+};
+
+static Chip chips_[MAX_CHIPS];
+static uint8_t chipCount_ = 0;
+static uint8_t level_[256];
+static Listener listener_ = nullptr;
+static void* context_ = nullptr;
+static uint32_t busyNanos_ = 2000;
+static uint32_t statusReads_ = 0;
+
+static uint8_t reverseBits(uint8_t b) {
+  b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+  b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+  b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+  return b;
+}
+
+// Byte the chip sees on D0-D7
+static uint8_t busByte(const Chip& chip) {
+  if (chip.pins.data[0] == NO_PIN) {
+    return chip.shift;
+  }
+  uint8_t value = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    if (level_[chip.pins.data[i]]) value |= (uint8_t)(1 << i);
+  }
+  return value;
+}
+
+static void report(uint8_t chip, uint8_t type, uint8_t port, uint8_t reg, uint8_t val) {
+  if (!listener_) return;
+  Write write = { HostClock::nanos(), chip, type, port, reg, val };
+  listener_(write, context_);
+}
+
+void clear() {
+  chipCount_ = 0;
+  memset(level_, 0, sizeof(level_));
+  statusReads_ = 0;
+}
+
+uint8_t addChip(const Pins& pins) {
+  if (chipCount_ == MAX_CHIPS) {
+    return NO_PIN;
+  }
+  Chip& chip = chips_[chipCount_];
+  chip.pins = pins;
+  chip.shift = 0;
+  chip.address[0] = chip.address[1] = 0;
+  chip.busyUntil = 0;
+  return chipCount_++;
+}
+
+void setListener(Listener listener, void* context) {
+  listener_ = listener;
+  context_ = context;
+}
+
+void setBusyNanos(uint32_t ns) {
+  busyNanos_ = ns;
+}
+
+uint32_t getStatusReads() {
+  return statusReads_;
+}
+
+void pinWrite(uint8_t pin, uint8_t level) {
+  uint8_t previous = level_[pin];
+  level_[pin] = level ? 1 : 0;
+  if (previous == level_[pin]) {
+    return;
+  }
+  bool rising = level_[pin] != 0;
+
+  for (uint8_t i = 0; i < chipCount_; i++) {
+    Chip& chip = chips_[i];
+    const Pins& p = chip.pins;
+
+    if (pin == p.icY && !rising) {
+      chip.address[0] = chip.address[1] = 0;
+      report(i, WRITE_RESET, 0, 0, 0);
+    }
+    if (!level_[p.icY]) {
+      continue;   // Held in reset
+    }
+
+    // Both chips latch the bus as their write strobe rises
+    if (pin == p.wrY && rising) {
+      uint8_t port = level_[p.a1Y];
+      uint8_t value = busByte(chip);
+      if (!level_[p.a0Y]) {
+        chip.address[port] = value;
+      } else {
+        report(i, WRITE_YM, port, chip.address[port], value);
+        chip.busyUntil = HostClock::nanos() + busyNanos_;
+      }
+    }
+    if (pin == p.wrP && rising) {
+      report(i, WRITE_PSG, 0, 0, reverseBits(busByte(chip)));
+    }
+  }
+}
+
+int pinRead(uint8_t pin) {
+  for (uint8_t i = 0; i < chipCount_; i++) {
+    Chip& chip = chips_[i];
+    if (pin == chip.pins.busy && chip.pins.rdY != NO_PIN && !level_[chip.pins.rdY]) {
+      statusReads_++;
+      return HostClock::nanos() < chip.busyUntil ? HIGH : LOW;
+    }
+  }
+  return level_[pin];
+}
+
+void spiTransfer(uint8_t data) {
+  // Every shift register on the SPI lines loads the byte
+  for (uint8_t i = 0; i < chipCount_; i++) {
+    if (chips_[i].pins.data[0] == NO_PIN) {
+      chips_[i].shift = data;
+    }
+  }
+}
+
+}  // namespace MockBoard
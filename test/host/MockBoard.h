@@ -0,0 +1,76 @@
+#ifndef MOCK_BOARD_H
+#define MOCK_BOARD_H
+
+#include <stdint.h>
+
+// =============================================================================
+// MockBoard - the chips of one or more boards, seen from the pins
+//
+// The real GenesisBoard drives the host's digitalWrite() and SPI.transfer().
+// MockBoard follows the levels the way the chips would (the CD74HCT164E
+// loaded over SPI or the parallel D0-D7 bus, A0/A1, the WR strobes and the
+// IC reset) and reports every write that reaches a chip:
+// - YM2612: an address write (A0 low) latches the register for its port
+//   (A1), a data write (A0 high) is reported with the latched register
+// - SN76489: the byte on the bus when WR_P rises, bit order undone (the
+//   board wires QA to D7)
+// - A falling IC edge is reported as a reset
+// Status reads (RD low) return the busy bit for a while after a data write
+// (setBusyNanos()).
+// =============================================================================
+
+namespace MockBoard {
+
+enum WriteType : uint8_t {
+  WRITE_YM = 0,
+  WRITE_PSG = 1,
+  WRITE_RESET = 2
+};
+
+struct Write {
+  uint64_t nanos;   // Host clock at the write strobe
+  uint8_t chip;     // Index returned by addChip()
+  uint8_t type;     // WriteType
+  uint8_t port;     // YM2612 port (A1)
+  uint8_t reg;      // YM2612 register
+  uint8_t val;
+};
+
+// Pins of one board (the numbers passed to its GenesisBoard)
+// 0xFF = not wired
+struct Pins {
+  uint8_t wrP;
+  uint8_t wrY;
+  uint8_t icY;
+  uint8_t a0Y;
+  uint8_t a1Y;
+  uint8_t rdY;
+  uint8_t busy;
+  uint8_t data[8];  // Parallel bus D0-D7 (data[0] = 0xFF: shift register)
+};
+
+typedef void (*Listener)(const Write& write, void* context);
+
+// Forget all chips and pin levels
+void clear();
+
+// Wire up a board; returns its chip index
+uint8_t addChip(const Pins& pins);
+
+// Called for every write
+void setListener(Listener listener, void* context);
+
+// How long the YM2612 reports busy after a data write
+void setBusyNanos(uint32_t ns);
+
+// Pin reads on a status read while RD_Y was low (0 without read-back)
+uint32_t getStatusReads();
+
+// Hooks for the host core
+void pinWrite(uint8_t pin, uint8_t level);
+int pinRead(uint8_t pin);
+void spiTransfer(uint8_t data);
+
+}  // namespace MockBoard
+
+#endif // MOCK_BOARD_H
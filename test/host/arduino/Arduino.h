@@ -0,0 +1,148 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// =============================================================================
+// Host Arduino Core - just enough of the Arduino API to build the library on
+// a desktop (see test/host/README.md)
+//
+// Time is simulated: micros() only moves when the code waits or touches the
+// hardware, so a run writes the same log every time. Pin and SPI activity
+// goes to MockBoard, which turns it back into chip writes.
+// =============================================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <new>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define DEC 10
+#define HEX 16
+
+// -----------------------------------------------------------------------------
+// Flash strings and PROGMEM (flash is ordinary memory here)
+// -----------------------------------------------------------------------------
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(const void* const*)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+
+// -----------------------------------------------------------------------------
+// Time and Pins
+// -----------------------------------------------------------------------------
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void yield() {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+// Simulated clock, for the test runner
+namespace HostClock {
+  uint64_t nanos();
+  void advance(uint64_t ns);
+}
+
+// -----------------------------------------------------------------------------
+// Print / Stream / Serial
+// -----------------------------------------------------------------------------
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const __FlashStringHelper* s) { return print((const char*)s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return printNumber(v, base); }
+  size_t print(int v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned int v, int base = DEC) { return printNumber(v, base); }
+  size_t print(long v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned long v, int base = DEC) { return printNumber(v, base); }
+  size_t print(long long v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned long long v, int base = DEC) { return printNumber(v, base); }
+  size_t print(double v, int digits = 2) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, v);
+    return print(buffer);
+  }
+
+  template <typename T>
+  size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <typename T>
+  size_t println(T v, int format) { size_t n = print(v, format); return n + println(); }
+  size_t println() { return print("\r\n"); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  size_t printNumber(unsigned long long v, int base) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), base == HEX ? "%llX" : "%llu", v);
+    return print(buffer);
+  }
+  size_t printSigned(long long v, int base) {
+    if (base != DEC) return printNumber((unsigned long long)v, base);
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%lld", v);
+    return print(buffer);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// Serial output goes to stderr (kept out of the runner's logs), and only
+// with HostSerial::echo set
+class HostSerial : public Stream {
+public:
+  static bool echo;
+
+  void begin(unsigned long) {}
+  explicit operator bool() const { return true; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,261 @@
+#include "Arduino.h"
+#include "SPI.h"
+#include "SD.h"
+#include "../MockBoard.h"
+
+#include <stdarg.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// =============================================================================
+// Simulated Clock
+// Reading the clock and touching a pin cost a little time, so spin loops on
+// micros() end and bus writes take time the way they do on a board
+// =============================================================================
+
+static const uint64_t CLOCK_READ_NS = 250;
+static const uint64_t PIN_ACCESS_NS = 100;
+static const uint64_t SPI_BYTE_NS = 1000;   // 8 bits at 8MHz
+
+static uint64_t nanos_ = 0;
+
+namespace HostClock {
+  uint64_t nanos() { return nanos_; }
+  void advance(uint64_t ns) { nanos_ += ns; }
+}
+
+uint32_t micros() {
+  nanos_ += CLOCK_READ_NS;
+  return (uint32_t)(nanos_ / 1000);
+}
+
+uint32_t millis() {
+  nanos_ += CLOCK_READ_NS;
+  return (uint32_t)(nanos_ / 1000000);
+}
+
+void delay(uint32_t ms) {
+  nanos_ += (uint64_t)ms * 1000000;
+}
+
+void delayMicroseconds(uint32_t us) {
+  nanos_ += (uint64_t)us * 1000;
+}
+
+// =============================================================================
+// Pins and SPI
+// =============================================================================
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  nanos_ += PIN_ACCESS_NS;
+  MockBoard::pinWrite(pin, level);
+}
+
+int digitalRead(uint8_t pin) {
+  nanos_ += PIN_ACCESS_NS;
+  return MockBoard::pinRead(pin);
+}
+
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  nanos_ += SPI_BYTE_NS;
+  MockBoard::spiTransfer(data);
+  return 0;
+}
+
+// =============================================================================
+// Serial
+// =============================================================================
+
+HostSerial Serial;
+bool HostSerial::echo = false;
+
+size_t HostSerial::write(uint8_t c) {
+  if (echo) fputc(c, stderr);
+  return 1;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return print(buffer);
+}
+
+// =============================================================================
+// SD Card
+// =============================================================================
+
+SDClass SD;
+
+void File::take(File& other) {
+  file_ = other.file_;
+  dir_ = other.dir_;
+  size_ = other.size_;
+  memcpy(path_, other.path_, sizeof(path_));
+  memcpy(name_, other.name_, sizeof(name_));
+  other.file_ = nullptr;
+  other.dir_ = nullptr;
+}
+
+int File::read() {
+  return file_ ? fgetc(file_) : -1;
+}
+
+int File::read(void* buffer, size_t length) {
+  return file_ ? (int)fread(buffer, 1, length, file_) : -1;
+}
+
+int File::peek() {
+  if (!file_) return -1;
+  int c = fgetc(file_);
+  if (c != EOF) ungetc(c, file_);
+  return c;
+}
+
+int File::available() {
+  if (!file_) return 0;
+  long pos = ftell(file_);
+  return pos < (long)size_ ? (int)(size_ - pos) : 0;
+}
+
+size_t File::write(const uint8_t* buffer, size_t length) {
+  if (!file_) return 0;
+  size_t n = fwrite(buffer, 1, length, file_);
+  long end = ftell(file_);
+  if (end > (long)size_) size_ = (uint32_t)end;
+  return n;
+}
+
+void File::flush() {
+  if (file_) fflush(file_);
+}
+
+bool File::seek(uint32_t position) {
+  return file_ && position <= size_ && fseek(file_, (long)position, SEEK_SET) == 0;
+}
+
+uint32_t File::position() {
+  return file_ ? (uint32_t)ftell(file_) : 0;
+}
+
+void File::close() {
+  if (file_) fclose(file_);
+  if (dir_) closedir((DIR*)dir_);
+  file_ = nullptr;
+  dir_ = nullptr;
+}
+
+File File::openNextFile(uint8_t mode) {
+  File entry;
+  if (!dir_) return entry;
+
+  struct dirent* de;
+  while ((de = readdir((DIR*)dir_)) != nullptr) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+    char path[sizeof(path_)];
+    int length = snprintf(path, sizeof(path), "%.255s/%.255s", path_, de->d_name);
+    if (length < 0 || (size_t)length >= sizeof(path)) continue;
+
+    struct stat st;
+    if (stat(path, &st) != 0) continue;
+    if (S_ISDIR(st.st_mode)) {
+      entry.dir_ = opendir(path);
+      entry.size_ = 0;
+    } else {
+      entry.file_ = fopen(path, mode == FILE_WRITE ? "r+b" : "rb");
+      entry.size_ = (uint32_t)st.st_size;
+    }
+    if (!entry) continue;
+    snprintf(entry.path_, sizeof(entry.path_), "%s", path);
+    snprintf(entry.name_, sizeof(entry.name_), "%s", de->d_name);
+    break;
+  }
+  return entry;
+}
+
+void File::rewindDirectory() {
+  if (dir_) rewinddir((DIR*)dir_);
+}
+
+void SDClass::setRoot(const char* dir) {
+  snprintf(root_, sizeof(root_), "%s", dir);
+}
+
+bool SDClass::begin(uint8_t) {
+  struct stat st;
+  mounted_ = root_[0] != '\0' && stat(root_, &st) == 0 && S_ISDIR(st.st_mode);
+  return mounted_;
+}
+
+void SDClass::hostPath(const char* path, char* out, size_t size) const {
+  while (*path == '/') path++;
+  size_t n = strlen(root_);
+  if (n + 1 >= size) n = size - 2;
+  memcpy(out, root_, n);
+  out[n] = '/';
+  strncpy(out + n + 1, path, size - n - 1);
+  out[size - 1] = '\0';
+}
+
+File SDClass::open(const char* path, uint8_t mode) {
+  File file;
+  if (!mounted_) return file;
+
+  char host[sizeof(file.path_)];
+  hostPath(path, host, sizeof(host));
+  struct stat st;
+  bool exists = stat(host, &st) == 0;
+
+  if (exists && S_ISDIR(st.st_mode)) {
+    file.dir_ = opendir(host);
+  } else if (mode == FILE_WRITE) {
+    // Like the Arduino SD library: create if missing, write at the end
+    file.file_ = fopen(host, exists ? "r+b" : "w+b");
+    if (file.file_) {
+      fseek(file.file_, 0, SEEK_END);
+      file.size_ = (uint32_t)ftell(file.file_);
+    }
+  } else if (exists) {
+    file.file_ = fopen(host, "rb");
+    file.size_ = (uint32_t)st.st_size;
+  }
+  if (!file) return file;
+
+  snprintf(file.path_, sizeof(file.path_), "%s", host);
+  const char* slash = strrchr(path, '/');
+  snprintf(file.name_, sizeof(file.name_), "%s", slash ? slash + 1 : path);
+  return file;
+}
+
+bool SDClass::exists(const char* path) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  struct stat st;
+  return mounted_ && stat(host, &st) == 0;
+}
+
+bool SDClass::remove(const char* path) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  return mounted_ && unlink(host) == 0;
+}
+
+bool SDClass::mkdir(const char* path) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  return mounted_ && ::mkdir(host, 0755) == 0;
+}
+
+bool SDClass::rmdir(const char* path) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  return mounted_ && ::rmdir(host) == 0;
+}
@@ -0,0 +1,82 @@
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include "Arduino.h"
+
+// =============================================================================
+// Host SD Library - card paths map into a directory on the host
+// (SD.setRoot(), the corpus directory in the test runner)
+// =============================================================================
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+
+class File {
+public:
+  File() : file_(nullptr), dir_(nullptr), size_(0) { path_[0] = name_[0] = '\0'; }
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+  File(File&& other) { take(other); }
+  File& operator=(File&& other) {
+    if (this != &other) {
+      close();
+      take(other);
+    }
+    return *this;
+  }
+  ~File() { close(); }
+
+  explicit operator bool() const { return file_ != nullptr || dir_ != nullptr; }
+
+  int read();
+  int read(void* buffer, size_t length);
+  int peek();
+  int available();
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t* buffer, size_t length);
+  void flush();
+  bool seek(uint32_t position);
+  uint32_t position();
+  uint32_t size() { return size_; }
+  void close();
+
+  const char* name() const { return name_; }
+  bool isDirectory() const { return dir_ != nullptr; }
+  File openNextFile(uint8_t mode = FILE_READ);
+  void rewindDirectory();
+
+private:
+  friend class SDClass;
+  void take(File& other);
+
+  FILE* file_;
+  void* dir_;            // DIR* for directories
+  uint32_t size_;
+  char path_[512];       // Host path
+  char name_[256];       // Card name (last component)
+};
+
+class SDClass {
+public:
+  SDClass() : mounted_(false) { root_[0] = '\0'; }
+
+  // Host directory the card's root maps to
+  void setRoot(const char* dir);
+
+  bool begin(uint8_t csPin = 0);
+  File open(const char* path, uint8_t mode = FILE_READ);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool mkdir(const char* path);
+  bool rmdir(const char* path);
+
+private:
+  void hostPath(const char* path, char* out, size_t size) const;
+
+  bool mounted_;
+  char root_[512];
+};
+
+extern SDClass SD;
+
+#endif // HOST_SD_H
@@ -0,0 +1,25 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0
+
+struct SPISettings {
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+// Bytes go to MockBoard's shift register
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+  void beginTransaction(const SPISettings&) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif // HOST_SPI_H
@@ -0,0 +1,36 @@
+# Run genesis_host_run --digest and compare its output with a golden log
+# -DRUNNER, -DCARD, -DARGS (runner options and files), -DGOLDEN, -DOUTPUT
+# With GENESIS_UPDATE_GOLDEN set in the environment, the golden is rewritten.
+
+get_filename_component(output_dir ${OUTPUT} DIRECTORY)
+file(MAKE_DIRECTORY ${output_dir})
+
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+execute_process(
+  COMMAND ${RUNNER} --digest ${CARD} ${args}
+  OUTPUT_FILE ${OUTPUT}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "genesis_host_run failed (${result})")
+endif()
+
+if(DEFINED ENV{GENESIS_UPDATE_GOLDEN})
+  configure_file(${OUTPUT} ${GOLDEN} COPYONLY)
+  message(STATUS "Updated ${GOLDEN}")
+  return()
+endif()
+
+if(NOT EXISTS ${GOLDEN})
+  message(FATAL_ERROR "No golden log ${GOLDEN} (run with GENESIS_UPDATE_GOLDEN=1 to create it)")
+endif()
+
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E compare_files ${GOLDEN} ${OUTPUT}
+  RESULT_VARIABLE different)
+if(different)
+  find_program(DIFF diff)
+  if(DIFF)
+    execute_process(COMMAND ${DIFF} -u ${GOLDEN} ${OUTPUT})
+  endif()
+  message(FATAL_ERROR "Writes differ from ${GOLDEN} (output: ${OUTPUT})")
+endif()
@@ -0,0 +1,334 @@
+// =============================================================================
+// genesis_host_run - play VGM/VGZ files through the library on the host
+//
+// The real GenesisEngine and GenesisBoard run against the host core in
+// test/host/arduino; MockBoard turns the pins back into chip writes. Time is
+// simulated, so the same file always gives the same writes at the same
+// times. See test/host/README.md.
+//
+// Usage: genesis_host_run [options] <card dir> <file> [<file>...]
+//   Options can go anywhere. Files are card paths (relative to the card
+//   dir): the first one is played, each following one is enqueue()d once
+//   the one before it starts.
+//   --queued       Queued playback (default: direct)
+//   --ram          Load the first file (.vgm) into memory and play() it
+//   --loop         Looping on
+//   --seconds N    Stop after N seconds (default: play to the end)
+//   --readback     Board with YM2612 status read-back (RD_Y and busy pins)
+//   --log          Print every write
+//   --digest       Print a summary per second of playback (the golden logs)
+//   --bench        Print host time and the playback profile
+//   --serial       Show the library's Serial output (on stderr)
+// =============================================================================
+
+#include <Arduino.h>
+#include <SD.h>
+#include <GenesisBoard.h>
+#include <GenesisEngine.h>
+#include "MockBoard.h"
+
+#include <chrono>
+#include <vector>
+
+// Pins the host board is wired to
+static const uint8_t PIN_WR_P = 2;
+static const uint8_t PIN_WR_Y = 3;
+static const uint8_t PIN_IC_Y = 4;
+static const uint8_t PIN_A0_Y = 5;
+static const uint8_t PIN_A1_Y = 6;
+static const uint8_t PIN_SCK = 7;
+static const uint8_t PIN_SDI = 8;
+static const uint8_t PIN_RD_Y = 9;
+static const uint8_t PIN_BUSY = 10;
+
+// Time a sketch's loop() spends outside update()
+static const uint64_t LOOP_NS = 2000;
+
+static const uint64_t NANOS_PER_SECOND = 1000000000ULL;
+
+// -----------------------------------------------------------------------------
+// Options
+// -----------------------------------------------------------------------------
+
+struct Options {
+  bool queued = false;
+  bool ram = false;
+  bool loop = false;
+  bool readback = false;
+  bool log = false;
+  bool digest = false;
+  bool bench = false;
+  bool serial = false;
+  uint32_t seconds = 0;
+  const char* card = nullptr;
+  std::vector<const char*> files;
+};
+
+static void usage() {
+  fprintf(stderr,
+          "usage: genesis_host_run [--queued] [--ram] [--loop] [--seconds N]\n"
+          "                        [--readback] [--log] [--digest] [--bench] [--serial]\n"
+          "                        <card dir> <file> [<file>...]\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--queued") == 0) {
+      options.queued = true;
+    } else if (strcmp(arg, "--ram") == 0) {
+      options.ram = true;
+    } else if (strcmp(arg, "--loop") == 0) {
+      options.loop = true;
+    } else if (strcmp(arg, "--readback") == 0) {
+      options.readback = true;
+    } else if (strcmp(arg, "--log") == 0) {
+      options.log = true;
+    } else if (strcmp(arg, "--digest") == 0) {
+      options.digest = true;
+    } else if (strcmp(arg, "--bench") == 0) {
+      options.bench = true;
+    } else if (strcmp(arg, "--serial") == 0) {
+      options.serial = true;
+    } else if (strcmp(arg, "--seconds") == 0 && i + 1 < argc) {
+      options.seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (arg[0] == '-') {
+      return false;
+    } else if (!options.card) {
+      options.card = arg;
+    } else {
+      options.files.push_back(arg);
+    }
+  }
+  return options.card && !options.files.empty();
+}
+
+// -----------------------------------------------------------------------------
+// Write Log
+// The digest is one line per second of playback: the writes of each kind and
+// an FNV-1a hash of every write (chip, kind, port, register, value) in order.
+// Write times only decide which second a write falls in, so a change that
+// moves writes by a few microseconds doesn't touch the goldens, but one that
+// drops, reorders or delays them does.
+// -----------------------------------------------------------------------------
+
+struct Digest {
+  uint64_t start;      // Host clock playback started at
+  uint32_t second;     // Second being summed
+  uint32_t ym;
+  uint32_t psg;
+  uint32_t dac;
+  uint32_t hash;
+  uint32_t total;
+};
+
+static Options options_;
+static Digest digest_;
+
+static void resetDigest() {
+  digest_.ym = digest_.psg = digest_.dac = 0;
+  digest_.hash = 2166136261u;
+}
+
+static void hashByte(uint8_t b) {
+  digest_.hash = (digest_.hash ^ b) * 16777619u;
+}
+
+static void flushDigest() {
+  if (options_.digest && (digest_.ym || digest_.psg)) {
+    printf("t %u ym %u psg %u dac %u hash %08x\n", digest_.second,
+           digest_.ym, digest_.psg, digest_.dac, digest_.hash);
+  }
+  resetDigest();
+}
+
+static void onWrite(const MockBoard::Write& write, void*) {
+  uint64_t elapsed = write.nanos - digest_.start;
+  if (options_.log) {
+    printf("%llu %u ", (unsigned long long)(elapsed / 1000), write.chip);
+    switch (write.type) {
+      case MockBoard::WRITE_YM:
+        printf("ym %u %02x %02x\n", write.port, write.reg, write.val);
+        break;
+      case MockBoard::WRITE_PSG:
+        printf("psg %02x\n", write.val);
+        break;
+      default:
+        printf("reset\n");
+        break;
+    }
+  }
+
+  uint32_t second = (uint32_t)(elapsed / NANOS_PER_SECOND);
+  if (second != digest_.second) {
+    flushDigest();
+    digest_.second = second;
+  }
+  if (write.type == MockBoard::WRITE_YM) {
+    digest_.ym++;
+    if (write.port == 0 && write.reg == 0x2A) {
+      digest_.dac++;
+    }
+  } else if (write.type == MockBoard::WRITE_PSG) {
+    digest_.psg++;
+  }
+  hashByte(write.chip);
+  hashByte(write.type);
+  hashByte(write.port);
+  hashByte(write.reg);
+  hashByte(write.val);
+  digest_.total++;
+}
+
+// Profile output goes to stdout
+class StdoutPrint : public Print {
+public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  using Print::write;
+};
+
+// -----------------------------------------------------------------------------
+// Playback
+// -----------------------------------------------------------------------------
+
+static const char* stateName(const GenesisEngine& engine) {
+  if (engine.isFinished()) return "finished";
+  if (engine.isStopped()) return "stopped";
+  if (engine.isPaused()) return "paused";
+  return "playing";
+}
+
+static std::vector<uint8_t> loadFile(const char* card, const char* path) {
+  std::vector<uint8_t> data;
+  char host[1024];
+  snprintf(host, sizeof(host), "%s/%s", card, path);
+  FILE* file = fopen(host, "rb");
+  if (!file) {
+    return data;
+  }
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(file);
+  return data;
+}
+
+int main(int argc, char** argv) {
+  if (!parseOptions(argc, argv, options_)) {
+    usage();
+    return 2;
+  }
+
+  MockBoard::Pins pins = { PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y,
+                           GenesisBoard::NO_PIN, GenesisBoard::NO_PIN,
+                           { GenesisBoard::NO_PIN } };
+  if (options_.readback) {
+    pins.rdY = PIN_RD_Y;
+    pins.busy = PIN_BUSY;
+  }
+  HostSerial::echo = options_.serial;
+  MockBoard::clear();
+  MockBoard::addChip(pins);
+  MockBoard::setListener(onWrite, nullptr);
+
+  GenesisBoard board = options_.readback
+    ? GenesisBoard(PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y, PIN_SCK, PIN_SDI,
+                   PIN_RD_Y, PIN_BUSY)
+    : GenesisBoard(PIN_WR_P, PIN_WR_Y, PIN_IC_Y, PIN_A0_Y, PIN_A1_Y, PIN_SCK, PIN_SDI);
+  GenesisEngine engine(board);
+  board.begin();
+
+  SD.setRoot(options_.card);
+  if (!SD.begin()) {
+    fprintf(stderr, "genesis_host_run: no card directory %s\n", options_.card);
+    return 2;
+  }
+
+  engine.setLooping(options_.loop);
+  if (options_.queued && !engine.setQueuedPlayback(true)) {
+    fprintf(stderr, "genesis_host_run: queued playback unavailable\n");
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  digest_.start = HostClock::nanos();
+  digest_.second = 0;
+  digest_.total = 0;
+  resetDigest();
+
+  bool started;
+  if (options_.ram) {
+    data = loadFile(options_.card, options_.files[0]);
+    started = !data.empty() && engine.play(data.data(), data.size());
+  } else {
+    started = engine.playFile(options_.files[0]);
+  }
+  if (!started) {
+    fprintf(stderr, "genesis_host_run: can't play %s\n", options_.files[0]);
+    return 1;
+  }
+
+  size_t next = 1;
+  uint16_t track = engine.getTrackNumber();
+  if (next < options_.files.size()) {
+    engine.enqueue(options_.files[next++]);
+  }
+
+  auto hostStart = std::chrono::steady_clock::now();
+  uint64_t limit = (uint64_t)options_.seconds * NANOS_PER_SECOND;
+
+  while (true) {
+    engine.update();
+
+    if (engine.getTrackNumber() != track) {
+      track = engine.getTrackNumber();
+      flushDigest();
+      if (options_.digest) {
+        printf("track %u\n", track);
+      }
+      if (next < options_.files.size()) {
+        engine.enqueue(options_.files[next++]);
+      }
+    }
+    if (!engine.isPlaying()) {
+      break;
+    }
+    if (limit && HostClock::nanos() - digest_.start >= limit) {
+      engine.stop();
+      break;
+    }
+
+    // The sketch's loop(), then the wait until the next write is due
+    HostClock::advance(LOOP_NS);
+    uint32_t due = engine.microsUntilDue();
+    if (due == GenesisEngine::NOTHING_DUE) {
+      break;
+    }
+    HostClock::advance((uint64_t)due * 1000);
+  }
+  flushDigest();
+
+  uint64_t played = HostClock::nanos() - digest_.start;
+  if (options_.digest) {
+    printf("end t %llu writes %u state %s enqueueFailed %d reads %s\n",
+           (unsigned long long)(played / 1000000), digest_.total, stateName(engine),
+           engine.enqueueFailed() ? 1 : 0,
+           MockBoard::getStatusReads() ? "yes" : "no");
+  }
+
+  if (options_.bench) {
+    double hostMs = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - hostStart).count();
+    printf("%s: %.1f s played in %.1f ms host time (%.0fx), %u writes\n",
+           options_.files[0], played / 1e9, hostMs,
+           hostMs > 0 ? played / 1e6 / hostMs : 0.0, digest_.total);
+#if GENESIS_ENGINE_USE_PROFILING
+    StdoutPrint out;
+    engine.printProfile(out);
+#endif
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,336 @@
+// Native VGM preprocessing for vgm_preprocess.py
+// Same loops as the Python fallback there, output byte for byte the same.
+// Plain CPython API so it builds with nothing but a compiler (see
+// build_vgm_preprocess.py).
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+static const uint32_t FRAME_SAMPLES_NTSC = 735;
+static const uint32_t FRAME_SAMPLES_PAL = 882;
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool isSkipped(uint8_t cmd) {
+    switch (cmd) {
+        case 0x50: case 0x52: case 0x53: case 0x61: case 0x62: case 0x63:
+        case 0x66: case 0x67: case 0xE0:
+            return false;
+        default:
+            return cmd < 0x70 || cmd > 0x8F;
+    }
+}
+
+// =============================================================================
+// scan(data, data_offset)
+// -> (pcm_start, pcm_size, psg, dac, waits, wait_bytes, ends, register_counts)
+// =============================================================================
+
+static PyObject* scan(PyObject*, PyObject* args) {
+    Py_buffer buf;
+    Py_ssize_t pos;
+    if (!PyArg_ParseTuple(args, "y*n", &buf, &pos)) {
+        return nullptr;
+    }
+
+    const uint8_t* data = (const uint8_t*)buf.buf;
+    const Py_ssize_t end = buf.len;
+    Py_ssize_t pcmStart = -1, pcmSize = 0;
+    long psg = 0, dac = 0, waits = 0, waitBytes = 0, ends = 0;
+    long counts[512] = {0};
+
+    Py_BEGIN_ALLOW_THREADS
+    while (pos < end) {
+        uint8_t cmd = data[pos];
+        if (isSkipped(cmd)) {
+            pos += 1;
+        } else if (cmd == 0x52 || cmd == 0x53) {
+            if (pos + 1 < end) {
+                counts[((cmd - 0x52) << 8) | data[pos + 1]]++;
+            }
+            pos += 3;
+        } else if (cmd >= 0x80 && cmd <= 0x8F) {
+            dac++;
+            pos += 1;
+        } else if ((cmd >= 0x70 && cmd <= 0x7F) || cmd == 0x62 || cmd == 0x63) {
+            waits++;
+            waitBytes += 1;
+            pos += 1;
+        } else if (cmd == 0x50) {
+            psg++;
+            pos += 2;
+        } else if (cmd == 0x61) {
+            waits++;
+            waitBytes += 3;
+            pos += 3;
+        } else if (cmd == 0xE0) {
+            pos += 5;
+        } else if (cmd == 0x67) {
+            if (pos + 7 > end) {
+                break;
+            }
+            Py_ssize_t blockSize = readU32(data + pos + 3);
+            if (data[pos + 2] == 0x00) {
+                pcmStart = pos + 7;
+                pcmSize = blockSize < end - pcmStart ? blockSize : end - pcmStart;
+            }
+            pos += 7 + blockSize;
+        } else {  // 0x66
+            ends = 1;
+            break;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&buf);
+
+    PyObject* list = PyList_New(512);
+    if (!list) {
+        return nullptr;
+    }
+    for (int i = 0; i < 512; i++) {
+        PyList_SET_ITEM(list, i, PyLong_FromLong(counts[i]));
+    }
+    return Py_BuildValue("nnlllllN", pcmStart, pcmSize, psg, dac, waits, waitBytes, ends, list);
+}
+
+// =============================================================================
+// prepare(data, data_offset, loop_offset, pcm, dac_rate, no_dac,
+//         psg_attenuation, merge_waits, end_marker)
+// -> (stream, loop_offset or None, commands)
+// =============================================================================
+
+// Shortest encoding of a merged wait. Returns the commands written.
+static long emitWait(std::string& out, uint32_t total) {
+    long n = 0;
+    while (total > 0) {
+        n++;
+        if (total >= FRAME_SAMPLES_NTSC * 2 && total % FRAME_SAMPLES_NTSC == 0) {
+            uint32_t frames = total / FRAME_SAMPLES_NTSC;
+            if (frames > 255) {
+                frames = 255;
+            }
+            out += (char)0xC0;
+            out += (char)frames;
+            total -= frames * FRAME_SAMPLES_NTSC;
+        } else if (total == FRAME_SAMPLES_NTSC) {
+            out += (char)0x62;
+            total = 0;
+        } else if (total == FRAME_SAMPLES_PAL) {
+            out += (char)0x63;
+            total = 0;
+        } else if (total <= 16) {
+            out += (char)(0x70 + total - 1);
+            total = 0;
+        } else {
+            uint32_t samples = total < 65535 ? total : 65535;
+            out += (char)0x61;
+            out += (char)(samples & 0xFF);
+            out += (char)(samples >> 8);
+            total -= samples;
+        }
+    }
+    return n;
+}
+
+static PyObject* prepare(PyObject*, PyObject* args) {
+    Py_buffer buf, pcmBuf;
+    Py_ssize_t pos, loopAt;
+    int dacRate, noDac, attenuation, merge, endMarker;
+    if (!PyArg_ParseTuple(args, "y*nny*ipipp", &buf, &pos, &loopAt, &pcmBuf, &dacRate,
+                          &noDac, &attenuation, &merge, &endMarker)) {
+        return nullptr;
+    }
+    if (loopAt == 0) {
+        loopAt = -1;
+    }
+    if (noDac || dacRate < 1) {
+        dacRate = 1;
+    }
+
+    const uint8_t* data = (const uint8_t*)buf.buf;
+    const Py_ssize_t end = buf.len;
+    const uint8_t* pcm = (const uint8_t*)pcmBuf.buf;
+    const uint64_t pcmSize = pcmBuf.len;
+    uint64_t pcmPos = 0;
+    uint32_t dacCount = 0;
+
+    std::string out;
+    long commands = 0;
+    int64_t run = -1;           // Samples in the run of waits being merged, -1 = none
+    bool loopPending = false;   // Loop point reached, no command written since
+    Py_ssize_t loopOffset = -1;
+    bool truncated = false;
+
+    Py_BEGIN_ALLOW_THREADS
+    out.reserve(end - pos + 1024);
+
+    // Flush the merged run and mark the loop ahead of the next command
+    auto beforeCommand = [&]() {
+        if (run >= 0) {
+            commands += emitWait(out, (uint32_t)run);
+            run = -1;
+        }
+        if (loopPending) {
+            loopOffset = out.size();
+            loopPending = false;
+        }
+    };
+
+    while (pos < end) {
+        if (pos == loopAt) {
+            loopPending = true;
+            loopAt = -1;
+        }
+
+        uint8_t cmd = data[pos];
+        if (isSkipped(cmd)) {
+            pos += 1;
+            continue;
+        }
+
+        uint32_t samples;
+        if (cmd >= 0x70 && cmd <= 0x7F) {
+            samples = (cmd & 0x0F) + 1;
+            pos += 1;
+        } else if (cmd == 0x61) {
+            if (pos + 3 > end) {
+                truncated = true;
+                break;
+            }
+            samples = data[pos + 1] | (data[pos + 2] << 8);
+            pos += 3;
+        } else if (cmd == 0x62) {
+            samples = FRAME_SAMPLES_NTSC;
+            pos += 1;
+        } else if (cmd == 0x63) {
+            samples = FRAME_SAMPLES_PAL;
+            pos += 1;
+        } else if (cmd >= 0x80 && cmd <= 0x8F) {
+            uint8_t sample = 0x80;
+            if (pcmPos < pcmSize) {
+                sample = pcm[pcmPos++];
+            }
+            pos += 1;
+
+            if (!noDac) {
+                dacCount++;
+                if (dacRate == 1 || dacCount % dacRate == 1) {
+                    beforeCommand();
+                    out += (char)cmd;
+                    out += (char)sample;
+                    commands++;
+                    continue;
+                }
+            }
+
+            // Dropped sample - keep its wait
+            samples = cmd & 0x0F;
+            if (!samples) {
+                continue;
+            }
+            cmd = 0x70 + samples - 1;
+        } else {
+            // Everything else is a command of its own
+            if (cmd == 0x67) {
+                if (pos + 7 > end) {
+                    truncated = true;
+                    break;
+                }
+                pos += 7 + (Py_ssize_t)readU32(data + pos + 3);
+                continue;
+            }
+            if (cmd == 0xE0) {
+                if (pos + 5 <= end) {
+                    pcmPos = readU32(data + pos + 1);
+                }
+                pos += 5;
+                continue;
+            }
+
+            beforeCommand();
+
+            if (cmd == 0x66) {
+                if (endMarker) {
+                    out += (char)0x66;
+                    commands++;
+                }
+                break;
+            }
+            Py_ssize_t length = cmd == 0x50 ? 2 : 3;
+            if (pos + length > end) {
+                truncated = true;
+                break;
+            }
+            if (cmd == 0x50) {
+                uint8_t value = data[pos + 1];
+                if (attenuation && (value & 0x90) == 0x90 && (value & 0x0F) != 0x0F) {
+                    int level = (value & 0x0F) + attenuation;
+                    value = (value & 0xF0) | (level < 14 ? level : 14);
+                }
+                out += (char)0x50;
+                out += (char)value;
+                pos += 2;
+            } else {
+                out.append((const char*)data + pos, 3);
+                pos += 3;
+            }
+            commands++;
+            continue;
+        }
+
+        // A wait
+        if (loopPending) {
+            beforeCommand();
+        }
+        if (merge) {
+            run = run < 0 ? samples : run + samples;
+        } else {
+            if (cmd == 0x61) {
+                out.append((const char*)data + pos - 3, 3);
+            } else {
+                out += (char)cmd;
+            }
+            commands++;
+        }
+    }
+
+    if (run >= 0) {
+        commands += emitWait(out, (uint32_t)run);
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&buf);
+    PyBuffer_Release(&pcmBuf);
+
+    if (truncated) {
+        PyErr_SetString(PyExc_ValueError, "VGM data ends inside a command");
+        return nullptr;
+    }
+
+    PyObject* loop = loopOffset >= 0 ? PyLong_FromSsize_t(loopOffset) : (Py_INCREF(Py_None), Py_None);
+    return Py_BuildValue("y#Nl", out.data(), (Py_ssize_t)out.size(), loop, commands);
+}
+
+// =============================================================================
+// Module
+// =============================================================================
+
+static PyMethodDef methods[] = {
+    {"scan", scan, METH_VARARGS, "Walk a VGM for its PCM block and command counts."},
+    {"prepare", prepare, METH_VARARGS, "Fused VGM to stream bytes pass."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "_vgm_preprocess", "Native VGM preprocessing", -1, methods
+};
+
+PyMODINIT_FUNC PyInit__vgm_preprocess() {
+    return PyModule_Create(&module);
+}
@@ -0,0 +1,67 @@
+"""Build script for the native VGM preprocessing module (_vgm_preprocess).
+
+Optional: vgm_preprocess.py falls back to Python without it, just slower.
+Needs only a C++ compiler and the Python headers.
+"""
+
+import subprocess
+import sys
+import os
+import sysconfig
+
+def build():
+    # Get paths
+    this_dir = os.path.dirname(os.path.abspath(__file__))
+    source_cpp = os.path.join(this_dir, "_vgm_preprocess.cpp")
+
+    # Get Python include and lib paths
+    python_include = sysconfig.get_paths()["include"]
+    python_libs = os.path.join(sys.prefix, "libs")
+
+    # Output file
+    suffix = sysconfig.get_config_var("EXT_SUFFIX") or (".pyd" if sys.platform == "win32" else ".so")
+    output = os.path.join(this_dir, f"_vgm_preprocess{suffix}")
+
+    print(f"Building VGM preprocessing module...")
+    print(f"  Python headers: {python_include}")
+    print(f"  Output: {output}")
+
+    if sys.platform == "win32":
+        # Windows: Use cl.exe (MSVC)
+        cmd = [
+            "cl", "/O2", "/EHsc", "/std:c++17", "/LD",
+            f"/I{python_include}",
+            source_cpp,
+            f"/Fe:{output}",
+            f"/link", f"/LIBPATH:{python_libs}",
+        ]
+    else:
+        # Linux/Mac: Use g++ (symbols resolve against the interpreter at import)
+        cmd = [
+            "g++", "-O3", "-shared", "-std=c++17", "-fPIC",
+            f"-I{python_include}",
+            source_cpp,
+            "-o", output,
+        ]
+        if sys.platform == "darwin":
+            cmd += ["-undefined", "dynamic_lookup"]
+
+    print(f"Command: {' '.join(cmd)}")
+
+    try:
+        result = subprocess.run(cmd, cwd=this_dir, capture_output=True, text=True)
+        if result.returncode != 0:
+            print(f"Build failed!")
+            print(result.stdout)
+            print(result.stderr)
+            return False
+        print(f"Build successful: {output}")
+        return True
+    except FileNotFoundError as e:
+        print(f"Compiler not found: {e}")
+        print("Make sure you have Visual Studio Build Tools (Windows) or g++ (Linux/Mac)")
+        return False
+
+if __name__ == "__main__":
+    success = build()
+    sys.exit(0 if success else 1)
@@ -0,0 +1,587 @@
+"""
+vgm_preprocess.py - VGM preprocessing shared by the streaming tools
+
+Turns a VGM file into the command stream the Genesis Engine sketches play:
+DAC samples inlined from the PCM data block, PSG attenuated for FM+PSG mixes,
+DAC stripped or thinned, and waits merged into the shortest encoding.
+
+The VGM is tokenized once, straight into that stream (every command has a
+fixed length, so the stream doubles as the token array), with all the passes
+fused into the same loop. The native module (_vgm_preprocess, built by
+build_vgm_preprocess.py) runs the same loop in C++; without it the Python
+version here is used, which gives identical output.
+
+For streaming, BackgroundStream prepares in a thread so sending can start
+with the first piece instead of after the whole song.
+
+Usage:
+    from vgm_preprocess import decompress_vgz, parse_vgm_header, scan_vgm, prepare_stream
+
+    data = decompress_vgz(open('song.vgz', 'rb').read())
+    header = parse_vgm_header(data)
+    stream, loop_offset = prepare_stream(data, header, scan_vgm(data, header), dac_rate=2)
+"""
+
+import gzip
+import struct
+import threading
+from collections import namedtuple
+
+try:
+    import _vgm_preprocess as _native
+except ImportError:
+    _native = None
+
+
+# =============================================================================
+# Stream Commands (match StreamingProtocol.h)
+# =============================================================================
+
+CMD_PSG_WRITE = 0x50
+CMD_YM2612_WRITE_A0 = 0x52
+CMD_YM2612_WRITE_A1 = 0x53
+CMD_WAIT_FRAMES = 0x61
+CMD_WAIT_NTSC = 0x62
+CMD_WAIT_PAL = 0x63
+CMD_END_OF_STREAM = 0x66
+CMD_RLE_WAIT_FRAME_1 = 0xC0
+
+FRAME_SAMPLES_NTSC = 735
+FRAME_SAMPLES_PAL = 882
+
+# PSG volume drop when FM and PSG play together
+PSG_MIX_ATTENUATION = 2
+
+# Bytes after the command byte, for each command the stream can hold
+STREAM_ARGS = bytearray(256)
+for _cmd, _n in ((CMD_PSG_WRITE, 1), (CMD_YM2612_WRITE_A0, 2), (CMD_YM2612_WRITE_A1, 2),
+                 (CMD_WAIT_FRAMES, 2), (CMD_RLE_WAIT_FRAME_1, 1)):
+    STREAM_ARGS[_cmd] = _n
+for _cmd in range(0x80, 0x90):
+    STREAM_ARGS[_cmd] = 1
+
+# VGM command lengths the tokenizer just skips over (0 = handled itself).
+# Unknown commands skip one byte, as the sketches' parser does.
+_VGM_SKIP = bytearray([1] * 256)
+for _cmd in (0x50, 0x52, 0x53, 0x61, 0x62, 0x63, 0x66, 0x67, 0xE0):
+    _VGM_SKIP[_cmd] = 0
+for _cmd in range(0x70, 0x90):
+    _VGM_SKIP[_cmd] = 0
+
+# VGM bytes between yields from StreamPreparer.run()
+PIECE_BYTES = 64 * 1024
+
+
+def has_native():
+    """True when the C++ module is doing the work."""
+    return _native is not None
+
+
+# =============================================================================
+# File Handling
+# =============================================================================
+
+def decompress_vgz(data):
+    """Decompress VGZ if needed."""
+    if data[:2] == b'\x1f\x8b':
+        return gzip.decompress(data)
+    return data
+
+
+def parse_gd3_tag(data, gd3_offset):
+    """Parse GD3 tag for metadata (title, composer, etc.)."""
+    if gd3_offset == 0 or gd3_offset >= len(data):
+        return {}
+
+    # Check GD3 signature
+    if data[gd3_offset:gd3_offset + 4] != b'Gd3 ':
+        return {}
+
+    # GD3 data starts after signature (4), version (4), and length (4)
+    gd3_data_start = gd3_offset + 12
+    gd3_length = struct.unpack('<I', data[gd3_offset + 8:gd3_offset + 12])[0]
+    gd3_data = data[gd3_data_start:gd3_data_start + gd3_length]
+
+    # Parse UTF-16LE strings separated by null terminators
+    # Order: track_en, track_jp, game_en, game_jp, system_en, system_jp,
+    #        author_en, author_jp, date, creator, notes
+    try:
+        strings = gd3_data.decode('utf-16-le').split('\x00')
+    except UnicodeDecodeError:
+        return {}
+
+    result = {}
+    if len(strings) > 0 and strings[0]:
+        result['title'] = strings[0]
+    if len(strings) > 2 and strings[2]:
+        result['game'] = strings[2]
+    if len(strings) > 6 and strings[6]:
+        result['composer'] = strings[6]
+
+    return result
+
+
+def parse_vgm_header(data):
+    """Parse VGM header."""
+    if data[:4] != b'Vgm ':
+        return None
+
+    version = struct.unpack('<I', data[0x08:0x0C])[0]
+    total_samples = struct.unpack('<I', data[0x18:0x1C])[0]
+
+    # GD3 offset is relative to 0x14
+    gd3_offset_rel = struct.unpack('<I', data[0x14:0x18])[0]
+    gd3_offset = (0x14 + gd3_offset_rel) if gd3_offset_rel else 0
+
+    # Loop offset is relative to 0x1C
+    loop_offset_rel = struct.unpack('<I', data[0x1C:0x20])[0]
+    loop_offset = (0x1C + loop_offset_rel) if loop_offset_rel else 0
+
+    # Loop samples (how long the loop section is)
+    loop_samples = struct.unpack('<I', data[0x20:0x24])[0]
+
+    if version >= 0x150:
+        data_offset_rel = struct.unpack('<I', data[0x34:0x38])[0]
+        data_offset = 0x34 + data_offset_rel if data_offset_rel else 0x40
+    else:
+        data_offset = 0x40
+
+    # Parse GD3 metadata
+    gd3 = parse_gd3_tag(data, gd3_offset)
+
+    return {
+        'version': version,
+        'data_offset': data_offset,
+        'total_samples': total_samples,
+        'duration': total_samples / 44100.0,
+        'loop_offset': loop_offset,
+        'loop_samples': loop_samples,
+        'title': gd3.get('title', ''),
+        'game': gd3.get('game', ''),
+        'composer': gd3.get('composer', ''),
+    }
+
+
+# =============================================================================
+# Scan
+# =============================================================================
+
+VgmScan = namedtuple('VgmScan', [
+    'pcm',              # PCM data block for the 0x80-0x8F commands (or None)
+    'has_psg',
+    'has_ym2612',       # FM or DAC
+    'commands',         # Commands in the stream before any pass
+    'stream_bytes',     # Their size
+    'register_counts',  # (port, reg) -> YM2612 writes
+])
+
+
+def scan_vgm(data, header):
+    """Walk the VGM once for what the passes need to know up front.
+
+    The PCM data is the last type 0x00 data block before the end.
+
+    Returns: VgmScan
+    """
+    if _native is not None:
+        pcm_start, pcm_size, psg, dac, waits, wait_bytes, ends, counts = \
+            _native.scan(data, header['data_offset'])
+        pcm = data[pcm_start:pcm_start + pcm_size] if pcm_start >= 0 else None
+    else:
+        pcm, psg, dac, waits, wait_bytes, ends, counts = _scan_python(data, header['data_offset'])
+
+    ym = sum(counts)
+    register_counts = {(i >> 8, i & 0xFF): n for i, n in enumerate(counts) if n}
+    return VgmScan(pcm, psg > 0, ym > 0 or dac > 0,
+                   psg + ym + dac + waits + ends,
+                   psg * 2 + ym * 3 + dac * 2 + wait_bytes + ends,
+                   register_counts)
+
+
+def _scan_python(data, pos):
+    pcm = None
+    psg = dac = waits = wait_bytes = ends = 0
+    counts = [0] * 512
+    skip = _VGM_SKIP
+    end = len(data)
+
+    while pos < end:
+        cmd = data[pos]
+        n = skip[cmd]
+        if n:
+            pos += n
+        elif cmd == 0x52 or cmd == 0x53:
+            counts[((cmd - 0x52) << 8) | data[pos + 1]] += 1
+            pos += 3
+        elif 0x80 <= cmd <= 0x8F:
+            dac += 1
+            pos += 1
+        elif 0x70 <= cmd <= 0x7F or cmd == 0x62 or cmd == 0x63:
+            waits += 1
+            wait_bytes += 1
+            pos += 1
+        elif cmd == 0x50:
+            psg += 1
+            pos += 2
+        elif cmd == 0x61:
+            waits += 1
+            wait_bytes += 3
+            pos += 3
+        elif cmd == 0xE0:
+            pos += 5
+        elif cmd == 0x67:
+            if pos + 7 > end:
+                break
+            block_size = struct.unpack_from('<I', data, pos + 3)[0]
+            if data[pos + 2] == 0x00:
+                pcm = data[pos + 7:pos + 7 + block_size]
+            pos += 7 + block_size
+        else:  # 0x66
+            ends = 1
+            break
+
+    return pcm, psg, dac, waits, wait_bytes, ends, counts
+
+
+# =============================================================================
+# Prepare
+# =============================================================================
+
+def _emit_wait(out, total):
+    """Shortest encoding of a merged wait. Returns the commands written."""
+    n = 0
+    while total > 0:
+        n += 1
+        if total >= FRAME_SAMPLES_NTSC * 2 and total % FRAME_SAMPLES_NTSC == 0:
+            # Multiple NTSC frames - use RLE
+            frames = min(total // FRAME_SAMPLES_NTSC, 255)
+            out.append(CMD_RLE_WAIT_FRAME_1)
+            out.append(frames)
+            total -= frames * FRAME_SAMPLES_NTSC
+        elif total == FRAME_SAMPLES_NTSC:
+            out.append(CMD_WAIT_NTSC)
+            total = 0
+        elif total == FRAME_SAMPLES_PAL:
+            out.append(CMD_WAIT_PAL)
+            total = 0
+        elif total <= 16:
+            out.append(0x70 + total - 1)
+            total = 0
+        else:
+            # General wait, split if too large
+            samples = min(total, 65535)
+            out.append(CMD_WAIT_FRAMES)
+            out.append(samples & 0xFF)
+            out.append(samples >> 8)
+            total -= samples
+    return n
+
+
+class StreamPreparer:
+    """One fused pass from VGM to stream bytes.
+
+    The passes, in the order they apply:
+      - psg_attenuation: raise PSG attenuation by this much (a silent channel
+        stays silent, the rest stop at 14). None = PSG_MIX_ATTENUATION when
+        the song has both FM and PSG, otherwise 0.
+      - no_dac: DAC + wait commands become plain waits
+      - dac_rate: keep every Nth DAC sample, the rest become plain waits
+      - merge_waits: runs of waits become the shortest encoding (never merged
+        across the loop point)
+
+    With no passes the stream holds the VGM's commands one for one.
+
+    loop_offset is the stream offset of the first command at or after the
+    VGM loop point (None without one), end_marker whether the stream ends
+    in CMD_END_OF_STREAM.
+    """
+
+    def __init__(self, data, header, scan, dac_rate=1, no_dac=False, psg_attenuation=None,
+                 merge_waits=True, end_marker=True):
+        if psg_attenuation is None:
+            psg_attenuation = PSG_MIX_ATTENUATION if scan.has_psg and scan.has_ym2612 else 0
+        self.data = data
+        self.header = header
+        self.scan = scan
+        self.dac_rate = dac_rate
+        self.no_dac = no_dac
+        self.psg_attenuation = psg_attenuation
+        self.merge_waits = merge_waits
+        self.end_marker = end_marker
+
+        self.out = bytearray()
+        self.loop_offset = None
+        self.commands = 0           # Written to out so far
+        self.fraction = 0.0         # Of the VGM done
+        self.done = False
+
+    def run(self, piece=PIECE_BYTES):
+        """Prepare into self.out, yielding after each piece."""
+        if _native is not None:
+            stream, self.loop_offset, self.commands = _native.prepare(
+                self.data, self.header['data_offset'], self.header['loop_offset'],
+                self.scan.pcm or b'', self.dac_rate, self.no_dac, self.psg_attenuation,
+                self.merge_waits, self.end_marker)
+            self.out.extend(stream)
+        else:
+            yield from self._run_python(piece)
+        self.fraction = 1.0
+        self.done = True
+        yield
+
+    def finish(self):
+        """Prepare the rest. Returns: (stream bytes, loop_offset)"""
+        for _ in self.run():
+            pass
+        return bytes(self.out), self.loop_offset
+
+    def _run_python(self, piece):
+        data = self.data
+        end = len(data)
+        pos = self.header['data_offset']
+        loop_at = self.header['loop_offset'] or -1
+        pcm = self.scan.pcm or b''
+        pcm_size = len(pcm)
+        pcm_pos = 0
+        dac_rate = 1 if self.no_dac else self.dac_rate
+        keep_dac = not self.no_dac
+        dac_count = 0
+        attenuation = self.psg_attenuation
+        merge = self.merge_waits
+
+        out = self.out
+        append = out.append
+        extend = out.extend
+        skip = _VGM_SKIP
+        commands = 0
+        run = -1                # Samples in the run of waits being merged, -1 = none
+        loop_pending = False    # Loop point reached, no command written since
+        next_yield = pos + piece
+
+        while pos < end:
+            if pos >= next_yield:
+                self.commands = commands
+                self.fraction = pos / end
+                yield
+                next_yield = pos + piece
+
+            if pos == loop_at:
+                loop_pending = True
+                loop_at = -1
+
+            cmd = data[pos]
+            n = skip[cmd]
+            if n:
+                pos += n
+                continue
+
+            # Waits: samples and the command that encodes them one for one
+            if 0x70 <= cmd <= 0x7F:
+                samples = (cmd & 0x0F) + 1
+                pos += 1
+            elif cmd == 0x61:
+                samples = data[pos + 1] | (data[pos + 2] << 8)
+                pos += 3
+            elif cmd == 0x62:
+                samples = FRAME_SAMPLES_NTSC
+                pos += 1
+            elif cmd == 0x63:
+                samples = FRAME_SAMPLES_PAL
+                pos += 1
+            elif 0x80 <= cmd <= 0x8F:
+                if pcm_pos < pcm_size:
+                    sample = pcm[pcm_pos]
+                    pcm_pos += 1
+                else:
+                    sample = 0x80
+                pos += 1
+
+                if keep_dac:
+                    dac_count += 1
+                    if dac_rate == 1 or dac_count % dac_rate == 1:
+                        if run >= 0:
+                            commands += _emit_wait(out, run)
+                            run = -1
+                        if loop_pending:
+                            self.loop_offset = len(out)
+                            loop_pending = False
+                        append(cmd)
+                        append(sample)
+                        commands += 1
+                        continue
+
+                # Dropped sample - keep its wait
+                samples = cmd & 0x0F
+                if not samples:
+                    continue
+                cmd = 0x70 + samples - 1
+            else:
+                # Everything else is a command of its own
+                if cmd == 0x67:
+                    pos += 7 + struct.unpack_from('<I', data, pos + 3)[0]
+                    continue
+                if cmd == 0xE0:
+                    if pos + 5 <= end:
+                        pcm_pos = struct.unpack_from('<I', data, pos + 1)[0]
+                    pos += 5
+                    continue
+
+                if run >= 0:
+                    commands += _emit_wait(out, run)
+                    run = -1
+                if loop_pending:
+                    self.loop_offset = len(out)
+                    loop_pending = False
+
+                if cmd == 0x66:
+                    if self.end_marker:
+                        append(CMD_END_OF_STREAM)
+                        commands += 1
+                    break
+                if cmd == 0x50:
+                    value = data[pos + 1]
+                    if attenuation and (value & 0x90) == 0x90 and (value & 0x0F) != 0x0F:
+                        value = (value & 0xF0) | min(14, (value & 0x0F) + attenuation)
+                    append(CMD_PSG_WRITE)
+                    append(value)
+                    pos += 2
+                else:
+                    extend(data[pos:pos + 3])
+                    pos += 3
+                commands += 1
+                continue
+
+            # A wait
+            if loop_pending:
+                if run >= 0:
+                    commands += _emit_wait(out, run)
+                    run = -1
+                self.loop_offset = len(out)
+                loop_pending = False
+            if merge:
+                run = samples if run < 0 else run + samples
+            else:
+                if cmd == 0x61:
+                    extend(data[pos - 3:pos])
+                else:
+                    append(cmd)
+                commands += 1
+
+        if run >= 0:
+            commands += _emit_wait(out, run)
+        self.commands = commands
+
+
+def prepare_stream(data, header, scan, **options):
+    """Stream bytes for a VGM in one go. See StreamPreparer for the options.
+
+    Returns: (stream bytes, loop_offset)
+    """
+    return StreamPreparer(data, header, scan, **options).finish()
+
+
+class BackgroundStream:
+    """Stream bytes prepared in a thread while the caller sends them.
+
+    encode, if given, turns each prepared piece into what is sent instead
+    (say, protocol v2 batches): encode(piece, loop_offset_in_piece) returns
+    (bytes, loop_offset_in_bytes), offsets None when the loop point isn't in
+    that piece. Pieces always end on a command boundary.
+
+    data grows as pieces arrive; loop_offset is set once the loop point has
+    been prepared, done once everything has.
+    """
+
+    def __init__(self, preparer, encode=None):
+        self.preparer = preparer
+        self.encode = encode
+        self.data = preparer.out if encode is None else bytearray()
+        self.loop_offset = None
+        self.error = None
+        self.done = threading.Event()
+        self._grew = threading.Condition()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def _run(self):
+        preparer = self.preparer
+        sent = 0
+        try:
+            for _ in preparer.run():
+                if self.encode is None:
+                    self.loop_offset = preparer.loop_offset
+                else:
+                    loop = preparer.loop_offset
+                    loop = loop - sent if loop is not None and loop >= sent else None
+                    piece, piece_loop = self.encode(bytes(preparer.out[sent:]), loop)
+                    sent = len(preparer.out)
+                    if piece_loop is not None:
+                        self.loop_offset = len(self.data) + piece_loop
+                    self.data.extend(piece)
+                with self._grew:
+                    self._grew.notify_all()
+        except Exception as e:
+            self.error = e
+        self.done.set()
+        with self._grew:
+            self._grew.notify_all()
+
+    def wait(self, size, timeout=None):
+        """Wait until data holds more than size bytes or everything is ready.
+
+        Returns: True if it does
+        """
+        with self._grew:
+            self._grew.wait_for(lambda: len(self.data) > size or self.done.is_set(), timeout)
+        if self.error is not None:
+            raise self.error
+        return len(self.data) > size
+
+    def estimated_size(self):
+        """Final size of data, as far as can be told yet."""
+        fraction = self.preparer.fraction
+        if self.done.is_set() or fraction <= 0:
+            return len(self.data)
+        return int(len(self.data) / fraction)
+
+
+# =============================================================================
+# Stream Helpers
+# =============================================================================
+
+def stream_commands(stream, loop_offset=None):
+    """Split stream bytes back into commands.
+
+    Returns: (commands, loop_index)
+        commands is a list of (command_byte, args) tuples, loop_index the
+        index of the command at loop_offset, or None.
+    """
+    commands = []
+    append = commands.append
+    args = STREAM_ARGS
+    loop_index = None
+    pos = 0
+    end = len(stream)
+
+    while pos < end:
+        if pos == loop_offset:
+            loop_index = len(commands)
+        cmd = stream[pos]
+        n = args[cmd]
+        append((cmd, bytes(stream[pos + 1:pos + 1 + n])))
+        pos += 1 + n
+
+    return commands, loop_index
+
+
+def preprocess_vgm(data, data_offset, loop_offset=0):
+    """The VGM's commands with DAC samples inlined, before any other pass.
+
+    Returns: (commands, loop_command_index)
+        commands is a list of (command_byte, args) tuples, loop_command_index
+        the index where the loop starts, or None if no loop point.
+    """
+    header = {'data_offset': data_offset, 'loop_offset': loop_offset}
+    scan = scan_vgm(data, header)
+    stream, loop = prepare_stream(data, header, scan, psg_attenuation=0, merge_waits=False)
+    return stream_commands(stream, loop)